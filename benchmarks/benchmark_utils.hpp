@@ -0,0 +1,122 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+#ifndef SINGULARITY_OPAC_BENCHMARKS_BENCHMARK_UTILS_
+#define SINGULARITY_OPAC_BENCHMARKS_BENCHMARK_UTILS_
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace singularity {
+namespace benchmarks {
+
+// Counts a hardware event for the calling thread with
+// perf_event_open. Reports -1 if the counter isn't available, e.g.,
+// off linux or when perf_event_paranoid forbids it.
+class HardwareCounter {
+ public:
+  enum class Event { CacheMisses, L1DReadMisses };
+
+  explicit HardwareCounter(const Event event) {
+#ifdef __linux__
+    perf_event_attr attr = {};
+    attr.size = sizeof(attr);
+    if (event == Event::CacheMisses) {
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    } else {
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_L1D |
+                    (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+  }
+  ~HardwareCounter() {
+#ifdef __linux__
+    if (fd_ >= 0) close(fd_);
+#endif
+  }
+  HardwareCounter(const HardwareCounter &) = delete;
+  HardwareCounter &operator=(const HardwareCounter &) = delete;
+
+  void Start() {
+#ifdef __linux__
+    if (fd_ >= 0) {
+      ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+  long long Stop() {
+    long long count = -1;
+#ifdef __linux__
+    if (fd_ >= 0) {
+      ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+      if (read(fd_, &count, sizeof(count)) != sizeof(count)) count = -1;
+    }
+#endif
+    return count;
+  }
+
+ private:
+  int fd_ = -1;
+};
+
+class Timer {
+ public:
+  void Start() { start_ = std::chrono::steady_clock::now(); }
+  double Stop() const {
+    std::chrono::duration<double> dt = std::chrono::steady_clock::now() - start_;
+    return dt.count();
+  }
+
+ private:
+  std::chrono::steady_clock::time_point start_;
+};
+
+// Reproducible uniform samples in [0, 1), independent of the
+// standard library implementation.
+class SplitMix64 {
+ public:
+  explicit SplitMix64(const std::uint64_t seed) : state_(seed) {}
+  double Uniform() {
+    std::uint64_t z = (state_ += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z = z ^ (z >> 31);
+    return (z >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+ private:
+  std::uint64_t state_;
+};
+
+} // namespace benchmarks
+} // namespace singularity
+
+#endif // SINGULARITY_OPAC_BENCHMARKS_BENCHMARK_UTILS_
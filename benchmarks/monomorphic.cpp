@@ -0,0 +1,141 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+// Cost of dispatch through neutrinos::Opacity, against
+// neutrinos::Monomorphic and direct calls to the model, for a
+// SpinerOpac in NonCGSUnits.
+//
+// Usage: monomorphic [NRho NT NYe Ne [nsamples]]
+//
+// The tables are small by default, so that lookups hit in cache and
+// memory traffic doesn't hide the cost of dispatch.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <ports-of-call/portability.hpp>
+
+#include <singularity-opac/base/radiation_types.hpp>
+#include <singularity-opac/constants/constants.hpp>
+#include <singularity-opac/neutrinos/opac_neutrinos.hpp>
+
+#include "benchmark_utils.hpp"
+
+using namespace singularity;
+using namespace singularity::benchmarks;
+
+using pc = PhysicalConstantsCGS;
+using Model = neutrinos::NonCGSUnits<neutrinos::SpinerOpac>;
+
+struct Point {
+  Real rho, T, Ye, nu;
+  RadiationType type;
+};
+
+template <typename Body>
+double Seconds(const std::vector<Point> &points, Body &&body, Real &sum) {
+  constexpr int NREP = 5;
+  double best = 0;
+  for (int rep = 0; rep < NREP; ++rep) {
+    Timer timer;
+    timer.Start();
+    for (const Point &p : points) {
+      sum += body(p);
+    }
+    const double dt = timer.Stop();
+    if (rep == 0 || dt < best) best = dt;
+  }
+  return best;
+}
+
+// Times the same queries through any opacity with the neutrino API
+template <typename Opac>
+void Run(const char *name, const Opac &opac, const std::vector<Point> &points,
+         Real &sum) {
+  const double n = points.size();
+  const double talpha = Seconds(
+      points,
+      [&](const Point &p) {
+        return opac.AbsorptionCoefficient(p.rho, p.T, p.Ye, p.type, p.nu);
+      },
+      sum);
+  const double tfused = Seconds(
+      points,
+      [&](const Point &p) {
+        Real a, j;
+        opac.AbsorptionAndEmissivity(p.rho, p.T, p.Ye, p.type, p.nu, a, j);
+        return a + j;
+      },
+      sum);
+  const double tJ = Seconds(
+      points,
+      [&](const Point &p) { return opac.Emissivity(p.rho, p.T, p.Ye, p.type); },
+      sum);
+  std::printf("%-12s %10.2f %10.2f %10.2f %8zu\n", name, 1e9 * talpha / n,
+              1e9 * tfused / n, 1e9 * tJ / n, sizeof(Opac));
+}
+
+int main(int argc, char *argv[]) {
+  int NRho = 16, NT = 16, NYe = 8, Ne = 16;
+  std::size_t nsamples = 1 << 20;
+  if (argc >= 5) {
+    NRho = std::atoi(argv[1]);
+    NT = std::atoi(argv[2]);
+    NYe = std::atoi(argv[3]);
+    Ne = std::atoi(argv[4]);
+  }
+  if (argc >= 6) {
+    nsamples = std::strtoull(argv[5], nullptr, 10);
+  }
+
+  constexpr Real MeV2K = 1e6 * pc::eV / pc::kb;
+  const Real lRhoMin = 8, lRhoMax = 12;
+  const Real lTMin = -2 + std::log10(MeV2K), lTMax = 2 + std::log10(MeV2K);
+  const Real YeMin = 0.1, YeMax = 0.5;
+  const Real leMin = -1, leMax = 2;
+
+  neutrinos::Opacity brt = neutrinos::BRTOpac();
+  neutrinos::SpinerOpac table(brt, lRhoMin, lRhoMax, NRho, lTMin, lTMax, NT,
+                              YeMin, YeMax, NYe, leMin, leMax, Ne);
+  const Model model(neutrinos::SpinerOpac(table), 1, 1, 1, 1);
+  const neutrinos::Opacity variant = model;
+  const neutrinos::Monomorphic<Model> mono = model;
+
+  std::vector<Point> points(nsamples);
+  SplitMix64 rng(20211231);
+  for (Point &p : points) {
+    p.rho = std::pow(10, lRhoMin + (lRhoMax - lRhoMin) * rng.Uniform());
+    p.T = std::pow(10, lTMin + (lTMax - lTMin) * rng.Uniform());
+    p.Ye = YeMin + (YeMax - YeMin) * rng.Uniform();
+    p.nu = std::pow(10, leMin + (leMax - leMin) * rng.Uniform()) *
+           neutrinos::SpinerOpac::MeV2Hz;
+    p.type = Idx2RadType(static_cast<int>(NEUTRINO_NTYPES * rng.Uniform()));
+  }
+
+  std::printf("Table: NRho = %d, NT = %d, NYe = %d, Ne = %d, %zu lookups\n",
+              NRho, NT, NYe, Ne, nsamples);
+  std::printf("%-12s %10s %10s %10s %8s\n", "", "alpha ns", "fused ns",
+              "J ns", "bytes");
+  Real sum = 0;
+  Run("model", model, points, sum);
+  Run("monomorphic", mono, points, sum);
+  Run("variant", variant, points, sum);
+  std::printf("(checksum %.6e)\n", sum);
+
+  table.Finalize();
+  return 0;
+}
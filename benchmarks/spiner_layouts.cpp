@@ -0,0 +1,170 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+// Random-access lookup throughput and cache misses of the spectral
+// table layouts in neutrinos::SpinerOpacity.
+//
+// Usage: spiner_layouts [NRho NT NYe Ne [nsamples]]
+//
+// Each point is drawn uniformly from the table, so consecutive
+// lookups land in unrelated cells, as they do for Monte Carlo
+// packets. Pick a table size well beyond the last level cache to see
+// the effect of the layout.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <ports-of-call/portability.hpp>
+
+#include <singularity-opac/base/radiation_types.hpp>
+#include <singularity-opac/constants/constants.hpp>
+#include <singularity-opac/neutrinos/opac_neutrinos.hpp>
+#include <singularity-opac/neutrinos/spiner_opac_neutrinos.hpp>
+
+#include "benchmark_utils.hpp"
+
+using namespace singularity;
+using namespace singularity::benchmarks;
+
+using pc = PhysicalConstantsCGS;
+
+struct Point {
+  Real rho, T, Ye, nu;
+  RadiationType type;
+};
+
+struct Result {
+  double seconds;
+  long long cache_misses;
+  long long l1_misses;
+  Real checksum;
+};
+
+template <typename Body>
+Result MeasureOnce(const std::vector<Point> &points, Body &body) {
+  HardwareCounter llc(HardwareCounter::Event::CacheMisses);
+  HardwareCounter l1(HardwareCounter::Event::L1DReadMisses);
+  Timer timer;
+  Real checksum = 0;
+  llc.Start();
+  l1.Start();
+  timer.Start();
+  for (const Point &p : points) {
+    checksum += body(p);
+  }
+  Result r;
+  r.seconds = timer.Stop();
+  r.l1_misses = l1.Stop();
+  r.cache_misses = llc.Stop();
+  r.checksum = checksum;
+  return r;
+}
+
+// Best of a few repetitions, to filter out noise from other processes
+template <typename Body>
+Result Measure(const std::vector<Point> &points, Body &&body) {
+  constexpr int NREP = 5;
+  Result best = MeasureOnce(points, body);
+  for (int rep = 1; rep < NREP; ++rep) {
+    Result r = MeasureOnce(points, body);
+    if (r.seconds < best.seconds) best = r;
+  }
+  return best;
+}
+
+void Report(const char *layout, const char *call, const Result &r,
+            const std::size_t n) {
+  const double per = 1.0 / static_cast<double>(n);
+  std::printf("%-12s %-8s %10.2f %12.3f", layout, call, 1e9 * r.seconds * per,
+              1e-6 * n / r.seconds);
+  if (r.cache_misses >= 0) {
+    std::printf(" %12.3f", r.cache_misses * per);
+  } else {
+    std::printf(" %12s", "n/a");
+  }
+  if (r.l1_misses >= 0) {
+    std::printf(" %12.3f", r.l1_misses * per);
+  } else {
+    std::printf(" %12s", "n/a");
+  }
+  std::printf("   (checksum %.6e)\n", r.checksum);
+}
+
+int main(int argc, char *argv[]) {
+  int NRho = 48, NT = 48, NYe = 24, Ne = 32;
+  std::size_t nsamples = 1 << 20;
+  if (argc >= 5) {
+    NRho = std::atoi(argv[1]);
+    NT = std::atoi(argv[2]);
+    NYe = std::atoi(argv[3]);
+    Ne = std::atoi(argv[4]);
+  }
+  if (argc >= 6) {
+    nsamples = std::strtoull(argv[5], nullptr, 10);
+  }
+
+  constexpr Real MeV2K = 1e6 * pc::eV / pc::kb;
+  const Real lRhoMin = 8, lRhoMax = 12;
+  const Real lTMin = -2 + std::log10(MeV2K), lTMax = 2 + std::log10(MeV2K);
+  const Real YeMin = 0.1, YeMax = 0.5;
+  const Real leMin = -1, leMax = 2;
+
+  std::printf("Table: NRho = %d, NT = %d, NYe = %d, Ne = %d, %zu lookups\n",
+              NRho, NT, NYe, Ne, nsamples);
+  std::printf("Separate tables: %.1f MB\n",
+              2. * NRho * NT * NYe * NEUTRINO_NTYPES * Ne * sizeof(Real) /
+                  (1024. * 1024.));
+
+  std::vector<Point> points(nsamples);
+  SplitMix64 rng(20211231);
+  for (Point &p : points) {
+    p.rho = std::pow(10, lRhoMin + (lRhoMax - lRhoMin) * rng.Uniform());
+    p.T = std::pow(10, lTMin + (lTMax - lTMin) * rng.Uniform());
+    p.Ye = YeMin + (YeMax - YeMin) * rng.Uniform();
+    p.nu = std::pow(10, leMin + (leMax - leMin) * rng.Uniform()) *
+           neutrinos::SpinerOpac::MeV2Hz;
+    p.type = Idx2RadType(static_cast<int>(NEUTRINO_NTYPES * rng.Uniform()));
+  }
+
+  neutrinos::Gray gray(1.0);
+  const neutrinos::SpectralLayout layouts[] = {
+      neutrinos::SpectralLayout::Separate,
+      neutrinos::SpectralLayout::Interleaved};
+  const char *names[] = {"Separate", "Interleaved"};
+
+  std::printf("%-12s %-8s %10s %12s %12s %12s\n", "layout", "call",
+              "ns/lookup", "Mlookups/s", "misses/look", "L1D/look");
+  for (int l = 0; l < 2; ++l) {
+    neutrinos::SpinerOpac opac(gray, lRhoMin, lRhoMax, NRho, lTMin, lTMax, NT,
+                               YeMin, YeMax, NYe, leMin, leMax, Ne,
+                               layouts[l]);
+    Result alpha = Measure(points, [&](const Point &p) {
+      return opac.AbsorptionCoefficient(p.rho, p.T, p.Ye, p.type, p.nu);
+    });
+    Report(names[l], "alpha", alpha, nsamples);
+
+    Result fused = Measure(points, [&](const Point &p) {
+      Real a, j;
+      opac.AbsorptionAndEmissivity(p.rho, p.T, p.Ye, p.type, p.nu, a, j);
+      return a + j;
+    });
+    Report(names[l], "fused", fused, nsamples);
+
+    opac.Finalize();
+  }
+  return 0;
+}
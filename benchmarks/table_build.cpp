@@ -0,0 +1,227 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+// Strong scaling of the SpinerOpacity and MeanOpacity tabulating
+// constructors with the number of host threads.
+//
+// Usage: table_build [NRho NT NYe Ne [maxthreads]]
+//
+// Thread counts double from 1 up to maxthreads, which defaults to the
+// number of hardware threads. Each build is checked to be bitwise
+// identical to the serial one. Mean opacities are tabulated on the
+// same rho, T and Ye nodes, each integrating over 100 frequencies.
+// Serial mean opacity builds with each frequency quadrature are then
+// compared to one with a tight Gauss-Kronrod tolerance.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <ports-of-call/portability.hpp>
+
+#include <singularity-opac/base/host_parallel.hpp>
+#include <singularity-opac/base/mean_quadrature.hpp>
+#include <singularity-opac/base/radiation_types.hpp>
+#include <singularity-opac/constants/constants.hpp>
+#include <singularity-opac/neutrinos/mean_opacity_neutrinos.hpp>
+#include <singularity-opac/neutrinos/opac_neutrinos.hpp>
+#include <singularity-opac/neutrinos/spiner_opac_neutrinos.hpp>
+
+#include "benchmark_utils.hpp"
+
+using namespace singularity;
+using namespace singularity::benchmarks;
+
+using pc = PhysicalConstantsCGS;
+
+int main(int argc, char *argv[]) {
+  int NRho = 64, NT = 64, NYe = 16, Ne = 64;
+  int maxthreads = impl::defaultHostThreads();
+  if (argc >= 5) {
+    NRho = std::atoi(argv[1]);
+    NT = std::atoi(argv[2]);
+    NYe = std::atoi(argv[3]);
+    Ne = std::atoi(argv[4]);
+  }
+  if (argc >= 6) {
+    maxthreads = std::atoi(argv[5]);
+  }
+
+  constexpr Real MeV2K = 1e6 * pc::eV / pc::kb;
+  const Real lRhoMin = 8, lRhoMax = 12;
+  const Real lTMin = -2 + std::log10(MeV2K), lTMax = 2 + std::log10(MeV2K);
+  const Real YeMin = 0.1, YeMax = 0.5;
+  const Real leMin = -1, leMax = 2;
+  neutrinos::Opacity brt = neutrinos::BRTOpac();
+
+  auto build = [&](const int nthreads) {
+    return neutrinos::SpinerOpac(brt, lRhoMin, lRhoMax, NRho, lTMin, lTMax,
+                                 NT, YeMin, YeMax, NYe, leMin, leMax, Ne,
+                                 neutrinos::SpectralLayout::Separate,
+                                 TablePrecision::Double, nthreads);
+  };
+
+  std::printf("Table: NRho = %d, NT = %d, NYe = %d, Ne = %d\n", NRho, NT,
+              NYe, Ne);
+  std::printf("%8s %12s %10s %10s\n", "threads", "seconds", "speedup",
+              "identical");
+  Timer timer;
+  timer.Start();
+  neutrinos::SpinerOpac serial = build(1);
+  const double tserial = timer.Stop();
+  std::printf("%8d %12.3f %10.2f %10s\n", 1, tserial, 1.0, "yes");
+
+  for (int nthreads = 2; nthreads <= maxthreads; nthreads *= 2) {
+    timer.Start();
+    neutrinos::SpinerOpac threaded = build(nthreads);
+    const double t = timer.Stop();
+    // Compare at every node of the table
+    bool identical = true;
+    for (int iRho = 0; iRho < NRho && identical; ++iRho) {
+      const Real rho =
+          std::pow(10, lRhoMin + (lRhoMax - lRhoMin) * iRho / (NRho - 1));
+      for (int iT = 0; iT < NT; ++iT) {
+        const Real T = std::pow(10, lTMin + (lTMax - lTMin) * iT / (NT - 1));
+        for (int iYe = 0; iYe < NYe; ++iYe) {
+          const Real Ye = YeMin + (YeMax - YeMin) * iYe / (NYe - 1);
+          for (int idx = 0; idx < NEUTRINO_NTYPES; ++idx) {
+            const RadiationType type = Idx2RadType(idx);
+            for (int ie = 0; ie < Ne; ++ie) {
+              const Real nu =
+                  std::pow(10, leMin + (leMax - leMin) * ie / (Ne - 1)) *
+                  neutrinos::SpinerOpac::MeV2Hz;
+              identical = identical &&
+                          (serial.AbsorptionCoefficient(rho, T, Ye, type, nu) ==
+                           threaded.AbsorptionCoefficient(rho, T, Ye, type,
+                                                          nu)) &&
+                          (serial.EmissivityPerNuOmega(rho, T, Ye, type, nu) ==
+                           threaded.EmissivityPerNuOmega(rho, T, Ye, type, nu));
+            }
+          }
+        }
+      }
+    }
+    std::printf("%8d %12.3f %10.2f %10s\n", nthreads, t, tserial / t,
+                identical ? "yes" : "NO");
+    threaded.Finalize();
+  }
+  serial.Finalize();
+
+  auto buildMean = [&](const int nthreads) {
+    return neutrinos::MeanOpacityCGS(brt, lRhoMin, lRhoMax, NRho, lTMin, lTMax,
+                                     NT, YeMin, YeMax, NYe, nullptr,
+                                     TablePrecision::Double, nthreads);
+  };
+
+  std::printf("\nMean opacity: NRho = %d, NT = %d, NYe = %d\n", NRho, NT, NYe);
+  std::printf("%8s %12s %10s %10s\n", "threads", "seconds", "speedup",
+              "identical");
+  timer.Start();
+  neutrinos::MeanOpacityCGS serial_mean = buildMean(1);
+  const double tserial_mean = timer.Stop();
+  std::printf("%8d %12.3f %10.2f %10s\n", 1, tserial_mean, 1.0, "yes");
+
+  for (int nthreads = 2; nthreads <= maxthreads; nthreads *= 2) {
+    timer.Start();
+    neutrinos::MeanOpacityCGS threaded = buildMean(nthreads);
+    const double t = timer.Stop();
+    bool identical = true;
+    for (int iRho = 0; iRho < NRho && identical; ++iRho) {
+      const Real rho =
+          std::pow(10, lRhoMin + (lRhoMax - lRhoMin) * iRho / (NRho - 1));
+      for (int iT = 0; iT < NT; ++iT) {
+        const Real T = std::pow(10, lTMin + (lTMax - lTMin) * iT / (NT - 1));
+        for (int iYe = 0; iYe < NYe; ++iYe) {
+          const Real Ye = YeMin + (YeMax - YeMin) * iYe / (NYe - 1);
+          for (int idx = 0; idx < NEUTRINO_NTYPES; ++idx) {
+            const RadiationType type = Idx2RadType(idx);
+            identical =
+                identical &&
+                (serial_mean.PlanckMeanAbsorptionCoefficient(rho, T, Ye,
+                                                             type) ==
+                 threaded.PlanckMeanAbsorptionCoefficient(rho, T, Ye, type)) &&
+                (serial_mean.RosselandMeanAbsorptionCoefficient(rho, T, Ye,
+                                                                type) ==
+                 threaded.RosselandMeanAbsorptionCoefficient(rho, T, Ye,
+                                                             type));
+          }
+        }
+      }
+    }
+    std::printf("%8d %12.3f %10.2f %10s\n", nthreads, t, tserial_mean / t,
+                identical ? "yes" : "NO");
+    threaded.Finalize();
+  }
+  serial_mean.Finalize();
+
+  auto buildRule = [&](const MeanQuadrature &quadrature) {
+    return neutrinos::MeanOpacityCGS(brt, lRhoMin, lRhoMax, NRho, lTMin, lTMax,
+                                     NT, YeMin, YeMax, NYe, quadrature,
+                                     nullptr, TablePrecision::Double, 1);
+  };
+  MeanQuadrature tight;
+  tight.rule = QuadratureRule::GaussKronrod;
+  tight.tolerance = 1e-10;
+  tight.maxPanels = 256;
+  neutrinos::MeanOpacityCGS reference = buildRule(tight);
+
+  MeanQuadrature rules[5];
+  const char *names[5] = {"trapezoid 100", "laguerre 16", "laguerre 32",
+                          "kronrod 1e-4", "kronrod 1e-6"};
+  rules[1].rule = rules[2].rule = QuadratureRule::GaussLaguerre;
+  rules[1].points = 16;
+  rules[2].points = 32;
+  rules[3].rule = rules[4].rule = QuadratureRule::GaussKronrod;
+  rules[3].tolerance = 1e-4;
+  rules[4].tolerance = 1e-6;
+
+  std::printf("\nMean opacity quadratures, serial\n");
+  std::printf("%-14s %12s %14s %14s\n", "rule", "seconds", "planck error",
+              "rosseland error");
+  for (int r = 0; r < 5; ++r) {
+    timer.Start();
+    neutrinos::MeanOpacityCGS mean = buildRule(rules[r]);
+    const double t = timer.Stop();
+    // Largest relative difference from the reference at the nodes
+    Real planck = 0, rosseland = 0;
+    for (int iRho = 0; iRho < NRho; ++iRho) {
+      const Real rho =
+          std::pow(10, lRhoMin + (lRhoMax - lRhoMin) * iRho / (NRho - 1));
+      for (int iT = 0; iT < NT; ++iT) {
+        const Real T = std::pow(10, lTMin + (lTMax - lTMin) * iT / (NT - 1));
+        for (int iYe = 0; iYe < NYe; ++iYe) {
+          const Real Ye = YeMin + (YeMax - YeMin) * iYe / (NYe - 1);
+          for (int idx = 0; idx < NEUTRINO_NTYPES; ++idx) {
+            const RadiationType type = Idx2RadType(idx);
+            const Real dp =
+                mean.PlanckMeanAbsorptionCoefficient(rho, T, Ye, type) /
+                reference.PlanckMeanAbsorptionCoefficient(rho, T, Ye, type);
+            const Real dr =
+                mean.RosselandMeanAbsorptionCoefficient(rho, T, Ye, type) /
+                reference.RosselandMeanAbsorptionCoefficient(rho, T, Ye, type);
+            planck = std::max(planck, std::abs(dp - 1));
+            rosseland = std::max(rosseland, std::abs(dr - 1));
+          }
+        }
+      }
+    }
+    std::printf("%-14s %12.3f %14.3e %14.3e\n", names[r], t, planck,
+                rosseland);
+    mean.Finalize();
+  }
+  reference.Finalize();
+  return 0;
+}
@@ -0,0 +1,181 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+// Error and throughput of float and quantized table storage in
+// neutrinos::SpinerOpacity, relative to the double tables.
+//
+// Usage: table_precision [NRho NT NYe Ne [nsamples]]
+//
+// The BRT opacity is tabulated, since its logs span many decades and
+// so exercise the float rounding of large values.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <ports-of-call/portability.hpp>
+
+#include <singularity-opac/base/radiation_types.hpp>
+#include <singularity-opac/base/table_storage.hpp>
+#include <singularity-opac/constants/constants.hpp>
+#include <singularity-opac/neutrinos/opac_neutrinos.hpp>
+#include <singularity-opac/neutrinos/spiner_opac_neutrinos.hpp>
+
+#include "benchmark_utils.hpp"
+
+using namespace singularity;
+using namespace singularity::benchmarks;
+
+using pc = PhysicalConstantsCGS;
+
+struct Point {
+  Real rho, T, Ye, nu;
+  RadiationType type;
+};
+
+struct ErrorStats {
+  Real max = 0;
+  Real sum2 = 0;
+  std::size_t n = 0;
+  void Add(const Real ref, const Real val) {
+    const Real err = std::abs(val - ref) / std::max(std::abs(ref), 1e-300);
+    max = std::max(max, err);
+    sum2 += err * err;
+    n++;
+  }
+  Real Rms() const { return n > 0 ? std::sqrt(sum2 / n) : 0; }
+};
+
+template <typename Body>
+double Seconds(const std::vector<Point> &points, Body &&body, Real &sum) {
+  constexpr int NREP = 5;
+  double best = 0;
+  for (int rep = 0; rep < NREP; ++rep) {
+    Timer timer;
+    timer.Start();
+    for (const Point &p : points) {
+      sum += body(p);
+    }
+    const double dt = timer.Stop();
+    if (rep == 0 || dt < best) best = dt;
+  }
+  return best;
+}
+
+int main(int argc, char *argv[]) {
+  int NRho = 48, NT = 48, NYe = 24, Ne = 32;
+  std::size_t nsamples = 1 << 20;
+  if (argc >= 5) {
+    NRho = std::atoi(argv[1]);
+    NT = std::atoi(argv[2]);
+    NYe = std::atoi(argv[3]);
+    Ne = std::atoi(argv[4]);
+  }
+  if (argc >= 6) {
+    nsamples = std::strtoull(argv[5], nullptr, 10);
+  }
+
+  constexpr Real MeV2K = 1e6 * pc::eV / pc::kb;
+  const Real lRhoMin = 8, lRhoMax = 12;
+  const Real lTMin = -2 + std::log10(MeV2K), lTMax = 2 + std::log10(MeV2K);
+  const Real YeMin = 0.1, YeMax = 0.5;
+  const Real leMin = -1, leMax = 2;
+
+  neutrinos::Opacity brt = neutrinos::BRTOpac();
+  neutrinos::SpinerOpac dbl(brt, lRhoMin, lRhoMax, NRho, lTMin, lTMax, NT,
+                            YeMin, YeMax, NYe, leMin, leMax, Ne);
+  neutrinos::SpinerOpac flt(brt, lRhoMin, lRhoMax, NRho, lTMin, lTMax, NT,
+                            YeMin, YeMax, NYe, leMin, leMax, Ne,
+                            neutrinos::SpectralLayout::Separate,
+                            TablePrecision::Float);
+  neutrinos::SpinerOpac qnt(brt, lRhoMin, lRhoMax, NRho, lTMin, lTMax, NT,
+                            YeMin, YeMax, NYe, leMin, leMax, Ne,
+                            neutrinos::SpectralLayout::Separate,
+                            TablePrecision::Quantized);
+
+  const double nspectral = 2. * NRho * NT * NYe * NEUTRINO_NTYPES * Ne;
+  const double ntotal = 2. * NRho * NT * NYe * NEUTRINO_NTYPES;
+  const double MB = 1024. * 1024.;
+  std::printf("Table: NRho = %d, NT = %d, NYe = %d, Ne = %d, %zu lookups\n",
+              NRho, NT, NYe, Ne, nsamples);
+  // Quantized tables add a float offset and scale per block
+  const double qbytes = sizeof(std::uint16_t) +
+                        2. * sizeof(float) / impl::QUANTIZED_BLOCK;
+  std::printf("Memory: double %.1f MB, float %.1f MB, quantized %.1f MB\n",
+              (nspectral + ntotal) * sizeof(double) / MB,
+              (nspectral + ntotal) * sizeof(float) / MB,
+              (nspectral + ntotal) * qbytes / MB);
+
+  std::vector<Point> points(nsamples);
+  SplitMix64 rng(20211231);
+  for (Point &p : points) {
+    p.rho = std::pow(10, lRhoMin + (lRhoMax - lRhoMin) * rng.Uniform());
+    p.T = std::pow(10, lTMin + (lTMax - lTMin) * rng.Uniform());
+    p.Ye = YeMin + (YeMax - YeMin) * rng.Uniform();
+    p.nu = std::pow(10, leMin + (leMax - leMin) * rng.Uniform()) *
+           neutrinos::SpinerOpac::MeV2Hz;
+    p.type = Idx2RadType(static_cast<int>(NEUTRINO_NTYPES * rng.Uniform()));
+  }
+
+  std::printf("%-10s %-10s %14s %14s\n", "tables", "quantity", "max rel err",
+              "rms rel err");
+  const neutrinos::SpinerOpac *reduced[] = {&flt, &qnt};
+  const char *names[] = {"float", "quantized"};
+  for (int r = 0; r < 2; ++r) {
+    const neutrinos::SpinerOpac &opac = *reduced[r];
+    ErrorStats alpha, jnu, J, JYe;
+    for (const Point &p : points) {
+      alpha.Add(dbl.AbsorptionCoefficient(p.rho, p.T, p.Ye, p.type, p.nu),
+                opac.AbsorptionCoefficient(p.rho, p.T, p.Ye, p.type, p.nu));
+      jnu.Add(dbl.EmissivityPerNuOmega(p.rho, p.T, p.Ye, p.type, p.nu),
+              opac.EmissivityPerNuOmega(p.rho, p.T, p.Ye, p.type, p.nu));
+      J.Add(dbl.Emissivity(p.rho, p.T, p.Ye, p.type),
+            opac.Emissivity(p.rho, p.T, p.Ye, p.type));
+      JYe.Add(dbl.NumberEmissivity(p.rho, p.T, p.Ye, p.type),
+              opac.NumberEmissivity(p.rho, p.T, p.Ye, p.type));
+    }
+    std::printf("%-10s %-10s %14.3e %14.3e\n", names[r], "alphanu", alpha.max,
+                alpha.Rms());
+    std::printf("%-10s %-10s %14.3e %14.3e\n", names[r], "jnu", jnu.max,
+                jnu.Rms());
+    std::printf("%-10s %-10s %14.3e %14.3e\n", names[r], "J", J.max, J.Rms());
+    std::printf("%-10s %-10s %14.3e %14.3e\n", names[r], "JYe", JYe.max,
+                JYe.Rms());
+  }
+
+  Real sum = 0;
+  auto fused = [](const neutrinos::SpinerOpac &opac) {
+    return [&opac](const Point &p) {
+      Real a, j;
+      opac.AbsorptionAndEmissivity(p.rho, p.T, p.Ye, p.type, p.nu, a, j);
+      return a + j;
+    };
+  };
+  const double tdbl = Seconds(points, fused(dbl), sum);
+  const double tflt = Seconds(points, fused(flt), sum);
+  const double tqnt = Seconds(points, fused(qnt), sum);
+  std::printf("Fused lookups: double %.2f ns, float %.2f ns, quantized %.2f ns",
+              1e9 * tdbl / nsamples, 1e9 * tflt / nsamples,
+              1e9 * tqnt / nsamples);
+  std::printf("   (checksum %.6e)\n", sum);
+
+  dbl.Finalize();
+  flt.Finalize();
+  qnt.Finalize();
+  return 0;
+}
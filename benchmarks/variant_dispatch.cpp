@@ -0,0 +1,215 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+// mpark::visit against the switch dispatch that SINGULARITY_VARIANT_SWITCH
+// selects, for every alternative of neutrinos::Opacity. Scalar calls
+// evaluate the absorption coefficient at one frequency, and batched
+// calls at nbins frequencies through the indexer form.
+//
+// Usage: variant_dispatch [nsamples [nbins]]
+//
+// Both backends are timed in the same binary, on an mpark::variant
+// of the same alternatives as neutrinos::Opacity, whichever backend
+// the variant classes were built with.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#include <ports-of-call/portability.hpp>
+#include <variant/include/mpark/variant.hpp>
+
+#include <singularity-opac/base/opac_variant.hpp>
+#include <singularity-opac/base/radiation_types.hpp>
+#include <singularity-opac/constants/constants.hpp>
+#include <singularity-opac/neutrinos/opac_neutrinos.hpp>
+
+#include "benchmark_utils.hpp"
+
+using namespace singularity;
+using namespace singularity::benchmarks;
+using namespace singularity::neutrinos;
+
+using pc = PhysicalConstantsCGS;
+using Alternatives =
+    mpark::variant<ScaleFree, BRTOpac, Gray, Tophat, SpinerOpac,
+                   MultigroupOpac, NonCGSUnits<BRTOpac>, NonCGSUnits<Gray>,
+                   NonCGSUnits<Tophat>, NonCGSUnits<SpinerOpac>,
+                   NonCGSUnits<MultigroupOpac>>;
+
+struct Point {
+  Real rho, T, Ye, nu;
+  RadiationType type;
+};
+
+struct MparkDispatch {
+  template <typename Visitor>
+  static decltype(auto) visit(Visitor &&f, const Alternatives &v) {
+    return mpark::visit(std::forward<Visitor>(f), v);
+  }
+};
+struct SwitchDispatch {
+  template <typename Visitor>
+  static decltype(auto) visit(Visitor &&f, const Alternatives &v) {
+    return singularity::impl::switchVisit(std::forward<Visitor>(f), v);
+  }
+};
+
+template <typename Body>
+double Seconds(const std::vector<Point> &points, Body &&body, Real &sum) {
+  constexpr int NREP = 5;
+  double best = 0;
+  for (int rep = 0; rep < NREP; ++rep) {
+    Timer timer;
+    timer.Start();
+    for (const Point &p : points) {
+      sum += body(p);
+    }
+    const double dt = timer.Stop();
+    if (rep == 0 || dt < best) best = dt;
+  }
+  return best;
+}
+
+template <typename Dispatch>
+double Scalar(const Alternatives &v, const std::vector<Point> &points,
+              Real &sum) {
+  return Seconds(
+      points,
+      [&](const Point &p) {
+        return Dispatch::visit(
+            [&](const auto &opac) {
+              return opac.AbsorptionCoefficient(p.rho, p.T, p.Ye, p.type,
+                                                p.nu);
+            },
+            v);
+      },
+      sum);
+}
+
+template <typename Dispatch>
+double Batched(const Alternatives &v, const std::vector<Point> &points,
+               std::vector<Real> &nu_bins, std::vector<Real> &coeffs,
+               Real &sum) {
+  const int nbins = nu_bins.size();
+  return Seconds(
+      points,
+      [&](const Point &p) {
+        Real *nu = nu_bins.data();
+        Real *alpha = coeffs.data();
+        Dispatch::visit(
+            [&](const auto &opac) {
+              opac.AbsorptionCoefficient(p.rho, p.T, p.Ye, p.type, nu, alpha,
+                                         nbins);
+            },
+            v);
+        return alpha[nbins / 2];
+      },
+      sum);
+}
+
+int main(int argc, char *argv[]) {
+  std::size_t nsamples = 1 << 18;
+  int nbins = 16;
+  if (argc >= 2) {
+    nsamples = std::strtoull(argv[1], nullptr, 10);
+  }
+  if (argc >= 3) {
+    nbins = std::atoi(argv[2]);
+  }
+
+  constexpr Real MeV2K = 1e6 * pc::eV / pc::kb;
+  constexpr Real MeV2Hz = SpinerOpac::MeV2Hz;
+  const Real lRhoMin = 8, lRhoMax = 12;
+  const Real lTMin = -2 + std::log10(MeV2K), lTMax = 2 + std::log10(MeV2K);
+  const Real YeMin = 0.1, YeMax = 0.5;
+  const Real leMin = -1, leMax = 2;
+
+  // One group per bin, so that batched multigroup calls fill every bin
+  std::vector<Real> edges(nbins + 1);
+  std::vector<Real> nu_bins(nbins);
+  std::vector<Real> coeffs(nbins);
+  for (int i = 0; i <= nbins; ++i) {
+    edges[i] = std::pow(10, leMin + (leMax - leMin) * i / nbins) * MeV2Hz;
+  }
+  for (int i = 0; i < nbins; ++i) {
+    nu_bins[i] = std::sqrt(edges[i] * edges[i + 1]);
+  }
+
+  Opacity brt = BRTOpac();
+  SpinerOpac table(brt, lRhoMin, lRhoMax, 16, lTMin, lTMax, 16, YeMin, YeMax,
+                   8, leMin, leMax, 16);
+  MultigroupOpac groups(table, edges);
+
+  const Alternatives models[] = {
+      ScaleFree(1),
+      BRTOpac(),
+      Gray(1),
+      Tophat(1, edges[0], edges[nbins]),
+      table,
+      groups,
+      NonCGSUnits<BRTOpac>(BRTOpac(), 1, 1, 1, 1),
+      NonCGSUnits<Gray>(Gray(1), 1, 1, 1, 1),
+      NonCGSUnits<Tophat>(Tophat(1, edges[0], edges[nbins]), 1, 1, 1, 1),
+      NonCGSUnits<SpinerOpac>(SpinerOpac(table), 1, 1, 1, 1),
+      NonCGSUnits<MultigroupOpac>(MultigroupOpac(groups), 1, 1, 1, 1)};
+  const char *names[] = {"ScaleFree",
+                         "BRTOpac",
+                         "Gray",
+                         "Tophat",
+                         "SpinerOpac",
+                         "MultigroupOpac",
+                         "NonCGSUnits<BRTOpac>",
+                         "NonCGSUnits<Gray>",
+                         "NonCGSUnits<Tophat>",
+                         "NonCGSUnits<SpinerOpac>",
+                         "NonCGSUnits<MultigroupOpac>"};
+
+  std::vector<Point> points(nsamples);
+  SplitMix64 rng(20211231);
+  for (Point &p : points) {
+    p.rho = std::pow(10, lRhoMin + (lRhoMax - lRhoMin) * rng.Uniform());
+    p.T = std::pow(10, lTMin + (lTMax - lTMin) * rng.Uniform());
+    p.Ye = YeMin + (YeMax - YeMin) * rng.Uniform();
+    p.nu = std::pow(10, leMin + (leMax - leMin) * rng.Uniform()) * MeV2Hz;
+    p.type = Idx2RadType(static_cast<int>(NEUTRINO_NTYPES * rng.Uniform()));
+  }
+
+  std::printf("%zu calls, %d bins per batched call. Times in ns per call.\n",
+              nsamples, nbins);
+  std::printf("%-28s %10s %10s %10s %10s\n", "alternative", "mpark",
+              "switch", "mpark", "switch");
+  std::printf("%-28s %10s %10s %10s %10s\n", "", "scalar", "scalar",
+              "batched", "batched");
+  const double n = nsamples;
+  Real sum = 0;
+  for (int m = 0; m < static_cast<int>(sizeof(names) / sizeof(names[0]));
+       ++m) {
+    const Alternatives &v = models[m];
+    const double sm = Scalar<MparkDispatch>(v, points, sum);
+    const double ss = Scalar<SwitchDispatch>(v, points, sum);
+    const double bm = Batched<MparkDispatch>(v, points, nu_bins, coeffs, sum);
+    const double bs = Batched<SwitchDispatch>(v, points, nu_bins, coeffs, sum);
+    std::printf("%-28s %10.2f %10.2f %10.2f %10.2f\n", names[m], 1e9 * sm / n,
+                1e9 * ss / n, 1e9 * bm / n, 1e9 * bs / n);
+  }
+  std::printf("(checksum %.6e)\n", sum);
+
+  groups.Finalize();
+  table.Finalize();
+  return 0;
+}
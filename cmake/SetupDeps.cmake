@@ -16,6 +16,13 @@ endif()
 find_package(PortsofCall REQUIRED)
 target_link_libraries(singularity-opac::flags INTERFACE PortsofCall::PortsofCall)
 
+#=======================================
+# Setup Threads
+# - provides Threads::Threads, used to build
+#   tables on all host cores
+#=======================================
+find_package(Threads REQUIRED)
+
 #=======================================
 # Setup Kokkos
 # - provides Kokkos::kokkos
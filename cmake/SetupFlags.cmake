@@ -7,8 +7,10 @@ set(build_release "$<CONFIG:Release>")
 set(cxx_lang "$<COMPILE_LANGUAGE:CXX>")
 set(cxx_xl "$<COMPILE_LANG_AND_ID:CXX,XL>")
 set(with_fmath "$<BOOL:${SINGULARITY_USE_FMATH}>")
+set(with_variant_switch "$<BOOL:${SINGULARITY_VARIANT_SWITCH}>")
 set(with_hdf5 "$<BOOL:${SINGULARITY_USE_HDF5}>")
 set(with_mpi "$<BOOL:${SINGULARITY_USE_MPI}>")
+set(with_mmap "$<BOOL:${SINGULARITY_USE_MMAP}>")
 set(with_kokkos "$<BOOL:${SINGULARITY_USE_KOKKOS}>")
 set(without_kokkos "$<NOT:${with_kokkos}>")
 set(with_cuda "$<BOOL:${SINGULARITY_USE_CUDA}>")
@@ -73,11 +75,27 @@ INTERFACE
       SINGULARITY_USE_FMATH
     >
   >
+  $<${with_hdf5}:
+    $<${with_mpi}:
+      SINGULARITY_USE_MPI
+    >
+  >
+  $<${with_variant_switch}:
+    SINGULARITY_VARIANT_SWITCH
+  >
+  $<${with_mmap}:
+    SINGULARITY_USE_MMAP
+  >
 )
 
 # target_link_libraries brings in compile flags, compile defs, link flags.
 target_link_libraries(${PROJECT_NAME}
 INTERFACE
+    Threads::Threads
+    $<${with_mmap}:
+        # shm_open lives in librt on older glibc
+        $<$<PLATFORM_ID:Linux>:rt>
+    >
     $<${with_kokkos}:
         Kokkos::kokkos
     >
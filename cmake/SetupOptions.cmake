@@ -9,9 +9,13 @@ option (SINGULARITY_INSTALL_LIBRARY "Enable installing the libraries to default
 option (SINGULARITY_USE_FORTRAN "Enable fortran bindings" OFF)
 option (SINGULARITY_HIDE_MORE_WARNINGS "hide more warnings" OFF)
 option (SINGULARITY_BUILD_TESTS "Compile tests" OFF)
+option (SINGULARITY_BUILD_BENCHMARKS "Compile benchmarks" OFF)
+option (SINGULARITY_BUILD_TOOLS "Compile tools" OFF)
 option (SINGULARITY_BETTER_DEBUG_FLAGS
   "Better debug flags for singularity" ON)
 option (SINGULARITY_USE_FMATH "Enable fast-math logarithms" ON)
+option (SINGULARITY_VARIANT_SWITCH
+  "Dispatch opacity variants with a switch rather than mpark::visit" OFF)
 
 #=======================================
 # Dependency options
@@ -28,6 +32,10 @@ option (SINGULARITY_USE_HDF5 "Pull in hdf5" OFF)
 cmake_dependent_option(SINGULARITY_USE_MPI "Link to MPI"
   ON "${SINGULARITY_USE_MPI};${HDF5_IS_PARALLEL}" OFF)
 
+# Memory-mapped raw tables and POSIX shared memory
+cmake_dependent_option(SINGULARITY_USE_MMAP
+  "Map raw table files and POSIX shared memory" ON "UNIX" OFF)
+
 #=======================================
 # Options logic
 #=======================================
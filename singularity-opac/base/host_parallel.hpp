@@ -0,0 +1,79 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+#ifndef SINGULARITY_OPAC_BASE_HOST_PARALLEL_
+#define SINGULARITY_OPAC_BASE_HOST_PARALLEL_
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace singularity {
+namespace impl {
+
+// Threads table builds use when asked for nthreads <= 0. Builds are
+// serial unless a caller asks for threads.
+inline int defaultHostThreads() {
+  const unsigned int n = std::thread::hardware_concurrency();
+  return (n > 0) ? static_cast<int>(n) : 1;
+}
+
+// Calls f(i) for 0 <= i < n, split into contiguous chunks over
+// nthreads host threads. Tables are filled on host, and the models
+// that fill them need not be callable on device, so this doesn't go
+// through the portability layer. As long as f(i) only writes to
+// locations determined by i, the result doesn't depend on the
+// number of threads. The first exception thrown by f is rethrown
+// once all threads have finished.
+template <typename Function>
+void hostParallelFor(const int n, int nthreads, const Function &f) {
+  if (nthreads <= 0) nthreads = defaultHostThreads();
+  nthreads = std::max(1, std::min(nthreads, n));
+  if (nthreads == 1) {
+    for (int i = 0; i < n; ++i) {
+      f(i);
+    }
+    return;
+  }
+  std::vector<std::exception_ptr> errors(nthreads);
+  std::vector<std::thread> threads;
+  threads.reserve(nthreads);
+  for (int t = 0; t < nthreads; ++t) {
+    const long long N = n;
+    const int begin = static_cast<int>(N * t / nthreads);
+    const int end = static_cast<int>(N * (t + 1) / nthreads);
+    threads.emplace_back([&f, &errors, t, begin, end]() {
+      try {
+        for (int i = begin; i < end; ++i) {
+          f(i);
+        }
+      } catch (...) {
+        errors[t] = std::current_exception();
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  for (const std::exception_ptr &error : errors) {
+    if (error) std::rethrow_exception(error);
+  }
+}
+
+} // namespace impl
+} // namespace singularity
+
+#endif // SINGULARITY_OPAC_BASE_HOST_PARALLEL_
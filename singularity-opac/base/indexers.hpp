@@ -148,8 +148,8 @@ class LogCheb {
   PORTABLE_INLINE_FUNCTION
   Real operator()(const Real nu) {
     Real lnu = BDMath::log10(nu);
-    return std::pow(
-        10, chebyshev::InterpFromCoeffs(lnu, lnumin_, lnumax_, coeffs_, N));
+    return BDMath::exp10(
+        chebyshev::InterpFromCoeffs(lnu, lnumin_, lnumax_, coeffs_, N));
   }
 
  private:
@@ -158,6 +158,66 @@ class LogCheb {
   Data_t data_, logdata_, coeffs_;
 };
 
+// Views of another indexer in other units, applied per element as it
+// is read or written. ScaledFrequencies reads data[i] * scale, and
+// assigning x to element i of ScaledData stores x * scale in data[i].
+// NonCGSUnits hands these to the model it wraps, so the conversion
+// costs no extra pass over the bins and never writes to the caller's
+// frequencies. Elements of ScaledData are proxies, not Real &, so
+// models assign to them rather than pass them by reference.
+template <typename Indexer>
+class ScaledFrequencies {
+ public:
+  PORTABLE_INLINE_FUNCTION
+  ScaledFrequencies(Indexer &data, const Real scale)
+      : data_(data), scale_(scale) {}
+
+  PORTABLE_INLINE_FUNCTION
+  Real operator[](const int i) const { return data_[i] * scale_; }
+
+ private:
+  Indexer &data_;
+  Real scale_;
+};
+
+template <typename Indexer>
+class ScaledData {
+ public:
+  class Element {
+   public:
+    PORTABLE_INLINE_FUNCTION
+    Element(Indexer &data, const int i, const Real scale)
+        : data_(data), i_(i), scale_(scale) {}
+
+    PORTABLE_INLINE_FUNCTION
+    Element &operator=(const Real x) {
+      data_[i_] = x * scale_;
+      return *this;
+    }
+    PORTABLE_INLINE_FUNCTION
+    Element &operator=(const Element &other) {
+      return *this = static_cast<Real>(other);
+    }
+    PORTABLE_INLINE_FUNCTION
+    operator Real() const { return data_[i_] / scale_; }
+
+   private:
+    Indexer &data_;
+    int i_;
+    Real scale_;
+  };
+
+  PORTABLE_INLINE_FUNCTION
+  ScaledData(Indexer &data, const Real scale) : data_(data), scale_(scale) {}
+
+  PORTABLE_INLINE_FUNCTION
+  Element operator[](const int i) const { return Element(data_, i, scale_); }
+
+ private:
+  Indexer &data_;
+  Real scale_;
+};
+
 } // namespace indexers
 } // namespace singularity
 
@@ -0,0 +1,70 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+#ifndef SINGULARITY_OPAC_BASE_LOOKUP_STATE_
+#define SINGULARITY_OPAC_BASE_LOOKUP_STATE_
+
+#include <ports-of-call/portability.hpp>
+#include <spiner/interpolation.hpp>
+
+namespace singularity {
+
+// Where a point (rho, T, Ye) falls in the tables of a model: the
+// lower node of the cell holding it on each axis and the two
+// interpolation weights. PrepareLookup fills one, and each query has
+// an overload taking it in place of rho, temp and Ye, so a zone that
+// makes several queries at one point takes the logarithms and finds
+// the cell once. A state is only meaningful to the model that
+// prepared it. Models without tables just record the point.
+struct LookupState {
+  // The point, in the units of the model that prepared the state
+  Real rho = 0;
+  Real temp = 0;
+  Real Ye = 0;
+  int iRho = 0;
+  int iT = 0;
+  int iYe = 0;
+  Real wRho[2] = {1, 0};
+  Real wT[2] = {1, 0};
+  Real wYe[2] = {1, 0};
+};
+
+namespace impl {
+
+// Lower node and weights of the cell of grid g holding x
+template <typename Grid>
+PORTABLE_INLINE_FUNCTION void locate(const Grid &g, const Real x, int &ix,
+                                     Real w[2]) {
+  Spiner::weights_t sw;
+  g.weights(x, ix, sw);
+  w[0] = sw[0];
+  w[1] = sw[1];
+}
+
+// A state for models that have nothing to look up
+PORTABLE_INLINE_FUNCTION LookupState pointState(const Real rho,
+                                                const Real temp,
+                                                const Real Ye) {
+  LookupState s;
+  s.rho = rho;
+  s.temp = temp;
+  s.Ye = Ye;
+  return s;
+}
+
+} // namespace impl
+} // namespace singularity
+
+#endif // SINGULARITY_OPAC_BASE_LOOKUP_STATE_
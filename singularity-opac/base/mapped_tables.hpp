@@ -0,0 +1,489 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+#ifndef SINGULARITY_OPAC_BASE_MAPPED_TABLES_
+#define SINGULARITY_OPAC_BASE_MAPPED_TABLES_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef SINGULARITY_USE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef SINGULARITY_USE_MPI
+#include <mpi.h>
+#endif
+
+#include <ports-of-call/portability.hpp>
+#include <spiner/databox.hpp>
+#include <spiner/interpolation.hpp>
+#include <spiner/spiner_types.hpp>
+
+#include <singularity-opac/base/opac_error.hpp>
+#include <singularity-opac/base/table_storage.hpp>
+
+// Raw table files hold DataBoxes exactly as they sit in memory, so
+// they can be memory-mapped and used in place instead of being read
+// through HDF5. A file is a header, a directory with one entry per
+// table, then the data of each table aligned to a cache line. Files
+// are only meant to be read on the kind of machine that wrote them;
+// the header records the byte order and the loader rejects others.
+// The same image can be placed in shared memory, so that processes
+// on a node share one copy of the tables. Mapping files and POSIX
+// shared memory need SINGULARITY_USE_MMAP; writing raw files and MPI
+// shared windows do not.
+
+namespace singularity {
+
+// Tag selecting the raw format in file constructors, e.g.,
+// SpinerOpacity(filename, RawFormat())
+struct RawFormat {};
+
+// Tag selecting a POSIX shared memory segment, created by SaveShared,
+// in place of a file
+struct SharedMemory {};
+
+#ifdef SINGULARITY_USE_MMAP
+// Removes a shared memory segment created by SaveShared. Processes
+// that have attached to it keep their mapping until they Finalize.
+inline void RemoveSharedTables(const std::string &name) {
+  shm_unlink(name.c_str());
+}
+#endif
+
+namespace impl {
+
+struct RawHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t byte_order;
+  std::uint32_t log_base;
+  std::uint32_t ntables;
+};
+
+// Axes are in DataBox order, fastest first. Grids are only
+// meaningful for interpolated axes.
+struct RawEntry {
+  enum { NAMELEN = 64 };
+  char name[NAMELEN];
+  std::int32_t rank;
+  std::int32_t dims[Spiner::MAXRANK];
+  std::int32_t index_types[Spiner::MAXRANK];
+  std::int32_t npoints[Spiner::MAXRANK];
+  double min[Spiner::MAXRANK];
+  double max[Spiner::MAXRANK];
+  std::uint64_t offset;
+  std::uint64_t bytes;
+};
+
+constexpr char RAW_MAGIC[8] = {'S', 'O', 'P', 'A', 'C', 'R', 'A', 'W'};
+constexpr std::uint32_t RAW_VERSION = 1;
+constexpr std::uint32_t RAW_BYTE_ORDER = 0x01020304;
+constexpr std::size_t RAW_ALIGNMENT = 64;
+
+static_assert(sizeof(Real) == sizeof(double),
+              "raw table files hold double precision tables");
+static_assert(sizeof(RawHeader) == 24 && sizeof(RawEntry) == 256,
+              "raw table file layout must not depend on the compiler");
+
+// Collects tables and writes them to a raw file. Only references to
+// the tables are kept, so they must outlive write.
+class RawTableWriter {
+ public:
+  void add(const char *name, const Spiner::DataBox &db) {
+    if (std::strlen(name) >= RawEntry::NAMELEN) {
+      OPAC_ERROR("mapped_tables: table name too long\n");
+    }
+    names_.push_back(name);
+    tables_.push_back(db);
+  }
+
+  void write(const std::string &filename, const TableEncoding encoding) const {
+    const std::size_t ntables = tables_.size();
+    RawHeader header;
+    std::vector<RawEntry> entries;
+    layout_(encoding, header, entries);
+
+    std::FILE *f = std::fopen(filename.c_str(), "wb");
+    if (f == nullptr) {
+      OPAC_ERROR("mapped_tables: could not open file for writing\n");
+    }
+    bool ok = (std::fwrite(&header, sizeof(header), 1, f) == 1);
+    if (ntables > 0) {
+      ok = ok && (std::fwrite(entries.data(), sizeof(RawEntry), ntables, f) ==
+                  ntables);
+    }
+    std::size_t pos = sizeof(RawHeader) + ntables * sizeof(RawEntry);
+    const char zeros[RAW_ALIGNMENT] = {};
+    for (std::size_t t = 0; t < ntables && ok; ++t) {
+      ok = (std::fwrite(zeros, 1, entries[t].offset - pos, f) ==
+            entries[t].offset - pos);
+      ok = ok && (std::fwrite(&tables_[t](0), 1, entries[t].bytes, f) ==
+                  entries[t].bytes);
+      pos = entries[t].offset + entries[t].bytes;
+    }
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok) {
+      OPAC_ERROR("mapped_tables: error writing file\n");
+    }
+  }
+
+  // Size of the image written by write or serialize
+  std::size_t bytes() const {
+    RawHeader header;
+    std::vector<RawEntry> entries;
+    return layout_(TableEncoding::Log2, header, entries);
+  }
+
+  // Writes the image to dst, which must hold bytes(). The magic
+  // number is written last, so a reader in another process that sees
+  // it sees the whole image.
+  void serialize(char *dst, const TableEncoding encoding) const {
+    const std::size_t ntables = tables_.size();
+    RawHeader header;
+    std::vector<RawEntry> entries;
+    const std::size_t size = layout_(encoding, header, entries);
+    std::memset(dst, 0, size);
+    RawHeader unfinished = header;
+    std::memset(unfinished.magic, 0, sizeof(unfinished.magic));
+    std::memcpy(dst, &unfinished, sizeof(unfinished));
+    if (ntables > 0) {
+      std::memcpy(dst + sizeof(RawHeader), entries.data(),
+                  ntables * sizeof(RawEntry));
+    }
+    for (std::size_t t = 0; t < ntables; ++t) {
+      std::memcpy(dst + entries[t].offset, &tables_[t](0), entries[t].bytes);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(dst, header.magic, sizeof(header.magic));
+  }
+
+ private:
+  static std::size_t align_(const std::size_t n) {
+    return (n + RAW_ALIGNMENT - 1) / RAW_ALIGNMENT * RAW_ALIGNMENT;
+  }
+  // Fills the header and directory and returns the size of the image
+  std::size_t layout_(const TableEncoding encoding, RawHeader &header,
+                      std::vector<RawEntry> &entries) const {
+    const std::size_t ntables = tables_.size();
+    std::memcpy(header.magic, RAW_MAGIC, sizeof(RAW_MAGIC));
+    header.version = RAW_VERSION;
+    header.byte_order = RAW_BYTE_ORDER;
+    header.log_base = static_cast<std::uint32_t>(encoding);
+    header.ntables = static_cast<std::uint32_t>(ntables);
+
+    entries.resize(ntables);
+    std::size_t offset =
+        align_(sizeof(RawHeader) + ntables * sizeof(RawEntry));
+    for (std::size_t t = 0; t < ntables; ++t) {
+      const Spiner::DataBox &db = tables_[t];
+      RawEntry &e = entries[t];
+      std::memset(&e, 0, sizeof(e));
+      std::strncpy(e.name, names_[t].c_str(), RawEntry::NAMELEN - 1);
+      e.rank = db.rank();
+      for (int i = 0; i < db.rank(); ++i) {
+        e.dims[i] = db.dim(i + 1);
+        e.index_types[i] = static_cast<std::int32_t>(db.indexType(i));
+        if (db.indexType(i) == Spiner::IndexType::Interpolated) {
+          e.npoints[i] = db.range(i).nPoints();
+          e.min[i] = db.range(i).min();
+          e.max[i] = db.range(i).max();
+        }
+      }
+      e.offset = offset;
+      e.bytes = static_cast<std::uint64_t>(db.size()) * sizeof(Real);
+      offset = align_(offset + e.bytes);
+    }
+    return offset;
+  }
+  std::vector<std::string> names_;
+  std::vector<Spiner::DataBox> tables_;
+};
+
+#ifdef SINGULARITY_USE_MMAP
+// Creates shared memory segment name holding the image of writer.
+// Fails if the segment already exists.
+inline void createSharedTables(const std::string &name,
+                               const RawTableWriter &writer,
+                               const TableEncoding encoding) {
+  const std::size_t size = writer.bytes();
+  const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    OPAC_ERROR("mapped_tables: could not create shared memory segment\n");
+  }
+  void *p = MAP_FAILED;
+  if (ftruncate(fd, static_cast<off_t>(size)) == 0) {
+    p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  ::close(fd);
+  if (p == MAP_FAILED) {
+    shm_unlink(name.c_str());
+    OPAC_ERROR("mapped_tables: could not map shared memory segment\n");
+  }
+  writer.serialize(static_cast<char *>(p), encoding);
+  munmap(p, size);
+}
+#endif
+
+// Raw tables mapped read-only into memory, from a file, a POSIX
+// shared memory segment, or an MPI shared window. Tables returned by
+// get wrap the mapped pages without copying, so every process that
+// maps the same tables shares one copy of them. Like DataBoxes,
+// copies are shallow: the mapping lives until close is called, which
+// invalidates every table taken from it. The tables must not be
+// written to.
+class MappedTables {
+ public:
+  MappedTables() = default;
+
+#ifdef SINGULARITY_USE_MMAP
+  void open(const std::string &filename) {
+    close();
+    map_(::open(filename.c_str(), O_RDONLY));
+  }
+
+  // Attaches to a segment created by createSharedTables, which must
+  // have finished
+  void attachShared(const std::string &name) {
+    close();
+    map_(shm_open(name.c_str(), O_RDONLY, 0));
+  }
+#endif
+
+#ifdef SINGULARITY_USE_MPI
+  // Collective over node, whose ranks must share memory, e.g., from
+  // MPI_Comm_split_type with MPI_COMM_TYPE_SHARED. Rank 0 calls
+  // load(share), which loads the tables and passes share a writer
+  // holding them. share places their image in a shared window, which
+  // every rank then maps. Rank 0 tells the others whether it loaded
+  // the tables before anyone allocates the window, so a failed load
+  // is an error on every rank rather than a hang on all but one.
+  // Takes ownership of node. close is then collective too.
+  template <typename Load>
+  void shareOnNode(MPI_Comm node, const TableEncoding encoding,
+                   const Load &load) {
+    close();
+    int rank;
+    MPI_Comm_rank(node, &rank);
+    if (rank != 0) {
+      int loaded = 0;
+      MPI_Bcast(&loaded, 1, MPI_INT, 0, node);
+      if (!loaded) {
+        MPI_Comm_free(&node);
+        OPAC_ERROR("mapped_tables: node leader could not load tables\n");
+      }
+      allocateWindow_(node, nullptr, encoding);
+      return;
+    }
+    bool announced = false;
+    auto share = [&](const RawTableWriter &writer) {
+      int loaded = 1;
+      MPI_Bcast(&loaded, 1, MPI_INT, 0, node);
+      announced = true;
+      allocateWindow_(node, &writer, encoding);
+    };
+#ifdef SINGULARITY_ENABLE_EXCEPTIONS
+    try {
+      load(share);
+    } catch (...) {
+      if (!announced) {
+        announceFailure_(node);
+      }
+      throw;
+    }
+#else
+    load(share);
+#endif
+    if (!announced) {
+      announceFailure_(node);
+      OPAC_ERROR("mapped_tables: node leader has no tables to share\n");
+    }
+  }
+#endif
+
+  void close() {
+#ifdef SINGULARITY_USE_MPI
+    if (window_) {
+      MPI_Win_free(&win_);
+      MPI_Comm_free(&node_);
+      window_ = false;
+      base_ = nullptr;
+    }
+#endif
+#ifdef SINGULARITY_USE_MMAP
+    if (base_ != nullptr) {
+      munmap(const_cast<char *>(base_), size_);
+    }
+#endif
+    base_ = nullptr;
+    size_ = 0;
+  }
+
+  bool isOpen() const { return base_ != nullptr; }
+
+  TableEncoding encoding() const {
+    return static_cast<TableEncoding>(header_().log_base);
+  }
+
+  bool has(const char *name) const { return find_(name) != nullptr; }
+
+  // A DataBox over the mapped data of table name, with its grids
+  Spiner::DataBox get(const char *name) const {
+    const RawEntry *e = find_(name);
+    if (e == nullptr) {
+      OPAC_ERROR("mapped_tables: table not in file\n");
+    }
+    Real *data = reinterpret_cast<Real *>(const_cast<char *>(base_) +
+                                          e->offset);
+    const std::int32_t *n = e->dims;
+    Spiner::DataBox db;
+    switch (e->rank) {
+    case 1:
+      db = Spiner::DataBox(data, n[0]);
+      break;
+    case 2:
+      db = Spiner::DataBox(data, n[1], n[0]);
+      break;
+    case 3:
+      db = Spiner::DataBox(data, n[2], n[1], n[0]);
+      break;
+    case 4:
+      db = Spiner::DataBox(data, n[3], n[2], n[1], n[0]);
+      break;
+    case 5:
+      db = Spiner::DataBox(data, n[4], n[3], n[2], n[1], n[0]);
+      break;
+    default:
+      OPAC_ERROR("mapped_tables: unsupported table rank\n");
+    }
+    for (int i = 0; i < e->rank; ++i) {
+      const auto type = static_cast<Spiner::IndexType>(e->index_types[i]);
+      if (type == Spiner::IndexType::Interpolated) {
+        db.setRange(i, e->min[i], e->max[i], e->npoints[i]);
+      } else {
+        db.setIndexType(i, type);
+      }
+    }
+    return db;
+  }
+
+ private:
+#ifdef SINGULARITY_USE_MMAP
+  // Maps the whole of the open file descriptor fd, and closes it
+  void map_(const int fd) {
+    if (fd < 0) {
+      OPAC_ERROR("mapped_tables: could not open tables\n");
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 0 ||
+        static_cast<std::size_t>(st.st_size) < sizeof(RawHeader)) {
+      ::close(fd);
+      OPAC_ERROR("mapped_tables: too small to hold tables\n");
+    }
+    const std::size_t size = static_cast<std::size_t>(st.st_size);
+    void *p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping holds its own reference to the file
+    ::close(fd);
+    if (p == MAP_FAILED) {
+      OPAC_ERROR("mapped_tables: mmap failed\n");
+    }
+    base_ = static_cast<const char *>(p);
+    size_ = size;
+    validate_();
+  }
+#endif
+  void validate_() {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const RawHeader &h = header_();
+    if (std::memcmp(h.magic, RAW_MAGIC, sizeof(RAW_MAGIC)) != 0 ||
+        h.version != RAW_VERSION || h.byte_order != RAW_BYTE_ORDER ||
+        size_ < sizeof(RawHeader) + h.ntables * sizeof(RawEntry)) {
+      close();
+      OPAC_ERROR("mapped_tables: not raw tables for this machine\n");
+    }
+    for (std::uint32_t t = 0; t < h.ntables; ++t) {
+      const RawEntry &e = entries_()[t];
+      if (e.offset % RAW_ALIGNMENT != 0 || e.offset + e.bytes > size_) {
+        close();
+        OPAC_ERROR("mapped_tables: tables are truncated or corrupt\n");
+      }
+    }
+  }
+  const RawHeader &header_() const {
+    return *reinterpret_cast<const RawHeader *>(base_);
+  }
+  const RawEntry *entries_() const {
+    return reinterpret_cast<const RawEntry *>(base_ + sizeof(RawHeader));
+  }
+  const RawEntry *find_(const char *name) const {
+    if (base_ == nullptr) return nullptr;
+    for (std::uint32_t t = 0; t < header_().ntables; ++t) {
+      if (std::strncmp(entries_()[t].name, name, RawEntry::NAMELEN) == 0) {
+        return entries_() + t;
+      }
+    }
+    return nullptr;
+  }
+#ifdef SINGULARITY_USE_MPI
+  // Places the image of writer, which only rank 0 passes, in a shared
+  // window over node and maps it
+  void allocateWindow_(MPI_Comm node, const RawTableWriter *writer,
+                       const TableEncoding encoding) {
+    const MPI_Aint size = (writer != nullptr) ? writer->bytes() : 0;
+    char *mine;
+    MPI_Win_allocate_shared(size, 1, MPI_INFO_NULL, node, &mine, &win_);
+    if (writer != nullptr) {
+      writer->serialize(mine, encoding);
+    }
+    // Completes the copy before any rank reads it
+    MPI_Win_fence(0, win_);
+    MPI_Aint shared_size;
+    int disp;
+    char *shared;
+    MPI_Win_shared_query(win_, 0, &shared_size, &disp, &shared);
+    node_ = node;
+    window_ = true;
+    base_ = shared;
+    size_ = static_cast<std::size_t>(shared_size);
+    validate_();
+  }
+  static void announceFailure_(MPI_Comm node) {
+    int loaded = 0;
+    MPI_Bcast(&loaded, 1, MPI_INT, 0, node);
+    MPI_Comm_free(&node);
+  }
+#endif
+  const char *base_ = nullptr;
+  std::size_t size_ = 0;
+#ifdef SINGULARITY_USE_MPI
+  MPI_Comm node_ = MPI_COMM_NULL;
+  MPI_Win win_ = MPI_WIN_NULL;
+  bool window_ = false;
+#endif
+};
+
+} // namespace impl
+} // namespace singularity
+
+#endif // SINGULARITY_OPAC_BASE_MAPPED_TABLES_
@@ -0,0 +1,353 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+#ifndef SINGULARITY_OPAC_BASE_MEAN_QUADRATURE_
+#define SINGULARITY_OPAC_BASE_MEAN_QUADRATURE_
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <ports-of-call/portability.hpp>
+#include <singularity-opac/base/opac_error.hpp>
+#include <singularity-opac/base/robust_utils.hpp>
+
+namespace singularity {
+
+// Rule mean opacity tables integrate over frequency with. Trapezoid
+// spaces points evenly in log nu over one range for the whole table.
+// The others follow the temperature of each node, in x = h nu / k T.
+// GaussLaguerre puts points on 0 < x < infinity, and is exact for
+// integrands that are e^-x times a polynomial of degree below twice
+// points. GaussKronrod bisects 15 point Gauss-Kronrod panels on
+// 0 < x < 64 until the estimated relative error of every integral is
+// below tolerance, or there are maxPanels panels.
+enum class QuadratureRule { Trapezoid, GaussLaguerre, GaussKronrod };
+
+// points is used by Trapezoid and GaussLaguerre, tolerance and
+// maxPanels by GaussKronrod. Thermal spectra are smooth in x, so
+// GaussLaguerre with 16 to 32 points is usually accurate far beyond
+// the interpolation error of the table, unless the opacity has
+// features narrower than the peak.
+struct MeanQuadrature {
+  QuadratureRule rule = QuadratureRule::Trapezoid;
+  int points = 100;
+  Real tolerance = 1e-4;
+  int maxPanels = 32;
+};
+
+namespace impl {
+
+// Constructors that choose their own frequencies integrate from
+// THERMAL_NU_LOW k T / h at the lowest temperature to THERMAL_NU_HIGH
+// k T / h at the highest.
+constexpr Real THERMAL_NU_LOW = 1.e-3;
+constexpr Real THERMAL_NU_HIGH = 1.e3;
+
+// Sums over frequency of the integrands of the Planck and Rosseland
+// means, and the means per unit density they give
+struct MeanSums {
+  enum { PLANCK_NUM, PLANCK_DENOM, ROSSELAND_NUM, ROSSELAND_DENOM, N };
+  Real sum[N] = {0, 0, 0, 0};
+
+  void add(const Real w, const Real rho, const Real alpha, const Real B,
+           const Real dBdT) {
+    sum[PLANCK_NUM] += w * alpha / rho * B;
+    sum[PLANCK_DENOM] += w * B;
+    // Only contributions to integral from non-zero kappa
+    if (alpha > singularity_opac::robust::SMALL()) {
+      sum[ROSSELAND_NUM] +=
+          w * singularity_opac::robust::ratio(rho, alpha) * dBdT;
+      sum[ROSSELAND_DENOM] += w * dBdT;
+    }
+  }
+  void add(const MeanSums &other) {
+    for (int c = 0; c < N; ++c) {
+      sum[c] += other.sum[c];
+    }
+  }
+
+  Real Planck() const {
+    return singularity_opac::robust::ratio(sum[PLANCK_NUM],
+                                           sum[PLANCK_DENOM]);
+  }
+  Real Rosseland() const {
+    return Planck() > singularity_opac::robust::SMALL()
+               ? singularity_opac::robust::ratio(sum[ROSSELAND_DENOM],
+                                                 sum[ROSSELAND_NUM])
+               : 0.;
+  }
+};
+
+// Nodes of the n point Gauss-Laguerre rule, and weights w e^x, so
+// that sum w f(x) approximates the integral of f(x) on 0 < x <
+// infinity. Newton iteration from the usual asymptotic guesses.
+inline void gaussLaguerre(const int n, std::vector<Real> &x,
+                          std::vector<Real> &w) {
+  constexpr int MAXIT = 100;
+  x.resize(n);
+  w.resize(n);
+  Real z = 0;
+  for (int i = 0; i < n; ++i) {
+    if (i == 0) {
+      z = 3. / (1. + 2.4 * n);
+    } else if (i == 1) {
+      z += 15. / (1. + 2.5 * n);
+    } else {
+      const Real ai = i - 1;
+      z += (1. + 2.55 * ai) / (1.9 * ai) * (z - x[i - 2]);
+    }
+    Real p1 = 1, p2 = 0, pp = 0;
+    for (int it = 0; it < MAXIT; ++it) {
+      p1 = 1;
+      p2 = 0;
+      for (int j = 1; j <= n; ++j) {
+        const Real p3 = p2;
+        p2 = p1;
+        p1 = ((2 * j - 1 - z) * p2 - (j - 1) * p3) / j;
+      }
+      pp = n * (p1 - p2) / z;
+      const Real z1 = z;
+      z = z1 - p1 / pp;
+      if (std::abs(z - z1) <= 1e-14 * z) break;
+    }
+    x[i] = z;
+    w[i] = -std::exp(z) / (pp * n * p2);
+  }
+}
+
+// Integrates the mean opacity integrands over frequency with a
+// MeanQuadrature. The Trapezoid range is fixed at construction. The
+// integrands come from eval(nu, n, alpha, B, dBdT), which fills
+// alpha, B and dBdT at the n frequencies nu, so that opacities may
+// be evaluated in batches. Safe to call from several threads.
+class FrequencyQuadrature {
+ public:
+  // nuMin and nuMax bound the Trapezoid rule, and are otherwise
+  // ignored
+  FrequencyQuadrature(const MeanQuadrature &quadrature, const Real nuMin,
+                      const Real nuMax)
+      : quadrature_(quadrature) {
+    const int n = quadrature.points;
+    switch (quadrature.rule) {
+    case QuadratureRule::Trapezoid: {
+      if (n < 2) {
+        OPAC_ERROR("FrequencyQuadrature: Trapezoid needs 2 or more points\n");
+      }
+      const Real dlnu = std::log(nuMax / nuMin) / (n - 1);
+      x_.resize(n);
+      w_.resize(n);
+      for (int i = 0; i < n; ++i) {
+        const Real weight = (i == 0 || i == n - 1) ? 0.5 : 1.;
+        x_[i] = nuMin * std::exp(i * dlnu);
+        w_[i] = weight * x_[i] * dlnu;
+      }
+      break;
+    }
+    case QuadratureRule::GaussLaguerre:
+      // Keeps the polynomials and e^x at the largest nodes in range
+      if (n < 1 || n > 100) {
+        OPAC_ERROR("FrequencyQuadrature: GaussLaguerre takes 1 to 100 "
+                   "points\n");
+      }
+      gaussLaguerre(n, x_, w_);
+      break;
+    case QuadratureRule::GaussKronrod:
+      if (quadrature.tolerance <= 0 || quadrature.maxPanels < 1) {
+        OPAC_ERROR("FrequencyQuadrature: GaussKronrod needs a positive "
+                   "tolerance and maxPanels\n");
+      }
+      break;
+    }
+  }
+
+  // Frequencies integrate evaluates at temperature nuT, in the order
+  // it passes them to eval, so that parts of the integrands that
+  // depend only on T may be filled once per temperature. Empty for
+  // GaussKronrod, whose nodes depend on the integrands.
+  std::vector<Real> nodes(const Real nuT) const {
+    if (quadrature_.rule == QuadratureRule::GaussKronrod) {
+      return std::vector<Real>();
+    }
+    const Real scale = scale_(nuT);
+    std::vector<Real> nu(x_.size());
+    for (std::size_t i = 0; i < x_.size(); ++i) {
+      nu[i] = scale * x_[i];
+    }
+    return nu;
+  }
+
+  // Sums at density rho and temperature T, where nuT = k T / h
+  template <typename Evaluate>
+  MeanSums integrate(const Real rho, const Real nuT, Evaluate &&eval) const {
+    if (quadrature_.rule == QuadratureRule::GaussKronrod) {
+      return integrateAdaptive_(rho, nuT, eval);
+    }
+    const Real scale = scale_(nuT);
+    const std::vector<Real> nu = nodes(nuT);
+    const int n = nu.size();
+    std::vector<Real> alpha(n), B(n), dBdT(n);
+    eval(nu.data(), n, alpha.data(), B.data(), dBdT.data());
+    MeanSums sums;
+    for (int i = 0; i < n; ++i) {
+      sums.add(scale * w_[i], rho, alpha[i], B[i], dBdT[i]);
+    }
+    return sums;
+  }
+
+ private:
+  static constexpr int NGK = 15;
+  static constexpr Real XMAX = 64;
+  // Trapezoid nodes are frequencies already
+  Real scale_(const Real nuT) const {
+    return (quadrature_.rule == QuadratureRule::Trapezoid) ? 1. : nuT;
+  }
+  struct Panel {
+    Real a, b;
+    MeanSums kronrod;
+    Real error[MeanSums::N];
+  };
+
+  // 15 point Kronrod and embedded 7 point Gauss rules on a < x < b
+  template <typename Evaluate>
+  Panel panel_(const Real a, const Real b, const Real rho, const Real nuT,
+               Evaluate &eval) const {
+    // abscissae on (-1, 1), the last at the center, and their weights
+    constexpr Real XGK[8] = {
+        0.991455371120812639206854697526329,
+        0.949107912342758524526189684047851,
+        0.864864423359769072789712788640926,
+        0.741531185599394439863864773280788,
+        0.586087235467691130294144845693013,
+        0.405845151377397166906606412076961,
+        0.207784955007898467600689403773245,
+        0.000000000000000000000000000000000};
+    constexpr Real WGK[8] = {
+        0.022935322010529224963732008058970,
+        0.063092092629978553290700663189204,
+        0.104790010322250183839876322541518,
+        0.140653259715525918745189590510238,
+        0.169004726639267902826583426598550,
+        0.190350578064785409913256402421014,
+        0.204432940075298892414161999234649,
+        0.209482141084727828012999174891714};
+    // Gauss weights of the odd abscissae above
+    constexpr Real WG[4] = {
+        0.129484966168869693270611432679082,
+        0.279705391489276667901467771423780,
+        0.381830050505118944950369775488975,
+        0.417959183673469387755102040816327};
+    const Real center = 0.5 * (a + b);
+    const Real half = 0.5 * (b - a);
+    Real nu[NGK], alpha[NGK], B[NGK], dBdT[NGK], wk[NGK], wg[NGK];
+    for (int j = 0; j < 8; ++j) {
+      const int jg = (j % 2 == 1) ? j / 2 : -1;
+      for (int s = 0; s < ((j < 7) ? 2 : 1); ++s) {
+        const int k = (s == 0) ? j : NGK - 1 - j;
+        const Real x = center + (s == 0 ? -1 : 1) * half * XGK[j];
+        nu[k] = nuT * x;
+        wk[k] = nuT * half * WGK[j];
+        wg[k] = (jg >= 0) ? nuT * half * WG[jg] : 0.;
+      }
+    }
+    eval(nu, NGK, alpha, B, dBdT);
+    Panel p;
+    p.a = a;
+    p.b = b;
+    MeanSums gauss;
+    MeanSums f[NGK];
+    for (int k = 0; k < NGK; ++k) {
+      f[k].add(1., rho, alpha[k], B[k], dBdT[k]);
+      p.kronrod.add(wk[k], rho, alpha[k], B[k], dBdT[k]);
+      gauss.add(wg[k], rho, alpha[k], B[k], dBdT[k]);
+    }
+    // |K - G| overestimates the error of K by far on smooth
+    // integrands, so it is scaled as in QUADPACK by the variation of
+    // the integrand over the panel
+    for (int c = 0; c < MeanSums::N; ++c) {
+      const Real mean = p.kronrod.sum[c] / (nuT * (b - a));
+      Real variation = 0;
+      for (int k = 0; k < NGK; ++k) {
+        variation += wk[k] * std::abs(f[k].sum[c] - mean);
+      }
+      p.error[c] = std::abs(p.kronrod.sum[c] - gauss.sum[c]);
+      if (variation > 0 && p.error[c] > 0) {
+        p.error[c] = variation * std::min(1., std::pow(200. * p.error[c] /
+                                                           variation,
+                                                       1.5));
+      }
+    }
+    return p;
+  }
+
+  // Bisects the panel that contributes the largest relative error to
+  // any integral until all of them meet the tolerance
+  template <typename Evaluate>
+  MeanSums integrateAdaptive_(const Real rho, const Real nuT,
+                              Evaluate &eval) const {
+    // The thermal peak is at a few x, so the first panels are
+    // narrower there
+    constexpr Real EDGES[4] = {0, 4, 16, XMAX};
+    std::vector<Panel> panels;
+    for (int i = 0; i < 3; ++i) {
+      panels.push_back(panel_(EDGES[i], EDGES[i + 1], rho, nuT, eval));
+    }
+    while (true) {
+      MeanSums total;
+      Real error[MeanSums::N] = {0, 0, 0, 0};
+      for (const Panel &p : panels) {
+        total.add(p.kronrod);
+        for (int c = 0; c < MeanSums::N; ++c) {
+          error[c] += p.error[c];
+        }
+      }
+      bool converged = true;
+      for (int c = 0; c < MeanSums::N; ++c) {
+        converged = converged &&
+                    error[c] <= quadrature_.tolerance * std::abs(total.sum[c]);
+      }
+      if (converged ||
+          static_cast<int>(panels.size()) >= quadrature_.maxPanels) {
+        return total;
+      }
+      std::size_t worst = 0;
+      Real worstError = -1;
+      for (std::size_t i = 0; i < panels.size(); ++i) {
+        for (int c = 0; c < MeanSums::N; ++c) {
+          if (total.sum[c] == 0) continue;
+          const Real e = panels[i].error[c] / std::abs(total.sum[c]);
+          if (e > worstError) {
+            worstError = e;
+            worst = i;
+          }
+        }
+      }
+      const Real a = panels[worst].a;
+      const Real b = panels[worst].b;
+      const Real mid = 0.5 * (a + b);
+      panels[worst] = panel_(a, mid, rho, nuT, eval);
+      panels.push_back(panel_(mid, b, rho, nuT, eval));
+    }
+  }
+
+  MeanQuadrature quadrature_;
+  // Trapezoid frequencies or Gauss-Laguerre x, and their weights
+  std::vector<Real> x_, w_;
+};
+
+} // namespace impl
+} // namespace singularity
+
+#endif // SINGULARITY_OPAC_BASE_MEAN_QUADRATURE_
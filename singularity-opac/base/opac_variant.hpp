@@ -0,0 +1,201 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+#ifndef SINGULARITY_OPAC_BASE_OPAC_VARIANT_
+#define SINGULARITY_OPAC_BASE_OPAC_VARIANT_
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include <ports-of-call/portability.hpp>
+#include <variant/include/mpark/variant.hpp>
+
+// Storage and dispatch of the opacity variants. A variant of several
+// models is an mpark::variant. A variant of exactly one model holds
+// that model directly, so it is the size of the model and every call
+// through it goes straight to the model, where the compiler can
+// inline it. The variant classes only touch their storage through
+// visit, get and holds_alternative, which work for both.
+//
+// mpark::visit dispatches through a table of function pointers, which
+// CPU compilers often can't see through, so the call can't be inlined
+// or vectorized. With SINGULARITY_VARIANT_SWITCH (the CMake option of
+// the same name), visit uses switchVisit instead, a switch on the
+// index whose cases call the visitor directly.
+
+namespace singularity {
+namespace impl {
+
+template <typename Model>
+class SingleModel {
+ public:
+  SingleModel() = default;
+
+  template <typename Choice,
+            typename std::enable_if<
+                !std::is_same<SingleModel,
+                              typename std::decay<Choice>::type>::value,
+                bool>::type = true>
+  PORTABLE_FUNCTION SingleModel(Choice &&choice)
+      : model_(std::forward<Choice>(choice)) {}
+
+  PORTABLE_FORCEINLINE_FUNCTION Model &model() { return model_; }
+  PORTABLE_FORCEINLINE_FUNCTION const Model &model() const { return model_; }
+
+ private:
+  Model model_;
+};
+
+template <typename... Models>
+struct OpacVariant {
+  using type = mpark::variant<Models...>;
+};
+template <typename Model>
+struct OpacVariant<Model> {
+  using type = SingleModel<Model>;
+};
+template <typename... Models>
+using opac_variant = typename OpacVariant<Models...>::type;
+
+constexpr std::size_t SWITCH_BLOCK = 8;
+
+template <std::size_t I, typename Variant>
+using HasAlternative = std::integral_constant<
+    bool, (I < mpark::variant_size<typename std::decay<Variant>::type>::value)>;
+
+// Calls f on alternative I of v, which must be the one v holds. Cases
+// past the last alternative are never taken, but must compile.
+template <std::size_t I, typename R, typename Visitor, typename Variant>
+PORTABLE_FORCEINLINE_FUNCTION
+    typename std::enable_if<HasAlternative<I, Variant>::value, R>::type
+    visitAlternative(Visitor &&f, Variant &v) {
+  return std::forward<Visitor>(f)(*mpark::get_if<I>(&v));
+}
+template <std::size_t I, typename R, typename Visitor, typename Variant>
+PORTABLE_FORCEINLINE_FUNCTION
+    typename std::enable_if<!HasAlternative<I, Variant>::value, R>::type
+    visitAlternative(Visitor &&f, Variant &v) {
+  return visitAlternative<0, R>(std::forward<Visitor>(f), v);
+}
+
+// One switch per block of SWITCH_BLOCK alternatives, starting at B.
+// Later blocks are reached from the default case, and the last one
+// leaves anything else, i.e., a valueless variant, to mpark::visit.
+template <std::size_t B, std::size_t N, bool LAST = (B + SWITCH_BLOCK >= N)>
+struct SwitchVisit {
+  template <typename R, typename Visitor, typename Variant>
+  PORTABLE_FORCEINLINE_FUNCTION static R visit(Visitor &&f, Variant &v) {
+    switch (v.index()) {
+    case B + 0:
+      return visitAlternative<B + 0, R>(std::forward<Visitor>(f), v);
+    case B + 1:
+      return visitAlternative<B + 1, R>(std::forward<Visitor>(f), v);
+    case B + 2:
+      return visitAlternative<B + 2, R>(std::forward<Visitor>(f), v);
+    case B + 3:
+      return visitAlternative<B + 3, R>(std::forward<Visitor>(f), v);
+    case B + 4:
+      return visitAlternative<B + 4, R>(std::forward<Visitor>(f), v);
+    case B + 5:
+      return visitAlternative<B + 5, R>(std::forward<Visitor>(f), v);
+    case B + 6:
+      return visitAlternative<B + 6, R>(std::forward<Visitor>(f), v);
+    case B + 7:
+      return visitAlternative<B + 7, R>(std::forward<Visitor>(f), v);
+    default:
+      return next<R>(std::forward<Visitor>(f), v);
+    }
+  }
+
+ private:
+  template <typename R, typename Visitor, typename Variant, bool L = LAST>
+  PORTABLE_FORCEINLINE_FUNCTION static typename std::enable_if<L, R>::type
+  next(Visitor &&f, Variant &v) {
+    return mpark::visit(std::forward<Visitor>(f), v);
+  }
+  template <typename R, typename Visitor, typename Variant, bool L = LAST>
+  PORTABLE_FORCEINLINE_FUNCTION static typename std::enable_if<!L, R>::type
+  next(Visitor &&f, Variant &v) {
+    return SwitchVisit<B + SWITCH_BLOCK, N>::template visit<R>(
+        std::forward<Visitor>(f), v);
+  }
+};
+
+// mpark::visit for one variant, as a switch on its index
+template <typename Visitor, typename Variant>
+PORTABLE_FORCEINLINE_FUNCTION decltype(auto) switchVisit(Visitor &&f,
+                                                         Variant &v) {
+  using V = typename std::decay<Variant>::type;
+  using R = decltype(std::declval<Visitor>()(*mpark::get_if<0>(&v)));
+  return SwitchVisit<0, mpark::variant_size<V>::value>::template visit<R>(
+      std::forward<Visitor>(f), v);
+}
+
+template <typename Visitor, typename... Models>
+PORTABLE_FORCEINLINE_FUNCTION decltype(auto)
+visit(Visitor &&f, mpark::variant<Models...> &v) {
+#ifdef SINGULARITY_VARIANT_SWITCH
+  return switchVisit(std::forward<Visitor>(f), v);
+#else
+  return mpark::visit(std::forward<Visitor>(f), v);
+#endif
+}
+template <typename Visitor, typename... Models>
+PORTABLE_FORCEINLINE_FUNCTION decltype(auto)
+visit(Visitor &&f, const mpark::variant<Models...> &v) {
+#ifdef SINGULARITY_VARIANT_SWITCH
+  return switchVisit(std::forward<Visitor>(f), v);
+#else
+  return mpark::visit(std::forward<Visitor>(f), v);
+#endif
+}
+template <typename Visitor, typename Model>
+PORTABLE_FORCEINLINE_FUNCTION decltype(auto) visit(Visitor &&f,
+                                                   SingleModel<Model> &v) {
+  return std::forward<Visitor>(f)(v.model());
+}
+template <typename Visitor, typename Model>
+PORTABLE_FORCEINLINE_FUNCTION decltype(auto)
+visit(Visitor &&f, const SingleModel<Model> &v) {
+  return std::forward<Visitor>(f)(v.model());
+}
+
+template <typename T, typename... Models>
+T &get(mpark::variant<Models...> &v) {
+  return mpark::get<T>(v);
+}
+template <typename T, typename Model>
+T &get(SingleModel<Model> &v) {
+  static_assert(std::is_same<T, Model>::value,
+                "The variant does not hold this model");
+  return v.model();
+}
+
+template <typename T, typename... Models>
+PORTABLE_FORCEINLINE_FUNCTION bool
+holds_alternative(const mpark::variant<Models...> &v) noexcept {
+  return mpark::holds_alternative<T>(v);
+}
+template <typename T, typename Model>
+PORTABLE_FORCEINLINE_FUNCTION bool
+holds_alternative(const SingleModel<Model> &v) noexcept {
+  return std::is_same<T, Model>::value;
+}
+
+} // namespace impl
+} // namespace singularity
+
+#endif // SINGULARITY_OPAC_BASE_OPAC_VARIANT_
@@ -18,6 +18,20 @@
 
 namespace SP5 {
 
+// File attribute holding the base of the tabulated logarithms
+constexpr char LogBase[] = "log base";
+
+// Tables saved quantized replace the databox dataset of their group
+// with these, and keep the grids
+namespace Quantized {
+constexpr char Values[] = "quantized values";
+constexpr char Offsets[] = "block offsets";
+constexpr char Scales[] = "block scales";
+constexpr char BlockSize[] = "block size";
+// Value of level 0. Files without it decode level 0 like the others.
+constexpr char Floor[] = "floor";
+} // namespace Quantized
+
 namespace Opac {
 constexpr char defaultFileName[] = "opac.sp5";
 constexpr char AbsorptionCoefficient[] = "absorption coefficient";
@@ -26,6 +40,16 @@ constexpr char AngleAveragedAbsorptionCoefficient[] =
 constexpr char EmissivityPerNu[] = "emissivity per nu";
 constexpr char TotalEmissivity[] = "total emissivity";
 constexpr char NumberEmissivity[] = "number emissivity";
+constexpr char Species[] = "species";
+// Nodes of the axes that aren't uniformly spaced, in the log base of
+// the file
+constexpr char EnergyNodes[] = "energy nodes";
+constexpr char YeNodes[] = "Ye nodes";
+constexpr char TemperatureNodes[] = "temperature nodes";
+constexpr char DensityNodes[] = "density nodes";
+// Energies below which given fractions of the emission lie, for
+// sampling emitted neutrinos
+constexpr char EmissionQuantiles[] = "emission energy quantiles";
 } // namespace Opac
 
 namespace MeanOpac {
@@ -0,0 +1,72 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+#ifndef SINGULARITY_OPAC_BASE_SUM_COMPONENTS_
+#define SINGULARITY_OPAC_BASE_SUM_COMPONENTS_
+
+#include <ports-of-call/portability.hpp>
+
+namespace singularity {
+namespace impl {
+
+// The models of a SumOpacity, held by value. forEach calls f on each
+// model in turn, so a sum can accumulate every component in one pass,
+// and the compiler sees every call, unlike a loop over a variant.
+template <typename... Models>
+class SumComponents;
+
+template <>
+class SumComponents<> {
+ public:
+  SumComponents GetOnDevice() { return *this; }
+  inline void Finalize() noexcept {}
+
+  template <typename F>
+  PORTABLE_FORCEINLINE_FUNCTION void forEach(F &&f) const {}
+};
+
+template <typename First, typename... Rest>
+class SumComponents<First, Rest...> {
+ public:
+  SumComponents() = default;
+  SumComponents(const First &first, const Rest &... rest)
+      : first_(first), rest_(rest...) {}
+
+  SumComponents GetOnDevice() {
+    return SumComponents(first_.GetOnDevice(), rest_.GetOnDevice());
+  }
+  inline void Finalize() noexcept {
+    first_.Finalize();
+    rest_.Finalize();
+  }
+
+  template <typename F>
+  PORTABLE_FORCEINLINE_FUNCTION void forEach(F &&f) const {
+    f(first_);
+    rest_.forEach(f);
+  }
+
+ private:
+  SumComponents(const First &first, const SumComponents<Rest...> &rest)
+      : first_(first), rest_(rest) {}
+
+  First first_;
+  SumComponents<Rest...> rest_;
+};
+
+} // namespace impl
+} // namespace singularity
+
+#endif // SINGULARITY_OPAC_BASE_SUM_COMPONENTS_
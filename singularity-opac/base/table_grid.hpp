@@ -0,0 +1,227 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+#ifndef SINGULARITY_OPAC_BASE_TABLE_GRID_
+#define SINGULARITY_OPAC_BASE_TABLE_GRID_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+#include <ports-of-call/portability.hpp>
+#include <spiner/databox.hpp>
+#include <spiner/interpolation.hpp>
+
+#include <singularity-opac/base/opac_error.hpp>
+#include <singularity-opac/base/table_storage.hpp>
+
+namespace singularity {
+
+// What a table lookup does at a point outside the table on one axis.
+// Extrapolate continues the first or last cell, which for tables of
+// logs is a power law. Clamp holds the point on the edge of the
+// table. Fallback extrapolates as well, but the point is not
+// InTable, so a WithFallback wrapper hands it to another model.
+enum class OutOfRange { Extrapolate, Clamp, Fallback };
+
+// Out of range policy of each axis. Axes a table doesn't have are
+// ignored. Energy is only an axis of spectral tables.
+struct OutOfRangePolicy {
+  OutOfRange rho = OutOfRange::Extrapolate;
+  OutOfRange T = OutOfRange::Extrapolate;
+  OutOfRange Ye = OutOfRange::Extrapolate;
+  OutOfRange e = OutOfRange::Extrapolate;
+};
+
+namespace impl {
+
+// The limits an OutOfRange policy puts on one axis. Axes that don't
+// clamp get infinite limits, so applying them is a min and a max
+// whatever the policy, with no branches in the lookup.
+class AxisBounds {
+ public:
+  AxisBounds() = default;
+  AxisBounds(const OutOfRange policy, const Real min, const Real max)
+      : min_(min), max_(max), fallback_(policy == OutOfRange::Fallback) {
+    if (policy == OutOfRange::Clamp) {
+      lo_ = min;
+      hi_ = max;
+    }
+  }
+
+  // x, clamped to the table if the policy is to clamp
+  PORTABLE_FORCEINLINE_FUNCTION Real operator()(const Real x) const {
+    return std::min(std::max(x, lo_), hi_);
+  }
+  // False only for points outside the table on a Fallback axis,
+  // including NaN
+  PORTABLE_INLINE_FUNCTION bool covers(const Real x) const {
+    return !fallback_ || (x >= min_ && x <= max_);
+  }
+
+ private:
+  Real lo_ = -std::numeric_limits<Real>::infinity();
+  Real hi_ = std::numeric_limits<Real>::infinity();
+  Real min_ = -std::numeric_limits<Real>::infinity();
+  Real max_ = std::numeric_limits<Real>::infinity();
+  bool fallback_ = false;
+};
+
+// An interpolation axis with uniform spacing or with explicit,
+// strictly increasing nodes. The cell holding a point on a
+// non-uniform axis is found without a search: the axis is cut into
+// uniform bins no wider than its narrowest cell, and a map gives the
+// cell holding the start of each bin, so the point is in that cell or
+// the next. Points outside the nodes extrapolate the first or last
+// cell, as with Spiner::RegularGrid1D. Copies share the nodes, which
+// finalize frees.
+class TableGrid1D {
+ public:
+  // Limits the bin map of very unevenly spaced nodes. Past it, bins
+  // may span more than one node and lookups step over each of them.
+  enum { MAXBINS_PER_CELL = 64 };
+
+  TableGrid1D() = default;
+
+  explicit TableGrid1D(const Spiner::RegularGrid1D &g)
+      : regular_(g), min_(g.min()), max_(g.max()), N_(g.nPoints()) {}
+
+  // Copies the N nodes. Evenly spaced nodes make a uniform axis.
+  TableGrid1D(const Real *nodes, const int N) : N_(N) {
+    if (N < 2) {
+      OPAC_ERROR("TableGrid1D: at least two nodes are required\n");
+    }
+    Real minWidth = nodes[1] - nodes[0];
+    for (int i = 0; i + 1 < N; ++i) {
+      const Real width = nodes[i + 1] - nodes[i];
+      if (!(width > 0) || !std::isfinite(width)) {
+        OPAC_ERROR("TableGrid1D: nodes must be finite and increasing\n");
+      }
+      minWidth = std::min(minWidth, width);
+    }
+    min_ = nodes[0];
+    max_ = nodes[N - 1];
+    regular_ = Spiner::RegularGrid1D(min_, max_, N);
+    const Real dx = regular_.dx();
+    bool uniform = true;
+    for (int i = 0; i < N && uniform; ++i) {
+      uniform = std::abs(nodes[i] - regular_.x(i)) <= 1e-10 * dx;
+    }
+    if (uniform) {
+      return;
+    }
+    const Real nfit = std::ceil((max_ - min_) / minWidth);
+    nbins_ = static_cast<int>(
+        std::min(nfit, static_cast<Real>(MAXBINS_PER_CELL) * (N - 1)));
+    invBin_ = nbins_ / (max_ - min_);
+    storage_.allocate((2 * N - 1) * sizeof(Real) + nbins_ * sizeof(int));
+    point_();
+    Real *x = storage_.data<Real>();
+    Real *invWidths = x + N;
+    int *cells = reinterpret_cast<int *>(invWidths + N - 1);
+    for (int i = 0; i < N; ++i) {
+      x[i] = nodes[i];
+    }
+    for (int i = 0; i + 1 < N; ++i) {
+      invWidths[i] = 1 / (nodes[i + 1] - nodes[i]);
+    }
+    const Real h = (max_ - min_) / nbins_;
+    for (int b = 0, i = 0; b < nbins_; ++b) {
+      while (i < N - 2 && nodes[i + 1] <= min_ + b * h) {
+        ++i;
+      }
+      cells[b] = i;
+    }
+  }
+
+  PORTABLE_INLINE_FUNCTION bool isUniform() const { return nodes_ == nullptr; }
+  PORTABLE_INLINE_FUNCTION int nPoints() const { return N_; }
+  PORTABLE_INLINE_FUNCTION Real min() const { return min_; }
+  PORTABLE_INLINE_FUNCTION Real max() const { return max_; }
+  PORTABLE_INLINE_FUNCTION Real x(const int i) const {
+    return isUniform() ? regular_.x(i) : nodes_[i];
+  }
+
+  // Lower node of the cell holding x, clamped to [0, N - 2]
+  PORTABLE_INLINE_FUNCTION int index(const Real x) const {
+    if (isUniform()) {
+      return regular_.index(x);
+    }
+    // Written so that NaN lands in the first bin
+    const Real fb = (x - min_) * invBin_;
+    const int b =
+        (fb > 0) ? static_cast<int>(std::min(fb, Real(nbins_ - 1))) : 0;
+    int ix = cells_[b];
+    while (ix < N_ - 2 && x >= nodes_[ix + 1]) {
+      ++ix;
+    }
+    return ix;
+  }
+
+  PORTABLE_INLINE_FUNCTION void weights(const Real x, int &ix,
+                                        Spiner::weights_t &w) const {
+    if (isUniform()) {
+      regular_.weights(x, ix, w);
+      return;
+    }
+    ix = index(x);
+    w[1] = (x - nodes_[ix]) * invWidths_[ix];
+    w[0] = 1 - w[1];
+  }
+
+  // The uniform grid with the same bounds and number of points. This
+  // is what DataBoxes record for a non-uniform axis.
+  Spiner::RegularGrid1D regular() const { return regular_; }
+
+  TableGrid1D getOnDevice() const {
+    TableGrid1D other = *this;
+    if (!isUniform()) {
+      other.storage_ = storage_.getOnDevice();
+      other.point_();
+    }
+    return other;
+  }
+
+  void finalize() {
+    storage_.finalize();
+    nodes_ = nullptr;
+    invWidths_ = nullptr;
+    cells_ = nullptr;
+  }
+
+ private:
+  // Nodes, then the inverse cell widths, then the bin map
+  void point_() {
+    nodes_ = storage_.data<Real>();
+    invWidths_ = nodes_ + N_;
+    cells_ = reinterpret_cast<const int *>(invWidths_ + N_ - 1);
+  }
+  Spiner::RegularGrid1D regular_;
+  AlignedStorage storage_;
+  const Real *nodes_ = nullptr;
+  const Real *invWidths_ = nullptr;
+  const int *cells_ = nullptr;
+  Real min_ = 0;
+  Real max_ = 0;
+  Real invBin_ = 0;
+  int nbins_ = 0;
+  int N_ = 0;
+};
+
+} // namespace impl
+} // namespace singularity
+
+#endif // SINGULARITY_OPAC_BASE_TABLE_GRID_
@@ -0,0 +1,768 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+#ifndef SINGULARITY_OPAC_BASE_TABLE_STORAGE_
+#define SINGULARITY_OPAC_BASE_TABLE_STORAGE_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <ports-of-call/portability.hpp>
+#include <spiner/databox.hpp>
+#include <spiner/interpolation.hpp>
+
+#include <singularity-opac/base/lookup_state.hpp>
+#include <singularity-opac/base/opac_error.hpp>
+#include <singularity-opac/base/sp5.hpp>
+
+namespace singularity {
+
+// Precision tabulated data is stored in. Interpolation and everything
+// after it is always done in Real; Float halves the memory and
+// bandwidth of a table at the cost of about seven significant digits
+// in the stored log values. Quantized stores 16-bit fixed point
+// values with an offset and scale per block of QUANTIZED_BLOCK
+// values, about a quarter of the memory of Double. The smallest value
+// of a table, the floor zeros are clamped to, is stored exactly and
+// left out of the range of its block. The error in any other stored
+// log is at most half a step, 1 / 131068 of the range of its block.
+enum class TablePrecision { Double, Float, Quantized };
+
+// Base of the logarithms tabulated data and its log coordinates are
+// stored in. Tables are built in base 2, so that lookups decode with
+// exp2; files written before the base was recorded hold base 10 and
+// are converted on load.
+enum class TableEncoding { Log10 = 10, Log2 = 2 };
+
+namespace impl {
+
+// Cache-line aligned storage for table data of any element type. The
+// bytes live in a Spiner::DataBox, so they are allocated, copied to
+// device, and freed the same way as every other table.
+class AlignedStorage {
+ public:
+  enum { CACHELINE = 64 };
+
+  AlignedStorage() = default;
+
+  // Allocates on host. Contents are uninitialized.
+  void allocate(const std::size_t bytes) {
+    constexpr int LINE = CACHELINE / sizeof(Real);
+    const std::size_t nlines = (bytes + CACHELINE - 1) / CACHELINE;
+    // One extra line so the data can start on a cache line boundary
+    box_.resize(static_cast<int>(nlines + 1), LINE);
+    shift_ = shift_of_(box_);
+    bytes_ = bytes;
+  }
+
+  AlignedStorage getOnDevice() const {
+    AlignedStorage other;
+    if (bytes_ == 0) return other;
+    other.box_ = Spiner::getOnDeviceDataBox(box_);
+    other.bytes_ = bytes_;
+    other.shift_ = shift_of_(other.box_);
+    // The copy may have landed on a different boundary
+    if (other.shift_ != shift_) {
+      portableCopyToDevice(other.data<char>(), data<char>(), bytes_);
+    }
+    return other;
+  }
+
+  void finalize() {
+    if (bytes_ > 0) box_.finalize();
+    bytes_ = 0;
+    shift_ = 0;
+  }
+
+  template <typename T>
+  PORTABLE_INLINE_FUNCTION T *data() const {
+    return reinterpret_cast<T *>(reinterpret_cast<char *>(&box_(0, 0)) +
+                                 shift_);
+  }
+  PORTABLE_INLINE_FUNCTION std::size_t bytes() const { return bytes_; }
+
+ private:
+  static int shift_of_(const Spiner::DataBox &box) {
+    const std::uintptr_t addr = reinterpret_cast<std::uintptr_t>(&box(0, 0));
+    return static_cast<int>((CACHELINE - addr % CACHELINE) % CACHELINE);
+  }
+  Spiner::DataBox box_;
+  int shift_ = 0;
+  std::size_t bytes_ = 0;
+};
+
+// Values per block of quantized storage, and the largest quantized
+// value. Level 0 is reserved for the floor of the table; the block's
+// range is spread over the levels above it.
+constexpr std::size_t QUANTIZED_BLOCK = 64;
+constexpr int QUANTIZED_LEVELS = 65535;
+
+// Read-only pointer into quantized storage. Indexing decodes the
+// value, so it can stand in for a const pointer to Real in the
+// interpolation kernels.
+class QuantizedPtr {
+ public:
+  QuantizedPtr() = default;
+  PORTABLE_INLINE_FUNCTION QuantizedPtr(const std::uint16_t *values,
+                                        const float *offsets,
+                                        const float *scales, const float floor,
+                                        const std::size_t pos)
+      : values_(values), offsets_(offsets), scales_(scales), floor_(floor),
+        pos_(pos) {}
+
+  PORTABLE_FORCEINLINE_FUNCTION Real operator[](const std::size_t i) const {
+    const std::size_t k = pos_ + i;
+    const std::size_t b = k / QUANTIZED_BLOCK;
+    const int level = values_[k];
+    return (level == 0)
+               ? static_cast<Real>(floor_)
+               : offsets_[b] + static_cast<Real>(scales_[b]) * (level - 1);
+  }
+  PORTABLE_FORCEINLINE_FUNCTION QuantizedPtr
+  operator+(const std::size_t n) const {
+    return QuantizedPtr(values_, offsets_, scales_, floor_, pos_ + n);
+  }
+
+ private:
+  const std::uint16_t *values_ = nullptr;
+  const float *offsets_ = nullptr;
+  const float *scales_ = nullptr;
+  float floor_ = 0;
+  std::size_t pos_ = 0;
+};
+
+// Smallest of the n values of a table, stored exactly as level 0
+inline Real quantizedFloor(const Real *values, const std::size_t n) {
+  return *std::min_element(values, values + n);
+}
+
+// Quantizes one block of n <= QUANTIZED_BLOCK values into
+// QUANTIZED_BLOCK slots, repeating the last value in the slots past
+// n. Values equal to floor, the floor of the table, get level 0; the
+// offset and scale span the others. Returns the largest absolute
+// error of the n values.
+inline Real quantizeBlock(const Real *values, const std::size_t n,
+                          const Real floor, std::uint16_t *q, float &offset,
+                          float &scale) {
+  constexpr int STEPS = QUANTIZED_LEVELS - 1;
+  Real lo = std::numeric_limits<Real>::infinity();
+  Real hi = -std::numeric_limits<Real>::infinity();
+  for (std::size_t i = 0; i < n; ++i) {
+    if (values[i] != floor) {
+      lo = std::min(lo, values[i]);
+      hi = std::max(hi, values[i]);
+    }
+  }
+  // A block at the floor throughout
+  if (lo > hi) {
+    lo = hi = floor;
+  }
+  if (!std::isfinite(lo) || !std::isfinite(hi) || !std::isfinite(floor) ||
+      std::abs(lo) > std::numeric_limits<float>::max() ||
+      std::abs(hi) > std::numeric_limits<float>::max()) {
+    OPAC_ERROR("table_storage: values out of range for quantization\n");
+  }
+  // Round the offset down and the scale up, so the block's range is
+  // covered despite their float rounding
+  offset = static_cast<float>(lo);
+  if (offset > lo) {
+    offset = std::nextafter(offset, -std::numeric_limits<float>::infinity());
+  }
+  scale = static_cast<float>((hi - offset) / STEPS);
+  if (offset + static_cast<Real>(scale) * STEPS < hi) {
+    scale = std::nextafter(scale, std::numeric_limits<float>::infinity());
+  }
+  Real error = 0;
+  for (std::size_t i = 0; i < QUANTIZED_BLOCK; ++i) {
+    const Real v = values[std::min(i, n - 1)];
+    long level = 0;
+    Real decoded = static_cast<float>(floor);
+    if (v != floor) {
+      if (scale > 0) {
+        level = std::lround((v - offset) / scale);
+        level = std::min(std::max(level, 0L), long(STEPS));
+      }
+      decoded = offset + static_cast<Real>(scale) * level;
+      level += 1;
+    }
+    q[i] = static_cast<std::uint16_t>(level);
+    if (i < n) {
+      error = std::max(error, std::abs(decoded - v));
+    }
+  }
+  return error;
+}
+
+// One or more tables of the same number of values, stored quantized
+// in a single aligned allocation. Each table starts on a block
+// boundary, so it decodes the same wherever it is stored.
+class QuantizedStorage {
+ public:
+  QuantizedStorage() = default;
+
+  // Number of values a table of n values occupies, whole blocks
+  PORTABLE_INLINE_FUNCTION static std::size_t stride(const std::size_t n) {
+    return (n + QUANTIZED_BLOCK - 1) / QUANTIZED_BLOCK * QUANTIZED_BLOCK;
+  }
+
+  // Allocates ntables tables of n values on host. Contents are
+  // uninitialized until encoded.
+  void allocate(const std::size_t n, const int ntables) {
+    n_ = n;
+    ntables_ = ntables;
+    const std::size_t nvalues = ntables * stride(n);
+    const std::size_t nblocks = nvalues / QUANTIZED_BLOCK;
+    storage_.allocate(nvalues * sizeof(std::uint16_t) +
+                      (2 * nblocks + ntables) * sizeof(float));
+  }
+
+  // Quantizes the n values of table t. Returns the largest absolute
+  // error.
+  Real encode(const int t, const Real *values) {
+    std::uint16_t *q = values_() + t * stride(n_);
+    float *offsets = offsets_() + t * stride(n_) / QUANTIZED_BLOCK;
+    float *scales = offsets + blocks_();
+    const Real floor = quantizedFloor(values, n_);
+    floors_()[t] = static_cast<float>(floor);
+    Real error = 0;
+    for (std::size_t b = 0; b * QUANTIZED_BLOCK < n_; ++b) {
+      const std::size_t first = b * QUANTIZED_BLOCK;
+      const std::size_t count = std::min(QUANTIZED_BLOCK, n_ - first);
+      error = std::max(error, quantizeBlock(values + first, count, floor,
+                                            q + first, offsets[b], scales[b]));
+    }
+    return error;
+  }
+
+  PORTABLE_INLINE_FUNCTION QuantizedPtr table(const int t) const {
+    return QuantizedPtr(values_(), offsets_(), offsets_() + blocks_(),
+                        floors_()[t], t * stride(n_));
+  }
+
+  QuantizedStorage getOnDevice() const {
+    QuantizedStorage other;
+    other.storage_ = storage_.getOnDevice();
+    other.n_ = n_;
+    other.ntables_ = ntables_;
+    return other;
+  }
+
+  void finalize() {
+    storage_.finalize();
+    n_ = 0;
+    ntables_ = 0;
+  }
+
+  PORTABLE_INLINE_FUNCTION std::size_t size() const { return n_; }
+
+ private:
+  PORTABLE_INLINE_FUNCTION std::size_t blocks_() const {
+    return ntables_ * stride(n_) / QUANTIZED_BLOCK;
+  }
+  PORTABLE_INLINE_FUNCTION std::uint16_t *values_() const {
+    return storage_.data<std::uint16_t>();
+  }
+  // Scales follow the offsets, and the floor of each table follows
+  // the scales. Tables are whole blocks, so the offsets start on a
+  // four byte boundary.
+  PORTABLE_INLINE_FUNCTION float *offsets_() const {
+    return reinterpret_cast<float *>(values_() + ntables_ * stride(n_));
+  }
+  PORTABLE_INLINE_FUNCTION float *floors_() const {
+    return offsets_() + 2 * blocks_();
+  }
+  AlignedStorage storage_;
+  std::size_t n_ = 0;
+  int ntables_ = 0;
+};
+
+constexpr Real LOG2_10 = 3.321928094887362;
+
+// Converts a base 10 log table on host to base 2 in place, along
+// with the ranges of the axes in log_axes. Other axes, such as Ye,
+// are left alone.
+inline void log10ToLog2(Spiner::DataBox &db,
+                        std::initializer_list<int> log_axes) {
+  for (int i = 0; i < db.size(); ++i) {
+    db(i) *= LOG2_10;
+  }
+  for (const int axis : log_axes) {
+    const Spiner::RegularGrid1D g = db.range(axis);
+    db.setRange(axis, LOG2_10 * g.min(), LOG2_10 * g.max(), g.nPoints());
+  }
+}
+
+// Adds lvalue to every value of a base 2 log table on host, and to
+// the range of each axis in log_axes its paired offset, as when
+// changing the units of the table and of its axes.
+inline void shiftLog2(Spiner::DataBox &db, const Real lvalue,
+                      std::initializer_list<std::pair<int, Real>> log_axes) {
+  for (int i = 0; i < db.size(); ++i) {
+    db(i) += lvalue;
+  }
+  for (const std::pair<int, Real> &axis : log_axes) {
+    const Spiner::RegularGrid1D g = db.range(axis.first);
+    db.setRange(axis.first, g.min() + axis.second, g.max() + axis.second,
+                g.nPoints());
+  }
+}
+
+#ifdef SPINER_USE_HDF
+inline herr_t saveEncoding(hid_t file, const TableEncoding encoding) {
+  const int base = static_cast<int>(encoding);
+  return H5LTset_attribute_int(file, "/", SP5::LogBase, &base, 1);
+}
+
+// Files without the attribute predate it and hold base 10
+inline TableEncoding loadEncoding(hid_t file) {
+  if (H5Aexists_by_name(file, "/", SP5::LogBase, H5P_DEFAULT) <= 0) {
+    return TableEncoding::Log10;
+  }
+  int base;
+  if (H5LTget_attribute_int(file, "/", SP5::LogBase, &base) < 0) {
+    OPAC_ERROR("table_storage: HDF5 error reading log base\n");
+  }
+  if (base != static_cast<int>(TableEncoding::Log10) &&
+      base != static_cast<int>(TableEncoding::Log2)) {
+    OPAC_ERROR("table_storage: unknown log base in file\n");
+  }
+  return static_cast<TableEncoding>(base);
+}
+
+// Whether the table in group groupname was saved quantized
+inline bool isQuantizedHDF(hid_t loc, const std::string &groupname) {
+  const std::string path = groupname + "/" + SP5::DB::DSETNAME;
+  return H5Lexists(loc, path.c_str(), H5P_DEFAULT) <= 0;
+}
+
+// Shape of the DataBox saved in group groupname, quantized or not,
+// without reading its data. dims is in DataBox order, fastest axis
+// first.
+inline herr_t loadHDFShape(hid_t loc, const std::string &groupname, int &rank,
+                           int dims[Spiner::MAXRANK]) {
+  hsize_t fdims[Spiner::MAXRANK];
+  H5T_class_t typeclass;
+  std::size_t size;
+  const char *dset = isQuantizedHDF(loc, groupname) ? SP5::Quantized::Values
+                                                    : SP5::DB::DSETNAME;
+  hid_t group = H5Gopen(loc, groupname.c_str(), H5P_DEFAULT);
+  herr_t status = H5LTget_dataset_ndims(group, dset, &rank);
+  status += H5LTget_dataset_info(group, dset, fdims, &typeclass, &size);
+  // Files store the slowest axis first
+  for (int i = 0; i < rank; ++i) {
+    dims[i] = static_cast<int>(fdims[rank - 1 - i]);
+  }
+  status += H5Gclose(group);
+  return status;
+}
+
+// Grid of axis of the DataBox saved in group groupname
+inline herr_t loadHDFGrid(hid_t loc, const std::string &groupname,
+                          const int axis, Spiner::RegularGrid1D &grid) {
+  hid_t group = H5Gopen(loc, groupname.c_str(), H5P_DEFAULT);
+  hid_t grids = H5Gopen(group, SP5::DB::GRID_INFONAME, H5P_DEFAULT);
+  const std::string gridname = SP5::DB::GRIDNAME + std::to_string(axis + 1);
+  herr_t status = grid.loadHDF(grids, gridname.c_str());
+  status += H5Gclose(grids);
+  status += H5Gclose(group);
+  return status;
+}
+
+// Reads the hyperslab of the DataBox saved in group groupname that
+// starts at start and spans count points along each axis, into db at
+// offset dst. Only the hyperslab is read from disk. Indices are in
+// DataBox order, and db must already have the rank of the file.
+inline herr_t loadHDFHyperslab(hid_t loc, const std::string &groupname,
+                               const int *start, const int *count,
+                               const int *dst, Spiner::DataBox &db) {
+  const int rank = db.rank();
+  hsize_t fstart[Spiner::MAXRANK], mstart[Spiner::MAXRANK];
+  hsize_t n[Spiner::MAXRANK], mdims[Spiner::MAXRANK];
+  for (int i = 0; i < rank; ++i) {
+    const int j = rank - 1 - i;
+    fstart[j] = start[i];
+    mstart[j] = dst[i];
+    n[j] = count[i];
+    mdims[j] = db.dim(i + 1);
+  }
+  hid_t group = H5Gopen(loc, groupname.c_str(), H5P_DEFAULT);
+  hid_t dset = H5Dopen(group, SP5::DB::DSETNAME, H5P_DEFAULT);
+  hid_t fspace = H5Dget_space(dset);
+  hid_t mspace = H5Screate_simple(rank, mdims, nullptr);
+  herr_t status = H5Sselect_hyperslab(fspace, H5S_SELECT_SET, fstart, nullptr,
+                                      n, nullptr);
+  status += H5Sselect_hyperslab(mspace, H5S_SELECT_SET, mstart, nullptr, n,
+                                nullptr);
+  status += H5Dread(dset, H5T_REAL, mspace, fspace, H5P_DEFAULT, &db(0));
+  status += H5Sclose(mspace);
+  status += H5Sclose(fspace);
+  status += H5Dclose(dset);
+  status += H5Gclose(group);
+  return status;
+}
+
+// Saves db in group groupname with its values quantized, and the
+// grids laid out as DataBox::saveHDF does. Sets error to the largest
+// absolute error of the quantized values.
+inline herr_t saveHDFQuantized(hid_t loc, const std::string &groupname,
+                               const Spiner::DataBox &db, Real &error) {
+  const std::size_t n = db.size();
+  const std::size_t nblocks = QuantizedStorage::stride(n) / QUANTIZED_BLOCK;
+  std::vector<std::uint16_t> values(nblocks * QUANTIZED_BLOCK);
+  std::vector<float> offsets(nblocks), scales(nblocks);
+  const Real *data = &db(0);
+  const Real floor = quantizedFloor(data, n);
+  const float stored_floor = static_cast<float>(floor);
+  error = 0;
+  for (std::size_t b = 0; b < nblocks; ++b) {
+    const std::size_t first = b * QUANTIZED_BLOCK;
+    const std::size_t count = std::min(QUANTIZED_BLOCK, n - first);
+    error = std::max(error, quantizeBlock(data + first, count, floor,
+                                          values.data() + first, offsets[b],
+                                          scales[b]));
+  }
+  const int rank = db.rank();
+  hsize_t dims[Spiner::MAXRANK];
+  for (int i = 0; i < rank; ++i) {
+    dims[i] = db.dim(rank - i);
+  }
+  const hsize_t nb = nblocks;
+  const int block = QUANTIZED_BLOCK;
+  hid_t group = H5Gcreate(loc, groupname.c_str(), H5P_DEFAULT, H5P_DEFAULT,
+                          H5P_DEFAULT);
+  herr_t status = H5LTmake_dataset(group, SP5::Quantized::Values, rank, dims,
+                                   H5T_NATIVE_UINT16, values.data());
+  status += H5LTset_attribute_int(group, SP5::Quantized::Values,
+                                  SP5::Quantized::BlockSize, &block, 1);
+  status += H5LTset_attribute_float(group, SP5::Quantized::Values,
+                                    SP5::Quantized::Floor, &stored_floor, 1);
+  status += H5LTmake_dataset(group, SP5::Quantized::Offsets, 1, &nb,
+                             H5T_NATIVE_FLOAT, offsets.data());
+  status += H5LTmake_dataset(group, SP5::Quantized::Scales, 1, &nb,
+                             H5T_NATIVE_FLOAT, scales.data());
+  hid_t grids = H5Gcreate(group, SP5::DB::GRID_INFONAME, H5P_DEFAULT,
+                          H5P_DEFAULT, H5P_DEFAULT);
+  for (int i = 0; i < rank; ++i) {
+    if (db.indexType(i) == Spiner::IndexType::Interpolated) {
+      const std::string gridname = SP5::DB::GRIDNAME + std::to_string(i + 1);
+      status += db.range(i).saveHDF(grids, gridname.c_str());
+    }
+  }
+  status += H5Gclose(grids);
+  status += H5Gclose(group);
+  return status;
+}
+
+// Decodes the levels of a quantized file. Level 0 of files with a
+// floor attribute is the floor; files from before it was reserved use
+// level 0 like any other.
+struct QuantizedFloor {
+  herr_t load(hid_t group) {
+    if (H5Aexists_by_name(group, SP5::Quantized::Values, SP5::Quantized::Floor,
+                          H5P_DEFAULT) <= 0) {
+      return H5_SUCCESS;
+    }
+    first_level = 1;
+    return H5LTget_attribute_float(group, SP5::Quantized::Values,
+                                   SP5::Quantized::Floor, &floor);
+  }
+  Real decode(const std::uint16_t level, const float offset,
+              const float scale) const {
+    return (first_level == 1 && level == 0)
+               ? static_cast<Real>(floor)
+               : offset + static_cast<Real>(scale) * (level - first_level);
+  }
+  float floor = 0;
+  int first_level = 0;
+};
+
+// Loads a table saved by saveHDFQuantized into db, decoded to Real.
+// Axes without a grid are indexed.
+inline herr_t loadHDFQuantized(hid_t loc, const std::string &groupname,
+                               Spiner::DataBox &db) {
+  hsize_t dims[Spiner::MAXRANK];
+  H5T_class_t typeclass;
+  std::size_t size;
+  int rank, block;
+  hid_t group = H5Gopen(loc, groupname.c_str(), H5P_DEFAULT);
+  herr_t status = H5LTget_dataset_ndims(group, SP5::Quantized::Values, &rank);
+  status += H5LTget_dataset_info(group, SP5::Quantized::Values, dims,
+                                 &typeclass, &size);
+  status += H5LTget_attribute_int(group, SP5::Quantized::Values,
+                                  SP5::Quantized::BlockSize, &block);
+  if (status != H5_SUCCESS || rank < 1 || rank > Spiner::MAXRANK ||
+      block < 1) {
+    H5Gclose(group);
+    return -1;
+  }
+  int n[Spiner::MAXRANK] = {1, 1, 1, 1, 1, 1};
+  std::size_t count = 1;
+  for (int i = 0; i < rank; ++i) {
+    n[i] = static_cast<int>(dims[i]);
+    count *= dims[i];
+  }
+  db = Spiner::DataBox();
+  switch (rank) {
+  case 1:
+    db.resize(n[0]);
+    break;
+  case 2:
+    db.resize(n[0], n[1]);
+    break;
+  case 3:
+    db.resize(n[0], n[1], n[2]);
+    break;
+  case 4:
+    db.resize(n[0], n[1], n[2], n[3]);
+    break;
+  case 5:
+    db.resize(n[0], n[1], n[2], n[3], n[4]);
+    break;
+  default:
+    db.resize(n[0], n[1], n[2], n[3], n[4], n[5]);
+  }
+  const std::size_t nblocks = (count + block - 1) / block;
+  std::vector<std::uint16_t> values(count);
+  std::vector<float> offsets(nblocks), scales(nblocks);
+  status += H5LTread_dataset(group, SP5::Quantized::Values, H5T_NATIVE_UINT16,
+                             values.data());
+  status += H5LTread_dataset(group, SP5::Quantized::Offsets, H5T_NATIVE_FLOAT,
+                             offsets.data());
+  status += H5LTread_dataset(group, SP5::Quantized::Scales, H5T_NATIVE_FLOAT,
+                             scales.data());
+  QuantizedFloor floor;
+  status += floor.load(group);
+  Real *data = &db(0);
+  for (std::size_t k = 0; k < count; ++k) {
+    const std::size_t b = k / block;
+    data[k] = floor.decode(values[k], offsets[b], scales[b]);
+  }
+  hid_t grids = H5Gopen(group, SP5::DB::GRID_INFONAME, H5P_DEFAULT);
+  for (int i = 0; i < rank; ++i) {
+    const std::string gridname = SP5::DB::GRIDNAME + std::to_string(i + 1);
+    if (H5Lexists(grids, gridname.c_str(), H5P_DEFAULT) > 0) {
+      Spiner::RegularGrid1D grid;
+      status += grid.loadHDF(grids, gridname.c_str());
+      db.setRange(i, grid.min(), grid.max(), grid.nPoints());
+    }
+  }
+  status += H5Gclose(grids);
+  status += H5Gclose(group);
+  return status;
+}
+
+// As loadHDFHyperslab, for a table saved by saveHDFQuantized. Only the
+// hyperslab and the offsets and scales of the blocks it spans are
+// read, and values decode as they would with the whole table.
+inline herr_t loadHDFQuantizedHyperslab(hid_t loc,
+                                        const std::string &groupname,
+                                        const int *start, const int *count,
+                                        const int *dst, Spiner::DataBox &db) {
+  const int rank = db.rank();
+  hsize_t fdims[Spiner::MAXRANK];
+  H5T_class_t typeclass;
+  std::size_t size;
+  int block;
+  hid_t group = H5Gopen(loc, groupname.c_str(), H5P_DEFAULT);
+  herr_t status = H5LTget_dataset_info(group, SP5::Quantized::Values, fdims,
+                                       &typeclass, &size);
+  status += H5LTget_attribute_int(group, SP5::Quantized::Values,
+                                  SP5::Quantized::BlockSize, &block);
+  if (status != H5_SUCCESS || block < 1) {
+    H5Gclose(group);
+    return -1;
+  }
+  // Strides of each axis in the file and in db, in DataBox order
+  std::size_t fstride[Spiner::MAXRANK], mstride[Spiner::MAXRANK];
+  hsize_t fstart[Spiner::MAXRANK], n[Spiner::MAXRANK];
+  std::size_t nvalues = 1;
+  std::size_t kfirst = 0;
+  std::size_t klast = 0;
+  for (int i = 0; i < rank; ++i) {
+    const int j = rank - 1 - i;
+    fstride[i] = (i == 0) ? 1 : fstride[i - 1] * fdims[j + 1];
+    mstride[i] = (i == 0) ? 1 : mstride[i - 1] * db.dim(i);
+    fstart[j] = start[i];
+    n[j] = count[i];
+    nvalues *= count[i];
+    kfirst += start[i] * fstride[i];
+    klast += (start[i] + count[i] - 1) * fstride[i];
+  }
+  const hsize_t bfirst = kfirst / block;
+  const hsize_t nblocks = klast / block - bfirst + 1;
+  std::vector<std::uint16_t> values(nvalues);
+  std::vector<float> offsets(nblocks), scales(nblocks);
+
+  hid_t dset = H5Dopen(group, SP5::Quantized::Values, H5P_DEFAULT);
+  hid_t fspace = H5Dget_space(dset);
+  hid_t mspace = H5Screate_simple(rank, n, nullptr);
+  status += H5Sselect_hyperslab(fspace, H5S_SELECT_SET, fstart, nullptr, n,
+                                nullptr);
+  status += H5Dread(dset, H5T_NATIVE_UINT16, mspace, fspace, H5P_DEFAULT,
+                    values.data());
+  status += H5Sclose(mspace);
+  status += H5Sclose(fspace);
+  status += H5Dclose(dset);
+  const char *perblock[] = {SP5::Quantized::Offsets, SP5::Quantized::Scales};
+  float *buffers[] = {offsets.data(), scales.data()};
+  for (int p = 0; p < 2; ++p) {
+    dset = H5Dopen(group, perblock[p], H5P_DEFAULT);
+    fspace = H5Dget_space(dset);
+    mspace = H5Screate_simple(1, &nblocks, nullptr);
+    status += H5Sselect_hyperslab(fspace, H5S_SELECT_SET, &bfirst, nullptr,
+                                  &nblocks, nullptr);
+    status += H5Dread(dset, H5T_NATIVE_FLOAT, mspace, fspace, H5P_DEFAULT,
+                      buffers[p]);
+    status += H5Sclose(mspace);
+    status += H5Sclose(fspace);
+    status += H5Dclose(dset);
+  }
+  QuantizedFloor floor;
+  status += floor.load(group);
+  status += H5Gclose(group);
+
+  // The hyperslab is read fastest axis last, as the file stores it
+  Real *data = &db(0);
+  for (std::size_t m = 0; m < nvalues; ++m) {
+    std::size_t r = m;
+    std::size_t k = 0;
+    std::size_t d = 0;
+    for (int i = 0; i < rank; ++i) {
+      const std::size_t x = r % count[i];
+      r /= count[i];
+      k += (start[i] + x) * fstride[i];
+      d += (dst[i] + x) * mstride[i];
+    }
+    const std::size_t b = k / block - bfirst;
+    data[d] = floor.decode(values[m], offsets[b], scales[b]);
+  }
+  return status;
+}
+
+// Loads the table in group groupname into db, whether it was saved
+// by DataBox::saveHDF or quantized
+inline herr_t loadHDFTable(hid_t loc, const std::string &groupname,
+                           Spiner::DataBox &db) {
+  if (isQuantizedHDF(loc, groupname)) {
+    return loadHDFQuantized(loc, groupname, db);
+  }
+  return db.loadHDF(loc, groupname);
+}
+#endif
+
+// Bilinear interpolation in a row-major (N_rho, N_T) table, at the
+// cell and weights of a LookupState. Ptr is a const pointer to the
+// element type, or QuantizedPtr.
+template <typename Ptr>
+PORTABLE_INLINE_FUNCTION Real interp2D(const Ptr data, const std::size_t NT,
+                                       const LookupState &s) {
+  const Ptr lo = data + s.iRho * NT + s.iT;
+  const Ptr hi = lo + NT;
+  return (s.wRho[0] * (s.wT[0] * lo[0] + s.wT[1] * lo[1]) +
+          s.wRho[1] * (s.wT[0] * hi[0] + s.wT[1] * hi[1]));
+}
+
+// Bilinear interpolation in a row-major (N1, N0) table. Grid is
+// Spiner::RegularGrid1D or TableGrid1D.
+template <typename Ptr, typename Grid>
+PORTABLE_INLINE_FUNCTION Real interp2D(const Ptr data, const Grid &g1,
+                                       const Grid &g0, const Real x1,
+                                       const Real x0) {
+  LookupState s;
+  locate(g1, x1, s.iRho, s.wRho);
+  locate(g0, x0, s.iT, s.wT);
+  return interp2D(data, g0.nPoints(), s);
+}
+
+// Trilinear interpolation at species idx in a row-major (N_rho, N_T,
+// N_Ye, nspecies) table, at the cell and weights of a LookupState.
+template <typename Ptr>
+PORTABLE_INLINE_FUNCTION Real
+interp3DSpecies(const Ptr data, const std::size_t NT, const std::size_t NYe,
+                const int nspecies, const LookupState &s, const int idx) {
+  Real val = 0;
+  for (int a = 0; a < 2; ++a) {
+    for (int b = 0; b < 2; ++b) {
+      const Ptr row =
+          data + (((s.iRho + a) * NT + s.iT + b) * NYe + s.iYe) * nspecies;
+      val += s.wRho[a] * s.wT[b] *
+             (s.wYe[0] * row[idx] + s.wYe[1] * row[nspecies + idx]);
+    }
+  }
+  return val;
+}
+
+// Trilinear interpolation at species idx in a row-major
+// (N2, N1, N0, nspecies) table.
+template <typename Ptr, typename Grid>
+PORTABLE_INLINE_FUNCTION Real
+interp3DSpecies(const Ptr data, const Grid &g2, const Grid &g1,
+                const Grid &g0, const int nspecies, const Real x2,
+                const Real x1, const Real x0, const int idx) {
+  LookupState s;
+  locate(g2, x2, s.iRho, s.wRho);
+  locate(g1, x1, s.iT, s.wT);
+  locate(g0, x0, s.iYe, s.wYe);
+  return interp3DSpecies(data, g1.nPoints(), g0.nPoints(), nspecies, s, idx);
+}
+
+// Fraction of the quantile at point t of Nu evenly spaced points on
+// [0, 1]. The quantiles crowd into both tails, where the inverse CDF
+// is steepest, so the ends of a table bounded in energy don't spread
+// their last interval over the whole tail.
+PORTABLE_INLINE_FUNCTION Real quantileFraction(const Real t) {
+  const Real s = std::sin(0.5 * M_PI * t);
+  return s * s;
+}
+
+// Interpolation at species idx in a row-major (N_rho, N_T, N_Ye,
+// nspecies, Nu) table of quantiles at the fractions quantileFraction
+// gives, trilinear at the cell and weights of a LookupState and linear
+// between quantiles. u outside [0, 1] is clamped.
+template <typename Ptr>
+PORTABLE_INLINE_FUNCTION Real
+interpQuantile(const Ptr data, const std::size_t NT, const std::size_t NYe,
+               const int nspecies, const int Nu, const LookupState &s,
+               const int idx, const Real u) {
+  const Real t = std::asin(std::sqrt(std::min(std::max(u, Real(0)), Real(1))));
+  const Real fu = t * (2 / M_PI) * (Nu - 1);
+  const int k = std::min(static_cast<int>(fu), Nu - 2);
+  const Real wu = fu - k;
+  Real val = 0;
+  for (int a = 0; a < 2; ++a) {
+    for (int b = 0; b < 2; ++b) {
+      for (int c = 0; c < 2; ++c) {
+        const std::size_t cell =
+            ((s.iRho + a) * NT + s.iT + b) * NYe + s.iYe + c;
+        const Ptr row = data + (cell * nspecies + idx) * Nu + k;
+        val += s.wRho[a] * s.wT[b] * s.wYe[c] *
+               ((1 - wu) * row[0] + wu * row[1]);
+      }
+    }
+  }
+  return val;
+}
+
+} // namespace impl
+} // namespace singularity
+
+#endif // SINGULARITY_OPAC_BASE_TABLE_STORAGE_
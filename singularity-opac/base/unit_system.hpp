@@ -0,0 +1,50 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+#ifndef SINGULARITY_OPAC_BASE_UNIT_SYSTEM_
+#define SINGULARITY_OPAC_BASE_UNIT_SYSTEM_
+
+#include <cmath>
+
+#include <ports-of-call/portability.hpp>
+
+namespace singularity {
+
+// A unit system, as the CGS size of its units of time, mass, length
+// and temperature, in the order NonCGSUnits takes them. Tables loaded
+// in a unit system take and return quantities in it. Since they are
+// stored as logs, the conversion is a constant shift of each axis and
+// table, applied once on load rather than on every lookup.
+struct UnitSystem {
+  UnitSystem() = default;
+  UnitSystem(const Real time_unit, const Real mass_unit,
+             const Real length_unit, const Real temp_unit)
+      : time(time_unit), mass(mass_unit), length(length_unit),
+        temp(temp_unit) {}
+
+  bool IsCGS() const {
+    return time == 1 && mass == 1 && length == 1 && temp == 1;
+  }
+  Real Density() const { return mass / (length * length * length); }
+
+  Real time = 1;
+  Real mass = 1;
+  Real length = 1;
+  Real temp = 1;
+};
+
+} // namespace singularity
+
+#endif // SINGULARITY_OPAC_BASE_UNIT_SYSTEM_
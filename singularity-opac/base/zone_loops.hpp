@@ -0,0 +1,131 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+#ifndef SINGULARITY_OPAC_BASE_ZONE_LOOPS_
+#define SINGULARITY_OPAC_BASE_ZONE_LOOPS_
+
+#include <cstddef>
+#include <type_traits>
+
+#include <ports-of-call/portability.hpp>
+
+#include <singularity-opac/base/host_parallel.hpp>
+#include <singularity-opac/base/opac_variant.hpp>
+
+// Machinery for the bulk forms of the variant queries, which evaluate
+// arrays of zones. The variant is visited once per call, and the
+// zones then loop over the model it holds, so each zone is a direct
+// call the compiler can inline. A query says what to evaluate at a
+// zone; Query::value returns one number per zone, and
+// Query::spectrum fills the bins of a zone. Loops are functors rather
+// than lambdas, since device lambdas can't be defined in the generic
+// lambdas the variants visit with.
+
+namespace singularity {
+namespace impl {
+
+// Runs f(z) for each of nzones zones: with portableFor when it may
+// run on device, and otherwise on nthreads host threads, all cores if
+// nthreads <= 0. One thread runs the zones in the calling thread.
+template <typename Function>
+void zoneFor(const char *name, const int nzones, const int nthreads,
+             const Function &f) {
+#if defined(PORTABILITY_STRATEGY_KOKKOS) || defined(PORTABILITY_STRATEGY_CUDA)
+  portableFor(name, 0, nzones, f);
+#else
+  hostParallelFor(nzones, nthreads, f);
+#endif
+}
+
+// The bins of one zone of a zone-major output indexer
+template <typename DataIndexer>
+struct ZoneBins {
+  DataIndexer data;
+  std::size_t offset;
+  PORTABLE_FORCEINLINE_FUNCTION Real &operator[](const int i) const {
+    return data[offset + i];
+  }
+};
+
+// out[z], one value per zone
+template <typename Query, typename Zones, typename DataIndexer>
+struct ZoneValues {
+  Zones zones;
+  DataIndexer out;
+  template <typename Opac>
+  PORTABLE_INLINE_FUNCTION void operator()(const Opac &opac,
+                                           const int z) const {
+    out[z] = Query::value(opac, zones, z);
+  }
+};
+
+// out[z * nbins + i], at frequency nu_bins[i]. Every zone reads the
+// same nu_bins, which the indexer forms of the models leave untouched.
+template <typename Query, typename Zones, typename FrequencyIndexer,
+          typename DataIndexer>
+struct ZoneSpectra {
+  Zones zones;
+  FrequencyIndexer nu_bins;
+  DataIndexer out;
+  int nbins;
+  template <typename Opac>
+  PORTABLE_INLINE_FUNCTION void operator()(const Opac &opac,
+                                           const int z) const {
+    ZoneBins<DataIndexer> bins = {out, static_cast<std::size_t>(z) * nbins};
+    Query::spectrum(opac, zones, z, nu_bins, bins, nbins);
+  }
+};
+
+template <typename Query, typename Zones, typename DataIndexer>
+ZoneValues<Query, Zones, DataIndexer> zoneValues(const Zones &zones,
+                                                 const DataIndexer &out) {
+  return {zones, out};
+}
+template <typename Query, typename Zones, typename FrequencyIndexer,
+          typename DataIndexer>
+ZoneSpectra<Query, Zones, FrequencyIndexer, DataIndexer>
+zoneSpectra(const Zones &zones, const FrequencyIndexer &nu_bins,
+            const DataIndexer &out, const int nbins) {
+  return {zones, nu_bins, out, nbins};
+}
+
+// A loop over zones of one model
+template <typename Opac, typename Kernel>
+struct ZoneLoop {
+  Opac opac;
+  Kernel kernel;
+  PORTABLE_INLINE_FUNCTION void operator()(const int z) const {
+    kernel(opac, z);
+  }
+};
+
+// Visits the variant v once and runs kernel over nzones zones of the
+// model it holds
+template <typename Variant, typename Kernel>
+void visitZones(const Variant &v, const int nzones, const int nthreads,
+                const Kernel &kernel) {
+  impl::visit(
+      [&](const auto &opac) {
+        using Opac = typename std::decay<decltype(opac)>::type;
+        zoneFor("singularity-opac zones", nzones, nthreads,
+                ZoneLoop<Opac, Kernel>{opac, kernel});
+      },
+      v);
+}
+
+} // namespace impl
+} // namespace singularity
+
+#endif // SINGULARITY_OPAC_BASE_ZONE_LOOPS_
@@ -0,0 +1,381 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+#ifndef SINGULARITY_OPAC_NEUTRINOS_ADAPTIVE_TABLE_NEUTRINOS_HPP_
+#define SINGULARITY_OPAC_NEUTRINOS_ADAPTIVE_TABLE_NEUTRINOS_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <ports-of-call/portability.hpp>
+
+#include <singularity-opac/base/host_parallel.hpp>
+#include <singularity-opac/base/lookup_state.hpp>
+#include <singularity-opac/base/mean_quadrature.hpp>
+#include <singularity-opac/base/opac_error.hpp>
+#include <singularity-opac/base/radiation_types.hpp>
+#include <singularity-opac/constants/constants.hpp>
+#include <singularity-opac/neutrinos/mean_opacity_neutrinos.hpp>
+#include <singularity-opac/neutrinos/spiner_opac_neutrinos.hpp>
+
+// Builds a SpinerOpacity table of a model at the coarsest uniform
+// resolution that interpolates it to a target accuracy, instead of at
+// a guessed one. Starting from a few points per axis, the table is
+// built, compared to the model at the midpoints of its cells, and
+// every axis that misses the target is refined by halving its cells,
+// which keeps the old nodes. The midpoints of one axis are where
+// linear interpolation along it is worst, so each axis is measured
+// there with the others held at their nodes. The result is an
+// ordinary SpinerOpacity, which Save writes to a .sp5 file. Mean
+// opacity tables are built the same way over rho, T and Ye.
+
+namespace singularity {
+namespace neutrinos {
+
+// Target and limits of an adaptive build. Errors are relative, but
+// values of the model below floor are compared as if they were floor,
+// so that vanishing opacities, which the tables hold as a tiny
+// number, don't count as errors. Refinement halves cells, so an axis
+// has 2^k (minPoints - 1) + 1 points; it stops at the largest such
+// count within maxPoints. Builds and error estimates are serial by
+// default; nthreads > 1 spreads them over that many host threads, and
+// nthreads <= 0 over all cores.
+struct AdaptiveTableOptions {
+  Real tolerance = 1e-3;
+  Real floor = 1e-200;
+  int minPoints = 3;
+  int maxPoints = 257;
+  int nthreads = 1;
+};
+
+// Resolution an adaptive build settled on and the worst relative error
+// measured on each axis of it. error is the largest of them.
+// converged is false if some axis reached the most points allowed
+// short of the tolerance.
+struct AdaptiveTableReport {
+  int NRho = 0;
+  int NT = 0;
+  int NYe = 0;
+  int Ne = 0;
+  Real errorRho = 0;
+  Real errorT = 0;
+  Real errorYe = 0;
+  Real errorE = 0;
+  Real error = 0;
+  int builds = 0;
+  bool converged = false;
+};
+
+namespace impl {
+
+enum { ADAPT_RHO = 0, ADAPT_T = 1, ADAPT_YE = 2, ADAPT_E = 3, ADAPT_NAXES = 4 };
+using AdaptiveNodes = std::vector<Real>[ADAPT_NAXES];
+
+// n evenly spaced points from min to max
+inline std::vector<Real> adaptiveNodes(const Real min, const Real max,
+                                       const int n) {
+  std::vector<Real> x(n);
+  for (int i = 0; i < n; ++i) {
+    x[i] = min + (max - min) * i / (n - 1);
+  }
+  return x;
+}
+
+// Most points an axis reaches by halving cells from minPoints
+// without passing maxPoints
+inline int adaptiveMaxPoints(const int minPoints, const int maxPoints) {
+  int n = minPoints;
+  while (n <= (maxPoints + 1) / 2) {
+    n = 2 * n - 1;
+  }
+  return n;
+}
+
+// Largest of compare(rho, T, Ye) over the cells of the rho, T and Ye
+// nodes, with axis at the midpoints of its cells and the other axes
+// at their nodes. compare receives rho, T in K and Ye, and returns
+// the largest relative error there.
+template <typename Compare>
+Real adaptiveCellError(const AdaptiveNodes &nodes, const int axis,
+                       const int nthreads, Compare &&compare) {
+  int n[ADAPT_YE + 1];
+  for (int b = 0; b <= ADAPT_YE; ++b) {
+    n[b] = nodes[b].size() - (b == axis);
+  }
+  auto coord = [&](const int b, const int i) {
+    return (b == axis) ? 0.5 * (nodes[b][i] + nodes[b][i + 1]) : nodes[b][i];
+  };
+  const int ncells = n[ADAPT_RHO] * n[ADAPT_T] * n[ADAPT_YE];
+  // One slot per cell, so the result doesn't depend on nthreads
+  std::vector<Real> errors(ncells, 0);
+  singularity::impl::hostParallelFor(ncells, nthreads, [&](const int i) {
+    const int iRho = i / (n[ADAPT_T] * n[ADAPT_YE]);
+    const int iT = (i / n[ADAPT_YE]) % n[ADAPT_T];
+    const int iYe = i % n[ADAPT_YE];
+    errors[i] = compare(std::pow(10., coord(ADAPT_RHO, iRho)),
+                        std::pow(10., coord(ADAPT_T, iT)),
+                        coord(ADAPT_YE, iYe));
+  });
+  Real err = 0;
+  for (const Real e : errors) {
+    err = std::max(err, e);
+  }
+  return err;
+}
+
+// Relative error, with exact raised to floor
+inline Real adaptiveRelative(const Real approx, const Real exact,
+                             const Real floor) {
+  return std::abs(approx - exact) / std::max(std::abs(exact), floor);
+}
+
+// Largest relative error of table against opac, with axis at the
+// midpoints of its cells and the other axes at their nodes. Nodes are
+// log10 rho, log10 T in K, Ye and log10 E in MeV.
+template <typename Table, typename Opacity>
+Real adaptiveMidpointError(const Table &table, Opacity &opac,
+                           const AdaptiveNodes &nodes, const int axis,
+                           const Real floor, const int nthreads) {
+  const int ne = nodes[ADAPT_E].size() - (axis == ADAPT_E);
+  auto le = [&](const int ie) {
+    return (axis == ADAPT_E)
+               ? 0.5 * (nodes[ADAPT_E][ie] + nodes[ADAPT_E][ie + 1])
+               : nodes[ADAPT_E][ie];
+  };
+  return adaptiveCellError(
+      nodes, axis, nthreads,
+      [&](const Real rho, const Real temp, const Real Ye) {
+        const LookupState s = table.PrepareLookup(rho, temp, Ye);
+        Real err = 0;
+        for (int idx = 0; idx < NEUTRINO_NTYPES; ++idx) {
+          const RadiationType type = Idx2RadType(idx);
+          // The totals don't depend on energy
+          if (axis != ADAPT_E) {
+            err = std::max(err, adaptiveRelative(
+                                    table.Emissivity(s, type),
+                                    opac.Emissivity(rho, temp, Ye, type),
+                                    floor));
+            err = std::max(err,
+                           adaptiveRelative(
+                               table.NumberEmissivity(s, type),
+                               opac.NumberEmissivity(rho, temp, Ye, type),
+                               floor));
+          }
+          for (int ie = 0; ie < ne; ++ie) {
+            const Real nu = std::pow(10., le(ie)) * Table::MeV2Hz;
+            err = std::max(
+                err, adaptiveRelative(
+                         table.AbsorptionCoefficient(s, type, nu),
+                         opac.AbsorptionCoefficient(rho, temp, Ye, type, nu),
+                         floor));
+            err = std::max(
+                err,
+                adaptiveRelative(table.EmissivityPerNu(s, type, nu),
+                                 opac.EmissivityPerNu(rho, temp, Ye, type, nu),
+                                 floor));
+          }
+        }
+        return err;
+      });
+}
+
+// Refines the first naxes axes from options.minPoints points each
+// until error(table, nodes, axis) is within options.tolerance on
+// every one, or they reach the most points allowed, and fills report.
+// build(N) tabulates on N[axis] evenly spaced points of each axis.
+template <typename Table, typename Build, typename Error>
+Table adaptiveRefine(const int naxes, const Real (&min)[ADAPT_NAXES],
+                     const Real (&max)[ADAPT_NAXES],
+                     const AdaptiveTableOptions &options,
+                     AdaptiveTableReport &report, Build &&build,
+                     Error &&error) {
+  const int maxPoints = adaptiveMaxPoints(options.minPoints, options.maxPoints);
+  int N[ADAPT_NAXES] = {0, 0, 0, 0};
+  std::fill(N, N + naxes, options.minPoints);
+  report = AdaptiveTableReport();
+  while (true) {
+    AdaptiveNodes nodes;
+    for (int a = 0; a < naxes; ++a) {
+      nodes[a] = adaptiveNodes(min[a], max[a], N[a]);
+    }
+    Table table = build(N);
+    report.builds++;
+    Real errors[ADAPT_NAXES] = {0, 0, 0, 0};
+    bool refined = false;
+    bool converged = true;
+    int next[ADAPT_NAXES];
+    std::copy(N, N + ADAPT_NAXES, next);
+    for (int a = 0; a < naxes; ++a) {
+      errors[a] = error(table, nodes, a);
+      if (errors[a] > options.tolerance) {
+        if (N[a] < maxPoints) {
+          next[a] = 2 * N[a] - 1;
+          refined = true;
+        } else {
+          converged = false;
+        }
+      }
+    }
+    if (refined) {
+      table.Finalize();
+      std::copy(next, next + ADAPT_NAXES, N);
+      continue;
+    }
+    report.NRho = N[ADAPT_RHO];
+    report.NT = N[ADAPT_T];
+    report.NYe = N[ADAPT_YE];
+    report.Ne = N[ADAPT_E];
+    report.errorRho = errors[ADAPT_RHO];
+    report.errorT = errors[ADAPT_T];
+    report.errorYe = errors[ADAPT_YE];
+    report.errorE = errors[ADAPT_E];
+    report.error = *std::max_element(errors, errors + ADAPT_NAXES);
+    report.converged = converged;
+    return table;
+  }
+}
+
+// Whether options are usable and the first naxes axes nonempty
+inline bool adaptiveValid(const AdaptiveTableOptions &options, const int naxes,
+                          const Real (&min)[ADAPT_NAXES],
+                          const Real (&max)[ADAPT_NAXES]) {
+  if (!(options.tolerance > 0) || options.minPoints < 2 ||
+      options.maxPoints < options.minPoints) {
+    return false;
+  }
+  for (int a = 0; a < naxes; ++a) {
+    if (!(max[a] > min[a])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace impl
+
+// Tabulates opac as the SpinerOpacity constructor does, on the fewest
+// points per axis for which the error at cell midpoints is within
+// options.tolerance, and fills report with the resolution and errors
+// of the table returned. Bounds are log10, with T in K and E in MeV.
+// Every intermediate table is freed, and the one returned is owned by
+// the caller. opac must be safe to call concurrently.
+template <typename ThermalDistribution, typename pc = PhysicalConstantsCGS,
+          typename Opacity>
+SpinerOpacity<ThermalDistribution, pc> BuildAdaptiveSpinerOpacity(
+    Opacity &opac, const Real lRhoMin, const Real lRhoMax, const Real lTMin,
+    const Real lTMax, const Real YeMin, const Real YeMax, const Real leMin,
+    const Real leMax, AdaptiveTableReport &report,
+    const AdaptiveTableOptions &options = AdaptiveTableOptions(),
+    SpectralLayout layout = SpectralLayout::Separate,
+    TablePrecision precision = TablePrecision::Double) {
+  using Table = SpinerOpacity<ThermalDistribution, pc>;
+  const Real min[impl::ADAPT_NAXES] = {lRhoMin, lTMin, YeMin, leMin};
+  const Real max[impl::ADAPT_NAXES] = {lRhoMax, lTMax, YeMax, leMax};
+  if (!impl::adaptiveValid(options, impl::ADAPT_NAXES, min, max)) {
+    OPAC_ERROR("neutrinos::BuildAdaptiveSpinerOpacity: the tolerance must be "
+               "positive, 2 <= minPoints <= maxPoints and each axis needs "
+               "max > min\n");
+  }
+  return impl::adaptiveRefine<Table>(
+      impl::ADAPT_NAXES, min, max, options, report,
+      [&](const int(&N)[impl::ADAPT_NAXES]) {
+        return Table(opac, lRhoMin, lRhoMax, N[impl::ADAPT_RHO], lTMin, lTMax,
+                     N[impl::ADAPT_T], YeMin, YeMax, N[impl::ADAPT_YE], leMin,
+                     leMax, N[impl::ADAPT_E], layout, precision,
+                     options.nthreads);
+      },
+      [&](const Table &table, const impl::AdaptiveNodes &nodes,
+          const int axis) {
+        return impl::adaptiveMidpointError(table, opac, nodes, axis,
+                                           options.floor, options.nthreads);
+      });
+}
+
+// Tabulates the Planck and Rosseland means of opac as the MeanOpacity
+// constructor taking a quadrature does, refining rho, T and Ye in the
+// same way. Each reference is one more quadrature of the same rule at
+// the midpoint, so report.error measures interpolation alone. report.Ne
+// and report.errorE are zero.
+template <typename pc = PhysicalConstantsCGS, typename Opacity>
+impl::MeanOpacity<pc> BuildAdaptiveMeanOpacity(
+    const Opacity &opac, const Real lRhoMin, const Real lRhoMax,
+    const Real lTMin, const Real lTMax, const Real YeMin, const Real YeMax,
+    AdaptiveTableReport &report,
+    const AdaptiveTableOptions &options = AdaptiveTableOptions(),
+    const MeanQuadrature &quadrature = MeanQuadrature(),
+    Real *lambda = nullptr,
+    TablePrecision precision = TablePrecision::Double) {
+  using Table = impl::MeanOpacity<pc>;
+  constexpr int naxes = impl::ADAPT_YE + 1;
+  const Real min[impl::ADAPT_NAXES] = {lRhoMin, lTMin, YeMin, 0};
+  const Real max[impl::ADAPT_NAXES] = {lRhoMax, lTMax, YeMax, 0};
+  if (!impl::adaptiveValid(options, naxes, min, max)) {
+    OPAC_ERROR("neutrinos::BuildAdaptiveMeanOpacity: the tolerance must be "
+               "positive, 2 <= minPoints <= maxPoints and each axis needs "
+               "max > min\n");
+  }
+  const singularity::impl::FrequencyQuadrature frequencies(
+      quadrature,
+      singularity::impl::THERMAL_NU_LOW * pc::kb * std::pow(10., lTMin) / pc::h,
+      singularity::impl::THERMAL_NU_HIGH * pc::kb * std::pow(10., lTMax) /
+          pc::h);
+  return impl::adaptiveRefine<Table>(
+      naxes, min, max, options, report,
+      [&](const int(&N)[impl::ADAPT_NAXES]) {
+        return Table(opac, lRhoMin, lRhoMax, N[impl::ADAPT_RHO], lTMin, lTMax,
+                     N[impl::ADAPT_T], YeMin, YeMax, N[impl::ADAPT_YE],
+                     quadrature, lambda, precision, options.nthreads);
+      },
+      [&](const Table &table, const impl::AdaptiveNodes &nodes,
+          const int axis) {
+        return impl::adaptiveCellError(
+            nodes, axis, options.nthreads,
+            [&](const Real rho, const Real temp, const Real Ye) {
+              const LookupState s = table.PrepareLookup(rho, temp, Ye);
+              Real err = 0;
+              for (int idx = 0; idx < NEUTRINO_NTYPES; ++idx) {
+                const RadiationType type = Idx2RadType(idx);
+                const singularity::impl::MeanSums sums = frequencies.integrate(
+                    rho, pc::kb * temp / pc::h,
+                    [&](const Real *nu, const int n, Real *alpha, Real *B,
+                        Real *dBdT) {
+                      opac.AbsorptionCoefficient(rho, temp, Ye, type, nu,
+                                                 alpha, n, lambda);
+                      for (int inu = 0; inu < n; ++inu) {
+                        B[inu] =
+                            opac.ThermalDistributionOfTNu(temp, type, nu[inu]);
+                        dBdT[inu] = opac.DThermalDistributionOfTNuDT(
+                            temp, type, nu[inu]);
+                      }
+                    });
+                err = std::max(
+                    err, impl::adaptiveRelative(
+                             table.PlanckMeanAbsorptionCoefficient(s, type),
+                             rho * sums.Planck(), options.floor));
+                err = std::max(
+                    err, impl::adaptiveRelative(
+                             table.RosselandMeanAbsorptionCoefficient(s, type),
+                             rho * sums.Rosseland(), options.floor));
+              }
+              return err;
+            });
+      });
+}
+
+} // namespace neutrinos
+} // namespace singularity
+
+#endif // SINGULARITY_OPAC_NEUTRINOS_ADAPTIVE_TABLE_NEUTRINOS_HPP_
@@ -21,6 +21,7 @@
 #include <cstdio>
 
 #include <ports-of-call/portability.hpp>
+#include <singularity-opac/base/lookup_state.hpp>
 #include <singularity-opac/base/opac_error.hpp>
 #include <singularity-opac/constants/constants.hpp>
 #include <singularity-opac/neutrinos/thermal_distributions_neutrinos.hpp>
@@ -99,6 +100,29 @@ class BRTOpacity {
     }
   }
 
+  PORTABLE_INLINE_FUNCTION
+  void AbsorptionAndEmissivity(const Real rho, const Real temp, const Real Ye,
+                               const RadiationType type, const Real nu,
+                               Real &alpha, Real &jnu,
+                               Real *lambda = nullptr) const {
+    alpha = AbsorptionCoefficient(rho, temp, Ye, type, nu, lambda);
+    jnu = EmissivityPerNuOmega(rho, temp, Ye, type, nu, lambda);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  AbsorptionAndEmissivity(const Real rho, const Real temp, const Real Ye,
+                          const RadiationType type, FrequencyIndexer &nu_bins,
+                          DataIndexer &alpha, DataIndexer &jnu, const int nbins,
+                          Real *lambda = nullptr) const {
+    for (int i = 0; i < nbins; ++i) {
+      Real a, j;
+      AbsorptionAndEmissivity(rho, temp, Ye, type, nu_bins[i], a, j, lambda);
+      alpha[i] = a;
+      jnu[i] = j;
+    }
+  }
+
   PORTABLE_INLINE_FUNCTION
   Real EmissivityPerNu(const Real rho, const Real temp, const Real Ye,
                        const RadiationType type, const Real nu,
@@ -129,6 +153,104 @@ class BRTOpacity {
     return 4 * M_PI * GetNAlphac(rho, temp, type);
   }
 
+  // Queries at a point from PrepareLookup. BRT opacities are
+  // analytic, so the state only holds the point.
+  PORTABLE_INLINE_FUNCTION
+  LookupState PrepareLookup(const Real rho, const Real temp,
+                            const Real Ye) const {
+    return singularity::impl::pointState(rho, temp, Ye);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real AbsorptionCoefficient(const LookupState &s, const RadiationType type,
+                             const Real nu, Real *lambda = nullptr) const {
+    return AbsorptionCoefficient(s.rho, s.temp, s.Ye, type, nu, lambda);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  AbsorptionCoefficient(const LookupState &s, const RadiationType type,
+                        FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+                        const int nbins, Real *lambda = nullptr) const {
+    AbsorptionCoefficient(s.rho, s.temp, s.Ye, type, nu_bins, coeffs, nbins,
+                          lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real AngleAveragedAbsorptionCoefficient(const LookupState &s,
+                                          const RadiationType type,
+                                          const Real nu,
+                                          Real *lambda = nullptr) const {
+    return AngleAveragedAbsorptionCoefficient(s.rho, s.temp, s.Ye, type, nu,
+                                              lambda);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void AngleAveragedAbsorptionCoefficient(
+      const LookupState &s, const RadiationType type, FrequencyIndexer &nu_bins,
+      DataIndexer &coeffs, const int nbins, Real *lambda = nullptr) const {
+    AngleAveragedAbsorptionCoefficient(s.rho, s.temp, s.Ye, type, nu_bins,
+                                       coeffs, nbins, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real EmissivityPerNuOmega(const LookupState &s, const RadiationType type,
+                            const Real nu, Real *lambda = nullptr) const {
+    return EmissivityPerNuOmega(s.rho, s.temp, s.Ye, type, nu, lambda);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  EmissivityPerNuOmega(const LookupState &s, const RadiationType type,
+                       FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+                       const int nbins, Real *lambda = nullptr) const {
+    EmissivityPerNuOmega(s.rho, s.temp, s.Ye, type, nu_bins, coeffs, nbins,
+                         lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real EmissivityPerNu(const LookupState &s, const RadiationType type,
+                       const Real nu, Real *lambda = nullptr) const {
+    return EmissivityPerNu(s.rho, s.temp, s.Ye, type, nu, lambda);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  EmissivityPerNu(const LookupState &s, const RadiationType type,
+                  FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+                  const int nbins, Real *lambda = nullptr) const {
+    EmissivityPerNu(s.rho, s.temp, s.Ye, type, nu_bins, coeffs, nbins, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  void AbsorptionAndEmissivity(const LookupState &s, const RadiationType type,
+                               const Real nu, Real &alpha, Real &jnu,
+                               Real *lambda = nullptr) const {
+    AbsorptionAndEmissivity(s.rho, s.temp, s.Ye, type, nu, alpha, jnu, lambda);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  AbsorptionAndEmissivity(const LookupState &s, const RadiationType type,
+                          FrequencyIndexer &nu_bins, DataIndexer &alpha,
+                          DataIndexer &jnu, const int nbins,
+                          Real *lambda = nullptr) const {
+    AbsorptionAndEmissivity(s.rho, s.temp, s.Ye, type, nu_bins, alpha, jnu,
+                            nbins, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real Emissivity(const LookupState &s, const RadiationType type,
+                  Real *lambda = nullptr) const {
+    return Emissivity(s.rho, s.temp, s.Ye, type, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real NumberEmissivity(const LookupState &s, const RadiationType type,
+                        Real *lambda = nullptr) const {
+    return NumberEmissivity(s.rho, s.temp, s.Ye, type, lambda);
+  }
+
   PORTABLE_INLINE_FUNCTION
   Real ThermalDistributionOfTNu(const Real temp, const RadiationType type,
                                 const Real nu, Real *lambda = nullptr) const {
@@ -0,0 +1,260 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+#ifndef SINGULARITY_OPAC_NEUTRINOS_EMISSION_SAMPLER_NEUTRINOS_HPP_
+#define SINGULARITY_OPAC_NEUTRINOS_EMISSION_SAMPLER_NEUTRINOS_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <fast-math/logs.hpp>
+#include <ports-of-call/portability.hpp>
+#include <spiner/databox.hpp>
+#include <spiner/interpolation.hpp>
+
+#include <singularity-opac/base/host_parallel.hpp>
+#include <singularity-opac/base/lookup_state.hpp>
+#include <singularity-opac/base/opac_error.hpp>
+#include <singularity-opac/base/radiation_types.hpp>
+#include <singularity-opac/base/sp5.hpp>
+#include <singularity-opac/base/table_storage.hpp>
+#include <singularity-opac/constants/constants.hpp>
+
+#ifdef SPINER_USE_HDF
+#include "hdf5.h"
+#include "hdf5_hl.h"
+#endif
+
+// Inverse CDF tables for drawing the energies of emitted neutrinos.
+// At each node of a (rho, T, Ye) grid and for each species, the
+// table holds the log2 energies below which Nu fractions from 0 to 1
+// of the emissivity per frequency lie, spaced as quantileFraction
+// gives. A sample interpolates the quantile at a uniform random
+// number, so it costs one table lookup rather than the several
+// evaluations of rejection sampling. Between energy nodes j_nu is
+// taken to be a power law, as tables of logs interpolate it, and its
+// integral and inverse are exact for that shape.
+
+namespace singularity {
+namespace neutrinos {
+namespace impl {
+
+// Fills lq with the Nu quantiles of the emission in frequency, given
+// Ne increasing log2 energies lE and the log2 emissivity per frequency
+// lj at each. A spectrum with nothing emitted gets evenly spaced
+// energies.
+inline void emissionQuantiles(const Real *lE, const Real *lj, const int Ne,
+                              Real *lq, const int Nu) {
+  // In x = ln(nu), the emission per unit x is f = j_nu nu, which is
+  // exponential in x on each interval. Normalized to the peak, so it
+  // can't overflow.
+  std::vector<Real> lf(Ne);
+  std::vector<Real> cdf(Ne, 0);
+  Real lfmax = -std::numeric_limits<Real>::infinity();
+  for (int i = 0; i < Ne; ++i) {
+    lfmax = std::max(lfmax, lj[i] + lE[i]);
+  }
+  for (int i = 0; i < Ne; ++i) {
+    lf[i] = M_LN2 * (lj[i] + lE[i] - lfmax);
+  }
+  // Slope of ln f and the integral of f over interval i
+  auto slope = [&](const int i) {
+    return (lf[i + 1] - lf[i]) / (M_LN2 * (lE[i + 1] - lE[i]));
+  };
+  auto integral = [&](const int i, const Real t) {
+    const Real k = slope(i);
+    const Real fa = std::exp(lf[i]);
+    return (std::abs(k * t) < 1e-8) ? fa * t : fa * std::expm1(k * t) / k;
+  };
+  for (int i = 0; i + 1 < Ne; ++i) {
+    cdf[i + 1] = cdf[i] + integral(i, M_LN2 * (lE[i + 1] - lE[i]));
+  }
+  const Real total = cdf[Ne - 1];
+  if (!(total > 0) || !std::isfinite(total)) {
+    for (int k = 0; k < Nu; ++k) {
+      lq[k] = lE[0] + (lE[Ne - 1] - lE[0]) * k / (Nu - 1);
+    }
+    return;
+  }
+  int i = 0;
+  for (int q = 0; q < Nu; ++q) {
+    const Real m =
+        total * singularity::impl::quantileFraction(Real(q) / (Nu - 1));
+    while (i < Ne - 2 && cdf[i + 1] < m) {
+      ++i;
+    }
+    // Invert the integral over interval i for the remaining mass
+    const Real dx = M_LN2 * (lE[i + 1] - lE[i]);
+    const Real rem = m - cdf[i];
+    const Real k = slope(i);
+    const Real fa = std::exp(lf[i]);
+    Real t = (std::abs(k * dx) < 1e-8) ? rem / fa
+                                       : std::log1p(rem * k / fa) / k;
+    // Also catches NaN from intervals that emit nothing
+    if (!(t > 0)) t = 0;
+    if (t > dx) t = dx;
+    lq[q] = lE[i] + t / M_LN2;
+  }
+  lq[0] = lE[0];
+  lq[Nu - 1] = lE[Ne - 1];
+}
+
+} // namespace impl
+
+// Emission sampling tables of any neutrino model, for models that
+// have no tables of their own. SpinerOpacity builds them from its
+// own tables with BuildEmissionSampling.
+template <typename pc = PhysicalConstantsCGS>
+class EmissionSampler {
+ public:
+  static constexpr Real EPS = 10.0 * std::numeric_limits<Real>::min();
+  static constexpr Real Hz2MeV = pc::h / (1e6 * pc::eV);
+  static constexpr Real MeV2Hz = 1 / Hz2MeV;
+  static constexpr Real MeV2K = 1.e9 * 11.604525006;
+  static constexpr Real K2MeV = 1. / MeV2K;
+
+  EmissionSampler() = default;
+
+  // Integrates the emissivity of opac over Ne energies from leMin to
+  // leMax, at each of NRho x NT x NYe nodes, into Nu quantiles. Bounds
+  // are log10, with T in K and E in MeV. The fill runs on nthreads
+  // host threads, one by default and all cores if nthreads <= 0. With
+  // more than one, opac must be safe to call concurrently.
+  template <typename Opacity>
+  EmissionSampler(const Opacity &opac, Real lRhoMin, Real lRhoMax, int NRho,
+                  Real lTMin, Real lTMax, int NT, Real YeMin, Real YeMax,
+                  int NYe, Real leMin, Real leMax, int Ne, int Nu = 64,
+                  int nthreads = 1) {
+    if (NRho < 2 || NT < 2 || NYe < 2 || Ne < 2 || Nu < 2) {
+      OPAC_ERROR("neutrinos::EmissionSampler: each axis needs at least two "
+                 "points\n");
+    }
+    constexpr Real LOG2_10 = singularity::impl::LOG2_10;
+    lquantile_.resize(NRho, NT, NYe, NEUTRINO_NTYPES, Nu);
+    lquantile_.setRange(0, 0, 1, Nu);
+    lquantile_.setRange(2, YeMin, YeMax, NYe);
+    lquantile_.setRange(3, LOG2_10 * (lTMin + std::log10(K2MeV)),
+                        LOG2_10 * (lTMax + std::log10(K2MeV)), NT);
+    lquantile_.setRange(4, LOG2_10 * lRhoMin, LOG2_10 * lRhoMax, NRho);
+    setGrids_();
+    const Spiner::RegularGrid1D egrid(LOG2_10 * leMin, LOG2_10 * leMax, Ne);
+    singularity::impl::hostParallelFor(
+        NRho * NT * NYe, nthreads, [&](const int i) {
+          const int iRho = i / (NT * NYe);
+          const int iT = (i / NYe) % NT;
+          const int iYe = i % NYe;
+          const Real rho = BDMath::exp2(Rhogrid_.x(iRho));
+          const Real T = BDMath::exp2(Tgrid_.x(iT)) * MeV2K;
+          const Real Ye = Yegrid_.x(iYe);
+          std::vector<Real> lE(Ne);
+          std::vector<Real> lj(Ne);
+          for (int idx = 0; idx < NEUTRINO_NTYPES; ++idx) {
+            const RadiationType type = Idx2RadType(idx);
+            for (int ie = 0; ie < Ne; ++ie) {
+              lE[ie] = egrid.x(ie);
+              const Real nu = MeV2Hz * BDMath::exp2(lE[ie]);
+              const Real j = opac.EmissivityPerNu(rho, T, Ye, type, nu);
+              lj[ie] = BDMath::log2(std::max(j, Real(0)) + EPS);
+            }
+            impl::emissionQuantiles(lE.data(), lj.data(), Ne,
+                                    &lquantile_(iRho, iT, iYe, idx, 0), Nu);
+          }
+        });
+  }
+
+#ifdef SPINER_USE_HDF
+  explicit EmissionSampler(const std::string &filename) {
+    herr_t status = H5_SUCCESS;
+    hid_t file = H5Fopen(filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+    status += singularity::impl::loadHDFTable(
+        file, SP5::Opac::EmissionQuantiles, lquantile_);
+    status += H5Fclose(file);
+    if (status != H5_SUCCESS) {
+      OPAC_ERROR("neutrinos::EmissionSampler: HDF5 error\n");
+    }
+    setGrids_();
+  }
+
+  void Save(const std::string &filename) const {
+    herr_t status = H5_SUCCESS;
+    hid_t file =
+        H5Fcreate(filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    status += lquantile_.saveHDF(file, SP5::Opac::EmissionQuantiles);
+    status += singularity::impl::saveEncoding(file, TableEncoding::Log2);
+    status += H5Fclose(file);
+    if (status != H5_SUCCESS) {
+      OPAC_ERROR("neutrinos::EmissionSampler: HDF5 error\n");
+    }
+  }
+#endif
+
+  EmissionSampler GetOnDevice() {
+    EmissionSampler other;
+    other.lquantile_ = Spiner::getOnDeviceDataBox(lquantile_);
+    other.Rhogrid_ = Rhogrid_;
+    other.Tgrid_ = Tgrid_;
+    other.Yegrid_ = Yegrid_;
+    other.Nu_ = Nu_;
+    return other;
+  }
+
+  void Finalize() { lquantile_.finalize(); }
+
+  PORTABLE_INLINE_FUNCTION
+  LookupState PrepareLookup(const Real rho, const Real temp,
+                            const Real Ye) const {
+    LookupState s = singularity::impl::pointState(rho, temp, Ye);
+    singularity::impl::locate(Rhogrid_, BDMath::log2(rho), s.iRho, s.wRho);
+    singularity::impl::locate(Tgrid_, BDMath::log2(temp * K2MeV), s.iT, s.wT);
+    singularity::impl::locate(Yegrid_, Ye, s.iYe, s.wYe);
+    return s;
+  }
+
+  // Frequency in Hz of an emitted neutrino, for a uniform random
+  // number u in [0, 1]
+  PORTABLE_INLINE_FUNCTION
+  Real SampleEmissionEnergy(const Real rho, const Real temp, const Real Ye,
+                            const RadiationType type, const Real u) const {
+    return SampleEmissionEnergy(PrepareLookup(rho, temp, Ye), type, u);
+  }
+  PORTABLE_INLINE_FUNCTION
+  Real SampleEmissionEnergy(const LookupState &s, const RadiationType type,
+                            const Real u) const {
+    return MeV2Hz *
+           BDMath::exp2(singularity::impl::interpQuantile(
+               &lquantile_(0, 0, 0, 0, 0), Tgrid_.nPoints(),
+               Yegrid_.nPoints(), NEUTRINO_NTYPES, Nu_, s,
+               RadType2Idx(type), u));
+  }
+
+ private:
+  void setGrids_() {
+    Nu_ = lquantile_.range(0).nPoints();
+    Yegrid_ = lquantile_.range(2);
+    Tgrid_ = lquantile_.range(3);
+    Rhogrid_ = lquantile_.range(4);
+  }
+  Spiner::DataBox lquantile_;
+  Spiner::RegularGrid1D Rhogrid_, Tgrid_, Yegrid_;
+  int Nu_ = 0;
+};
+
+} // namespace neutrinos
+} // namespace singularity
+
+#endif // SINGULARITY_OPAC_NEUTRINOS_EMISSION_SAMPLER_NEUTRINOS_HPP_
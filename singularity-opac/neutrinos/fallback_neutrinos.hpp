@@ -0,0 +1,339 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+#ifndef SINGULARITY_OPAC_NEUTRINOS_FALLBACK_NEUTRINOS_
+#define SINGULARITY_OPAC_NEUTRINOS_FALLBACK_NEUTRINOS_
+
+#include <cstdio>
+#include <utility>
+
+#include <ports-of-call/portability.hpp>
+#include <singularity-opac/base/radiation_types.hpp>
+
+namespace singularity {
+namespace neutrinos {
+
+// Hands the points a table doesn't cover to another model, e.g., an
+// analytic one. A point is covered unless it is outside the table on
+// an axis whose policy is OutOfRange::Fallback; see SetOutOfRange.
+// Both models must use the same units. Thermal distributions are
+// those of the table.
+template <typename Table, typename Fallback>
+class WithFallback {
+ public:
+  WithFallback() = default;
+  WithFallback(Table &&table, Fallback &&fallback)
+      : table_(std::forward<Table>(table)),
+        fallback_(std::forward<Fallback>(fallback)) {}
+
+  auto GetOnDevice() {
+    return WithFallback<Table, Fallback>(table_.GetOnDevice(),
+                                         fallback_.GetOnDevice());
+  }
+  inline void Finalize() noexcept {
+    table_.Finalize();
+    fallback_.Finalize();
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  int nlambda() const noexcept { return table_.nlambda(); }
+
+  PORTABLE_INLINE_FUNCTION
+  void PrintParams() const noexcept {
+    printf("Table with fallback:\n");
+    table_.PrintParams();
+    fallback_.PrintParams();
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real AbsorptionCoefficient(const Real rho, const Real temp, const Real Ye,
+                             const RadiationType type, const Real nu,
+                             Real *lambda = nullptr) const {
+    if (table_.InTable(rho, temp, Ye, nu)) {
+      return table_.AbsorptionCoefficient(rho, temp, Ye, type, nu, lambda);
+    }
+    return fallback_.AbsorptionCoefficient(rho, temp, Ye, type, nu, lambda);
+  }
+
+  // Bins the table covers come from one batched table call, the
+  // others from the fallback one at a time
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  AbsorptionCoefficient(const Real rho, const Real temp, const Real Ye,
+                        const RadiationType type, FrequencyIndexer &nu_bins,
+                        DataIndexer &coeffs, const int nbins,
+                        Real *lambda = nullptr) const {
+    if (!table_.InTable(rho, temp, Ye)) {
+      fallback_.AbsorptionCoefficient(rho, temp, Ye, type, nu_bins, coeffs,
+                                      nbins, lambda);
+      return;
+    }
+    table_.AbsorptionCoefficient(rho, temp, Ye, type, nu_bins, coeffs, nbins,
+                                 lambda);
+    for (int i = 0; i < nbins; ++i) {
+      if (!table_.InTable(rho, temp, Ye, nu_bins[i])) {
+        coeffs[i] = fallback_.AbsorptionCoefficient(rho, temp, Ye, type,
+                                                    nu_bins[i], lambda);
+      }
+    }
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real AngleAveragedAbsorptionCoefficient(const Real rho, const Real temp,
+                                          const Real Ye,
+                                          const RadiationType type,
+                                          const Real nu,
+                                          Real *lambda = nullptr) const {
+    if (table_.InTable(rho, temp, Ye, nu)) {
+      return table_.AngleAveragedAbsorptionCoefficient(rho, temp, Ye, type, nu,
+                                                       lambda);
+    }
+    return fallback_.AngleAveragedAbsorptionCoefficient(rho, temp, Ye, type,
+                                                        nu, lambda);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void AngleAveragedAbsorptionCoefficient(
+      const Real rho, const Real temp, const Real Ye, const RadiationType type,
+      FrequencyIndexer &nu_bins, DataIndexer &coeffs, const int nbins,
+      Real *lambda = nullptr) const {
+    if (!table_.InTable(rho, temp, Ye)) {
+      fallback_.AngleAveragedAbsorptionCoefficient(rho, temp, Ye, type,
+                                                   nu_bins, coeffs, nbins,
+                                                   lambda);
+      return;
+    }
+    table_.AngleAveragedAbsorptionCoefficient(rho, temp, Ye, type, nu_bins,
+                                              coeffs, nbins, lambda);
+    for (int i = 0; i < nbins; ++i) {
+      if (!table_.InTable(rho, temp, Ye, nu_bins[i])) {
+        coeffs[i] = fallback_.AngleAveragedAbsorptionCoefficient(
+            rho, temp, Ye, type, nu_bins[i], lambda);
+      }
+    }
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real EmissivityPerNuOmega(const Real rho, const Real temp, const Real Ye,
+                            const RadiationType type, const Real nu,
+                            Real *lambda = nullptr) const {
+    if (table_.InTable(rho, temp, Ye, nu)) {
+      return table_.EmissivityPerNuOmega(rho, temp, Ye, type, nu, lambda);
+    }
+    return fallback_.EmissivityPerNuOmega(rho, temp, Ye, type, nu, lambda);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  EmissivityPerNuOmega(const Real rho, const Real temp, const Real Ye,
+                       const RadiationType type, FrequencyIndexer &nu_bins,
+                       DataIndexer &coeffs, const int nbins,
+                       Real *lambda = nullptr) const {
+    if (!table_.InTable(rho, temp, Ye)) {
+      fallback_.EmissivityPerNuOmega(rho, temp, Ye, type, nu_bins, coeffs,
+                                     nbins, lambda);
+      return;
+    }
+    table_.EmissivityPerNuOmega(rho, temp, Ye, type, nu_bins, coeffs, nbins,
+                                lambda);
+    for (int i = 0; i < nbins; ++i) {
+      if (!table_.InTable(rho, temp, Ye, nu_bins[i])) {
+        coeffs[i] = fallback_.EmissivityPerNuOmega(rho, temp, Ye, type,
+                                                   nu_bins[i], lambda);
+      }
+    }
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real EmissivityPerNu(const Real rho, const Real temp, const Real Ye,
+                       const RadiationType type, const Real nu,
+                       Real *lambda = nullptr) const {
+    if (table_.InTable(rho, temp, Ye, nu)) {
+      return table_.EmissivityPerNu(rho, temp, Ye, type, nu, lambda);
+    }
+    return fallback_.EmissivityPerNu(rho, temp, Ye, type, nu, lambda);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  EmissivityPerNu(const Real rho, const Real temp, const Real Ye,
+                  const RadiationType type, FrequencyIndexer &nu_bins,
+                  DataIndexer &coeffs, const int nbins,
+                  Real *lambda = nullptr) const {
+    if (!table_.InTable(rho, temp, Ye)) {
+      fallback_.EmissivityPerNu(rho, temp, Ye, type, nu_bins, coeffs, nbins,
+                                lambda);
+      return;
+    }
+    table_.EmissivityPerNu(rho, temp, Ye, type, nu_bins, coeffs, nbins,
+                           lambda);
+    for (int i = 0; i < nbins; ++i) {
+      if (!table_.InTable(rho, temp, Ye, nu_bins[i])) {
+        coeffs[i] = fallback_.EmissivityPerNu(rho, temp, Ye, type, nu_bins[i],
+                                              lambda);
+      }
+    }
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  void AbsorptionAndEmissivity(const Real rho, const Real temp, const Real Ye,
+                               const RadiationType type, const Real nu,
+                               Real &alpha, Real &jnu,
+                               Real *lambda = nullptr) const {
+    if (table_.InTable(rho, temp, Ye, nu)) {
+      table_.AbsorptionAndEmissivity(rho, temp, Ye, type, nu, alpha, jnu,
+                                     lambda);
+    } else {
+      fallback_.AbsorptionAndEmissivity(rho, temp, Ye, type, nu, alpha, jnu,
+                                        lambda);
+    }
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  AbsorptionAndEmissivity(const Real rho, const Real temp, const Real Ye,
+                          const RadiationType type, FrequencyIndexer &nu_bins,
+                          DataIndexer &alpha, DataIndexer &jnu, const int nbins,
+                          Real *lambda = nullptr) const {
+    if (!table_.InTable(rho, temp, Ye)) {
+      fallback_.AbsorptionAndEmissivity(rho, temp, Ye, type, nu_bins, alpha,
+                                        jnu, nbins, lambda);
+      return;
+    }
+    table_.AbsorptionAndEmissivity(rho, temp, Ye, type, nu_bins, alpha, jnu,
+                                   nbins, lambda);
+    for (int i = 0; i < nbins; ++i) {
+      if (!table_.InTable(rho, temp, Ye, nu_bins[i])) {
+        Real a, j;
+        fallback_.AbsorptionAndEmissivity(rho, temp, Ye, type, nu_bins[i], a,
+                                          j, lambda);
+        alpha[i] = a;
+        jnu[i] = j;
+      }
+    }
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real Emissivity(const Real rho, const Real temp, const Real Ye,
+                  const RadiationType type, Real *lambda = nullptr) const {
+    if (table_.InTable(rho, temp, Ye)) {
+      return table_.Emissivity(rho, temp, Ye, type, lambda);
+    }
+    return fallback_.Emissivity(rho, temp, Ye, type, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real NumberEmissivity(const Real rho, const Real temp, Real Ye,
+                        RadiationType type, Real *lambda = nullptr) const {
+    if (table_.InTable(rho, temp, Ye)) {
+      return table_.NumberEmissivity(rho, temp, Ye, type, lambda);
+    }
+    return fallback_.NumberEmissivity(rho, temp, Ye, type, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real ThermalDistributionOfTNu(const Real temp, const RadiationType type,
+                                const Real nu, Real *lambda = nullptr) const {
+    return table_.ThermalDistributionOfTNu(temp, type, nu, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real DThermalDistributionOfTNuDT(const Real temp, const RadiationType type,
+                                   const Real nu,
+                                   Real *lambda = nullptr) const {
+    return table_.DThermalDistributionOfTNuDT(temp, type, nu, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real ThermalDistributionOfT(const Real temp, const RadiationType type,
+                              Real *lambda = nullptr) const {
+    return table_.ThermalDistributionOfT(temp, type, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION Real ThermalNumberDistributionOfT(
+      const Real temp, const RadiationType type, Real *lambda = nullptr) const {
+    return table_.ThermalNumberDistributionOfT(temp, type, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real EnergyDensityFromTemperature(const Real temp, const RadiationType type,
+                                    Real *lambda = nullptr) const {
+    return table_.EnergyDensityFromTemperature(temp, type, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real TemperatureFromEnergyDensity(const Real er, const RadiationType type,
+                                    Real *lambda = nullptr) const {
+    return table_.TemperatureFromEnergyDensity(er, type, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real NumberDensityFromTemperature(const Real temp, const RadiationType type,
+                                    Real *lambda = nullptr) const {
+    return table_.NumberDensityFromTemperature(temp, type, lambda);
+  }
+
+ private:
+  Table table_;
+  Fallback fallback_;
+};
+
+// The same for mean opacities
+template <typename Table, typename Fallback>
+class MeanWithFallback {
+ public:
+  MeanWithFallback() = default;
+  MeanWithFallback(Table &&table, Fallback &&fallback)
+      : table_(std::forward<Table>(table)),
+        fallback_(std::forward<Fallback>(fallback)) {}
+
+  auto GetOnDevice() {
+    return MeanWithFallback<Table, Fallback>(table_.GetOnDevice(),
+                                             fallback_.GetOnDevice());
+  }
+  inline void Finalize() noexcept {
+    table_.Finalize();
+    fallback_.Finalize();
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real PlanckMeanAbsorptionCoefficient(const Real rho, const Real temp,
+                                       const Real Ye,
+                                       const RadiationType type) const {
+    if (table_.InTable(rho, temp, Ye)) {
+      return table_.PlanckMeanAbsorptionCoefficient(rho, temp, Ye, type);
+    }
+    return fallback_.PlanckMeanAbsorptionCoefficient(rho, temp, Ye, type);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real RosselandMeanAbsorptionCoefficient(const Real rho, const Real temp,
+                                          const Real Ye,
+                                          const RadiationType type) const {
+    if (table_.InTable(rho, temp, Ye)) {
+      return table_.RosselandMeanAbsorptionCoefficient(rho, temp, Ye, type);
+    }
+    return fallback_.RosselandMeanAbsorptionCoefficient(rho, temp, Ye, type);
+  }
+
+ private:
+  Table table_;
+  Fallback fallback_;
+};
+
+} // namespace neutrinos
+} // namespace singularity
+
+#endif // SINGULARITY_OPAC_NEUTRINOS_FALLBACK_NEUTRINOS_
@@ -19,10 +19,12 @@
 #include <utility>
 
 #include <ports-of-call/portability.hpp>
+#include <singularity-opac/base/lookup_state.hpp>
 #include <singularity-opac/base/opac_error.hpp>
+#include <singularity-opac/base/opac_variant.hpp>
 #include <singularity-opac/base/radiation_types.hpp>
 #include <singularity-opac/neutrinos/neutrino_variant.hpp>
-#include <variant/include/mpark/variant.hpp>
+#include <singularity-opac/neutrinos/zone_queries_neutrinos.hpp>
 
 namespace singularity {
 namespace neutrinos {
@@ -60,11 +62,11 @@ class MeanVariant {
           !std::is_same<MeanVariant, typename std::decay<Choice>::type>::value,
           bool>::type = true>
   Choice get() {
-    return mpark::get<Choice>(opac_);
+    return singularity::impl::get<Choice>(opac_);
   }
 
   MeanVariant GetOnDevice() {
-    return mpark::visit(
+    return singularity::impl::visit(
         [](auto &opac) { return opac_variant<Opacs...>(opac.GetOnDevice()); },
         opac_);
   }
@@ -72,7 +74,7 @@ class MeanVariant {
   PORTABLE_INLINE_FUNCTION Real PlanckMeanAbsorptionCoefficient(
       const Real rho, const Real temp, const Real Ye,
       const RadiationType type) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.PlanckMeanAbsorptionCoefficient(rho, temp, Ye, type);
         },
@@ -81,15 +83,70 @@ class MeanVariant {
   PORTABLE_INLINE_FUNCTION Real RosselandMeanAbsorptionCoefficient(
       const Real rho, const Real temp, const Real Ye,
       const RadiationType type) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.RosselandMeanAbsorptionCoefficient(rho, temp, Ye, type);
         },
         opac_);
   }
 
+  PORTABLE_INLINE_FUNCTION LookupState PrepareLookup(const Real rho,
+                                                     const Real temp,
+                                                     const Real Ye) const {
+    return singularity::impl::visit(
+        [=](const auto &opac) { return opac.PrepareLookup(rho, temp, Ye); },
+        opac_);
+  }
+  PORTABLE_INLINE_FUNCTION Real PlanckMeanAbsorptionCoefficient(
+      const LookupState &s, const RadiationType type) const {
+    return singularity::impl::visit(
+        [&](const auto &opac) {
+          return opac.PlanckMeanAbsorptionCoefficient(s, type);
+        },
+        opac_);
+  }
+  PORTABLE_INLINE_FUNCTION Real RosselandMeanAbsorptionCoefficient(
+      const LookupState &s, const RadiationType type) const {
+    return singularity::impl::visit(
+        [&](const auto &opac) {
+          return opac.RosselandMeanAbsorptionCoefficient(s, type);
+        },
+        opac_);
+  }
+
+  // Bulk forms, for nzones zones at once, as for the bulk forms of
+  // Variant. values[z] is the mean of zone z.
+  template <typename ZoneIndexer, typename TypeIndexer, typename DataIndexer>
+  void BulkPlanckMeanAbsorptionCoefficient(const int nzones,
+                                           const ZoneIndexer &rho,
+                                           const ZoneIndexer &temp,
+                                           const ZoneIndexer &Ye,
+                                           const TypeIndexer &types,
+                                           const DataIndexer &values,
+                                           const int nthreads = 1) const {
+    singularity::impl::visitZones(
+        opac_, nzones, nthreads,
+        singularity::impl::zoneValues<PlanckMeanAbsorptionQuery>(
+            zoneArrays(rho, temp, Ye, types), values));
+  }
+
+  template <typename ZoneIndexer, typename TypeIndexer, typename DataIndexer>
+  void BulkRosselandMeanAbsorptionCoefficient(const int nzones,
+                                              const ZoneIndexer &rho,
+                                              const ZoneIndexer &temp,
+                                              const ZoneIndexer &Ye,
+                                              const TypeIndexer &types,
+                                              const DataIndexer &values,
+                                              const int nthreads = 1) const {
+    singularity::impl::visitZones(
+        opac_, nzones, nthreads,
+        singularity::impl::zoneValues<RosselandMeanAbsorptionQuery>(
+            zoneArrays(rho, temp, Ye, types), values));
+  }
+
   inline void Finalize() noexcept {
-    return mpark::visit([](auto &opac) { return opac.Finalize(); }, opac_);
+    return singularity::impl::visit(
+        [](auto &opac) { return opac.Finalize(); }, opac_);
   }
 };
 
@@ -16,18 +16,34 @@
 #ifndef SINGULARITY_OPAC_NEUTRINOS_MEAN_OPACITY_NEUTRINOS_
 #define SINGULARITY_OPAC_NEUTRINOS_MEAN_OPACITY_NEUTRINOS_
 
+#include <algorithm>
 #include <cmath>
+#include <vector>
 
+#include <fast-math/logs.hpp>
 #include <ports-of-call/portability.hpp>
+#include <singularity-opac/base/host_parallel.hpp>
+#include <singularity-opac/base/lookup_state.hpp>
+#include <singularity-opac/base/mapped_tables.hpp>
+#include <singularity-opac/base/mean_quadrature.hpp>
 #include <singularity-opac/base/radiation_types.hpp>
 #include <singularity-opac/base/robust_utils.hpp>
 #include <singularity-opac/base/sp5.hpp>
+#include <singularity-opac/base/table_grid.hpp>
+#include <singularity-opac/base/table_storage.hpp>
+#include <singularity-opac/base/unit_system.hpp>
 #include <singularity-opac/constants/constants.hpp>
 #include <spiner/databox.hpp>
 
+#include <singularity-opac/neutrinos/fallback_neutrinos.hpp>
 #include <singularity-opac/neutrinos/mean_neutrino_variant.hpp>
 #include <singularity-opac/neutrinos/non_cgs_neutrinos.hpp>
 
+// Tables are CGS in files and in memory, unless a file is loaded in
+// other units. That bakes the conversion MeanNonCGSUnits would make
+// into the tables, so lookups in those units cost what lookups in CGS
+// do. Tables loaded this way can't be saved.
+
 namespace singularity {
 namespace neutrinos {
 namespace impl {
@@ -42,48 +58,102 @@ class MeanOpacity {
 
  public:
   MeanOpacity() = default;
+  // The tables are filled on nthreads host threads, one by default
+  // and all cores if nthreads <= 0. With more than one, opac must
+  // be safe to call concurrently. The tables don't depend on how many.
+  template <typename Opacity>
+  MeanOpacity(const Opacity &opac, const Real lRhoMin, const Real lRhoMax,
+              const int NRho, const Real lTMin, const Real lTMax, const int NT,
+              const Real YeMin, const Real YeMax, const int NYe,
+              Real *lambda = nullptr,
+              TablePrecision precision = TablePrecision::Double,
+              const int nthreads = 1) {
+    MeanOpacityImpl_<Opacity, true>(opac, lRhoMin, lRhoMax, NRho, lTMin, lTMax,
+                                    NT, YeMin, YeMax, NYe, -1., -1.,
+                                    MeanQuadrature(), lambda, nthreads);
+    setPrecision_(precision);
+  }
+
+  // Integrates over frequency with quadrature. Trapezoid points span
+  // the range the constructor above chooses.
   template <typename Opacity>
   MeanOpacity(const Opacity &opac, const Real lRhoMin, const Real lRhoMax,
               const int NRho, const Real lTMin, const Real lTMax, const int NT,
               const Real YeMin, const Real YeMax, const int NYe,
-              Real *lambda = nullptr) {
+              const MeanQuadrature &quadrature, Real *lambda = nullptr,
+              TablePrecision precision = TablePrecision::Double,
+              const int nthreads = 1) {
     MeanOpacityImpl_<Opacity, true>(opac, lRhoMin, lRhoMax, NRho, lTMin, lTMax,
-                                    NT, YeMin, YeMax, NYe, -1., -1., 100,
-                                    lambda);
+                                    NT, YeMin, YeMax, NYe, -1., -1.,
+                                    quadrature, lambda, nthreads);
+    setPrecision_(precision);
   }
 
   template <typename Opacity>
   MeanOpacity(const Opacity &opac, const Real lRhoMin, const Real lRhoMax,
               const int NRho, const Real lTMin, const Real lTMax, const int NT,
               const Real YeMin, const Real YeMax, const int NYe, Real lNuMin,
-              Real lNuMax, const int NNu, Real *lambda = nullptr) {
+              Real lNuMax, const int NNu, Real *lambda = nullptr,
+              TablePrecision precision = TablePrecision::Double,
+              const int nthreads = 1) {
     MeanOpacityImpl_<Opacity, false>(opac, lRhoMin, lRhoMax, NRho, lTMin, lTMax,
-                                     NT, YeMin, YeMax, NYe, lNuMin, lNuMax, NNu,
-                                     lambda);
+                                     NT, YeMin, YeMax, NYe, lNuMin, lNuMax,
+                                     {QuadratureRule::Trapezoid, NNu}, lambda,
+                                     nthreads);
+    setPrecision_(precision);
   }
 
 #ifdef SPINER_USE_HDF
-  MeanOpacity(const std::string &filename) : filename_(filename.c_str()) {
+  // Files hold double or quantized tables. Either is decoded on load
+  // and converted to precision.
+  MeanOpacity(const std::string &filename,
+              TablePrecision precision = TablePrecision::Double)
+      : MeanOpacity(filename, UnitSystem(), precision) {}
+
+  // Loads filename in units, as described at the top of the file
+  MeanOpacity(const std::string &filename, const UnitSystem &units,
+              TablePrecision precision = TablePrecision::Double)
+      : filename_(filename.c_str()) {
     herr_t status = H5_SUCCESS;
     hid_t file = H5Fopen(filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
-    status += lkappaPlanck_.loadHDF(file, SP5::MeanOpac::PlanckMeanOpacity);
-    status +=
-        lkappaRosseland_.loadHDF(file, SP5::MeanOpac::RosselandMeanOpacity);
+    status += singularity::impl::loadHDFTable(
+        file, SP5::MeanOpac::PlanckMeanOpacity, lkappaPlanck_);
+    status += singularity::impl::loadHDFTable(
+        file, SP5::MeanOpac::RosselandMeanOpacity, lkappaRosseland_);
+    const TableEncoding encoding = singularity::impl::loadEncoding(file);
     status += H5Fclose(file);
 
     if (status != H5_SUCCESS) {
       OPAC_ERROR("neutrinos::MeanOpacity: HDF5 error\n");
     }
+    if (encoding == TableEncoding::Log10) {
+      singularity::impl::log10ToLog2(lkappaPlanck_, {2, 3});
+      singularity::impl::log10ToLog2(lkappaRosseland_, {2, 3});
+    }
+    bakeUnits_(units);
+    setPrecision_(precision);
   }
 
   void Save(const std::string &filename) const {
+    requireCGS_();
+    Spiner::DataBox lkappaPlanck = lkappaPlanck_;
+    Spiner::DataBox lkappaRosseland = lkappaRosseland_;
+    if (precision_ != TablePrecision::Double) {
+      widen_(PLANCK, lkappaPlanck);
+      widen_(ROSSELAND, lkappaRosseland);
+    }
     herr_t status = H5_SUCCESS;
     hid_t file =
         H5Fcreate(filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
-    status += lkappaPlanck_.saveHDF(file, SP5::MeanOpac::PlanckMeanOpacity);
+    status += lkappaPlanck.saveHDF(file, SP5::MeanOpac::PlanckMeanOpacity);
     status +=
-        lkappaRosseland_.saveHDF(file, SP5::MeanOpac::RosselandMeanOpacity);
+        lkappaRosseland.saveHDF(file, SP5::MeanOpac::RosselandMeanOpacity);
+    status += singularity::impl::saveEncoding(file, TableEncoding::Log2);
     status += H5Fclose(file);
+    if (precision_ != TablePrecision::Double) {
+      lkappaPlanck.finalize();
+      lkappaRosseland.finalize();
+    }
 
     if (status != H5_SUCCESS) {
       OPAC_ERROR("neutrinos::MeanOpacity: HDF5 error\n");
@@ -91,40 +161,146 @@ class MeanOpacity {
   }
 #endif
 
+#ifdef SINGULARITY_USE_MMAP
+  // Maps a file written by SaveRaw. At double precision the mapped
+  // tables are used in place, without reading or copying them.
+  MeanOpacity(const std::string &filename, RawFormat,
+              TablePrecision precision = TablePrecision::Double)
+      : filename_(filename.c_str()) {
+    mapped_.open(filename);
+    fromMapped_(precision);
+  }
+
+  // Attaches to a shared memory segment created by SaveShared. Only
+  // double precision tables are shared; others are private.
+  MeanOpacity(const std::string &name, SharedMemory,
+              TablePrecision precision = TablePrecision::Double)
+      : filename_(name.c_str()) {
+    mapped_.attachShared(name);
+    fromMapped_(precision);
+  }
+#endif
+
+#if defined(SINGULARITY_USE_MPI) && defined(SPINER_USE_HDF)
+  // Collective over comm. The first rank on each node loads filename
+  // and shares the tables with the other ranks on the node through
+  // an MPI shared window. Finalize is collective as well. If the
+  // first rank can't load the file, every rank on the node fails.
+  MeanOpacity(const std::string &filename, MPI_Comm comm,
+              TablePrecision precision = TablePrecision::Double)
+      : filename_(filename.c_str()) {
+    MPI_Comm node;
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node);
+    mapped_.shareOnNode(node, TableEncoding::Log2, [&](const auto &share) {
+      MeanOpacity loaded(filename);
+      loaded.withRawTables_(share);
+      loaded.Finalize();
+    });
+    fromMapped_(precision);
+  }
+#endif
+
+  void SaveRaw(const std::string &filename) const {
+    withRawTables_([&](const singularity::impl::RawTableWriter &w) {
+      w.write(filename, TableEncoding::Log2);
+    });
+  }
+
+#ifdef SINGULARITY_USE_MMAP
+  // Copies the tables into a new POSIX shared memory segment. Other
+  // processes on the node may attach to it once this returns; remove
+  // it with RemoveSharedTables once they have.
+  void SaveShared(const std::string &name) const {
+    withRawTables_([&](const singularity::impl::RawTableWriter &w) {
+      singularity::impl::createSharedTables(name, w, TableEncoding::Log2);
+    });
+  }
+#endif
+
+  // Sets what lookups do outside the table on the rho, T and Ye axes,
+  // which by default is to extrapolate. Set it on host, before
+  // GetOnDevice.
+  void SetOutOfRange(const OutOfRangePolicy &policy) {
+    bounds_.Rho = singularity::impl::AxisBounds(policy.rho, grids_.Rho.min(),
+                                                grids_.Rho.max());
+    bounds_.T = singularity::impl::AxisBounds(policy.T, grids_.T.min(),
+                                              grids_.T.max());
+    bounds_.Ye = singularity::impl::AxisBounds(policy.Ye, grids_.Ye.min(),
+                                               grids_.Ye.max());
+  }
+
+  // Whether a point is inside the table on every axis whose policy is
+  // OutOfRange::Fallback
+  PORTABLE_INLINE_FUNCTION bool InTable(const Real rho, const Real temp,
+                                        const Real Ye) const {
+    return bounds_.Rho.covers(toLog_(rho)) && bounds_.T.covers(toLog_(temp)) &&
+           bounds_.Ye.covers(Ye);
+  }
+
   PORTABLE_INLINE_FUNCTION void PrintParams() const {
     printf("Mean opacity\n");
   }
 
   MeanOpacity GetOnDevice() {
     MeanOpacity other;
-    other.lkappaPlanck_ = Spiner::getOnDeviceDataBox(lkappaPlanck_);
-    other.lkappaRosseland_ = Spiner::getOnDeviceDataBox(lkappaRosseland_);
+    if (precision_ != TablePrecision::Double) {
+      other.lkappa_ = lkappa_.getOnDevice();
+      other.qkappa_ = qkappa_.getOnDevice();
+    } else {
+      other.lkappaPlanck_ = Spiner::getOnDeviceDataBox(lkappaPlanck_);
+      other.lkappaRosseland_ = Spiner::getOnDeviceDataBox(lkappaRosseland_);
+    }
+    other.grids_ = grids_;
+    other.bounds_ = bounds_;
+    other.precision_ = precision_;
+    other.units_ = units_;
     return other;
   }
 
   void Finalize() {
     lkappaPlanck_.finalize();
     lkappaRosseland_.finalize();
+    lkappa_.finalize();
+    qkappa_.finalize();
+    mapped_.close();
+  }
+
+  // The cell of (rho, temp, Ye), for the forms of the queries below
+  // that take a LookupState
+  PORTABLE_INLINE_FUNCTION
+  LookupState PrepareLookup(const Real rho, const Real temp,
+                            const Real Ye) const {
+    LookupState s = singularity::impl::pointState(rho, temp, Ye);
+    singularity::impl::locate(grids_.Rho, bounds_.Rho(toLog_(rho)), s.iRho,
+                              s.wRho);
+    singularity::impl::locate(grids_.T, bounds_.T(toLog_(temp)), s.iT, s.wT);
+    singularity::impl::locate(grids_.Ye, bounds_.Ye(Ye), s.iYe, s.wYe);
+    return s;
   }
 
   PORTABLE_INLINE_FUNCTION
   Real PlanckMeanAbsorptionCoefficient(const Real rho, const Real temp,
                                        const Real Ye,
                                        const RadiationType type) const {
-    Real lRho = toLog_(rho);
-    Real lT = toLog_(temp);
-    int idx = RadType2Idx(type);
-    return rho * fromLog_(lkappaPlanck_.interpToReal(lRho, lT, Ye, idx));
+    return PlanckMeanAbsorptionCoefficient(PrepareLookup(rho, temp, Ye), type);
+  }
+  PORTABLE_INLINE_FUNCTION
+  Real PlanckMeanAbsorptionCoefficient(const LookupState &s,
+                                       const RadiationType type) const {
+    return s.rho * fromLog_(interp_(PLANCK, s, RadType2Idx(type)));
   }
 
   PORTABLE_INLINE_FUNCTION
   Real RosselandMeanAbsorptionCoefficient(const Real rho, const Real temp,
                                           const Real Ye,
                                           const RadiationType type) const {
-    Real lRho = toLog_(rho);
-    Real lT = toLog_(temp);
-    int idx = RadType2Idx(type);
-    return rho * fromLog_(lkappaRosseland_.interpToReal(lRho, lT, Ye, idx));
+    return RosselandMeanAbsorptionCoefficient(PrepareLookup(rho, temp, Ye),
+                                              type);
+  }
+  PORTABLE_INLINE_FUNCTION
+  Real RosselandMeanAbsorptionCoefficient(const LookupState &s,
+                                          const RadiationType type) const {
+    return s.rho * fromLog_(interp_(ROSSELAND, s, RadType2Idx(type)));
   }
 
  private:
@@ -133,65 +309,87 @@ class MeanOpacity {
                         const Real lRhoMax, const int NRho, const Real lTMin,
                         const Real lTMax, const int NT, const Real YeMin,
                         const Real YeMax, const int NYe, Real lNuMin,
-                        Real lNuMax, const int NNu, Real *lambda = nullptr) {
+                        Real lNuMax, const MeanQuadrature &quadrature,
+                        Real *lambda, const int nthreads) {
     lkappaPlanck_.resize(NRho, NT, NYe, NEUTRINO_NTYPES);
     // index 0 is the species and is not interpolatable
     lkappaPlanck_.setRange(1, YeMin, YeMax, NYe);
-    lkappaPlanck_.setRange(2, lTMin, lTMax, NT);
-    lkappaPlanck_.setRange(3, lRhoMin, lRhoMax, NRho);
+    // Bounds are given in log10, but the tables are stored in log2
+    constexpr Real LOG2_10 = singularity::impl::LOG2_10;
+    lkappaPlanck_.setRange(2, LOG2_10 * lTMin, LOG2_10 * lTMax, NT);
+    lkappaPlanck_.setRange(3, LOG2_10 * lRhoMin, LOG2_10 * lRhoMax, NRho);
+    lNuMin *= LOG2_10;
+    lNuMax *= LOG2_10;
+    const Real TMin = fromLog_(lkappaPlanck_.range(2).min());
+    const Real TMax = fromLog_(lkappaPlanck_.range(2).max());
     lkappaRosseland_.copyMetadata(lkappaPlanck_);
 
-    // Fill tables
-    for (int iRho = 0; iRho < NRho; ++iRho) {
-      Real lRho = lkappaPlanck_.range(3).x(iRho);
-      Real rho = fromLog_(lRho);
-      for (int iT = 0; iT < NT; ++iT) {
-        Real lT = lkappaPlanck_.range(2).x(iT);
-        Real T = fromLog_(lT);
-        for (int iYe = 0; iYe < NYe; ++iYe) {
-          Real Ye = lkappaPlanck_.range(1).x(iYe);
+    // Choose default temperature-specific frequency grid if frequency
+    // grid not specified
+    if (AUTOFREQ) {
+      lNuMin =
+          toLog_(singularity::impl::THERMAL_NU_LOW * pc::kb * TMin / pc::h);
+      lNuMax =
+          toLog_(singularity::impl::THERMAL_NU_HIGH * pc::kb * TMax / pc::h);
+    }
+    const singularity::impl::FrequencyQuadrature frequencies(
+        quadrature, fromLog_(lNuMin), fromLog_(lNuMax));
+
+    // The thermal spectra depend only on T and the species, so with
+    // fixed rules they are filled once per temperature, at the nodes
+    // integrate uses, B first and then dB/dT. GaussKronrod nodes
+    // follow the integrands, so it evaluates them where it needs them.
+    std::vector<std::vector<Real>> thermal(NT * NEUTRINO_NTYPES);
+    singularity::impl::hostParallelFor(NT, nthreads, [&](const int iT) {
+      const Real T = fromLog_(lkappaPlanck_.range(2).x(iT));
+      const std::vector<Real> nu = frequencies.nodes(pc::kb * T / pc::h);
+      const int n = nu.size();
+      for (int idx = 0; idx < NEUTRINO_NTYPES; ++idx) {
+        const RadiationType type = Idx2RadType(idx);
+        std::vector<Real> &spectra = thermal[iT * NEUTRINO_NTYPES + idx];
+        spectra.resize(2 * n);
+        for (int inu = 0; inu < n; ++inu) {
+          spectra[inu] = opac.ThermalDistributionOfTNu(T, type, nu[inu]);
+          spectra[n + inu] =
+              opac.DThermalDistributionOfTNuDT(T, type, nu[inu]);
+        }
+      }
+    });
+
+    // Fill tables. Each (rho, T, Ye) node is independent, so they are
+    // spread over host threads, and the absorption coefficients of a
+    // species at every frequency of a rule come from batched calls.
+    singularity::impl::hostParallelFor(
+        NRho * NT * NYe, nthreads, [&](const int i) {
+          const int iRho = i / (NT * NYe);
+          const int iT = (i / NYe) % NT;
+          const int iYe = i % NYe;
+          const Real rho = fromLog_(lkappaPlanck_.range(3).x(iRho));
+          const Real T = fromLog_(lkappaPlanck_.range(2).x(iT));
+          const Real Ye = lkappaPlanck_.range(1).x(iYe);
           for (int idx = 0; idx < NEUTRINO_NTYPES; ++idx) {
             RadiationType type = Idx2RadType(idx);
-            Real kappaPlanckNum = 0.;
-            Real kappaPlanckDenom = 0.;
-            Real kappaRosselandNum = 0.;
-            Real kappaRosselandDenom = 0.;
-            // Choose default temperature-specific frequency grid if frequency
-            // grid not specified
-            if (AUTOFREQ) {
-              lNuMin = toLog_(1.e-3 * pc::kb * fromLog_(lTMin) / pc::h);
-              lNuMax = toLog_(1.e3 * pc::kb * fromLog_(lTMax) / pc::h);
-            }
-            const Real dlnu = (lNuMax - lNuMin) / (NNu - 1);
-            // Integrate over frequency
-            for (int inu = 0; inu < NNu; ++inu) {
-              const Real weight =
-                  (inu == 0 || inu == NNu - 1) ? 0.5 : 1.; // Trapezoidal rule
-              const Real lnu = lNuMin + inu * dlnu;
-              const Real nu = fromLog_(lnu);
-              const Real alpha =
-                  opac.AbsorptionCoefficient(rho, T, Ye, type, nu, lambda);
-              const Real B = opac.ThermalDistributionOfTNu(T, type, nu);
-              const Real dBdT = opac.DThermalDistributionOfTNuDT(T, type, nu);
-              kappaPlanckNum += weight * alpha / rho * B * nu * dlnu;
-              kappaPlanckDenom += weight * B * nu * dlnu;
-
-              // Only contributions to integral from non-zero kappa
-              if (alpha > singularity_opac::robust::SMALL()) {
-                kappaRosselandNum +=
-                    weight * singularity_opac::robust::ratio(rho, alpha) *
-                    dBdT * nu * dlnu;
-                kappaRosselandDenom += weight * dBdT * nu * dlnu;
-              }
-            }
-
-            Real kappaPlanck = singularity_opac::robust::ratio(
-                kappaPlanckNum, kappaPlanckDenom);
-            Real kappaRosseland =
-                kappaPlanck > singularity_opac::robust::SMALL()
-                    ? singularity_opac::robust::ratio(kappaRosselandDenom,
-                                                      kappaRosselandNum)
-                    : 0.;
+            const singularity::impl::MeanSums sums = frequencies.integrate(
+                rho, pc::kb * T / pc::h,
+                [&](const Real *nu, const int n, Real *alpha, Real *B,
+                    Real *dBdT) {
+                  opac.AbsorptionCoefficient(rho, T, Ye, type, nu, alpha, n,
+                                             lambda);
+                  const std::vector<Real> &spectra =
+                      thermal[iT * NEUTRINO_NTYPES + idx];
+                  if (!spectra.empty()) {
+                    std::copy(spectra.begin(), spectra.begin() + n, B);
+                    std::copy(spectra.begin() + n, spectra.end(), dBdT);
+                    return;
+                  }
+                  for (int inu = 0; inu < n; ++inu) {
+                    B[inu] = opac.ThermalDistributionOfTNu(T, type, nu[inu]);
+                    dBdT[inu] =
+                        opac.DThermalDistributionOfTNuDT(T, type, nu[inu]);
+                  }
+                });
+            const Real kappaPlanck = sums.Planck();
+            const Real kappaRosseland = sums.Rosseland();
 
             lkappaPlanck_(iRho, iT, iYe, idx) = toLog_(kappaPlanck);
             lkappaRosseland_(iRho, iT, iYe, idx) = toLog_(kappaRosseland);
@@ -200,18 +398,164 @@ class MeanOpacity {
               OPAC_ERROR("neutrinos::MeanOpacity: NAN in opacity evaluations");
             }
           }
-        }
-      }
-    }
+        });
   }
   PORTABLE_INLINE_FUNCTION Real toLog_(const Real x) const {
-    return std::log10(std::abs(x) + EPS);
+    return BDMath::log2(std::abs(x) + EPS);
   }
   PORTABLE_INLINE_FUNCTION Real fromLog_(const Real lx) const {
-    return std::pow(10., lx);
+    return BDMath::exp2(lx);
+  }
+  PORTABLE_INLINE_FUNCTION Real interp_(const int q, const LookupState &s,
+                                        const int idx) const {
+    const std::size_t NT = grids_.T.nPoints();
+    const std::size_t NYe = grids_.Ye.nPoints();
+    if (precision_ == TablePrecision::Float) {
+      const float *data = lkappa_.data<float>() + q * grids_.size();
+      return singularity::impl::interp3DSpecies(data, NT, NYe, NEUTRINO_NTYPES,
+                                                s, idx);
+    }
+    if (precision_ == TablePrecision::Quantized) {
+      return singularity::impl::interp3DSpecies(qkappa_.table(q), NT, NYe,
+                                                NEUTRINO_NTYPES, s, idx);
+    }
+    const Spiner::DataBox &db =
+        (q == PLANCK) ? lkappaPlanck_ : lkappaRosseland_;
+    return singularity::impl::interp3DSpecies(&db(0, 0, 0, 0), NT, NYe,
+                                              NEUTRINO_NTYPES, s, idx);
+  }
+  void fromMapped_(const TablePrecision precision) {
+    if (mapped_.encoding() != TableEncoding::Log2) {
+      mapped_.close();
+      OPAC_ERROR("neutrinos::MeanOpacity: raw tables must be log2\n");
+    }
+    lkappaPlanck_ = mapped_.get(SP5::MeanOpac::PlanckMeanOpacity);
+    lkappaRosseland_ = mapped_.get(SP5::MeanOpac::RosselandMeanOpacity);
+    setPrecision_(precision);
+    // Reduced precision tables are copies, so the mapping is no
+    // longer needed
+    if (precision != TablePrecision::Double) {
+      mapped_.close();
+    }
   }
+  // Calls f with a writer holding the tables at double precision
+  template <typename Function>
+  void withRawTables_(const Function &f) const {
+    requireCGS_();
+    Spiner::DataBox lkappaPlanck = lkappaPlanck_;
+    Spiner::DataBox lkappaRosseland = lkappaRosseland_;
+    if (precision_ != TablePrecision::Double) {
+      widen_(PLANCK, lkappaPlanck);
+      widen_(ROSSELAND, lkappaRosseland);
+    }
+    singularity::impl::RawTableWriter writer;
+    writer.add(SP5::MeanOpac::PlanckMeanOpacity, lkappaPlanck);
+    writer.add(SP5::MeanOpac::RosselandMeanOpacity, lkappaRosseland);
+    f(writer);
+    if (precision_ != TablePrecision::Double) {
+      lkappaPlanck.finalize();
+      lkappaRosseland.finalize();
+    }
+  }
+  // Lookups multiply kappa by rho, so the tables shift by the log of
+  // the conversion of rho kappa
+  void bakeUnits_(const UnitSystem &units) {
+    units_ = units;
+    if (units.IsCGS()) {
+      return;
+    }
+    const Real lkappa = std::log2(units.mass / (units.length * units.length));
+    const Real lT = -std::log2(units.temp);
+    const Real lRho = -std::log2(units.Density());
+    singularity::impl::shiftLog2(lkappaPlanck_, lkappa,
+                                 {{2, lT}, {3, lRho}});
+    singularity::impl::shiftLog2(lkappaRosseland_, lkappa,
+                                 {{2, lT}, {3, lRho}});
+  }
+  // Files and raw tables are CGS
+  void requireCGS_() const {
+    if (!units_.IsCGS()) {
+      OPAC_ERROR("neutrinos::MeanOpacity: tables loaded in other units "
+                 "can't be saved\n");
+    }
+  }
+  // Converts the tables to the requested precision, releasing the
+  // double tables if they are no longer needed.
+  void setPrecision_(const TablePrecision precision) {
+    grids_.Rho = lkappaPlanck_.range(3);
+    grids_.T = lkappaPlanck_.range(2);
+    grids_.Ye = lkappaPlanck_.range(1);
+    precision_ = precision;
+    if (precision == TablePrecision::Double) {
+      return;
+    }
+    const std::size_t N = grids_.size();
+    const Real *planck = &lkappaPlanck_(0, 0, 0, 0);
+    const Real *rosseland = &lkappaRosseland_(0, 0, 0, 0);
+    if (precision == TablePrecision::Quantized) {
+      qkappa_.allocate(N, 2);
+      qkappa_.encode(PLANCK, planck);
+      qkappa_.encode(ROSSELAND, rosseland);
+    } else {
+      lkappa_.allocate(2 * N * sizeof(float));
+      float *data = lkappa_.data<float>();
+      for (std::size_t i = 0; i < N; ++i) {
+        data[PLANCK * N + i] = static_cast<float>(planck[i]);
+        data[ROSSELAND * N + i] = static_cast<float>(rosseland[i]);
+      }
+    }
+    lkappaPlanck_.finalize();
+    lkappaRosseland_.finalize();
+    lkappaPlanck_ = Spiner::DataBox();
+    lkappaRosseland_ = Spiner::DataBox();
+  }
+  // Copies reduced precision table q into a new double table on host.
+  // The caller is responsible for freeing it.
+  void widen_(const int q, Spiner::DataBox &db) const {
+    db = Spiner::DataBox();
+    db.resize(grids_.Rho.nPoints(), grids_.T.nPoints(), grids_.Ye.nPoints(),
+              NEUTRINO_NTYPES);
+    db.setRange(1, grids_.Ye.min(), grids_.Ye.max(), grids_.Ye.nPoints());
+    db.setRange(2, grids_.T.min(), grids_.T.max(), grids_.T.nPoints());
+    db.setRange(3, grids_.Rho.min(), grids_.Rho.max(), grids_.Rho.nPoints());
+    const std::size_t N = grids_.size();
+    Real *out = &db(0, 0, 0, 0);
+    if (precision_ == TablePrecision::Quantized) {
+      const singularity::impl::QuantizedPtr data = qkappa_.table(q);
+      for (std::size_t i = 0; i < N; ++i) {
+        out[i] = data[i];
+      }
+      return;
+    }
+    const float *data = lkappa_.data<float>() + q * N;
+    for (std::size_t i = 0; i < N; ++i) {
+      out[i] = data[i];
+    }
+  }
+  struct Grids {
+    Spiner::RegularGrid1D Rho, T, Ye;
+    PORTABLE_INLINE_FUNCTION std::size_t size() const {
+      return static_cast<std::size_t>(Rho.nPoints()) * T.nPoints() *
+             Ye.nPoints() * NEUTRINO_NTYPES;
+    }
+  };
+  struct Bounds {
+    singularity::impl::AxisBounds Rho, T, Ye;
+  };
+  enum { PLANCK = 0, ROSSELAND = 1 };
   Spiner::DataBox lkappaPlanck_;
   Spiner::DataBox lkappaRosseland_;
+  // both tables as floats, with TablePrecision::Float
+  singularity::impl::AlignedStorage lkappa_;
+  // both tables with TablePrecision::Quantized
+  singularity::impl::QuantizedStorage qkappa_;
+  Grids grids_;
+  Bounds bounds_;
+  TablePrecision precision_ = TablePrecision::Double;
+  // Units of the tables, CGS unless loaded in others
+  UnitSystem units_;
+  // raw file the tables are mapped from, if any
+  singularity::impl::MappedTables mapped_;
   const char *filename_;
 };
 
@@ -0,0 +1,622 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+#ifndef SINGULARITY_OPAC_NEUTRINOS_MULTIGROUP_OPACITY_NEUTRINOS_
+#define SINGULARITY_OPAC_NEUTRINOS_MULTIGROUP_OPACITY_NEUTRINOS_
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+#include <fast-math/logs.hpp>
+#include <ports-of-call/portability.hpp>
+#include <spiner/interpolation.hpp>
+
+#include <singularity-opac/base/host_parallel.hpp>
+#include <singularity-opac/base/lookup_state.hpp>
+#include <singularity-opac/base/opac_error.hpp>
+#include <singularity-opac/base/radiation_types.hpp>
+#include <singularity-opac/base/table_grid.hpp>
+#include <singularity-opac/base/table_storage.hpp>
+#include <singularity-opac/constants/constants.hpp>
+#include <singularity-opac/neutrinos/spiner_opac_neutrinos.hpp>
+
+namespace singularity {
+namespace neutrinos {
+
+// Opacities averaged over a fixed set of energy groups. The
+// absorption coefficient and emissivity per nu of the spectral tables
+// of a SpinerOpacity are integrated over each group, exactly for the
+// power laws the tables interpolate between energy nodes, and divided
+// by the group width. The results are tabulated linearly on the same
+// (rho, T, Ye) nodes, so a lookup interpolates them in (rho, T, Ye)
+// alone. Linear tables keep logs out of the lookup, but between nodes
+// they are less accurate than the log tables they come from.
+//
+// Every frequency maps to the group holding it, or to the first or
+// last group if it is outside them all, in batched calls too.
+// GroupAbsorptionAndEmissivity fills every group at once, without
+// mapping frequencies. Emissivity and NumberEmissivity are summed
+// over the groups, so they leave out emission outside them. Out of
+// range policies of the rho, T and Ye axes are those of the spectral
+// tables unless set again.
+template <typename ThermalDistribution, typename pc = PhysicalConstantsCGS>
+class MultigroupOpacity {
+ public:
+  using Spectral = SpinerOpacity<ThermalDistribution, pc>;
+  static constexpr Real EPS = 10.0 * std::numeric_limits<Real>::min();
+
+  MultigroupOpacity() = default;
+
+  // nu_edges holds the ngroups + 1 group edges in Hz, positive and
+  // strictly increasing. spectral must be in CGS, on host. The integrals
+  // run on nthreads host threads, one by default and all cores if
+  // nthreads <= 0.
+  MultigroupOpacity(const Spectral &spectral, const std::vector<Real> &nu_edges,
+                    int nthreads = 1)
+      : ngroups_(static_cast<int>(nu_edges.size()) - 1),
+        nspecies_(spectral.nspecies_) {
+    if (!spectral.units_.IsCGS()) {
+      OPAC_ERROR("neutrinos::MultigroupOpacity: spectral tables must be in "
+                 "CGS\n");
+    }
+    if (ngroups_ < 1) {
+      OPAC_ERROR("neutrinos::MultigroupOpacity: at least one group is "
+                 "required\n");
+    }
+    for (int g = 0; g < ngroups_; ++g) {
+      if (!(nu_edges[g] > 0) || !(nu_edges[g + 1] > nu_edges[g])) {
+        OPAC_ERROR("neutrinos::MultigroupOpacity: group edges must be "
+                   "positive and increasing\n");
+      }
+    }
+    for (int idx = 0; idx < NEUTRINO_NTYPES; ++idx) {
+      slot_[idx] = spectral.slot_[idx];
+    }
+    Yegrid_ = copyGrid_(spectral.Yegrid_);
+    Tgrid_ = copyGrid_(spectral.Tgrid_);
+    Rhogrid_ = copyGrid_(spectral.Rhogrid_);
+    Yebounds_ = spectral.bounds_[Spectral::YEAXIS];
+    Tbounds_ = spectral.bounds_[Spectral::TAXIS];
+    Rhobounds_ = spectral.bounds_[Spectral::RHOAXIS];
+    const std::size_t N = nNodes_();
+    storage_.allocate((ngroups_ + 1 + 2 * N * ngroups_ + 2 * N) *
+                      sizeof(Real));
+    point_();
+    Real *edges = storage_.data<Real>();
+    for (int g = 0; g <= ngroups_; ++g) {
+      edges[g] = nu_edges[g];
+    }
+    integrate_(spectral, nthreads);
+  }
+
+  MultigroupOpacity GetOnDevice() {
+    MultigroupOpacity other = *this;
+    other.storage_ = storage_.getOnDevice();
+    other.point_();
+    other.Yegrid_ = Yegrid_.getOnDevice();
+    other.Tgrid_ = Tgrid_.getOnDevice();
+    other.Rhogrid_ = Rhogrid_.getOnDevice();
+    return other;
+  }
+
+  void Finalize() {
+    storage_.finalize();
+    Yegrid_.finalize();
+    Tgrid_.finalize();
+    Rhogrid_.finalize();
+  }
+
+  // As for SpinerOpacity. Energy maps to the groups and has no policy.
+  void SetOutOfRange(const OutOfRangePolicy &policy) {
+    using singularity::impl::AxisBounds;
+    Yebounds_ = AxisBounds(policy.Ye, Yegrid_.min(), Yegrid_.max());
+    Tbounds_ = AxisBounds(policy.T, Tgrid_.min(), Tgrid_.max());
+    Rhobounds_ = AxisBounds(policy.rho, Rhogrid_.min(), Rhogrid_.max());
+  }
+
+  PORTABLE_INLINE_FUNCTION bool InTable(const Real rho, const Real temp,
+                                        const Real Ye) const {
+    return Rhobounds_.covers(BDMath::log2(std::abs(rho) + EPS)) &&
+           Tbounds_.covers(
+               BDMath::log2(std::abs(temp * Spectral::K2MeV) + EPS)) &&
+           Yebounds_.covers(Ye);
+  }
+  PORTABLE_INLINE_FUNCTION bool InTable(const Real rho, const Real temp,
+                                        const Real Ye, const Real nu) const {
+    return InTable(rho, temp, Ye);
+  }
+
+  PORTABLE_INLINE_FUNCTION int nlambda() const noexcept { return 0; }
+  PORTABLE_INLINE_FUNCTION
+  void PrintParams() const noexcept {
+    printf("Multigroup opacity. groups = %d\n", ngroups_);
+  }
+
+  PORTABLE_INLINE_FUNCTION int NumGroups() const { return ngroups_; }
+  // Lower edge of group g in Hz. Edge ngroups is the top of the last
+  // group.
+  PORTABLE_INLINE_FUNCTION Real GroupEdge(const int g) const {
+    return edges_[g];
+  }
+
+  // The cell of (rho, temp, Ye), for the forms of the queries below
+  // that take a LookupState
+  PORTABLE_INLINE_FUNCTION
+  LookupState PrepareLookup(const Real rho, const Real temp,
+                            const Real Ye) const {
+    LookupState s = singularity::impl::pointState(rho, temp, Ye);
+    const Real lRho = BDMath::log2(std::abs(rho) + EPS);
+    const Real lT = BDMath::log2(std::abs(temp * Spectral::K2MeV) + EPS);
+    singularity::impl::locate(Rhogrid_, Rhobounds_(lRho), s.iRho, s.wRho);
+    singularity::impl::locate(Tgrid_, Tbounds_(lT), s.iT, s.wT);
+    singularity::impl::locate(Yegrid_, Yebounds_(Ye), s.iYe, s.wYe);
+    return s;
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real AbsorptionCoefficient(const Real rho, const Real temp, const Real Ye,
+                             const RadiationType type, const Real nu,
+                             Real *lambda = nullptr) const {
+    return AbsorptionCoefficient(PrepareLookup(rho, temp, Ye), type, nu,
+                                 lambda);
+  }
+  PORTABLE_INLINE_FUNCTION
+  Real AbsorptionCoefficient(const LookupState &s, const RadiationType type,
+                             const Real nu, Real *lambda = nullptr) const {
+    std::size_t nodes[NCORNERS];
+    Real w[NCORNERS];
+    cell_(s, type, nodes, w);
+    return blend_(alpha_, ngroups_, nodes, w, group_(nu));
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  AbsorptionCoefficient(const Real rho, const Real temp, const Real Ye,
+                        const RadiationType type, FrequencyIndexer &nu_bins,
+                        DataIndexer &coeffs, const int nbins,
+                        Real *lambda = nullptr) const {
+    interpGroups_(alpha_, PrepareLookup(rho, temp, Ye), type, nu_bins, coeffs,
+                  nbins, 1);
+  }
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  AbsorptionCoefficient(const LookupState &s, const RadiationType type,
+                        FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+                        const int nbins, Real *lambda = nullptr) const {
+    interpGroups_(alpha_, s, type, nu_bins, coeffs, nbins, 1);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real AngleAveragedAbsorptionCoefficient(const Real rho, const Real temp,
+                                          const Real Ye,
+                                          const RadiationType type,
+                                          const Real nu,
+                                          Real *lambda = nullptr) const {
+    return AbsorptionCoefficient(rho, temp, Ye, type, nu, lambda);
+  }
+  PORTABLE_INLINE_FUNCTION
+  Real AngleAveragedAbsorptionCoefficient(const LookupState &s,
+                                          const RadiationType type,
+                                          const Real nu,
+                                          Real *lambda = nullptr) const {
+    return AbsorptionCoefficient(s, type, nu, lambda);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void AngleAveragedAbsorptionCoefficient(
+      const Real rho, const Real temp, const Real Ye, const RadiationType type,
+      FrequencyIndexer &nu_bins, DataIndexer &coeffs, const int nbins,
+      Real *lambda = nullptr) const {
+    interpGroups_(alpha_, PrepareLookup(rho, temp, Ye), type, nu_bins, coeffs,
+                  nbins, 1);
+  }
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void AngleAveragedAbsorptionCoefficient(
+      const LookupState &s, const RadiationType type, FrequencyIndexer &nu_bins,
+      DataIndexer &coeffs, const int nbins, Real *lambda = nullptr) const {
+    interpGroups_(alpha_, s, type, nu_bins, coeffs, nbins, 1);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real EmissivityPerNuOmega(const Real rho, const Real temp, const Real Ye,
+                            const RadiationType type, const Real nu,
+                            Real *lambda = nullptr) const {
+    return EmissivityPerNuOmega(PrepareLookup(rho, temp, Ye), type, nu,
+                                lambda);
+  }
+  PORTABLE_INLINE_FUNCTION
+  Real EmissivityPerNuOmega(const LookupState &s, const RadiationType type,
+                            const Real nu, Real *lambda = nullptr) const {
+    std::size_t nodes[NCORNERS];
+    Real w[NCORNERS];
+    cell_(s, type, nodes, w);
+    return blend_(jnu_, ngroups_, nodes, w, group_(nu));
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  EmissivityPerNuOmega(const Real rho, const Real temp, const Real Ye,
+                       const RadiationType type, FrequencyIndexer &nu_bins,
+                       DataIndexer &coeffs, const int nbins,
+                       Real *lambda = nullptr) const {
+    interpGroups_(jnu_, PrepareLookup(rho, temp, Ye), type, nu_bins, coeffs,
+                  nbins, 1);
+  }
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  EmissivityPerNuOmega(const LookupState &s, const RadiationType type,
+                       FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+                       const int nbins, Real *lambda = nullptr) const {
+    interpGroups_(jnu_, s, type, nu_bins, coeffs, nbins, 1);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real EmissivityPerNu(const Real rho, const Real temp, const Real Ye,
+                       const RadiationType type, const Real nu,
+                       Real *lambda = nullptr) const {
+    return 4 * M_PI * EmissivityPerNuOmega(rho, temp, Ye, type, nu, lambda);
+  }
+  PORTABLE_INLINE_FUNCTION
+  Real EmissivityPerNu(const LookupState &s, const RadiationType type,
+                       const Real nu, Real *lambda = nullptr) const {
+    return 4 * M_PI * EmissivityPerNuOmega(s, type, nu, lambda);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  EmissivityPerNu(const Real rho, const Real temp, const Real Ye,
+                  const RadiationType type, FrequencyIndexer &nu_bins,
+                  DataIndexer &coeffs, const int nbins,
+                  Real *lambda = nullptr) const {
+    interpGroups_(jnu_, PrepareLookup(rho, temp, Ye), type, nu_bins, coeffs,
+                  nbins, 4 * M_PI);
+  }
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  EmissivityPerNu(const LookupState &s, const RadiationType type,
+                  FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+                  const int nbins, Real *lambda = nullptr) const {
+    interpGroups_(jnu_, s, type, nu_bins, coeffs, nbins, 4 * M_PI);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  void AbsorptionAndEmissivity(const Real rho, const Real temp, const Real Ye,
+                               const RadiationType type, const Real nu,
+                               Real &alpha, Real &jnu,
+                               Real *lambda = nullptr) const {
+    AbsorptionAndEmissivity(PrepareLookup(rho, temp, Ye), type, nu, alpha, jnu,
+                            lambda);
+  }
+  PORTABLE_INLINE_FUNCTION
+  void AbsorptionAndEmissivity(const LookupState &s, const RadiationType type,
+                               const Real nu, Real &alpha, Real &jnu,
+                               Real *lambda = nullptr) const {
+    std::size_t nodes[NCORNERS];
+    Real w[NCORNERS];
+    cell_(s, type, nodes, w);
+    const int g = group_(nu);
+    alpha = blend_(alpha_, ngroups_, nodes, w, g);
+    jnu = blend_(jnu_, ngroups_, nodes, w, g);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  AbsorptionAndEmissivity(const Real rho, const Real temp, const Real Ye,
+                          const RadiationType type, FrequencyIndexer &nu_bins,
+                          DataIndexer &alpha, DataIndexer &jnu, const int nbins,
+                          Real *lambda = nullptr) const {
+    AbsorptionAndEmissivity(PrepareLookup(rho, temp, Ye), type, nu_bins, alpha,
+                            jnu, nbins, lambda);
+  }
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  AbsorptionAndEmissivity(const LookupState &s, const RadiationType type,
+                          FrequencyIndexer &nu_bins, DataIndexer &alpha,
+                          DataIndexer &jnu, const int nbins,
+                          Real *lambda = nullptr) const {
+    std::size_t nodes[NCORNERS];
+    Real w[NCORNERS];
+    cell_(s, type, nodes, w);
+    for (int i = 0; i < nbins; ++i) {
+      const int g = group_(nu_bins[i]);
+      alpha[i] = blend_(alpha_, ngroups_, nodes, w, g);
+      jnu[i] = blend_(jnu_, ngroups_, nodes, w, g);
+    }
+  }
+
+  // Fills alpha[g] and jnu[g] for every group g < NumGroups(), as for
+  // a frequency inside the group
+  template <typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  GroupAbsorptionAndEmissivity(const Real rho, const Real temp, const Real Ye,
+                               const RadiationType type, DataIndexer &alpha,
+                               DataIndexer &jnu) const {
+    GroupAbsorptionAndEmissivity(PrepareLookup(rho, temp, Ye), type, alpha,
+                                 jnu);
+  }
+  template <typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  GroupAbsorptionAndEmissivity(const LookupState &s, const RadiationType type,
+                               DataIndexer &alpha, DataIndexer &jnu) const {
+    std::size_t nodes[NCORNERS];
+    Real w[NCORNERS];
+    cell_(s, type, nodes, w);
+    for (int g = 0; g < ngroups_; ++g) {
+      alpha[g] = blend_(alpha_, ngroups_, nodes, w, g);
+      jnu[g] = blend_(jnu_, ngroups_, nodes, w, g);
+    }
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real Emissivity(const Real rho, const Real temp, const Real Ye,
+                  const RadiationType type, Real *lambda = nullptr) const {
+    return Emissivity(PrepareLookup(rho, temp, Ye), type, lambda);
+  }
+  PORTABLE_INLINE_FUNCTION
+  Real Emissivity(const LookupState &s, const RadiationType type,
+                  Real *lambda = nullptr) const {
+    std::size_t nodes[NCORNERS];
+    Real w[NCORNERS];
+    cell_(s, type, nodes, w);
+    return blend_(J_, 1, nodes, w, 0);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real NumberEmissivity(const Real rho, const Real temp, Real Ye,
+                        RadiationType type, Real *lambda = nullptr) const {
+    return NumberEmissivity(PrepareLookup(rho, temp, Ye), type, lambda);
+  }
+  PORTABLE_INLINE_FUNCTION
+  Real NumberEmissivity(const LookupState &s, const RadiationType type,
+                        Real *lambda = nullptr) const {
+    std::size_t nodes[NCORNERS];
+    Real w[NCORNERS];
+    cell_(s, type, nodes, w);
+    return blend_(JYe_, 1, nodes, w, 0);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real ThermalDistributionOfTNu(const Real temp, const RadiationType type,
+                                const Real nu, Real *lambda = nullptr) const {
+    return dist_.ThermalDistributionOfTNu(temp, type, nu, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real DThermalDistributionOfTNuDT(const Real temp, const RadiationType type,
+                                   const Real nu,
+                                   Real *lambda = nullptr) const {
+    return dist_.DThermalDistributionOfTNuDT(temp, type, nu, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real ThermalDistributionOfT(const Real temp, const RadiationType type,
+                              Real *lambda = nullptr) const {
+    return dist_.ThermalDistributionOfT(temp, type, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION Real ThermalNumberDistributionOfT(
+      const Real temp, const RadiationType type, Real *lambda = nullptr) const {
+    return dist_.ThermalNumberDistributionOfT(temp, type, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real EnergyDensityFromTemperature(const Real temp, const RadiationType type,
+                                    Real *lambda = nullptr) const {
+    return dist_.EnergyDensityFromTemperature(temp, type, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real TemperatureFromEnergyDensity(const Real er, const RadiationType type,
+                                    Real *lambda = nullptr) const {
+    return dist_.TemperatureFromEnergyDensity(er, type, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real NumberDensityFromTemperature(const Real temp, const RadiationType type,
+                                    Real *lambda = nullptr) const {
+    return dist_.NumberDensityFromTemperature(temp, type, lambda);
+  }
+
+ private:
+  using Grid = singularity::impl::TableGrid1D;
+  enum { NCORNERS = 8 };
+  // Fills nodes with the node index of each of the eight corners of
+  // the (rho, T, Ye) cell of s, and w with their weights.
+  PORTABLE_INLINE_FUNCTION void cell_(const LookupState &s,
+                                      const RadiationType type,
+                                      std::size_t nodes[NCORNERS],
+                                      Real w[NCORNERS]) const {
+    const int idx = slot_[RadType2Idx(type)];
+    // Species left out of a partial load have no slot
+    assert(idx >= 0);
+    for (int c = 0; c < NCORNERS; ++c) {
+      const int r = (c >> 2) & 1;
+      const int t = (c >> 1) & 1;
+      const int y = c & 1;
+      nodes[c] = nodeIndex_(s.iRho + r, s.iT + t, s.iYe + y, idx);
+      w[c] = s.wRho[r] * s.wT[t] * s.wYe[y];
+    }
+  }
+  // Value of group g of a table with width values per node. Linear
+  // extrapolation off the table may go negative, so it is floored.
+  PORTABLE_FORCEINLINE_FUNCTION Real blend_(const Real *table, const int width,
+                                            const std::size_t nodes[NCORNERS],
+                                            const Real w[NCORNERS],
+                                            const int g) const {
+    Real v = 0;
+    for (int c = 0; c < NCORNERS; ++c) {
+      v += w[c] * table[nodes[c] * width + g];
+    }
+    return std::max(v, Real(0));
+  }
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  interpGroups_(const Real *table, const LookupState &s,
+                const RadiationType type, FrequencyIndexer &nu_bins,
+                DataIndexer &coeffs, const int nbins, const Real scale) const {
+    std::size_t nodes[NCORNERS];
+    Real w[NCORNERS];
+    cell_(s, type, nodes, w);
+    for (int i = 0; i < nbins; ++i) {
+      coeffs[i] = scale * blend_(table, ngroups_, nodes, w, group_(nu_bins[i]));
+    }
+  }
+  // Group holding nu, clamped to the groups
+  PORTABLE_INLINE_FUNCTION int group_(const Real nu) const {
+    int lo = 0;
+    int hi = ngroups_ - 1;
+    while (lo < hi) {
+      const int mid = (lo + hi + 1) / 2;
+      if (nu >= edges_[mid]) {
+        lo = mid;
+      } else {
+        hi = mid - 1;
+      }
+    }
+    return lo;
+  }
+  PORTABLE_INLINE_FUNCTION std::size_t nodeIndex_(const int iRho, const int iT,
+                                                  const int iYe,
+                                                  const int idx) const {
+    return ((static_cast<std::size_t>(iRho) * Tgrid_.nPoints() + iT) *
+                Yegrid_.nPoints() +
+            iYe) *
+               nspecies_ +
+           idx;
+  }
+  std::size_t nNodes_() const {
+    return static_cast<std::size_t>(Rhogrid_.nPoints()) * Tgrid_.nPoints() *
+           Yegrid_.nPoints() * nspecies_;
+  }
+  // Group edges, then alpha and j per group at each node, then the
+  // totals J and JYe at each node
+  void point_() {
+    const std::size_t N = nNodes_();
+    edges_ = storage_.data<Real>();
+    alpha_ = edges_ + ngroups_ + 1;
+    jnu_ = alpha_ + N * ngroups_;
+    J_ = jnu_ + N * ngroups_;
+    JYe_ = J_ + N;
+  }
+  // Copies share their nodes, so a non-uniform grid is rebuilt from
+  // its nodes to be finalized on its own
+  static Grid copyGrid_(const Grid &g) {
+    if (g.isUniform()) {
+      return Grid(g.regular());
+    }
+    std::vector<Real> nodes(g.nPoints());
+    for (int i = 0; i < g.nPoints(); ++i) {
+      nodes[i] = g.x(i);
+    }
+    return Grid(nodes.data(), g.nPoints());
+  }
+  // Fills the tables from the spectral tables of spectral. Each (rho,
+  // T, Ye) node is independent, so they are spread over host threads.
+  void integrate_(const Spectral &spectral, const int nthreads) {
+    const Grid &egrid = spectral.egrid_;
+    const int Ne = egrid.nPoints();
+    const int NYe = Yegrid_.nPoints();
+    const int NT = Tgrid_.nPoints();
+    const int NRho = Rhogrid_.nPoints();
+    std::vector<Real> le(ngroups_ + 1);
+    for (int g = 0; g <= ngroups_; ++g) {
+      le[g] = std::log2(Spectral::Hz2MeV * edges_[g]);
+    }
+    Real *alpha = storage_.data<Real>() + (alpha_ - edges_);
+    Real *jnu = storage_.data<Real>() + (jnu_ - edges_);
+    Real *J = storage_.data<Real>() + (J_ - edges_);
+    Real *JYe = storage_.data<Real>() + (JYe_ - edges_);
+    singularity::impl::hostParallelFor(
+        NRho * NT * NYe, nthreads, [&](const int i) {
+          const int iRho = i / (NT * NYe);
+          const int iT = (i / NYe) % NT;
+          const int iYe = i % NYe;
+          std::vector<Real> lalpha(Ne), lj(Ne);
+          for (int idx = 0; idx < nspecies_; ++idx) {
+            for (int ie = 0; ie < Ne; ++ie) {
+              lalpha[ie] = spectral.spectralNode_(Spectral::ALPHA, iRho, iT,
+                                                  iYe, idx, ie);
+              lj[ie] =
+                  spectral.spectralNode_(Spectral::JNU, iRho, iT, iYe, idx, ie);
+            }
+            const std::size_t n = nodeIndex_(iRho, iT, iYe, idx);
+            Real Jsum = 0;
+            Real JYesum = 0;
+            for (int g = 0; g < ngroups_; ++g) {
+              const Real dnu = edges_[g + 1] - edges_[g];
+              const std::size_t k = n * ngroups_ + g;
+              alpha[k] = integral_(egrid, lalpha.data(), 0, le[g], le[g + 1]);
+              alpha[k] /= dnu;
+              const Real j = integral_(egrid, lj.data(), 0, le[g], le[g + 1]);
+              jnu[k] = j / dnu;
+              Jsum += j;
+              JYesum += integral_(egrid, lj.data(), -1, le[g], le[g + 1]);
+            }
+            J[n] = 4 * M_PI * Jsum;
+            JYe[n] = 4 * M_PI * JYesum / pc::h;
+          }
+        });
+  }
+  // Integral of f nu^p dnu from energy la to lb, log2 MeV, where log2
+  // f is lf interpolated linearly on egrid and extrapolated from the
+  // end cells, as the spectral tables are. On each piece f nu^p is a
+  // power law, integrated exactly.
+  static Real integral_(const Grid &egrid, const Real *lf, const int p,
+                        const Real la, const Real lb) {
+    constexpr Real LN2 = M_LN2;
+    const Real scale = LN2 * std::pow(Spectral::MeV2Hz, p + 1);
+    const int i0 = egrid.index(la);
+    const int i1 = egrid.index(lb);
+    Real sum = 0;
+    for (int ie = i0; ie <= i1; ++ie) {
+      const Real x0 = egrid.x(ie);
+      const Real slope = (lf[ie + 1] - lf[ie]) / (egrid.x(ie + 1) - x0);
+      const Real a = (ie == i0) ? la : x0;
+      const Real b = (ie == i1) ? lb : egrid.x(ie + 1);
+      if (!(b > a)) continue;
+      // log2 of f nu^p, up to a constant, at a and b
+      const Real ga = lf[ie] + slope * (a - x0) + (p + 1) * a;
+      const Real gb = lf[ie] + slope * (b - x0) + (p + 1) * b;
+      const Real d = LN2 * (gb - ga);
+      const Real phi = (std::abs(d) < 1e-8) ? 1 + d / 2 : std::expm1(d) / d;
+      sum += (b - a) * std::exp2(ga) * phi;
+    }
+    return scale * sum;
+  }
+  singularity::impl::AlignedStorage storage_;
+  const Real *edges_ = nullptr;
+  const Real *alpha_ = nullptr;
+  const Real *jnu_ = nullptr;
+  const Real *J_ = nullptr;
+  const Real *JYe_ = nullptr;
+  Grid Yegrid_, Tgrid_, Rhogrid_;
+  singularity::impl::AxisBounds Yebounds_, Tbounds_, Rhobounds_;
+  int ngroups_ = 0;
+  // Number of species in the tables, and the slot of each one, as in
+  // the spectral tables
+  int nspecies_ = NEUTRINO_NTYPES;
+  int slot_[NEUTRINO_NTYPES] = {0, 1, 2};
+  ThermalDistribution dist_;
+};
+
+} // namespace neutrinos
+} // namespace singularity
+
+#endif // SINGULARITY_OPAC_NEUTRINOS_MULTIGROUP_OPACITY_NEUTRINOS_
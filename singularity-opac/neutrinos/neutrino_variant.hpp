@@ -19,16 +19,18 @@
 #include <utility>
 
 #include <ports-of-call/portability.hpp>
+#include <singularity-opac/base/lookup_state.hpp>
 #include <singularity-opac/base/opac_error.hpp>
+#include <singularity-opac/base/opac_variant.hpp>
 #include <singularity-opac/base/radiation_types.hpp>
-#include <variant/include/mpark/variant.hpp>
+#include <singularity-opac/neutrinos/zone_queries_neutrinos.hpp>
 
 namespace singularity {
 namespace neutrinos {
 namespace impl {
 
 template <typename... Ts>
-using opac_variant = mpark::variant<Ts...>;
+using opac_variant = singularity::impl::opac_variant<Ts...>;
 
 template <typename... Opacs>
 class Variant {
@@ -62,11 +64,11 @@ class Variant {
           !std::is_same<Variant, typename std::decay<Choice>::type>::value,
           bool>::type = true>
   Choice get() {
-    return mpark::get<Choice>(opac_);
+    return singularity::impl::get<Choice>(opac_);
   }
 
   Variant GetOnDevice() {
-    return mpark::visit(
+    return singularity::impl::visit(
         [](auto &opac) { return opac_variant<Opacs...>(opac.GetOnDevice()); },
         opac_);
   }
@@ -77,7 +79,7 @@ class Variant {
   PORTABLE_INLINE_FUNCTION Real AbsorptionCoefficient(
       const Real rho, const Real temp, const Real Ye, const RadiationType type,
       const Real nu, Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.AbsorptionCoefficient(rho, temp, Ye, type, nu, lambda);
         },
@@ -90,7 +92,7 @@ class Variant {
                         const RadiationType type, FrequencyIndexer &nu_bins,
                         DataIndexer &coeffs, const int nbins,
                         Real *lambda = nullptr) const {
-    mpark::visit(
+    singularity::impl::visit(
         [&](const auto &opac) {
           opac.AbsorptionCoefficient(rho, temp, Ye, type, nu_bins, coeffs,
                                      nbins, lambda);
@@ -104,7 +106,7 @@ class Variant {
   PORTABLE_INLINE_FUNCTION Real AngleAveragedAbsorptionCoefficient(
       const Real rho, const Real temp, const Real Ye, const RadiationType type,
       const Real nu, Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.AngleAveragedAbsorptionCoefficient(rho, temp, Ye, type,
                                                          nu, lambda);
@@ -117,7 +119,7 @@ class Variant {
       const Real rho, const Real temp, const Real Ye, const RadiationType type,
       FrequencyIndexer &nu_bins, DataIndexer &coeffs, const int nbins,
       Real *lambda = nullptr) const {
-    mpark::visit(
+    singularity::impl::visit(
         [&](const auto &opac) {
           opac.AngleAveragedAbsorptionCoefficient(rho, temp, Ye, type, nu_bins,
                                                   coeffs, nbins, lambda);
@@ -130,7 +132,7 @@ class Variant {
   PORTABLE_INLINE_FUNCTION Real EmissivityPerNuOmega(
       const Real rho, const Real temp, const Real Ye, const RadiationType type,
       const Real nu, Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.EmissivityPerNuOmega(rho, temp, Ye, type, nu, lambda);
         },
@@ -143,7 +145,7 @@ class Variant {
                        const RadiationType type, FrequencyIndexer &nu_bins,
                        DataIndexer &coeffs, const int nbins,
                        Real *lambda = nullptr) const {
-    mpark::visit(
+    singularity::impl::visit(
         [&](const auto &opac) {
           return opac.EmissivityPerNuOmega(rho, temp, Ye, type, nu_bins, coeffs,
                                            nbins, lambda);
@@ -157,7 +159,7 @@ class Variant {
                                                 const RadiationType type,
                                                 const Real nu,
                                                 Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.EmissivityPerNu(rho, temp, Ye, type, nu, lambda);
         },
@@ -170,7 +172,7 @@ class Variant {
                   const RadiationType type, FrequencyIndexer &nu_bins,
                   DataIndexer &coeffs, const int nbins,
                   Real *lambda = nullptr) const {
-    mpark::visit(
+    singularity::impl::visit(
         [&](const auto &opac) {
           return opac.EmissivityPerNu(rho, temp, Ye, type, nu_bins, coeffs,
                                       nbins, lambda);
@@ -178,12 +180,40 @@ class Variant {
         opac_);
   }
 
+  // absorption coefficient and emissivity per nu per omega at the
+  // same point, in one call
+  PORTABLE_INLINE_FUNCTION void
+  AbsorptionAndEmissivity(const Real rho, const Real temp, const Real Ye,
+                          const RadiationType type, const Real nu, Real &alpha,
+                          Real &jnu, Real *lambda = nullptr) const {
+    singularity::impl::visit(
+        [&](const auto &opac) {
+          opac.AbsorptionAndEmissivity(rho, temp, Ye, type, nu, alpha, jnu,
+                                       lambda);
+        },
+        opac_);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  AbsorptionAndEmissivity(const Real rho, const Real temp, const Real Ye,
+                          const RadiationType type, FrequencyIndexer &nu_bins,
+                          DataIndexer &alpha, DataIndexer &jnu, const int nbins,
+                          Real *lambda = nullptr) const {
+    singularity::impl::visit(
+        [&](const auto &opac) {
+          opac.AbsorptionAndEmissivity(rho, temp, Ye, type, nu_bins, alpha, jnu,
+                                       nbins, lambda);
+        },
+        opac_);
+  }
+
   // emissivity integrated over angle and frequency
   PORTABLE_INLINE_FUNCTION Real Emissivity(const Real rho, const Real temp,
                                            const Real Ye,
                                            const RadiationType type,
                                            Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.Emissivity(rho, temp, Ye, type, lambda);
         },
@@ -195,18 +225,160 @@ class Variant {
                                                  const Real temp, Real Ye,
                                                  const RadiationType type,
                                                  Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.NumberEmissivity(rho, temp, Ye, type, lambda);
         },
         opac_);
   }
 
+  // Cell of (rho, temp, Ye) in the tables of the current model, for
+  // the forms of the queries below that take a LookupState
+  PORTABLE_INLINE_FUNCTION LookupState PrepareLookup(const Real rho,
+                                                     const Real temp,
+                                                     const Real Ye) const {
+    return singularity::impl::visit(
+        [=](const auto &opac) { return opac.PrepareLookup(rho, temp, Ye); },
+        opac_);
+  }
+
+  PORTABLE_INLINE_FUNCTION Real
+  AbsorptionCoefficient(const LookupState &s, const RadiationType type,
+                        const Real nu, Real *lambda = nullptr) const {
+    return singularity::impl::visit(
+        [&](const auto &opac) {
+          return opac.AbsorptionCoefficient(s, type, nu, lambda);
+        },
+        opac_);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  AbsorptionCoefficient(const LookupState &s, const RadiationType type,
+                        FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+                        const int nbins, Real *lambda = nullptr) const {
+    singularity::impl::visit(
+        [&](const auto &opac) {
+          opac.AbsorptionCoefficient(s, type, nu_bins, coeffs, nbins, lambda);
+        },
+        opac_);
+  }
+
+  PORTABLE_INLINE_FUNCTION Real AngleAveragedAbsorptionCoefficient(
+      const LookupState &s, const RadiationType type, const Real nu,
+      Real *lambda = nullptr) const {
+    return singularity::impl::visit(
+        [&](const auto &opac) {
+          return opac.AngleAveragedAbsorptionCoefficient(s, type, nu, lambda);
+        },
+        opac_);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void AngleAveragedAbsorptionCoefficient(
+      const LookupState &s, const RadiationType type, FrequencyIndexer &nu_bins,
+      DataIndexer &coeffs, const int nbins, Real *lambda = nullptr) const {
+    singularity::impl::visit(
+        [&](const auto &opac) {
+          opac.AngleAveragedAbsorptionCoefficient(s, type, nu_bins, coeffs,
+                                                  nbins, lambda);
+        },
+        opac_);
+  }
+
+  PORTABLE_INLINE_FUNCTION Real
+  EmissivityPerNuOmega(const LookupState &s, const RadiationType type,
+                       const Real nu, Real *lambda = nullptr) const {
+    return singularity::impl::visit(
+        [&](const auto &opac) {
+          return opac.EmissivityPerNuOmega(s, type, nu, lambda);
+        },
+        opac_);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  EmissivityPerNuOmega(const LookupState &s, const RadiationType type,
+                       FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+                       const int nbins, Real *lambda = nullptr) const {
+    singularity::impl::visit(
+        [&](const auto &opac) {
+          opac.EmissivityPerNuOmega(s, type, nu_bins, coeffs, nbins, lambda);
+        },
+        opac_);
+  }
+
+  PORTABLE_INLINE_FUNCTION Real EmissivityPerNu(const LookupState &s,
+                                                const RadiationType type,
+                                                const Real nu,
+                                                Real *lambda = nullptr) const {
+    return singularity::impl::visit(
+        [&](const auto &opac) {
+          return opac.EmissivityPerNu(s, type, nu, lambda);
+        },
+        opac_);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  EmissivityPerNu(const LookupState &s, const RadiationType type,
+                  FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+                  const int nbins, Real *lambda = nullptr) const {
+    singularity::impl::visit(
+        [&](const auto &opac) {
+          opac.EmissivityPerNu(s, type, nu_bins, coeffs, nbins, lambda);
+        },
+        opac_);
+  }
+
+  PORTABLE_INLINE_FUNCTION void
+  AbsorptionAndEmissivity(const LookupState &s, const RadiationType type,
+                          const Real nu, Real &alpha, Real &jnu,
+                          Real *lambda = nullptr) const {
+    singularity::impl::visit(
+        [&](const auto &opac) {
+          opac.AbsorptionAndEmissivity(s, type, nu, alpha, jnu, lambda);
+        },
+        opac_);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  AbsorptionAndEmissivity(const LookupState &s, const RadiationType type,
+                          FrequencyIndexer &nu_bins, DataIndexer &alpha,
+                          DataIndexer &jnu, const int nbins,
+                          Real *lambda = nullptr) const {
+    singularity::impl::visit(
+        [&](const auto &opac) {
+          opac.AbsorptionAndEmissivity(s, type, nu_bins, alpha, jnu, nbins,
+                                       lambda);
+        },
+        opac_);
+  }
+
+  PORTABLE_INLINE_FUNCTION Real Emissivity(const LookupState &s,
+                                           const RadiationType type,
+                                           Real *lambda = nullptr) const {
+    return singularity::impl::visit(
+        [&](const auto &opac) { return opac.Emissivity(s, type, lambda); },
+        opac_);
+  }
+
+  PORTABLE_INLINE_FUNCTION Real NumberEmissivity(const LookupState &s,
+                                                 const RadiationType type,
+                                                 Real *lambda = nullptr) const {
+    return singularity::impl::visit(
+        [&](const auto &opac) {
+          return opac.NumberEmissivity(s, type, lambda);
+        },
+        opac_);
+  }
+
   // Specific intensity of thermal distribution
   PORTABLE_INLINE_FUNCTION Real
   ThermalDistributionOfTNu(const Real temp, const RadiationType type,
                            const Real nu, Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.ThermalDistributionOfTNu(temp, type, nu, lambda);
         },
@@ -217,7 +389,7 @@ class Variant {
   PORTABLE_INLINE_FUNCTION Real
   DThermalDistributionOfTNuDT(const Real temp, const RadiationType type,
                               const Real nu, Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.DThermalDistributionOfTNuDT(temp, type, nu, lambda);
         },
@@ -227,7 +399,7 @@ class Variant {
   // Integral of thermal distribution over frequency and angle
   PORTABLE_INLINE_FUNCTION Real ThermalDistributionOfT(
       const Real temp, const RadiationType type, Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.ThermalDistributionOfT(temp, type, lambda);
         },
@@ -237,7 +409,7 @@ class Variant {
   // Integral of thermal distribution/energy over frequency and angle
   PORTABLE_INLINE_FUNCTION Real ThermalNumberDistributionOfT(
       const Real temp, const RadiationType type, Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.ThermalNumberDistributionOfT(temp, type, lambda);
         },
@@ -247,7 +419,7 @@ class Variant {
   // Energy density of thermal distribution
   PORTABLE_INLINE_FUNCTION Real EnergyDensityFromTemperature(
       const Real temp, const RadiationType type, Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.EnergyDensityFromTemperature(temp, type, lambda);
         },
@@ -257,7 +429,7 @@ class Variant {
   // Temperature of thermal distribution
   PORTABLE_INLINE_FUNCTION Real TemperatureFromEnergyDensity(
       const Real er, const RadiationType type, Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.TemperatureFromEnergyDensity(er, type, lambda);
         },
@@ -267,7 +439,7 @@ class Variant {
   // Number density of thermal distribution
   PORTABLE_INLINE_FUNCTION Real NumberDensityFromTemperature(
       const Real temp, const RadiationType type, Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.NumberDensityFromTemperature(temp, type, lambda);
         },
@@ -276,22 +448,83 @@ class Variant {
 
   PORTABLE_INLINE_FUNCTION
   int nlambda() const noexcept {
-    return mpark::visit([](const auto &opac) { return opac.nlambda(); }, opac_);
+    return singularity::impl::visit(
+        [](const auto &opac) { return opac.nlambda(); }, opac_);
   }
 
   template <typename T>
   PORTABLE_INLINE_FUNCTION bool IsType() const noexcept {
-    return mpark::holds_alternative<T>(opac_);
+    return singularity::impl::holds_alternative<T>(opac_);
   }
 
   PORTABLE_INLINE_FUNCTION
   void PrintParams() const noexcept {
-    return mpark::visit([](const auto &opac) { return opac.PrintParams(); },
-                        opac_);
+    return singularity::impl::visit(
+        [](const auto &opac) { return opac.PrintParams(); }, opac_);
+  }
+
+  // Bulk forms, for nzones zones at once. Zone z is at rho[z],
+  // temp[z] and Ye[z], for species types[z]. Spectral quantities at
+  // the nbins frequencies nu_bins go to coeffs[z * nbins + i], and
+  // the others to values[z]. The variant is visited once per call and
+  // the zones loop over the model it holds, with portableFor in device
+  // builds and otherwise on nthreads host threads: serially by default,
+  // all cores if nthreads <= 0. Threads are started on every call, so
+  // they only pay off for large nzones. Indexers are anything with an
+  // operator[] valid where the loop runs, such as pointers or views.
+  template <typename ZoneIndexer, typename TypeIndexer,
+            typename FrequencyIndexer, typename DataIndexer>
+  void BulkAbsorptionCoefficient(const int nzones, const ZoneIndexer &rho,
+                                 const ZoneIndexer &temp, const ZoneIndexer &Ye,
+                                 const TypeIndexer &types,
+                                 const FrequencyIndexer &nu_bins,
+                                 const DataIndexer &coeffs, const int nbins,
+                                 const int nthreads = 1) const {
+    singularity::impl::visitZones(
+        opac_, nzones, nthreads,
+        singularity::impl::zoneSpectra<AbsorptionQuery>(
+            zoneArrays(rho, temp, Ye, types), nu_bins, coeffs, nbins));
+  }
+
+  template <typename ZoneIndexer, typename TypeIndexer,
+            typename FrequencyIndexer, typename DataIndexer>
+  void BulkEmissivityPerNu(const int nzones, const ZoneIndexer &rho,
+                           const ZoneIndexer &temp, const ZoneIndexer &Ye,
+                           const TypeIndexer &types,
+                           const FrequencyIndexer &nu_bins,
+                           const DataIndexer &coeffs, const int nbins,
+                           const int nthreads = 1) const {
+    singularity::impl::visitZones(
+        opac_, nzones, nthreads,
+        singularity::impl::zoneSpectra<EmissivityPerNuQuery>(
+            zoneArrays(rho, temp, Ye, types), nu_bins, coeffs, nbins));
+  }
+
+  template <typename ZoneIndexer, typename TypeIndexer, typename DataIndexer>
+  void BulkEmissivity(const int nzones, const ZoneIndexer &rho,
+                      const ZoneIndexer &temp, const ZoneIndexer &Ye,
+                      const TypeIndexer &types, const DataIndexer &values,
+                      const int nthreads = 1) const {
+    singularity::impl::visitZones(
+        opac_, nzones, nthreads,
+        singularity::impl::zoneValues<EmissivityQuery>(
+            zoneArrays(rho, temp, Ye, types), values));
+  }
+
+  template <typename ZoneIndexer, typename TypeIndexer, typename DataIndexer>
+  void BulkNumberEmissivity(const int nzones, const ZoneIndexer &rho,
+                            const ZoneIndexer &temp, const ZoneIndexer &Ye,
+                            const TypeIndexer &types, const DataIndexer &values,
+                            const int nthreads = 1) const {
+    singularity::impl::visitZones(
+        opac_, nzones, nthreads,
+        singularity::impl::zoneValues<NumberEmissivityQuery>(
+            zoneArrays(rho, temp, Ye, types), values));
   }
 
   inline void Finalize() noexcept {
-    return mpark::visit([](auto &opac) { return opac.Finalize(); }, opac_);
+    return singularity::impl::visit(
+        [](auto &opac) { return opac.Finalize(); }, opac_);
   }
 };
 
@@ -21,6 +21,8 @@
 #include <cstdio>
 
 #include <ports-of-call/portability.hpp>
+#include <singularity-opac/base/indexers.hpp>
+#include <singularity-opac/base/lookup_state.hpp>
 #include <singularity-opac/base/opac_error.hpp>
 
 namespace singularity {
@@ -66,19 +68,14 @@ class NonCGSUnits {
   }
 
   template <typename FrequencyIndexer, typename DataIndexer>
-  PORTABLE_INLINE_FUNCTION Real AbsorptionCoefficient(
+  PORTABLE_INLINE_FUNCTION void AbsorptionCoefficient(
       const Real rho, const Real temp, const Real Ye, RadiationType type,
       FrequencyIndexer &nu_bins, DataIndexer &coeffs, const int nbins,
       Real *lambda = nullptr) const {
-    for (int i = 0; i < nbins; ++i) {
-      nu_bins[i] *= freq_unit_;
-    }
+    indexers::ScaledFrequencies<FrequencyIndexer> nu_cgs(nu_bins, freq_unit_);
+    indexers::ScaledData<DataIndexer> coeffs_cgs(coeffs, length_unit_);
     opac_.AbsorptionCoefficient(rho * rho_unit_, temp * temp_unit_, Ye, type,
-                                nu_bins, coeffs, nbins, lambda);
-    for (int i = 0; i < nbins; ++i) {
-      nu_bins[i] *= time_unit_;
-      coeffs[i] *= length_unit_;
-    }
+                                nu_cgs, coeffs_cgs, nbins, lambda);
   }
 
   PORTABLE_INLINE_FUNCTION
@@ -92,23 +89,16 @@ class NonCGSUnits {
     return alpha * length_unit_;
   }
 
-  // TODO(JMM): Doing the frequency conversion here is SUPER gross.
-  // Is there no better way? Should we just not allow modified units?
   template <typename FrequencyIndexer, typename DataIndexer>
   PORTABLE_INLINE_FUNCTION void AngleAveragedAbsorptionCoefficient(
       const Real rho, const Real temp, const Real Ye, RadiationType type,
       FrequencyIndexer &nu_bins, DataIndexer &coeffs, const int nbins,
       Real *lambda = nullptr) const {
-    for (int i = 0; i < nbins; ++i) {
-      nu_bins[i] *= freq_unit_;
-    }
+    indexers::ScaledFrequencies<FrequencyIndexer> nu_cgs(nu_bins, freq_unit_);
+    indexers::ScaledData<DataIndexer> coeffs_cgs(coeffs, length_unit_);
     opac_.AngleAveragedAbsorptionCoefficient(rho * rho_unit_, temp * temp_unit_,
-                                             Ye, type, nu_bins, coeffs, nbins,
-                                             lambda);
-    for (int i = 0; i < nbins; ++i) {
-      nu_bins[i] *= time_unit_;
-      coeffs[i] *= length_unit_;
-    }
+                                             Ye, type, nu_cgs, coeffs_cgs,
+                                             nbins, lambda);
   }
 
   PORTABLE_INLINE_FUNCTION
@@ -126,15 +116,10 @@ class NonCGSUnits {
                        const RadiationType type, FrequencyIndexer &nu_bins,
                        DataIndexer &coeffs, const int nbins,
                        Real *lambda = nullptr) const {
-    for (int i = 0; i < nbins; ++i) {
-      nu_bins[i] *= freq_unit_;
-    }
+    indexers::ScaledFrequencies<FrequencyIndexer> nu_cgs(nu_bins, freq_unit_);
+    indexers::ScaledData<DataIndexer> coeffs_cgs(coeffs, inv_emiss_unit_);
     opac_.EmissivityPerNuOmega(rho * rho_unit_, temp * temp_unit_, Ye, type,
-                               nu_bins, coeffs, nbins, lambda);
-    for (int i = 0; i < nbins; ++i) {
-      nu_bins[i] *= time_unit_;
-      coeffs[i] *= inv_emiss_unit_;
-    }
+                               nu_cgs, coeffs_cgs, nbins, lambda);
   }
 
   PORTABLE_INLINE_FUNCTION
@@ -152,15 +137,34 @@ class NonCGSUnits {
                   const RadiationType type, FrequencyIndexer &nu_bins,
                   DataIndexer &coeffs, const int nbins,
                   Real *lambda = nullptr) const {
-    for (int i = 0; i < nbins; ++i) {
-      nu_bins[i] *= freq_unit_;
-    }
-    opac_.EmissivityPerNu(rho * rho_unit_, temp * temp_unit_, Ye, type, nu_bins,
-                          coeffs, nbins, lambda);
-    for (int i = 0; i < nbins; ++i) {
-      nu_bins[i] *= time_unit_;
-      coeffs[i] *= inv_emiss_unit_;
-    }
+    indexers::ScaledFrequencies<FrequencyIndexer> nu_cgs(nu_bins, freq_unit_);
+    indexers::ScaledData<DataIndexer> coeffs_cgs(coeffs, inv_emiss_unit_);
+    opac_.EmissivityPerNu(rho * rho_unit_, temp * temp_unit_, Ye, type, nu_cgs,
+                          coeffs_cgs, nbins, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  void AbsorptionAndEmissivity(const Real rho, const Real temp, const Real Ye,
+                               const RadiationType type, const Real nu,
+                               Real &alpha, Real &jnu,
+                               Real *lambda = nullptr) const {
+    opac_.AbsorptionAndEmissivity(rho * rho_unit_, temp * temp_unit_, Ye, type,
+                                  nu * freq_unit_, alpha, jnu, lambda);
+    alpha *= length_unit_;
+    jnu *= inv_emiss_unit_;
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  AbsorptionAndEmissivity(const Real rho, const Real temp, const Real Ye,
+                          const RadiationType type, FrequencyIndexer &nu_bins,
+                          DataIndexer &alpha, DataIndexer &jnu, const int nbins,
+                          Real *lambda = nullptr) const {
+    indexers::ScaledFrequencies<FrequencyIndexer> nu_cgs(nu_bins, freq_unit_);
+    indexers::ScaledData<DataIndexer> alpha_cgs(alpha, length_unit_);
+    indexers::ScaledData<DataIndexer> jnu_cgs(jnu, inv_emiss_unit_);
+    opac_.AbsorptionAndEmissivity(rho * rho_unit_, temp * temp_unit_, Ye, type,
+                                  nu_cgs, alpha_cgs, jnu_cgs, nbins, lambda);
   }
 
   PORTABLE_INLINE_FUNCTION
@@ -180,6 +184,120 @@ class NonCGSUnits {
     return JoH * inv_num_emiss_unit_;
   }
 
+  // The queries above at a point prepared by PrepareLookup. The state
+  // holds the point in CGS, as the wrapped model sees it.
+  PORTABLE_INLINE_FUNCTION
+  LookupState PrepareLookup(const Real rho, const Real temp,
+                            const Real Ye) const {
+    return opac_.PrepareLookup(rho * rho_unit_, temp * temp_unit_, Ye);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real AbsorptionCoefficient(const LookupState &s, const RadiationType type,
+                             const Real nu, Real *lambda = nullptr) const {
+    return opac_.AbsorptionCoefficient(s, type, nu * freq_unit_, lambda) *
+           length_unit_;
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  AbsorptionCoefficient(const LookupState &s, const RadiationType type,
+                        FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+                        const int nbins, Real *lambda = nullptr) const {
+    indexers::ScaledFrequencies<FrequencyIndexer> nu_cgs(nu_bins, freq_unit_);
+    indexers::ScaledData<DataIndexer> coeffs_cgs(coeffs, length_unit_);
+    opac_.AbsorptionCoefficient(s, type, nu_cgs, coeffs_cgs, nbins, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real AngleAveragedAbsorptionCoefficient(const LookupState &s,
+                                          const RadiationType type,
+                                          const Real nu,
+                                          Real *lambda = nullptr) const {
+    return opac_.AngleAveragedAbsorptionCoefficient(s, type, nu * freq_unit_,
+                                                    lambda) *
+           length_unit_;
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void AngleAveragedAbsorptionCoefficient(
+      const LookupState &s, const RadiationType type, FrequencyIndexer &nu_bins,
+      DataIndexer &coeffs, const int nbins, Real *lambda = nullptr) const {
+    indexers::ScaledFrequencies<FrequencyIndexer> nu_cgs(nu_bins, freq_unit_);
+    indexers::ScaledData<DataIndexer> coeffs_cgs(coeffs, length_unit_);
+    opac_.AngleAveragedAbsorptionCoefficient(s, type, nu_cgs, coeffs_cgs, nbins,
+                                             lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real EmissivityPerNuOmega(const LookupState &s, const RadiationType type,
+                            const Real nu, Real *lambda = nullptr) const {
+    return opac_.EmissivityPerNuOmega(s, type, nu * freq_unit_, lambda) *
+           inv_emiss_unit_;
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  EmissivityPerNuOmega(const LookupState &s, const RadiationType type,
+                       FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+                       const int nbins, Real *lambda = nullptr) const {
+    indexers::ScaledFrequencies<FrequencyIndexer> nu_cgs(nu_bins, freq_unit_);
+    indexers::ScaledData<DataIndexer> coeffs_cgs(coeffs, inv_emiss_unit_);
+    opac_.EmissivityPerNuOmega(s, type, nu_cgs, coeffs_cgs, nbins, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real EmissivityPerNu(const LookupState &s, const RadiationType type,
+                       const Real nu, Real *lambda = nullptr) const {
+    return opac_.EmissivityPerNu(s, type, nu * freq_unit_, lambda) *
+           inv_emiss_unit_;
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  EmissivityPerNu(const LookupState &s, const RadiationType type,
+                  FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+                  const int nbins, Real *lambda = nullptr) const {
+    indexers::ScaledFrequencies<FrequencyIndexer> nu_cgs(nu_bins, freq_unit_);
+    indexers::ScaledData<DataIndexer> coeffs_cgs(coeffs, inv_emiss_unit_);
+    opac_.EmissivityPerNu(s, type, nu_cgs, coeffs_cgs, nbins, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  void AbsorptionAndEmissivity(const LookupState &s, const RadiationType type,
+                               const Real nu, Real &alpha, Real &jnu,
+                               Real *lambda = nullptr) const {
+    opac_.AbsorptionAndEmissivity(s, type, nu * freq_unit_, alpha, jnu,
+                                  lambda);
+    alpha *= length_unit_;
+    jnu *= inv_emiss_unit_;
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  AbsorptionAndEmissivity(const LookupState &s, const RadiationType type,
+                          FrequencyIndexer &nu_bins, DataIndexer &alpha,
+                          DataIndexer &jnu, const int nbins,
+                          Real *lambda = nullptr) const {
+    indexers::ScaledFrequencies<FrequencyIndexer> nu_cgs(nu_bins, freq_unit_);
+    indexers::ScaledData<DataIndexer> alpha_cgs(alpha, length_unit_);
+    indexers::ScaledData<DataIndexer> jnu_cgs(jnu, inv_emiss_unit_);
+    opac_.AbsorptionAndEmissivity(s, type, nu_cgs, alpha_cgs, jnu_cgs, nbins,
+                                  lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real Emissivity(const LookupState &s, const RadiationType type,
+                  Real *lambda = nullptr) const {
+    return opac_.Emissivity(s, type, lambda) * inv_emiss_unit_ * time_unit_;
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real NumberEmissivity(const LookupState &s, const RadiationType type,
+                        Real *lambda = nullptr) const {
+    return opac_.NumberEmissivity(s, type, lambda) * inv_num_emiss_unit_;
+  }
+
   PORTABLE_INLINE_FUNCTION
   Real ThermalDistributionOfTNu(const Real temp, const RadiationType type,
                                 const Real nu, Real *lambda = nullptr) const {
@@ -192,7 +310,8 @@ class NonCGSUnits {
   Real DThermalDistributionOfTNuDT(const Real temp, const RadiationType type,
                                    const Real nu,
                                    Real *lambda = nullptr) const {
-    Real dBdToH = opac_.DThermalDistributionOfTNuDT(temp, type, nu, lambda);
+    Real dBdToH = opac_.DThermalDistributionOfTNuDT(temp * temp_unit_, type,
+                                                   nu * freq_unit_, lambda);
     return dBdToH * inv_intensity_unit_ * temp_unit_;
   }
 
@@ -288,6 +407,23 @@ class MeanNonCGSUnits {
     return alpha * length_unit_;
   }
 
+  PORTABLE_INLINE_FUNCTION
+  LookupState PrepareLookup(const Real rho, const Real temp,
+                            const Real Ye) const {
+    return mean_opac_.PrepareLookup(rho_unit_ * rho, temp_unit_ * temp, Ye);
+  }
+  PORTABLE_INLINE_FUNCTION
+  Real PlanckMeanAbsorptionCoefficient(const LookupState &s,
+                                       const RadiationType type) const {
+    return mean_opac_.PlanckMeanAbsorptionCoefficient(s, type) * length_unit_;
+  }
+  PORTABLE_INLINE_FUNCTION
+  Real RosselandMeanAbsorptionCoefficient(const LookupState &s,
+                                          const RadiationType type) const {
+    return mean_opac_.RosselandMeanAbsorptionCoefficient(s, type) *
+           length_unit_;
+  }
+
  private:
   MeanOpac mean_opac_;
   Real time_unit_, mass_unit_, length_unit_, temp_unit_;
@@ -21,6 +21,7 @@
 #include <cstdio>
 
 #include <ports-of-call/portability.hpp>
+#include <singularity-opac/base/lookup_state.hpp>
 #include <singularity-opac/base/opac_error.hpp>
 
 namespace singularity {
@@ -131,6 +132,24 @@ class MeanNonCGSUnitsS {
     return alpha * length_unit_;
   }
 
+  PORTABLE_INLINE_FUNCTION
+  LookupState PrepareLookup(const Real rho, const Real temp,
+                            const Real Ye) const {
+    return mean_s_opac_.PrepareLookup(rho_unit_ * rho, temp_unit_ * temp, Ye);
+  }
+  PORTABLE_INLINE_FUNCTION
+  Real PlanckMeanTotalScatteringCoefficient(const LookupState &s,
+                                            const RadiationType type) const {
+    return mean_s_opac_.PlanckMeanTotalScatteringCoefficient(s, type) *
+           length_unit_;
+  }
+  PORTABLE_INLINE_FUNCTION
+  Real RosselandMeanTotalScatteringCoefficient(const LookupState &s,
+                                               const RadiationType type) const {
+    return mean_s_opac_.RosselandMeanTotalScatteringCoefficient(s, type) *
+           length_unit_;
+  }
+
  private:
   MeanSOpac mean_s_opac_;
   Real time_unit_, mass_unit_, length_unit_, temp_unit_;
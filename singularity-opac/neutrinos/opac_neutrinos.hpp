@@ -19,10 +19,13 @@
 #include <variant/include/mpark/variant.hpp>
 
 #include <singularity-opac/neutrinos/brt_neutrinos.hpp>
+#include <singularity-opac/neutrinos/fallback_neutrinos.hpp>
 #include <singularity-opac/neutrinos/gray_opacity_neutrinos.hpp>
+#include <singularity-opac/neutrinos/multigroup_opacity_neutrinos.hpp>
 #include <singularity-opac/neutrinos/neutrino_variant.hpp>
 #include <singularity-opac/neutrinos/non_cgs_neutrinos.hpp>
 #include <singularity-opac/neutrinos/spiner_opac_neutrinos.hpp>
+#include <singularity-opac/neutrinos/sum_opacity_neutrinos.hpp>
 #include <singularity-opac/neutrinos/thermal_distributions_neutrinos.hpp>
 #include <singularity-opac/neutrinos/tophat_emissivity_neutrinos.hpp>
 
@@ -39,10 +42,18 @@ using BRTOpac = BRTOpacity<FermiDiracDistributionNoMu<3>>;
 using Gray = GrayOpacity<FermiDiracDistributionNoMu<3>>;
 using Tophat = TophatEmissivity<FermiDiracDistributionNoMu<3>>;
 using SpinerOpac = SpinerOpacity<FermiDiracDistributionNoMu<3>>;
-
-using Opacity = impl::Variant<ScaleFree, BRTOpac, Gray, Tophat, SpinerOpac,
-                              NonCGSUnits<BRTOpac>, NonCGSUnits<Gray>,
-                              NonCGSUnits<Tophat>, NonCGSUnits<SpinerOpac>>;
+using MultigroupOpac = MultigroupOpacity<FermiDiracDistributionNoMu<3>>;
+
+using Opacity =
+    impl::Variant<ScaleFree, BRTOpac, Gray, Tophat, SpinerOpac, MultigroupOpac,
+                  NonCGSUnits<BRTOpac>, NonCGSUnits<Gray>, NonCGSUnits<Tophat>,
+                  NonCGSUnits<SpinerOpac>, NonCGSUnits<MultigroupOpac>>;
+
+// The interface of Opacity for exactly one model, e.g.,
+// Monomorphic<NonCGSUnits<SpinerOpac>>, with no dispatch. It holds the
+// model directly, so calls inline through to it.
+template <typename Model>
+using Monomorphic = impl::Variant<Model>;
 
 } // namespace neutrinos
 } // namespace singularity
@@ -16,10 +16,15 @@
 #ifndef SINGULARITY_OPAC_NEUTRINOS_SPINER_OPAC_NEUTRINOS_HPP_
 #define SINGULARITY_OPAC_NEUTRINOS_SPINER_OPAC_NEUTRINOS_HPP_
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <cstdio>
+#include <limits>
 #include <string>
+#include <vector>
 
 #include <fast-math/logs.hpp>
 #include <ports-of-call/portability.hpp>
@@ -27,10 +32,17 @@
 #include <spiner/interpolation.hpp>
 #include <spiner/spiner_types.hpp>
 
+#include <singularity-opac/base/host_parallel.hpp>
+#include <singularity-opac/base/lookup_state.hpp>
+#include <singularity-opac/base/mapped_tables.hpp>
 #include <singularity-opac/base/opac_error.hpp>
 #include <singularity-opac/base/radiation_types.hpp>
 #include <singularity-opac/base/sp5.hpp>
+#include <singularity-opac/base/table_grid.hpp>
+#include <singularity-opac/base/table_storage.hpp>
+#include <singularity-opac/base/unit_system.hpp>
 #include <singularity-opac/constants/constants.hpp>
+#include <singularity-opac/neutrinos/emission_sampler_neutrinos.hpp>
 
 #ifdef SPINER_USE_HDF
 #include "hdf5.h"
@@ -46,6 +58,10 @@
 // We should experiment with logs further to see if there's some games
 // we can play, but for now, I'm switching everything in this library
 // to log10.
+// The tables themselves are now stored in log2, which the double
+// precision BDMath::log2 and exp2 convert with little more than bit
+// manipulation. Bounds passed to the constructors are still log10,
+// and base 10 files are converted on load.
 
 namespace singularity {
 namespace neutrinos {
@@ -54,6 +70,33 @@ namespace impl {
 enum class DataStatus { Deallocated, OnDevice, OnHost };
 } // namespace impl
 
+// Memory layout of the spectral tables. Separate keeps alpha_nu and
+// j_nu in two tables. Interleaved stores them side by side at each
+// node in a single table, so a fused AbsorptionAndEmissivity call
+// reads both from the same cache lines. Files on disk always use the
+// separate layout.
+enum class SpectralLayout { Separate, Interleaved };
+
+// Part of a table file to load. Bounds are log10 and use the units of
+// the tabulating constructor, i.e., T in K and E in MeV. Each range is
+// widened to the enclosing grid points and clipped to the table, and
+// lookups inside it match the full table. Species left out are not
+// loaded at all and must not be looked up.
+struct TableSubset {
+  Real lRhoMin = -std::numeric_limits<Real>::infinity();
+  Real lRhoMax = std::numeric_limits<Real>::infinity();
+  Real lTMin = -std::numeric_limits<Real>::infinity();
+  Real lTMax = std::numeric_limits<Real>::infinity();
+  Real YeMin = -std::numeric_limits<Real>::infinity();
+  Real YeMax = std::numeric_limits<Real>::infinity();
+  Real leMin = -std::numeric_limits<Real>::infinity();
+  Real leMax = std::numeric_limits<Real>::infinity();
+  bool species[NEUTRINO_NTYPES] = {true, true, true};
+};
+
+template <typename ThermalDistribution, typename pc>
+class MultigroupOpacity;
+
 // TODO(JMM): Bottom of the table and top of the table handled by
 // DataBox. Bottom of the table is a floor. Top of the table is
 // power law extrapolation.
@@ -71,14 +114,27 @@ class SpinerOpacity {
 
   SpinerOpacity() = default;
 
-  // Testing constructor that fills the tables with gray opacities
+  // Testing constructor that fills the tables with gray opacities.
+  // The fill runs on nthreads host threads, one by default and all
+  // cores if nthreads <= 0. With more than one, opac must be safe to
+  // call concurrently.
   template <typename Opacity>
   SpinerOpacity(Opacity &opac, Real lRhoMin, Real lRhoMax, int NRho, Real lTMin,
                 Real lTMax, int NT, Real YeMin, Real YeMax, int NYe, Real leMin,
-                Real leMax, int Ne)
+                Real leMax, int Ne,
+                SpectralLayout layout = SpectralLayout::Separate,
+                TablePrecision precision = TablePrecision::Double,
+                int nthreads = 1)
       : filename_("none"), memoryStatus_(impl::DataStatus::OnHost) {
-    lTMin += std::log10(K2MeV);
-    lTMax += std::log10(K2MeV);
+    allSpecies_();
+    // Bounds are given in log10, but the tables are stored in log2
+    constexpr Real LOG2_10 = singularity::impl::LOG2_10;
+    lRhoMin *= LOG2_10;
+    lRhoMax *= LOG2_10;
+    lTMin = LOG2_10 * (lTMin + std::log10(K2MeV));
+    lTMax = LOG2_10 * (lTMax + std::log10(K2MeV));
+    leMin *= LOG2_10;
+    leMax *= LOG2_10;
     // Set metadata for lalphanu and ljnu
     lalphanu_.resize(NRho, NT, NYe, NEUTRINO_NTYPES, Ne);
     lalphanu_.setRange(0, leMin, leMax, Ne);
@@ -95,71 +151,225 @@ class SpinerOpacity {
     lJ_.setRange(3, lRhoMin, lRhoMax, NRho);
     lJYe_.copyMetadata(lJ_);
 
-    // Fill tables
-    for (int iRho = 0; iRho < NRho; ++iRho) {
-      Real lRho = lalphanu_.range(4).x(iRho);
-      Real rho = fromLog_(lRho);
-      for (int iT = 0; iT < NT; ++iT) {
-        Real lT = lalphanu_.range(3).x(iT);
-        Real T = fromLog_(lT);
-        for (int iYe = 0; iYe < NYe; ++iYe) {
-          Real Ye = lalphanu_.range(2).x(iYe);
-          for (int idx = 0; idx < NEUTRINO_NTYPES; ++idx) {
-            RadiationType type = Idx2RadType(idx);
-            Real J = std::max(opac.Emissivity(rho, T * MeV2K, Ye, type), 0.0);
-            Real lJ = toLog_(J);
-            lJ_(iRho, iT, iYe, idx) = lJ;
-            Real JYe = std::max(opac.NumberEmissivity(rho, T * MeV2K, Ye, type), 0.0);
-            lJYe_(iRho, iT, iYe, idx) = toLog_(JYe);
-            for (int ie = 0; ie < Ne; ++ie) {
-              Real lE = lalphanu_.range(0).x(ie);
-              Real E = fromLog_(lE);
-              Real nu = MeV2Hz * E;
-              Real alpha = std::max(
-                  opac.AbsorptionCoefficient(rho, T, Ye, type, nu), 0.0);
-              lalphanu_(iRho, iT, iYe, idx, ie) = toLog_(alpha);
-              Real j = std::max(opac.EmissivityPerNuOmega(rho, T * MeV2K, Ye, type, nu),
-                                0.0);
-              ljnu_(iRho, iT, iYe, idx, ie) = toLog_(j);
-            }
-          }
-        }
+    setGrids_();
+    tabulate_(opac, nthreads);
+    pack_(layout, precision, true);
+  }
+
+  // As above, but on explicit nodes that need not be evenly spaced.
+  // Nodes are log10, in the same units as the bounds above, and
+  // strictly increasing.
+  template <typename Opacity>
+  SpinerOpacity(Opacity &opac, const std::vector<Real> &lRhoNodes,
+                const std::vector<Real> &lTNodes,
+                const std::vector<Real> &YeNodes,
+                const std::vector<Real> &leNodes,
+                SpectralLayout layout = SpectralLayout::Separate,
+                TablePrecision precision = TablePrecision::Double,
+                int nthreads = 1)
+      : filename_("none"), memoryStatus_(impl::DataStatus::OnHost) {
+    allSpecies_();
+    std::vector<Real> nodes[NAXES] = {leNodes, YeNodes, lTNodes, lRhoNodes};
+    for (int i = 0; i < NAXES; ++i) {
+      if (nodes[i].size() < 2) {
+        OPAC_ERROR("neutrinos::SpinerOpacity: each axis needs at least two "
+                   "nodes\n");
       }
     }
+    for (Real &lT : nodes[TAXIS]) {
+      lT += std::log10(K2MeV);
+    }
+    nodesToLog2_(nodes);
+    const int Ne = nodes[EAXIS].size();
+    const int NYe = nodes[YEAXIS].size();
+    const int NT = nodes[TAXIS].size();
+    const int NRho = nodes[RHOAXIS].size();
+    lalphanu_.resize(NRho, NT, NYe, NEUTRINO_NTYPES, Ne);
+    lJ_.resize(NRho, NT, NYe, NEUTRINO_NTYPES);
+    // The DataBoxes record the bounds of each axis. The totals have no
+    // energy axis, so the others are one lower.
+    for (int i = 0; i < NAXES; ++i) {
+      const int axis = spectralAxis_(i);
+      const int n = nodes[i].size();
+      lalphanu_.setRange(axis, nodes[i].front(), nodes[i].back(), n);
+      if (i != EAXIS) {
+        lJ_.setRange(axis - 1, nodes[i].front(), nodes[i].back(), n);
+      }
+    }
+    ljnu_.copyMetadata(lalphanu_);
+    lJYe_.copyMetadata(lJ_);
+    setGrids_(nodes);
+    tabulate_(opac, nthreads);
+    pack_(layout, precision, true);
   }
 
   // DataBox constructor. Note that this constructor *shallow* copies
-  // the databoxes, so they must be managed externally.
+  // the databoxes, so they must be managed externally. Base 10
+  // tables, a packed layout, or float precision make a private copy
+  // of the tables they convert and drop the references to them.
   SpinerOpacity(const Spiner::DataBox &lalphanu, const Spiner::DataBox ljnu,
-                const Spiner::DataBox lJ, const Spiner::DataBox lJYe)
+                const Spiner::DataBox lJ, const Spiner::DataBox lJYe,
+                SpectralLayout layout = SpectralLayout::Separate,
+                TablePrecision precision = TablePrecision::Double,
+                TableEncoding encoding = TableEncoding::Log10)
       : memoryStatus_(impl::DataStatus::OnHost), lalphanu_(lalphanu),
-        ljnu_(ljnu), lJ_(lJ), lJYe_(lJYe) {}
+        ljnu_(ljnu), lJ_(lJ), lJYe_(lJYe) {
+    allSpecies_();
+    const bool convert = (encoding == TableEncoding::Log10);
+    if (convert) {
+      log10ToLog2_(true);
+    }
+    setGrids_();
+    pack_(layout, precision, convert);
+  }
 
 #ifdef SPINER_USE_HDF
-  SpinerOpacity(const std::string &filename)
+  // Files hold double or quantized tables. Either is decoded on load
+  // and converted to precision.
+  SpinerOpacity(const std::string &filename,
+                SpectralLayout layout = SpectralLayout::Separate,
+                TablePrecision precision = TablePrecision::Double)
+      : SpinerOpacity(filename, UnitSystem(), layout, precision) {}
+
+  // Loads filename in units, so that lookups take and return
+  // quantities in them as NonCGSUnits would, at the cost of lookups in
+  // CGS. Tables loaded this way can't be saved.
+  SpinerOpacity(const std::string &filename, const UnitSystem &units,
+                SpectralLayout layout = SpectralLayout::Separate,
+                TablePrecision precision = TablePrecision::Double)
       : filename_(filename.c_str()), memoryStatus_(impl::DataStatus::OnHost) {
     herr_t status = H5_SUCCESS;
     hid_t file = H5Fopen(filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
-    status += lalphanu_.loadHDF(file, SP5::Opac::AbsorptionCoefficient);
-    status += ljnu_.loadHDF(file, SP5::Opac::EmissivityPerNu);
-    status += lJ_.loadHDF(file, SP5::Opac::TotalEmissivity);
-    status += lJYe_.loadHDF(file, SP5::Opac::NumberEmissivity);
+    status += singularity::impl::loadHDFTable(
+        file, SP5::Opac::AbsorptionCoefficient, lalphanu_);
+    status += singularity::impl::loadHDFTable(
+        file, SP5::Opac::EmissivityPerNu, ljnu_);
+    status += singularity::impl::loadHDFTable(
+        file, SP5::Opac::TotalEmissivity, lJ_);
+    status += singularity::impl::loadHDFTable(
+        file, SP5::Opac::NumberEmissivity, lJYe_);
+    status += loadSpecies_(file, slot_);
+    std::vector<Real> nodes[NAXES];
+    status += loadNodes_(file, nodes);
+    if (H5Lexists(file, SP5::Opac::EmissionQuantiles, H5P_DEFAULT) > 0) {
+      status += singularity::impl::loadHDFTable(
+          file, SP5::Opac::EmissionQuantiles, lquantile_);
+      nquantiles_ = lquantile_.range(0).nPoints();
+    }
+    const TableEncoding encoding = singularity::impl::loadEncoding(file);
     status += H5Fclose(file);
 
     if (status != H5_SUCCESS) {
       OPAC_ERROR("neutrinos::SpinerOpacity: HDF5 error\n");
     }
+    nspecies_ = lJ_.dim(1);
+    if (encoding == TableEncoding::Log10) {
+      log10ToLog2_(false);
+      nodesToLog2_(nodes);
+    }
+    bakeUnits_(units, nodes);
+    setGrids_(nodes);
+    pack_(layout, precision, true);
+  }
+
+  // Loads only the part of a file covered by subset, reading just
+  // those hyperslabs from disk, along with the nodes of any
+  // non-uniform axis within them. Quantized files read the blocks the
+  // hyperslabs span and decode them as a full load would.
+  SpinerOpacity(const std::string &filename, const TableSubset &subset,
+                SpectralLayout layout = SpectralLayout::Separate,
+                TablePrecision precision = TablePrecision::Double)
+      : filename_(filename.c_str()), memoryStatus_(impl::DataStatus::OnHost) {
+    herr_t status = H5_SUCCESS;
+    hid_t file = H5Fopen(filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+    std::vector<Real> nodes[NAXES];
+    status += loadNodes_(file, nodes);
+    int fileSlot[NEUTRINO_NTYPES];
+    status += loadSpecies_(file, fileSlot);
+    const TableEncoding encoding = singularity::impl::loadEncoding(file);
+    nspecies_ = 0;
+    for (int idx = 0; idx < NEUTRINO_NTYPES; ++idx) {
+      if (subset.species[idx] && fileSlot[idx] < 0) {
+        H5Fclose(file);
+        OPAC_ERROR("neutrinos::SpinerOpacity: requested species not in file\n");
+      }
+      slot_[idx] = subset.species[idx] ? nspecies_++ : -1;
+    }
+    if (nspecies_ == 0) {
+      H5Fclose(file);
+      OPAC_ERROR("neutrinos::SpinerOpacity: subset selects no species\n");
+    }
+
+    // Bounds in the coordinates of the file, ordered like the axes of
+    // lalphanu, fastest first
+    const Real scale = (encoding == TableEncoding::Log2)
+                           ? singularity::impl::LOG2_10
+                           : static_cast<Real>(1);
+    const Real lo[] = {scale * subset.leMin, subset.YeMin,
+                       scale * (subset.lTMin + std::log10(K2MeV)),
+                       scale * subset.lRhoMin};
+    const Real hi[] = {scale * subset.leMax, subset.YeMax,
+                       scale * (subset.lTMax + std::log10(K2MeV)),
+                       scale * subset.lRhoMax};
+    int first[NAXES];
+    status += loadSubset_(file, SP5::Opac::AbsorptionCoefficient, 1, lo, hi,
+                          nodes, fileSlot, lalphanu_, first);
+    status += loadSubset_(file, SP5::Opac::EmissivityPerNu, 1, lo, hi, nodes,
+                          fileSlot, ljnu_);
+    status += loadSubset_(file, SP5::Opac::TotalEmissivity, 0, lo + 1, hi + 1,
+                          nodes + 1, fileSlot, lJ_);
+    status += loadSubset_(file, SP5::Opac::NumberEmissivity, 0, lo + 1,
+                          hi + 1, nodes + 1, fileSlot, lJYe_);
+    if (H5Lexists(file, SP5::Opac::EmissionQuantiles, H5P_DEFAULT) > 0) {
+      // Every quantile, at the nodes kept on the other axes
+      const Real qlo[] = {-std::numeric_limits<Real>::infinity(), lo[1], lo[2],
+                          lo[3]};
+      const Real qhi[] = {std::numeric_limits<Real>::infinity(), hi[1], hi[2],
+                          hi[3]};
+      const std::vector<Real> qnodes[] = {{}, nodes[1], nodes[2], nodes[3]};
+      status += loadSubset_(file, SP5::Opac::EmissionQuantiles, 1, qlo, qhi,
+                            qnodes, fileSlot, lquantile_);
+      nquantiles_ = lquantile_.range(0).nPoints();
+    }
+    status += H5Fclose(file);
+
+    if (status != H5_SUCCESS) {
+      OPAC_ERROR("neutrinos::SpinerOpacity: HDF5 error\n");
+    }
+    for (int i = 0; i < NAXES; ++i) {
+      if (!nodes[i].empty()) {
+        const int n = lalphanu_.range(spectralAxis_(i)).nPoints();
+        nodes[i] = std::vector<Real>(nodes[i].begin() + first[i],
+                                     nodes[i].begin() + first[i] + n);
+      }
+    }
+    if (encoding == TableEncoding::Log10) {
+      log10ToLog2_(false);
+      nodesToLog2_(nodes);
+    }
+    setGrids_(nodes);
+    pack_(layout, precision, true);
   }
 
   void Save(const std::string &filename) const {
+    requireCGS_();
+    Spiner::DataBox lalphanu, ljnu, lJ, lJYe;
+    savedTables_(lalphanu, ljnu, lJ, lJYe);
     herr_t status = H5_SUCCESS;
     hid_t file =
         H5Fcreate(filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
-    status += lalphanu_.saveHDF(file, SP5::Opac::AbsorptionCoefficient);
-    status += ljnu_.saveHDF(file, SP5::Opac::EmissivityPerNu);
-    status += lJ_.saveHDF(file, SP5::Opac::TotalEmissivity);
-    status += lJYe_.saveHDF(file, SP5::Opac::NumberEmissivity);
+    status += lalphanu.saveHDF(file, SP5::Opac::AbsorptionCoefficient);
+    status += ljnu.saveHDF(file, SP5::Opac::EmissivityPerNu);
+    status += lJ.saveHDF(file, SP5::Opac::TotalEmissivity);
+    status += lJYe.saveHDF(file, SP5::Opac::NumberEmissivity);
+    status += singularity::impl::saveEncoding(file, TableEncoding::Log2);
+    status += saveSpecies_(file);
+    status += saveNodes_(file);
+    if (nquantiles_ > 0) {
+      status += lquantile_.saveHDF(file, SP5::Opac::EmissionQuantiles);
+    }
     status += H5Fclose(file);
+    releaseSaved_(lalphanu, ljnu, lJ, lJYe);
 
     if (status != H5_SUCCESS) {
       OPAC_ERROR("neutrinos::SpinerOpacity: HDF5 error\n");
@@ -167,6 +377,98 @@ class SpinerOpacity {
   }
 #endif
 
+#ifdef SINGULARITY_USE_MMAP
+  // Maps a file written by SaveRaw. With the separate layout and
+  // double precision the mapped tables are used in place, without
+  // reading or copying them; other layouts and precisions are
+  // converted from the mapping.
+  SpinerOpacity(const std::string &filename, RawFormat,
+                SpectralLayout layout = SpectralLayout::Separate,
+                TablePrecision precision = TablePrecision::Double)
+      : filename_(filename.c_str()), memoryStatus_(impl::DataStatus::OnHost) {
+    mapped_.open(filename);
+    fromMapped_(layout, precision);
+  }
+
+  // Attaches to a shared memory segment created by SaveShared. As
+  // with raw files, only tables in the separate layout at double
+  // precision are shared; others are private copies.
+  SpinerOpacity(const std::string &name, SharedMemory,
+                SpectralLayout layout = SpectralLayout::Separate,
+                TablePrecision precision = TablePrecision::Double)
+      : filename_(name.c_str()), memoryStatus_(impl::DataStatus::OnHost) {
+    mapped_.attachShared(name);
+    fromMapped_(layout, precision);
+  }
+#endif
+
+#if defined(SINGULARITY_USE_MPI) && defined(SPINER_USE_HDF)
+  // Collective over comm. The first rank on each node loads filename
+  // and shares the tables with the other ranks on the node through
+  // an MPI shared window, so a node holds a single copy. Finalize is
+  // collective as well. If the first rank can't load the file, every
+  // rank on the node fails.
+  SpinerOpacity(const std::string &filename, MPI_Comm comm,
+                SpectralLayout layout = SpectralLayout::Separate,
+                TablePrecision precision = TablePrecision::Double)
+      : filename_(filename.c_str()), memoryStatus_(impl::DataStatus::OnHost) {
+    MPI_Comm node;
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node);
+    mapped_.shareOnNode(node, TableEncoding::Log2, [&](const auto &share) {
+      SpinerOpacity loaded(filename);
+      loaded.withRawTables_(share);
+      loaded.Finalize();
+    });
+    fromMapped_(layout, precision);
+  }
+#endif
+
+  // Writes the tables in the raw format, separate layout and double
+  // precision, so they can be mapped back in place.
+  void SaveRaw(const std::string &filename) const {
+    withRawTables_([&](const singularity::impl::RawTableWriter &w) {
+      w.write(filename, TableEncoding::Log2);
+    });
+  }
+
+#ifdef SINGULARITY_USE_MMAP
+  // Copies the tables into a new POSIX shared memory segment. Other
+  // processes on the node may attach to it once this returns; remove
+  // it with RemoveSharedTables once they have.
+  void SaveShared(const std::string &name) const {
+    withRawTables_([&](const singularity::impl::RawTableWriter &w) {
+      singularity::impl::createSharedTables(name, w, TableEncoding::Log2);
+    });
+  }
+#endif
+
+  // Sets what lookups do outside the table on each axis, which by
+  // default is to extrapolate. Bounds are those of the loaded tables,
+  // so a table may be cut to the states that matter and rely on the
+  // policy past them. Set it on host, before GetOnDevice.
+  void SetOutOfRange(const OutOfRangePolicy &policy) {
+    const OutOfRange policies[] = {policy.e, policy.Ye, policy.T, policy.rho};
+    const Grid *grids[] = {&egrid_, &Yegrid_, &Tgrid_, &Rhogrid_};
+    for (int i = 0; i < NAXES; ++i) {
+      bounds_[i] = singularity::impl::AxisBounds(policies[i], grids[i]->min(),
+                                                 grids[i]->max());
+    }
+  }
+
+  // Whether a point is inside the table on every axis whose policy is
+  // OutOfRange::Fallback. The first form leaves out energy.
+  PORTABLE_INLINE_FUNCTION bool InTable(const Real rho, const Real temp,
+                                        const Real Ye) const {
+    return bounds_[RHOAXIS].covers(toLog_(rho)) &&
+           bounds_[TAXIS].covers(toLog_(temp * K2MeV)) &&
+           bounds_[YEAXIS].covers(Ye);
+  }
+  PORTABLE_INLINE_FUNCTION bool InTable(const Real rho, const Real temp,
+                                        const Real Ye, const Real nu) const {
+    return InTable(rho, temp, Ye) &&
+           bounds_[EAXIS].covers(toLog_(Hz2MeV * nu));
+  }
+
   PORTABLE_INLINE_FUNCTION int nlambda() const noexcept { return 0; }
   PORTABLE_INLINE_FUNCTION
   void PrintParams() const noexcept {
@@ -175,10 +477,40 @@ class SpinerOpacity {
 
   SpinerOpacity GetOnDevice() {
     SpinerOpacity other;
-    other.lalphanu_ = Spiner::getOnDeviceDataBox(lalphanu_);
-    other.ljnu_ = Spiner::getOnDeviceDataBox(ljnu_);
-    other.lJ_ = Spiner::getOnDeviceDataBox(lJ_);
-    other.lJYe_ = Spiner::getOnDeviceDataBox(lJYe_);
+    other.egrid_ = egrid_.getOnDevice();
+    other.Yegrid_ = Yegrid_.getOnDevice();
+    other.Tgrid_ = Tgrid_.getOnDevice();
+    other.Rhogrid_ = Rhogrid_.getOnDevice();
+    for (int i = 0; i < NAXES; ++i) {
+      other.bounds_[i] = bounds_[i];
+    }
+    if (packed_) {
+      other.spectral_ = spectral_.getOnDevice();
+      other.qspectral_ = qspectral_.getOnDevice();
+    } else {
+      other.lalphanu_ = Spiner::getOnDeviceDataBox(lalphanu_);
+      other.ljnu_ = Spiner::getOnDeviceDataBox(ljnu_);
+    }
+    if (precision_ == TablePrecision::Double) {
+      other.lJ_ = Spiner::getOnDeviceDataBox(lJ_);
+      other.lJYe_ = Spiner::getOnDeviceDataBox(lJYe_);
+    } else {
+      other.totals_ = totals_.getOnDevice();
+      other.qtotals_ = qtotals_.getOnDevice();
+    }
+    other.layout_ = layout_;
+    other.precision_ = precision_;
+    other.packed_ = packed_;
+    if (nquantiles_ > 0) {
+      other.lquantile_ = Spiner::getOnDeviceDataBox(lquantile_);
+    }
+    other.nquantiles_ = nquantiles_;
+    other.nspecies_ = nspecies_;
+    other.units_ = units_;
+    other.cgs_ = cgs_;
+    for (int idx = 0; idx < NEUTRINO_NTYPES; ++idx) {
+      other.slot_[idx] = slot_[idx];
+    }
     other.memoryStatus_ = impl::DataStatus::OnDevice;
     return other;
   }
@@ -186,21 +518,47 @@ class SpinerOpacity {
   void Finalize() {
     lalphanu_.finalize();
     ljnu_.finalize();
+    spectral_.finalize();
+    qspectral_.finalize();
     lJ_.finalize();
     lJYe_.finalize();
+    totals_.finalize();
+    qtotals_.finalize();
+    lquantile_.finalize();
+    nquantiles_ = 0;
+    egrid_.finalize();
+    Yegrid_.finalize();
+    Tgrid_.finalize();
+    Rhogrid_.finalize();
+    mapped_.close();
+  }
+
+  // The cell of (rho, temp, Ye), for the forms of the queries below
+  // that take a LookupState. The rest call it themselves.
+  PORTABLE_INLINE_FUNCTION
+  LookupState PrepareLookup(const Real rho, const Real temp,
+                            const Real Ye) const {
+    LookupState s = singularity::impl::pointState(rho, temp, Ye);
+    singularity::impl::locate(Rhogrid_, bounds_[RHOAXIS](toLog_(rho)), s.iRho,
+                              s.wRho);
+    singularity::impl::locate(Tgrid_, bounds_[TAXIS](toLog_(temp * K2MeV)),
+                              s.iT, s.wT);
+    singularity::impl::locate(Yegrid_, bounds_[YEAXIS](Ye), s.iYe, s.wYe);
+    return s;
   }
 
   PORTABLE_INLINE_FUNCTION
   Real AbsorptionCoefficient(const Real rho, const Real temp, const Real Ye,
                              const RadiationType type, const Real nu,
                              Real *lambda = nullptr) const {
-    int idx;
-    Real lRho, lT;
-    toLogs_(rho, temp, type, lRho, lT, idx);
+    return AbsorptionCoefficient(PrepareLookup(rho, temp, Ye), type, nu,
+                                 lambda);
+  }
+  PORTABLE_INLINE_FUNCTION
+  Real AbsorptionCoefficient(const LookupState &s, const RadiationType type,
+                             const Real nu, Real *lambda = nullptr) const {
     const Real le = toLog_(Hz2MeV * nu);
-    const Real lalpha = lalphanu_.interpToReal(lRho, lT, Ye, idx, le);
-    const Real alpha = fromLog_(lalpha);
-    return alpha;
+    return fromLog_(interpSpectral_(ALPHA, s, species_(type), le));
   }
 
   // TODO(JMM): Should we provide a raw copy operator instead of or
@@ -211,13 +569,15 @@ class SpinerOpacity {
                         const RadiationType type, FrequencyIndexer &nu_bins,
                         DataIndexer &coeffs, const int nbins,
                         Real *lambda = nullptr) const {
-    int idx;
-    Real lRho, lT;
-    toLogs_(rho, temp, type, lRho, lT, idx);
-    for (int i = 0; i < nbins; ++i) {
-      const Real le = toLog_(Hz2MeV * nu_bins[i]);
-      coeffs[i] = fromLog_(lalphanu_.interpToReal(lRho, lT, Ye, idx, le));
-    }
+    AbsorptionCoefficient(PrepareLookup(rho, temp, Ye), type, nu_bins, coeffs,
+                          nbins, lambda);
+  }
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  AbsorptionCoefficient(const LookupState &s, const RadiationType type,
+                        FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+                        const int nbins, Real *lambda = nullptr) const {
+    interpSpectrum_(ALPHA, s, species_(type), nu_bins, coeffs, nbins, 1);
   }
 
   // Angle-averaged absorption coefficient assumed to be the same as absorption
@@ -228,41 +588,43 @@ class SpinerOpacity {
                                           const RadiationType type,
                                           const Real nu,
                                           Real *lambda = nullptr) const {
-    int idx;
-    Real lRho, lT;
-    toLogs_(rho, temp, type, lRho, lT, idx);
-    const Real le = toLog_(Hz2MeV * nu);
-    const Real lAlpha = lalphanu_.interpToReal(lRho, lT, Ye, idx, le);
-    const Real Alpha = fromLog_(lAlpha);
-    return Alpha;
+    return AbsorptionCoefficient(rho, temp, Ye, type, nu, lambda);
+  }
+  PORTABLE_INLINE_FUNCTION
+  Real AngleAveragedAbsorptionCoefficient(const LookupState &s,
+                                          const RadiationType type,
+                                          const Real nu,
+                                          Real *lambda = nullptr) const {
+    return AbsorptionCoefficient(s, type, nu, lambda);
   }
 
-  // TODO(JMM): Should we provide a raw copy operator instead of or
-  // addition to interpolation?
   template <typename FrequencyIndexer, typename DataIndexer>
   PORTABLE_INLINE_FUNCTION void AngleAveragedAbsorptionCoefficient(
       const Real rho, const Real temp, const Real Ye, const RadiationType type,
       FrequencyIndexer &nu_bins, DataIndexer &coeffs, const int nbins,
       Real *lambda = nullptr) const {
-    int idx;
-    Real lRho, lT;
-    toLogs_(rho, temp, type, lRho, lT, idx);
-    for (int i = 0; i < nbins; ++i) {
-      const Real le = toLog_(Hz2MeV * nu_bins[i]);
-      coeffs[i] = fromLog_(lalphanu_.interpToReal(lRho, lT, Ye, idx, le));
-    }
+    AbsorptionCoefficient(PrepareLookup(rho, temp, Ye), type, nu_bins, coeffs,
+                          nbins, lambda);
+  }
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void AngleAveragedAbsorptionCoefficient(
+      const LookupState &s, const RadiationType type, FrequencyIndexer &nu_bins,
+      DataIndexer &coeffs, const int nbins, Real *lambda = nullptr) const {
+    AbsorptionCoefficient(s, type, nu_bins, coeffs, nbins, lambda);
   }
 
   PORTABLE_INLINE_FUNCTION
   Real EmissivityPerNuOmega(const Real rho, const Real temp, const Real Ye,
                             const RadiationType type, const Real nu,
                             Real *lambda = nullptr) const {
-    int idx;
-    Real lRho, lT;
-    toLogs_(rho, temp, type, lRho, lT, idx);
+    return EmissivityPerNuOmega(PrepareLookup(rho, temp, Ye), type, nu,
+                                lambda);
+  }
+  PORTABLE_INLINE_FUNCTION
+  Real EmissivityPerNuOmega(const LookupState &s, const RadiationType type,
+                            const Real nu, Real *lambda = nullptr) const {
     const Real le = toLog_(Hz2MeV * nu);
-    const Real lj = ljnu_.interpToReal(lRho, lT, Ye, idx, le);
-    return fromLog_(lj);
+    return fromLog_(interpSpectral_(JNU, s, species_(type), le));
   }
 
   template <typename FrequencyIndexer, typename DataIndexer>
@@ -271,13 +633,15 @@ class SpinerOpacity {
                        const RadiationType type, FrequencyIndexer &nu_bins,
                        DataIndexer &coeffs, const int nbins,
                        Real *lambda = nullptr) const {
-    int idx;
-    Real lRho, lT;
-    toLogs_(rho, temp, type, lRho, lT, idx);
-    for (int i = 0; i < nbins; ++i) {
-      const Real le = toLog_(Hz2MeV * nu_bins[i]);
-      coeffs[i] = fromLog_(ljnu_.interpToReal(lRho, lT, Ye, idx, le));
-    }
+    EmissivityPerNuOmega(PrepareLookup(rho, temp, Ye), type, nu_bins, coeffs,
+                         nbins, lambda);
+  }
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  EmissivityPerNuOmega(const LookupState &s, const RadiationType type,
+                       FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+                       const int nbins, Real *lambda = nullptr) const {
+    interpSpectrum_(JNU, s, species_(type), nu_bins, coeffs, nbins, 1);
   }
 
   PORTABLE_INLINE_FUNCTION
@@ -286,6 +650,11 @@ class SpinerOpacity {
                        Real *lambda = nullptr) const {
     return 4 * M_PI * EmissivityPerNuOmega(rho, temp, Ye, type, nu, lambda);
   }
+  PORTABLE_INLINE_FUNCTION
+  Real EmissivityPerNu(const LookupState &s, const RadiationType type,
+                       const Real nu, Real *lambda = nullptr) const {
+    return 4 * M_PI * EmissivityPerNuOmega(s, type, nu, lambda);
+  }
 
   template <typename FrequencyIndexer, typename DataIndexer>
   PORTABLE_INLINE_FUNCTION void
@@ -293,105 +662,1195 @@ class SpinerOpacity {
                   const RadiationType type, FrequencyIndexer &nu_bins,
                   DataIndexer &coeffs, const int nbins,
                   Real *lambda = nullptr) const {
-    int idx;
-    Real lRho, lT;
-    toLogs_(rho, temp, type, lRho, lT, idx);
-    for (int i = 0; i < nbins; ++i) {
-      const Real le = toLog_(Hz2MeV * nu_bins[i]);
-      coeffs[i] =
-          4 * M_PI * fromLog_(ljnu_.interpToReal(lRho, lT, Ye, idx, le));
+    EmissivityPerNu(PrepareLookup(rho, temp, Ye), type, nu_bins, coeffs, nbins,
+                    lambda);
+  }
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  EmissivityPerNu(const LookupState &s, const RadiationType type,
+                  FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+                  const int nbins, Real *lambda = nullptr) const {
+    interpSpectrum_(JNU, s, species_(type), nu_bins, coeffs, nbins, 4 * M_PI);
+  }
+
+  // Absorption coefficient and emissivity per nu per omega at the
+  // same point, sharing the table lookup.
+  PORTABLE_INLINE_FUNCTION
+  void AbsorptionAndEmissivity(const Real rho, const Real temp, const Real Ye,
+                               const RadiationType type, const Real nu,
+                               Real &alpha, Real &jnu,
+                               Real *lambda = nullptr) const {
+    AbsorptionAndEmissivity(PrepareLookup(rho, temp, Ye), type, nu, alpha, jnu,
+                            lambda);
+  }
+  PORTABLE_INLINE_FUNCTION
+  void AbsorptionAndEmissivity(const LookupState &s, const RadiationType type,
+                               const Real nu, Real &alpha, Real &jnu,
+                               Real *lambda = nullptr) const {
+    const int idx = species_(type);
+    const Real le = toLog_(Hz2MeV * nu);
+    if (precision_ == TablePrecision::Float) {
+      interpBoth_<const float *>(s, idx, le, alpha, jnu);
+    } else if (precision_ == TablePrecision::Quantized) {
+      interpBoth_<QuantizedPtr>(s, idx, le, alpha, jnu);
+    } else {
+      interpBoth_<const Real *>(s, idx, le, alpha, jnu);
+    }
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  AbsorptionAndEmissivity(const Real rho, const Real temp, const Real Ye,
+                          const RadiationType type, FrequencyIndexer &nu_bins,
+                          DataIndexer &alpha, DataIndexer &jnu, const int nbins,
+                          Real *lambda = nullptr) const {
+    AbsorptionAndEmissivity(PrepareLookup(rho, temp, Ye), type, nu_bins, alpha,
+                            jnu, nbins, lambda);
+  }
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  AbsorptionAndEmissivity(const LookupState &s, const RadiationType type,
+                          FrequencyIndexer &nu_bins, DataIndexer &alpha,
+                          DataIndexer &jnu, const int nbins,
+                          Real *lambda = nullptr) const {
+    const int idx = species_(type);
+    if (precision_ == TablePrecision::Float) {
+      interpBothSpectrum_<const float *>(s, idx, nu_bins, alpha, jnu, nbins);
+    } else if (precision_ == TablePrecision::Quantized) {
+      interpBothSpectrum_<QuantizedPtr>(s, idx, nu_bins, alpha, jnu, nbins);
+    } else {
+      interpBothSpectrum_<const Real *>(s, idx, nu_bins, alpha, jnu, nbins);
     }
   }
 
   PORTABLE_INLINE_FUNCTION
   Real Emissivity(const Real rho, const Real temp, const Real Ye,
                   const RadiationType type, Real *lambda = nullptr) const {
-    int idx;
-    Real lRho, lT;
-    toLogs_(rho, temp, type, lRho, lT, idx);
-    const Real lJ = lJ_.interpToReal(lRho, lT, Ye, idx);
-    const Real J = fromLog_(lJ);
-    return J;
+    return Emissivity(PrepareLookup(rho, temp, Ye), type, lambda);
+  }
+  PORTABLE_INLINE_FUNCTION
+  Real Emissivity(const LookupState &s, const RadiationType type,
+                  Real *lambda = nullptr) const {
+    return fromLog_(interpTotal_(TOTALJ, s, species_(type)));
   }
 
   PORTABLE_INLINE_FUNCTION
   Real NumberEmissivity(const Real rho, const Real temp, Real Ye,
                         RadiationType type, Real *lambda = nullptr) const {
-    int idx;
-    Real lRho, lT;
-    toLogs_(rho, temp, type, lRho, lT, idx);
-    return fromLog_(lJYe_.interpToReal(lRho, lT, Ye, idx));
+    return NumberEmissivity(PrepareLookup(rho, temp, Ye), type, lambda);
+  }
+  PORTABLE_INLINE_FUNCTION
+  Real NumberEmissivity(const LookupState &s, const RadiationType type,
+                        Real *lambda = nullptr) const {
+    return fromLog_(interpTotal_(TOTALJYE, s, species_(type)));
+  }
+
+  // Tabulates the quantiles of the emissivity per frequency over the
+  // energies of the table at each (rho, T, Ye) node, so that
+  // SampleEmissionEnergy can draw emitted energies. Every save writes
+  // them with the rest of the tables. Call it on host, before
+  // GetOnDevice.
+  void BuildEmissionSampling(const int Nu = 64, const int nthreads = 1) {
+    const int Ne = egrid_.nPoints();
+    const int NYe = Yegrid_.nPoints();
+    const int NT = Tgrid_.nPoints();
+    const int NRho = Rhogrid_.nPoints();
+    if (Nu < 2 || NRho < 2 || NT < 2 || NYe < 2) {
+      OPAC_ERROR("neutrinos::SpinerOpacity: emission sampling needs at "
+                 "least two quantiles and two points in rho, T, and Ye\n");
+    }
+    lquantile_.finalize();
+    lquantile_.resize(NRho, NT, NYe, nspecies_, Nu);
+    lquantile_.setRange(0, 0, 1, Nu);
+    lquantile_.setRange(2, Yegrid_.min(), Yegrid_.max(), NYe);
+    lquantile_.setRange(3, Tgrid_.min(), Tgrid_.max(), NT);
+    lquantile_.setRange(4, Rhogrid_.min(), Rhogrid_.max(), NRho);
+    singularity::impl::hostParallelFor(
+        NRho * NT * NYe, nthreads, [&](const int i) {
+          const int iRho = i / (NT * NYe);
+          const int iT = (i / NYe) % NT;
+          const int iYe = i % NYe;
+          const LookupState s = nodeState_(iRho, iT, iYe);
+          std::vector<Real> lE(Ne);
+          std::vector<Real> lj(Ne);
+          for (int ie = 0; ie < Ne; ++ie) {
+            lE[ie] = egrid_.x(ie);
+          }
+          for (int idx = 0; idx < NEUTRINO_NTYPES; ++idx) {
+            if (slot_[idx] < 0) continue;
+            for (int ie = 0; ie < Ne; ++ie) {
+              lj[ie] = interpSpectral_(JNU, s, slot_[idx], lE[ie]);
+            }
+            impl::emissionQuantiles(
+                lE.data(), lj.data(), Ne,
+                &lquantile_(iRho, iT, iYe, slot_[idx], 0), Nu);
+          }
+        });
+    nquantiles_ = Nu;
   }
+  bool HasEmissionSampling() const { return nquantiles_ > 0; }
 
+  // Frequency in Hz of an emitted neutrino, for a uniform random
+  // number u in [0, 1]. Needs BuildEmissionSampling, or tables saved
+  // after it, and fails without them.
+  PORTABLE_INLINE_FUNCTION
+  Real SampleEmissionEnergy(const Real rho, const Real temp, const Real Ye,
+                            const RadiationType type, const Real u) const {
+    return SampleEmissionEnergy(PrepareLookup(rho, temp, Ye), type, u);
+  }
+  PORTABLE_INLINE_FUNCTION
+  Real SampleEmissionEnergy(const LookupState &s, const RadiationType type,
+                            const Real u) const {
+    if (nquantiles_ == 0) {
+      OPAC_ERROR("neutrinos::SpinerOpacity: no emission sampling tables\n");
+    }
+    return MeV2Hz * fromLog_(singularity::impl::interpQuantile(
+                        &lquantile_(0, 0, 0, 0, 0), Tgrid_.nPoints(),
+                        Yegrid_.nPoints(), nspecies_, nquantiles_, s,
+                        species_(type), u));
+  }
+
+  // The distribution is CGS; tables loaded in other units convert
+  // its arguments and results as NonCGSUnits does.
   PORTABLE_INLINE_FUNCTION
   Real ThermalDistributionOfTNu(const Real temp, const RadiationType type,
                                 const Real nu, Real *lambda = nullptr) const {
-    return dist_.ThermalDistributionOfTNu(temp, type, nu, lambda);
+    if (cgs_) {
+      return dist_.ThermalDistributionOfTNu(temp, type, nu, lambda);
+    }
+    const Real t = units_.time;
+    return dist_.ThermalDistributionOfTNu(temp * units_.temp, type, nu / t,
+                                          lambda) *
+           t * t / units_.mass;
   }
 
   PORTABLE_INLINE_FUNCTION
   Real DThermalDistributionOfTNuDT(const Real temp, const RadiationType type,
                                    const Real nu,
                                    Real *lambda = nullptr) const {
-    return dist_.DThermalDistributionOfTNuDT(temp, type, nu, lambda);
+    if (cgs_) {
+      return dist_.DThermalDistributionOfTNuDT(temp, type, nu, lambda);
+    }
+    const Real t = units_.time;
+    return dist_.DThermalDistributionOfTNuDT(temp * units_.temp, type, nu / t,
+                                             lambda) *
+           t * t / units_.mass * units_.temp;
   }
 
   PORTABLE_INLINE_FUNCTION
   Real ThermalDistributionOfT(const Real temp, const RadiationType type,
                               Real *lambda = nullptr) const {
-    return dist_.ThermalDistributionOfT(temp, type, lambda);
+    if (cgs_) {
+      return dist_.ThermalDistributionOfT(temp, type, lambda);
+    }
+    const Real t = units_.time;
+    return dist_.ThermalDistributionOfT(temp * units_.temp, type, lambda) *
+           t * t * t / units_.mass;
   }
 
   PORTABLE_INLINE_FUNCTION Real ThermalNumberDistributionOfT(
       const Real temp, const RadiationType type, Real *lambda = nullptr) const {
-    return dist_.ThermalNumberDistributionOfT(temp, type, lambda);
+    if (cgs_) {
+      return dist_.ThermalNumberDistributionOfT(temp, type, lambda);
+    }
+    const Real l = units_.length;
+    return dist_.ThermalNumberDistributionOfT(temp * units_.temp, type,
+                                              lambda) *
+           l * l * units_.time;
   }
 
   PORTABLE_INLINE_FUNCTION
   Real EnergyDensityFromTemperature(const Real temp, const RadiationType type,
                                     Real *lambda = nullptr) const {
-    return dist_.EnergyDensityFromTemperature(temp, type, lambda);
+    if (cgs_) {
+      return dist_.EnergyDensityFromTemperature(temp, type, lambda);
+    }
+    const Real t = units_.time;
+    return dist_.EnergyDensityFromTemperature(temp * units_.temp, type,
+                                              lambda) *
+           t * t * units_.length / units_.mass;
   }
 
   PORTABLE_INLINE_FUNCTION
   Real TemperatureFromEnergyDensity(const Real er, const RadiationType type,
                                     Real *lambda = nullptr) const {
-    return dist_.TemperatureFromEnergyDensity(er, type, lambda);
+    if (cgs_) {
+      return dist_.TemperatureFromEnergyDensity(er, type, lambda);
+    }
+    const Real t = units_.time;
+    return dist_.TemperatureFromEnergyDensity(
+               er * units_.mass / (t * t * units_.length), type, lambda) /
+           units_.temp;
   }
 
   PORTABLE_INLINE_FUNCTION
   Real NumberDensityFromTemperature(const Real temp, const RadiationType type,
                                     Real *lambda = nullptr) const {
-    return dist_.NumberDensityFromTemperature(temp, type, lambda);
+    if (cgs_) {
+      return dist_.NumberDensityFromTemperature(temp, type, lambda);
+    }
+    const Real l = units_.length;
+    return dist_.NumberDensityFromTemperature(temp * units_.temp, type,
+                                              lambda) *
+           l * l * l;
   }
 
  private:
+  // Integrates the spectral tables over its groups
+  friend class MultigroupOpacity<ThermalDistribution, pc>;
+  using QuantizedPtr = singularity::impl::QuantizedPtr;
+  using Grid = singularity::impl::TableGrid1D;
+  // Grids in the order of the axes of lalphanu_, fastest first
+  enum { EAXIS = 0, YEAXIS = 1, TAXIS = 2, RHOAXIS = 3, NAXES = 4 };
   // TODO(JMM): Offsets probably not necessary
   PORTABLE_INLINE_FUNCTION Real toLog_(const Real x, const Real offset) const {
-    return std::log10(std::abs(std::max(x, -offset) + offset) + EPS);
+    return BDMath::log2(std::abs(std::max(x, -offset) + offset) + EPS);
   }
   PORTABLE_INLINE_FUNCTION Real toLog_(const Real x) const {
     return toLog_(x, 0);
   }
   PORTABLE_INLINE_FUNCTION Real fromLog_(const Real lx,
                                          const Real offset) const {
-    return std::pow(10., lx) - offset;
+    return BDMath::exp2(lx) - offset;
   }
   PORTABLE_INLINE_FUNCTION Real fromLog_(const Real lx) const {
     return fromLog_(lx, 0);
   }
-  PORTABLE_INLINE_FUNCTION void toLogs_(const Real rho, const Real temp,
-                                        RadiationType type, Real &lRho,
-                                        Real &lT, int &idx) const {
-    lRho = toLog_(rho);
-    lT = toLog_(temp * K2MeV);
-    idx = RadType2Idx(type);
+  // The state of a node of the tables, which interpolates to it exactly
+  LookupState nodeState_(const int iRho, const int iT, const int iYe) const {
+    const Grid *grids[] = {&Rhogrid_, &Tgrid_, &Yegrid_};
+    const int nodes[] = {iRho, iT, iYe};
+    int ix[3];
+    Real w[3][2];
+    for (int i = 0; i < 3; ++i) {
+      const bool last = nodes[i] == grids[i]->nPoints() - 1;
+      ix[i] = nodes[i] - last;
+      w[i][0] = !last;
+      w[i][1] = last;
+    }
+    LookupState s = singularity::impl::pointState(
+        fromLog_(Rhogrid_.x(iRho)), fromLog_(Tgrid_.x(iT)) * MeV2K,
+        Yegrid_.x(iYe));
+    s.iRho = ix[0];
+    s.iT = ix[1];
+    s.iYe = ix[2];
+    std::copy(w[0], w[0] + 2, s.wRho);
+    std::copy(w[1], w[1] + 2, s.wT);
+    std::copy(w[2], w[2] + 2, s.wYe);
+    return s;
+  }
+  PORTABLE_INLINE_FUNCTION int species_(const RadiationType type) const {
+    const int idx = slot_[RadType2Idx(type)];
+    // Species left out of a partial load have no slot
+    assert(idx >= 0);
+    return idx;
+  }
+  // Interpolates one spectral quantity at a single energy.
+  PORTABLE_INLINE_FUNCTION Real interpSpectral_(const int q,
+                                                const LookupState &s,
+                                                const int idx,
+                                                const Real le) const {
+    if (precision_ == TablePrecision::Float) {
+      return interpSpectralAs_<const float *>(q, s, idx, le);
+    }
+    if (precision_ == TablePrecision::Quantized) {
+      return interpSpectralAs_<QuantizedPtr>(q, s, idx, le);
+    }
+    return interpSpectralAs_<const Real *>(q, s, idx, le);
+  }
+  // Ptr reads the packed storage: a const pointer to its element
+  // type, or QuantizedPtr.
+  template <typename Ptr>
+  PORTABLE_INLINE_FUNCTION Real interpSpectralAs_(const int q,
+                                                  const LookupState &s,
+                                                  const int idx,
+                                                  const Real le) const {
+    Ptr arows[8];
+    Ptr jrows[8];
+    Real w[8];
+    spectralCell_(s, idx, arows, jrows, w);
+    int ie;
+    Spiner::weights_t we;
+    energyWeights_(le, ie, we);
+    return blend_((q == ALPHA) ? arows : jrows, w, ie, we);
+  }
+  // Interpolates a spectral quantity to every bin in nu_bins. The
+  // (rho, T, Ye) cell and weights don't depend on energy, so we
+  // collapse the eight corner rows into one weighted sum per bin,
+  // rather than calling interpToReal for each bin.
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  interpSpectrum_(const int q, const LookupState &s, const int idx,
+                  FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+                  const int nbins, const Real scale) const {
+    if (precision_ == TablePrecision::Float) {
+      interpSpectrumAs_<const float *>(q, s, idx, nu_bins, coeffs, nbins,
+                                       scale);
+    } else if (precision_ == TablePrecision::Quantized) {
+      interpSpectrumAs_<QuantizedPtr>(q, s, idx, nu_bins, coeffs, nbins,
+                                      scale);
+    } else {
+      interpSpectrumAs_<const Real *>(q, s, idx, nu_bins, coeffs, nbins,
+                                      scale);
+    }
+  }
+  template <typename Ptr, typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  interpSpectrumAs_(const int q, const LookupState &s, const int idx,
+                    FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+                    const int nbins, const Real scale) const {
+    Ptr arows[8];
+    Ptr jrows[8];
+    Real w[8];
+    spectralCell_(s, idx, arows, jrows, w);
+    const Ptr *rows = (q == ALPHA) ? arows : jrows;
+    for (int i = 0; i < nbins; ++i) {
+      int ie;
+      Spiner::weights_t we;
+      energyWeights_(toLog_(Hz2MeV * nu_bins[i]), ie, we);
+      coeffs[i] = scale * fromLog_(blend_(rows, w, ie, we));
+    }
+  }
+  // alpha and j at one energy, sharing the cell
+  template <typename Ptr>
+  PORTABLE_INLINE_FUNCTION void interpBoth_(const LookupState &s,
+                                            const int idx, const Real le,
+                                            Real &alpha, Real &jnu) const {
+    Ptr arows[8];
+    Ptr jrows[8];
+    Real w[8];
+    spectralCell_(s, idx, arows, jrows, w);
+    int ie;
+    Spiner::weights_t we;
+    energyWeights_(le, ie, we);
+    alpha = fromLog_(blend_(arows, w, ie, we));
+    jnu = fromLog_(blend_(jrows, w, ie, we));
+  }
+  template <typename Ptr, typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  interpBothSpectrum_(const LookupState &s, const int idx,
+                      FrequencyIndexer &nu_bins, DataIndexer &alpha,
+                      DataIndexer &jnu, const int nbins) const {
+    Ptr arows[8];
+    Ptr jrows[8];
+    Real w[8];
+    spectralCell_(s, idx, arows, jrows, w);
+    for (int i = 0; i < nbins; ++i) {
+      int ie;
+      Spiner::weights_t we;
+      energyWeights_(toLog_(Hz2MeV * nu_bins[i]), ie, we);
+      alpha[i] = fromLog_(blend_(arows, w, ie, we));
+      jnu[i] = fromLog_(blend_(jrows, w, ie, we));
+    }
+  }
+  // Interpolates lJ (q = TOTALJ) or lJYe (q = TOTALJYE).
+  PORTABLE_INLINE_FUNCTION Real interpTotal_(const int q, const LookupState &s,
+                                             const int idx) const {
+    const std::size_t NT = Tgrid_.nPoints();
+    const std::size_t NYe = Yegrid_.nPoints();
+    if (precision_ == TablePrecision::Float) {
+      const float *data = totals_.data<float>() + q * nNodes_();
+      return singularity::impl::interp3DSpecies(data, NT, NYe, nspecies_, s,
+                                                idx);
+    }
+    if (precision_ == TablePrecision::Quantized) {
+      return singularity::impl::interp3DSpecies(qtotals_.table(q), NT, NYe,
+                                                nspecies_, s, idx);
+    }
+    const Spiner::DataBox &db = (q == TOTALJ) ? lJ_ : lJYe_;
+    return singularity::impl::interp3DSpecies(&db(0, 0, 0, 0), NT, NYe,
+                                              nspecies_, s, idx);
+  }
+  // Fills w with the weights of the eight corners of the (rho, T, Ye)
+  // cell of s, and arows, jrows with pointers to the alpha and j
+  // values at each corner for the lowest energy. Successive energies
+  // are spectralStride_() apart.
+  template <typename Ptr>
+  PORTABLE_INLINE_FUNCTION void spectralCell_(const LookupState &s,
+                                              const int idx, Ptr arows[8],
+                                              Ptr jrows[8], Real w[8]) const {
+    Ptr abase;
+    Ptr jbase;
+    spectralBases_(abase, jbase);
+    const std::size_t width = spectralStride_() * egrid_.nPoints();
+    for (int a = 0; a < 2; ++a) {
+      for (int b = 0; b < 2; ++b) {
+        for (int c = 0; c < 2; ++c) {
+          const int n = 4 * a + 2 * b + c;
+          const std::size_t offset =
+              nodeIndex_(s.iRho + a, s.iT + b, s.iYe + c, idx) * width;
+          arows[n] = abase + offset;
+          jrows[n] = jbase + offset;
+          w[n] = s.wRho[a] * s.wT[b] * s.wYe[c];
+        }
+      }
+    }
+  }
+  // Start of the alpha and j data. Only packed storage holds element
+  // types other than Real, so the DataBoxes are only used with T =
+  // Real.
+  template <typename T>
+  PORTABLE_INLINE_FUNCTION void spectralBases_(const T *&abase,
+                                               const T *&jbase) const {
+    if (packed_) {
+      abase = spectral_.data<T>();
+      jbase = abase + jOffset_();
+    } else {
+      abase = reinterpret_cast<const T *>(&lalphanu_(0, 0, 0, 0, 0));
+      jbase = reinterpret_cast<const T *>(&ljnu_(0, 0, 0, 0, 0));
+    }
+  }
+  // Quantized storage holds the separate tables as two tables, so
+  // each is quantized on its own blocks
+  PORTABLE_INLINE_FUNCTION void spectralBases_(QuantizedPtr &abase,
+                                               QuantizedPtr &jbase) const {
+    abase = qspectral_.table(0);
+    jbase = (layout_ == SpectralLayout::Separate) ? qspectral_.table(1)
+                                                  : abase + jOffset_();
+  }
+  PORTABLE_INLINE_FUNCTION void energyWeights_(const Real le, int &ie,
+                                               Spiner::weights_t &we) const {
+    egrid_.weights(bounds_[EAXIS](le), ie, we);
+  }
+  PORTABLE_INLINE_FUNCTION int spectralStride_() const {
+    return (layout_ == SpectralLayout::Interleaved) ? 2 : 1;
+  }
+  // Distance from the alpha data to the j data
+  PORTABLE_INLINE_FUNCTION std::size_t jOffset_() const {
+    if (layout_ == SpectralLayout::Interleaved) {
+      return 1;
+    }
+    return nNodes_() * egrid_.nPoints();
+  }
+  template <typename Ptr>
+  PORTABLE_FORCEINLINE_FUNCTION Real blend_(const Ptr rows[8], const Real w[8],
+                                            const int ie,
+                                            Spiner::weights_t &we) const {
+    Real lval = 0;
+    const int stride = spectralStride_();
+    const int i0 = stride * ie;
+    const int i1 = i0 + stride;
+    for (int n = 0; n < 8; ++n) {
+      lval += w[n] * (we[0] * rows[n][i0] + we[1] * rows[n][i1]);
+    }
+    return lval;
+  }
+  // Index of a (rho, T, Ye, species) node, with energy excluded
+  PORTABLE_INLINE_FUNCTION std::size_t nodeIndex_(const int iRho, const int iT,
+                                                  const int iYe,
+                                                  const int idx) const {
+    return ((static_cast<std::size_t>(iRho) * Tgrid_.nPoints() + iT) *
+                Yegrid_.nPoints() +
+            iYe) *
+               nspecies_ +
+           idx;
+  }
+  PORTABLE_INLINE_FUNCTION std::size_t nNodes_() const {
+    return nodeIndex_(Rhogrid_.nPoints(), 0, 0, 0);
+  }
+  // Converts the tables from base 10 to base 2, first copying them if
+  // they belong to someone else.
+  void log10ToLog2_(const bool copy) {
+    Spiner::DataBox *boxes[] = {&lalphanu_, &ljnu_, &lJ_, &lJYe_};
+    for (Spiner::DataBox *db : boxes) {
+      if (copy) {
+        Spiner::DataBox mine;
+        mine.copy(*db);
+        *db = mine;
+      }
+    }
+    singularity::impl::log10ToLog2(lalphanu_, {0, 3, 4});
+    singularity::impl::log10ToLog2(ljnu_, {0, 3, 4});
+    singularity::impl::log10ToLog2(lJ_, {2, 3});
+    singularity::impl::log10ToLog2(lJYe_, {2, 3});
+  }
+  // Sets up the tables from mapped_
+  void fromMapped_(const SpectralLayout layout,
+                   const TablePrecision precision) {
+    if (mapped_.encoding() != TableEncoding::Log2) {
+      mapped_.close();
+      OPAC_ERROR("neutrinos::SpinerOpacity: raw tables must be log2\n");
+    }
+    lalphanu_ = mapped_.get(SP5::Opac::AbsorptionCoefficient);
+    ljnu_ = mapped_.get(SP5::Opac::EmissivityPerNu);
+    lJ_ = mapped_.get(SP5::Opac::TotalEmissivity);
+    lJYe_ = mapped_.get(SP5::Opac::NumberEmissivity);
+    if (mapped_.has(SP5::Opac::EmissionQuantiles)) {
+      lquantile_ = mapped_.get(SP5::Opac::EmissionQuantiles);
+      nquantiles_ = lquantile_.range(0).nPoints();
+    }
+    allSpecies_();
+    if (mapped_.has(SP5::Opac::Species)) {
+      const Spiner::DataBox species = mapped_.get(SP5::Opac::Species);
+      for (int idx = 0; idx < NEUTRINO_NTYPES; ++idx) {
+        slot_[idx] = -1;
+      }
+      for (int k = 0; k < species.dim(1); ++k) {
+        const int idx = static_cast<int>(species(k));
+        if (idx < 0 || idx >= NEUTRINO_NTYPES) {
+          mapped_.close();
+          OPAC_ERROR("neutrinos::SpinerOpacity: bad species in raw file\n");
+        }
+        slot_[idx] = k;
+      }
+    }
+    nspecies_ = lJ_.dim(1);
+    std::vector<Real> nodes[NAXES];
+    for (int i = 0; i < NAXES; ++i) {
+      if (mapped_.has(nodesName_(i))) {
+        const Spiner::DataBox x = mapped_.get(nodesName_(i));
+        nodes[i].assign(&x(0), &x(0) + x.size());
+      }
+    }
+    setGrids_(nodes);
+    pack_(layout, precision, false);
+    // Nothing refers to the mapping once every table is converted
+    // and the quantiles, which are used in place, are copied
+    if (packed_ && precision_ != TablePrecision::Double) {
+      if (nquantiles_ > 0) {
+        Spiner::DataBox mine;
+        mine.copy(lquantile_);
+        lquantile_ = mine;
+      }
+      mapped_.close();
+    }
+  }
+  // Calls f with a writer holding the tables as they are saved
+  template <typename Function>
+  void withRawTables_(const Function &f) const {
+    requireCGS_();
+    Spiner::DataBox lalphanu, ljnu, lJ, lJYe;
+    savedTables_(lalphanu, ljnu, lJ, lJYe);
+    singularity::impl::RawTableWriter writer;
+    writer.add(SP5::Opac::AbsorptionCoefficient, lalphanu);
+    writer.add(SP5::Opac::EmissivityPerNu, ljnu);
+    writer.add(SP5::Opac::TotalEmissivity, lJ);
+    writer.add(SP5::Opac::NumberEmissivity, lJYe);
+    Spiner::DataBox species;
+    if (nspecies_ < NEUTRINO_NTYPES) {
+      species.resize(nspecies_);
+      for (int idx = 0; idx < NEUTRINO_NTYPES; ++idx) {
+        if (slot_[idx] >= 0) {
+          species(slot_[idx]) = idx;
+        }
+      }
+      writer.add(SP5::Opac::Species, species);
+    }
+    if (nquantiles_ > 0) {
+      writer.add(SP5::Opac::EmissionQuantiles, lquantile_);
+    }
+    const Grid *grids[] = {&egrid_, &Yegrid_, &Tgrid_, &Rhogrid_};
+    Spiner::DataBox nodes[NAXES];
+    for (int i = 0; i < NAXES; ++i) {
+      if (!grids[i]->isUniform()) {
+        nodes[i].resize(grids[i]->nPoints());
+        for (int k = 0; k < grids[i]->nPoints(); ++k) {
+          nodes[i](k) = grids[i]->x(k);
+        }
+        writer.add(nodesName_(i), nodes[i]);
+      }
+    }
+    f(writer);
+    species.finalize();
+    for (int i = 0; i < NAXES; ++i) {
+      nodes[i].finalize();
+    }
+    releaseSaved_(lalphanu, ljnu, lJ, lJYe);
+  }
+  // The tables in the separate layout at double precision, as they
+  // are written to disk. Tables that are stored otherwise are
+  // unpacked into copies, which releaseSaved_ frees.
+  void savedTables_(Spiner::DataBox &lalphanu, Spiner::DataBox &ljnu,
+                    Spiner::DataBox &lJ, Spiner::DataBox &lJYe) const {
+    lalphanu = lalphanu_;
+    ljnu = ljnu_;
+    lJ = lJ_;
+    lJYe = lJYe_;
+    if (packed_) {
+      unpack_(lalphanu, ljnu);
+    }
+    if (precision_ != TablePrecision::Double) {
+      unpackTotals_(lJ, lJYe);
+    }
+  }
+  void releaseSaved_(Spiner::DataBox &lalphanu, Spiner::DataBox &ljnu,
+                     Spiner::DataBox &lJ, Spiner::DataBox &lJYe) const {
+    if (packed_) {
+      lalphanu.finalize();
+      ljnu.finalize();
+    }
+    if (precision_ != TablePrecision::Double) {
+      lJ.finalize();
+      lJYe.finalize();
+    }
+  }
+  void allSpecies_() {
+    nspecies_ = NEUTRINO_NTYPES;
+    for (int idx = 0; idx < NEUTRINO_NTYPES; ++idx) {
+      slot_[idx] = idx;
+    }
+  }
+#ifdef SPINER_USE_HDF
+  // Files record the species they hold only if some were left out
+  static herr_t loadSpecies_(hid_t file, int slot[NEUTRINO_NTYPES]) {
+    for (int idx = 0; idx < NEUTRINO_NTYPES; ++idx) {
+      slot[idx] = idx;
+    }
+    if (H5Aexists_by_name(file, "/", SP5::Opac::Species, H5P_DEFAULT) <= 0) {
+      return H5_SUCCESS;
+    }
+    hsize_t n;
+    H5T_class_t typeclass;
+    std::size_t size;
+    herr_t status = H5LTget_attribute_info(file, "/", SP5::Opac::Species, &n,
+                                           &typeclass, &size);
+    int species[NEUTRINO_NTYPES];
+    if (status != H5_SUCCESS || n < 1 || n > NEUTRINO_NTYPES) {
+      return -1;
+    }
+    status += H5LTget_attribute_int(file, "/", SP5::Opac::Species, species);
+    for (int idx = 0; idx < NEUTRINO_NTYPES; ++idx) {
+      slot[idx] = -1;
+    }
+    for (int k = 0; k < static_cast<int>(n); ++k) {
+      if (species[k] < 0 || species[k] >= NEUTRINO_NTYPES) {
+        return -1;
+      }
+      slot[species[k]] = k;
+    }
+    return status;
+  }
+  herr_t saveSpecies_(hid_t file) const {
+    if (nspecies_ == NEUTRINO_NTYPES) {
+      return H5_SUCCESS;
+    }
+    int species[NEUTRINO_NTYPES];
+    for (int idx = 0; idx < NEUTRINO_NTYPES; ++idx) {
+      if (slot_[idx] >= 0) {
+        species[slot_[idx]] = idx;
+      }
+    }
+    return H5LTset_attribute_int(file, "/", SP5::Opac::Species, species,
+                                 nspecies_);
+  }
+  // Files record nodes only for the axes that aren't uniform. Nodes
+  // of the other axes are left empty.
+  static herr_t loadNodes_(hid_t file, std::vector<Real> nodes[NAXES]) {
+    herr_t status = H5_SUCCESS;
+    for (int i = 0; i < NAXES; ++i) {
+      nodes[i].clear();
+      if (H5Lexists(file, nodesName_(i), H5P_DEFAULT) <= 0) {
+        continue;
+      }
+      int rank;
+      hsize_t n;
+      H5T_class_t typeclass;
+      std::size_t size;
+      status += H5LTget_dataset_ndims(file, nodesName_(i), &rank);
+      if (status != H5_SUCCESS || rank != 1) {
+        return -1;
+      }
+      status += H5LTget_dataset_info(file, nodesName_(i), &n, &typeclass,
+                                     &size);
+      nodes[i].resize(n);
+      status += H5LTread_dataset(file, nodesName_(i), H5T_REAL,
+                                 nodes[i].data());
+    }
+    return status;
+  }
+  herr_t saveNodes_(hid_t file) const {
+    const Grid *grids[] = {&egrid_, &Yegrid_, &Tgrid_, &Rhogrid_};
+    herr_t status = H5_SUCCESS;
+    for (int i = 0; i < NAXES; ++i) {
+      if (grids[i]->isUniform()) {
+        continue;
+      }
+      const hsize_t n = grids[i]->nPoints();
+      std::vector<Real> x(n);
+      for (hsize_t k = 0; k < n; ++k) {
+        x[k] = grids[i]->x(k);
+      }
+      status += H5LTmake_dataset(file, nodesName_(i), 1, &n, H5T_REAL,
+                                 x.data());
+    }
+    return status;
+  }
+  // Reads the part of table name within [lo, hi] on every axis but
+  // speciesAxis, and the species with a slot, into db. Bounds and
+  // nodes skip the species axis, with empty nodes on uniform axes, and
+  // file holds species idx at fileSlot[idx]. Sets first, if given, to
+  // the index of the first point kept on each axis.
+  herr_t loadSubset_(hid_t file, const char *name, const int speciesAxis,
+                     const Real *lo, const Real *hi,
+                     const std::vector<Real> *nodes,
+                     const int fileSlot[NEUTRINO_NTYPES], Spiner::DataBox &db,
+                     int *first = nullptr) {
+    int rank;
+    int dims[Spiner::MAXRANK];
+    herr_t status = singularity::impl::loadHDFShape(file, name, rank, dims);
+    if (status != H5_SUCCESS || (rank != 4 && rank != 5)) {
+      return -1;
+    }
+    int start[Spiner::MAXRANK], count[Spiner::MAXRANK], dst[Spiner::MAXRANK];
+    Spiner::RegularGrid1D grids[Spiner::MAXRANK];
+    const std::vector<Real> *axisNodes[Spiner::MAXRANK];
+    for (int i = 0, b = 0; i < rank; ++i) {
+      dst[i] = 0;
+      if (i == speciesAxis) {
+        count[i] = nspecies_;
+        continue;
+      }
+      status += singularity::impl::loadHDFGrid(file, name, i, grids[i]);
+      axisNodes[i] = &nodes[b];
+      if (nodes[b].empty()) {
+        window_(grids[i], lo[b], hi[b], start[i], count[i]);
+      } else {
+        window_(nodes[b], lo[b], hi[b], start[i], count[i]);
+      }
+      if (first != nullptr) {
+        first[b] = start[i];
+      }
+      ++b;
+    }
+    db = Spiner::DataBox();
+    if (rank == 5) {
+      db.resize(count[4], count[3], count[2], count[1], count[0]);
+    } else {
+      db.resize(count[3], count[2], count[1], count[0]);
+    }
+    for (int i = 0; i < rank; ++i) {
+      if (i == speciesAxis) {
+        continue;
+      }
+      const int last = start[i] + count[i] - 1;
+      if (axisNodes[i]->empty()) {
+        db.setRange(i, grids[i].x(start[i]), grids[i].x(last), count[i]);
+      } else {
+        db.setRange(i, (*axisNodes[i])[start[i]], (*axisNodes[i])[last],
+                    count[i]);
+      }
+    }
+    const bool quantized = singularity::impl::isQuantizedHDF(file, name);
+    count[speciesAxis] = 1;
+    for (int idx = 0; idx < NEUTRINO_NTYPES; ++idx) {
+      if (slot_[idx] >= 0) {
+        start[speciesAxis] = fileSlot[idx];
+        dst[speciesAxis] = slot_[idx];
+        if (quantized) {
+          status += singularity::impl::loadHDFQuantizedHyperslab(
+              file, name, start, count, dst, db);
+        } else {
+          status += singularity::impl::loadHDFHyperslab(file, name, start,
+                                                        count, dst, db);
+        }
+      }
+    }
+    return status;
+  }
+#endif
+  // Smallest run of grid points covering [lo, hi], clipped to the
+  // grid. Keeps at least two points so the run can be interpolated.
+  static void window_(const Spiner::RegularGrid1D &g, const Real lo,
+                      const Real hi, int &start, int &count) {
+    const int N = g.nPoints();
+    if (N < 2) {
+      start = 0;
+      count = N;
+      return;
+    }
+    // Tolerate round off in bounds that fall on grid points
+    const Real dx = g.x(1) - g.x(0);
+    const Real tol = 1e-10;
+    const Real flo = std::floor((lo - g.min()) / dx + tol);
+    const Real fhi = std::ceil((hi - g.min()) / dx - tol);
+    int ilo = static_cast<int>(std::min(std::max(flo, Real(0)), Real(N - 2)));
+    int ihi = static_cast<int>(std::min(std::max(fhi, Real(1)), Real(N - 1)));
+    ihi = std::max(ihi, ilo + 1);
+    start = ilo;
+    count = ihi - ilo + 1;
+  }
+  // As above, on the nodes of a non-uniform axis
+  static void window_(const std::vector<Real> &nodes, const Real lo,
+                      const Real hi, int &start, int &count) {
+    const int N = nodes.size();
+    const Real tol = 1e-10 * (nodes.back() - nodes.front());
+    int ilo = static_cast<int>(std::upper_bound(nodes.begin(), nodes.end(),
+                                                lo + tol) -
+                               nodes.begin()) -
+              1;
+    int ihi = static_cast<int>(
+        std::lower_bound(nodes.begin(), nodes.end(), hi - tol) -
+        nodes.begin());
+    ilo = std::min(std::max(ilo, 0), N - 2);
+    ihi = std::min(std::max(ihi, 1), N - 1);
+    ihi = std::max(ihi, ilo + 1);
+    start = ilo;
+    count = ihi - ilo + 1;
+  }
+  // Sets the grids from the ranges of lalphanu_, or from nodes where
+  // an axis has them. nodes is ordered energy, Ye, T, rho. The totals
+  // are interpolated on the same (rho, T, Ye) grids, so their tables
+  // must share them.
+  void setGrids_(const std::vector<Real> *nodes = nullptr) {
+    for (const Spiner::DataBox *db : {&lJ_, &lJYe_}) {
+      bool same = (db->rank() == 4 && db->dim(1) == lalphanu_.dim(2));
+      for (int i = 1; i < 4 && same; ++i) {
+        const Spiner::RegularGrid1D &g = db->range(i);
+        const Spiner::RegularGrid1D &spectral = lalphanu_.range(i + 1);
+        same = (g.nPoints() == spectral.nPoints() &&
+                g.min() == spectral.min() && g.max() == spectral.max());
+      }
+      if (!same) {
+        OPAC_ERROR("neutrinos::SpinerOpacity: the total emissivity tables "
+                   "must share the spectral grids\n");
+      }
+    }
+    Grid *grids[] = {&egrid_, &Yegrid_, &Tgrid_, &Rhogrid_};
+    for (int i = 0; i < NAXES; ++i) {
+      const Spiner::RegularGrid1D g = lalphanu_.range(spectralAxis_(i));
+      if (nodes == nullptr || nodes[i].empty()) {
+        *grids[i] = Grid(g);
+        continue;
+      }
+      if (static_cast<int>(nodes[i].size()) != g.nPoints()) {
+        OPAC_ERROR("neutrinos::SpinerOpacity: grid nodes don't match the "
+                   "tables\n");
+      }
+      *grids[i] = Grid(nodes[i].data(), g.nPoints());
+    }
+  }
+  // Axis of lalphanu_ holding grid i of setGrids_
+  static int spectralAxis_(const int i) { return (i == EAXIS) ? 0 : i + 1; }
+  static const char *nodesName_(const int i) {
+    const char *names[] = {SP5::Opac::EnergyNodes, SP5::Opac::YeNodes,
+                           SP5::Opac::TemperatureNodes,
+                           SP5::Opac::DensityNodes};
+    return names[i];
+  }
+  // Expresses the tables and nodes in units. Every axis and table
+  // but Ye is a log, so each shifts by the log of its conversion
+  // factor, the one NonCGSUnits applies on every lookup.
+  void bakeUnits_(const UnitSystem &units, std::vector<Real> nodes[NAXES]) {
+    units_ = units;
+    cgs_ = units.IsCGS();
+    if (units.IsCGS()) {
+      return;
+    }
+    const Real time = units.time;
+    const Real length = units.length;
+    const Real le = std::log2(time);
+    const Real lT = -std::log2(units.temp);
+    const Real lRho = -std::log2(units.Density());
+    const Real lalpha = std::log2(length);
+    const Real ljnu = std::log2(length * time * time / units.mass);
+    const Real lJYe = std::log2(length * length * length * time);
+    singularity::impl::shiftLog2(lalphanu_, lalpha,
+                                 {{0, le}, {3, lT}, {4, lRho}});
+    singularity::impl::shiftLog2(ljnu_, ljnu, {{0, le}, {3, lT}, {4, lRho}});
+    singularity::impl::shiftLog2(lJ_, ljnu + le, {{2, lT}, {3, lRho}});
+    singularity::impl::shiftLog2(lJYe_, lJYe, {{2, lT}, {3, lRho}});
+    if (nquantiles_ > 0) {
+      singularity::impl::shiftLog2(lquantile_, le, {{3, lT}, {4, lRho}});
+    }
+    const Real shifts[] = {le, 0, lT, lRho};
+    for (int i = 0; i < NAXES; ++i) {
+      for (Real &x : nodes[i]) {
+        x += shifts[i];
+      }
+    }
+  }
+  // Files and raw tables are CGS
+  void requireCGS_() const {
+    if (!units_.IsCGS()) {
+      OPAC_ERROR("neutrinos::SpinerOpacity: tables loaded in other units "
+                 "can't be saved\n");
+    }
+  }
+  // Converts base 10 nodes to base 2. Ye isn't a log.
+  static void nodesToLog2_(std::vector<Real> nodes[NAXES]) {
+    for (int i = 0; i < NAXES; ++i) {
+      if (i == YEAXIS) {
+        continue;
+      }
+      for (Real &x : nodes[i]) {
+        x *= singularity::impl::LOG2_10;
+      }
+    }
+  }
+  // Fills the tables from opac at every node of the grids. Each (rho,
+  // T, Ye) point is independent, so they are spread over host threads;
+  // the tables don't depend on how many.
+  template <typename Opacity>
+  void tabulate_(Opacity &opac, const int nthreads) {
+    const int Ne = egrid_.nPoints();
+    const int NYe = Yegrid_.nPoints();
+    const int NT = Tgrid_.nPoints();
+    const int NRho = Rhogrid_.nPoints();
+    singularity::impl::hostParallelFor(
+        NRho * NT * NYe, nthreads, [&](const int i) {
+          const int iRho = i / (NT * NYe);
+          const int iT = (i / NYe) % NT;
+          const int iYe = i % NYe;
+          Real rho = fromLog_(Rhogrid_.x(iRho));
+          Real T = fromLog_(Tgrid_.x(iT));
+          Real Ye = Yegrid_.x(iYe);
+          for (int idx = 0; idx < NEUTRINO_NTYPES; ++idx) {
+            RadiationType type = Idx2RadType(idx);
+            Real J = std::max(opac.Emissivity(rho, T * MeV2K, Ye, type), 0.0);
+            Real lJ = toLog_(J);
+            lJ_(iRho, iT, iYe, idx) = lJ;
+            Real JYe =
+                std::max(opac.NumberEmissivity(rho, T * MeV2K, Ye, type), 0.0);
+            lJYe_(iRho, iT, iYe, idx) = toLog_(JYe);
+            for (int ie = 0; ie < Ne; ++ie) {
+              Real lE = egrid_.x(ie);
+              Real E = fromLog_(lE);
+              Real nu = MeV2Hz * E;
+              Real alpha = std::max(
+                  opac.AbsorptionCoefficient(rho, T * MeV2K, Ye, type, nu),
+                  0.0);
+              lalphanu_(iRho, iT, iYe, idx, ie) = toLog_(alpha);
+              Real j = std::max(
+                  opac.EmissivityPerNuOmega(rho, T * MeV2K, Ye, type, nu),
+                  0.0);
+              ljnu_(iRho, iT, iYe, idx, ie) = toLog_(j);
+            }
+          }
+        });
+  }
+  // Converts lalphanu_ and ljnu_ to the requested layout and
+  // precision, and lJ_ and lJYe_ to the requested precision. Releases
+  // the converted tables if we own them.
+  void pack_(const SpectralLayout layout, const TablePrecision precision,
+             const bool owned) {
+    layout_ = layout;
+    precision_ = precision;
+    if (layout == SpectralLayout::Separate &&
+        precision == TablePrecision::Double) {
+      return;
+    }
+    if (precision == TablePrecision::Quantized) {
+      quantizeSpectral_();
+    } else if (precision == TablePrecision::Float) {
+      packSpectral_<float>();
+    } else {
+      packSpectral_<Real>();
+    }
+    if (precision != TablePrecision::Double) {
+      packTotals_();
+      if (owned) {
+        lJ_.finalize();
+        lJYe_.finalize();
+      }
+      lJ_ = Spiner::DataBox();
+      lJYe_ = Spiner::DataBox();
+    }
+    if (owned) {
+      lalphanu_.finalize();
+      ljnu_.finalize();
+    }
+    lalphanu_ = Spiner::DataBox();
+    ljnu_ = Spiner::DataBox();
+    packed_ = true;
+  }
+  // Copies lalphanu_ and ljnu_ into spectral_, in layout_ and
+  // element type T.
+  template <typename T>
+  void packSpectral_() {
+    spectral_.allocate(spectralCount_() * sizeof(T));
+    T *abase = spectral_.data<T>();
+    fillSpectral_(abase, abase + jOffset_());
+  }
+  // Quantizes lalphanu_ and ljnu_ into qspectral_, in layout_. The
+  // separate tables are quantized as two tables, the others as one.
+  void quantizeSpectral_() {
+    const std::size_t count = spectralCount_();
+    std::vector<Real> values(count);
+    fillSpectral_(values.data(), values.data() + jOffset_());
+    if (layout_ == SpectralLayout::Separate) {
+      qspectral_.allocate(count / 2, 2);
+      qspectral_.encode(ALPHA, values.data());
+      qspectral_.encode(JNU, values.data() + count / 2);
+    } else {
+      qspectral_.allocate(count, 1);
+      qspectral_.encode(0, values.data());
+    }
+  }
+  // Number of values in the packed spectral storage
+  std::size_t spectralCount_() const {
+    return 2 * nNodes_() * egrid_.nPoints();
+  }
+  // Writes lalphanu_ and ljnu_ in layout_ to abase and jbase.
+  template <typename T>
+  void fillSpectral_(T *abase, T *jbase) const {
+    const int Ne = egrid_.nPoints();
+    const int NYe = Yegrid_.nPoints();
+    const int NT = Tgrid_.nPoints();
+    const int NRho = Rhogrid_.nPoints();
+    const int stride = spectralStride_();
+    for (int iRho = 0; iRho < NRho; ++iRho) {
+      for (int iT = 0; iT < NT; ++iT) {
+        for (int iYe = 0; iYe < NYe; ++iYe) {
+          for (int idx = 0; idx < nspecies_; ++idx) {
+            const std::size_t row =
+                nodeIndex_(iRho, iT, iYe, idx) * stride * Ne;
+            for (int ie = 0; ie < Ne; ++ie) {
+              const std::size_t i = row + ie * stride;
+              abase[i] = static_cast<T>(lalphanu_(iRho, iT, iYe, idx, ie));
+              jbase[i] = static_cast<T>(ljnu_(iRho, iT, iYe, idx, ie));
+            }
+          }
+        }
+      }
+    }
+  }
+  // Copies lJ_ then lJYe_ into totals_ as floats, or into qtotals_
+  // quantized. setGrids_ has checked that they share the spectral
+  // grids.
+  void packTotals_() {
+    const std::size_t N = nNodes_();
+    if (precision_ == TablePrecision::Quantized) {
+      qtotals_.allocate(N, 2);
+      qtotals_.encode(TOTALJ, &lJ_(0, 0, 0, 0));
+      qtotals_.encode(TOTALJYE, &lJYe_(0, 0, 0, 0));
+      return;
+    }
+    totals_.allocate(2 * N * sizeof(float));
+    float *data = totals_.data<float>();
+    const Real *lJ = &lJ_(0, 0, 0, 0);
+    const Real *lJYe = &lJYe_(0, 0, 0, 0);
+    for (std::size_t i = 0; i < N; ++i) {
+      data[TOTALJ * N + i] = static_cast<float>(lJ[i]);
+      data[TOTALJYE * N + i] = static_cast<float>(lJYe[i]);
+    }
+  }
+  // Value of spectral quantity q at a node, however it is stored
+  Real spectralNode_(const int q, const int iRho, const int iT, const int iYe,
+                     const int idx, const int ie) const {
+    if (packed_) {
+      return nodeValue_(q, iRho, iT, iYe, idx, ie);
+    }
+    const Spiner::DataBox &db = (q == ALPHA) ? lalphanu_ : ljnu_;
+    return db(iRho, iT, iYe, idx, ie);
+  }
+  // Value of spectral quantity q at a node of packed storage
+  Real nodeValue_(const int q, const int iRho, const int iT, const int iYe,
+                  const int idx, const int ie) const {
+    if (precision_ == TablePrecision::Float) {
+      return nodeValueAs_<const float *>(q, iRho, iT, iYe, idx, ie);
+    }
+    if (precision_ == TablePrecision::Quantized) {
+      return nodeValueAs_<QuantizedPtr>(q, iRho, iT, iYe, idx, ie);
+    }
+    return nodeValueAs_<const Real *>(q, iRho, iT, iYe, idx, ie);
+  }
+  template <typename Ptr>
+  Real nodeValueAs_(const int q, const int iRho, const int iT, const int iYe,
+                    const int idx, const int ie) const {
+    Ptr abase;
+    Ptr jbase;
+    spectralBases_(abase, jbase);
+    const Ptr base = (q == ALPHA) ? abase : jbase;
+    const std::size_t Ne = egrid_.nPoints();
+    const std::size_t stride = spectralStride_();
+    return base[(nodeIndex_(iRho, iT, iYe, idx) * Ne + ie) * stride];
+  }
+  // Inverse of pack_ for the spectral tables. Allocates lalphanu and
+  // ljnu on host; the caller is responsible for freeing them.
+  void unpack_(Spiner::DataBox &lalphanu, Spiner::DataBox &ljnu) const {
+    const int Ne = egrid_.nPoints();
+    const int NYe = Yegrid_.nPoints();
+    const int NT = Tgrid_.nPoints();
+    const int NRho = Rhogrid_.nPoints();
+    lalphanu = Spiner::DataBox();
+    lalphanu.resize(NRho, NT, NYe, nspecies_, Ne);
+    lalphanu.setRange(0, egrid_.min(), egrid_.max(), Ne);
+    lalphanu.setRange(2, Yegrid_.min(), Yegrid_.max(), NYe);
+    lalphanu.setRange(3, Tgrid_.min(), Tgrid_.max(), NT);
+    lalphanu.setRange(4, Rhogrid_.min(), Rhogrid_.max(), NRho);
+    ljnu = Spiner::DataBox();
+    ljnu.copyMetadata(lalphanu);
+    for (int iRho = 0; iRho < NRho; ++iRho) {
+      for (int iT = 0; iT < NT; ++iT) {
+        for (int iYe = 0; iYe < NYe; ++iYe) {
+          for (int idx = 0; idx < nspecies_; ++idx) {
+            for (int ie = 0; ie < Ne; ++ie) {
+              lalphanu(iRho, iT, iYe, idx, ie) =
+                  nodeValue_(ALPHA, iRho, iT, iYe, idx, ie);
+              ljnu(iRho, iT, iYe, idx, ie) =
+                  nodeValue_(JNU, iRho, iT, iYe, idx, ie);
+            }
+          }
+        }
+      }
+    }
+  }
+  // Inverse of packTotals_. Allocates lJ and lJYe on host; the caller
+  // is responsible for freeing them.
+  void unpackTotals_(Spiner::DataBox &lJ, Spiner::DataBox &lJYe) const {
+    const int NYe = Yegrid_.nPoints();
+    const int NT = Tgrid_.nPoints();
+    const int NRho = Rhogrid_.nPoints();
+    lJ = Spiner::DataBox();
+    lJ.resize(NRho, NT, NYe, nspecies_);
+    lJ.setRange(1, Yegrid_.min(), Yegrid_.max(), NYe);
+    lJ.setRange(2, Tgrid_.min(), Tgrid_.max(), NT);
+    lJ.setRange(3, Rhogrid_.min(), Rhogrid_.max(), NRho);
+    lJYe = Spiner::DataBox();
+    lJYe.copyMetadata(lJ);
+    const std::size_t N = nNodes_();
+    Real *J = &lJ(0, 0, 0, 0);
+    Real *JYe = &lJYe(0, 0, 0, 0);
+    if (precision_ == TablePrecision::Quantized) {
+      const QuantizedPtr qJ = qtotals_.table(TOTALJ);
+      const QuantizedPtr qJYe = qtotals_.table(TOTALJYE);
+      for (std::size_t i = 0; i < N; ++i) {
+        J[i] = qJ[i];
+        JYe[i] = qJYe[i];
+      }
+      return;
+    }
+    const float *data = totals_.data<float>();
+    for (std::size_t i = 0; i < N; ++i) {
+      J[i] = data[TOTALJ * N + i];
+      JYe[i] = data[TOTALJYE * N + i];
+    }
   }
+  enum { ALPHA = 0, JNU = 1 };
+  enum { TOTALJ = 0, TOTALJYE = 1 };
   const char *filename_;
   impl::DataStatus memoryStatus_ = impl::DataStatus::Deallocated;
   // TODO(JMM): Integrating J and JYe seems wise.
   // We can add more things here as needed.
   Spiner::DataBox lalphanu_, ljnu_, lJ_, lJYe_;
+  // alpha and j in a packed layout or reduced precision, replacing
+  // lalphanu_ and ljnu_ when packed_ is set
+  singularity::impl::AlignedStorage spectral_;
+  // lJ and lJYe as floats, replacing lJ_ and lJYe_ with float precision
+  singularity::impl::AlignedStorage totals_;
+  // The same with quantized precision
+  singularity::impl::QuantizedStorage qspectral_, qtotals_;
+  // raw file the tables are mapped from, if any
+  singularity::impl::MappedTables mapped_;
+  // grids of lalphanu_, kept here since packed storage drops it and
+  // DataBoxes only record the bounds of non-uniform axes
+  Grid egrid_, Yegrid_, Tgrid_, Rhogrid_;
+  // out of range policy of each grid, in the same order
+  singularity::impl::AxisBounds bounds_[NAXES];
+  SpectralLayout layout_ = SpectralLayout::Separate;
+  TablePrecision precision_ = TablePrecision::Double;
+  bool packed_ = false;
+  // Number of species in the tables, and the slot in the species axis
+  // of each one, or -1 if it wasn't loaded
+  int nspecies_ = NEUTRINO_NTYPES;
+  int slot_[NEUTRINO_NTYPES] = {0, 1, 2};
+  // Emission quantiles from BuildEmissionSampling, (rho, T, Ye,
+  // species, quantile), and how many there are, 0 without them
+  Spiner::DataBox lquantile_;
+  int nquantiles_ = 0;
+  // Units of the tables, CGS unless loaded in others
+  UnitSystem units_;
+  bool cgs_ = true;
   // TODO(JMM): Should we add table bounds? Given they're recorded in
   // each spiner table, I lean towards no, but could be convinced
   // otherwise if we need to do extrapolation, etc.
@@ -0,0 +1,427 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+#ifndef SINGULARITY_OPAC_NEUTRINOS_SUM_OPACITY_NEUTRINOS_
+#define SINGULARITY_OPAC_NEUTRINOS_SUM_OPACITY_NEUTRINOS_
+
+#include <cmath>
+#include <cstdio>
+#include <type_traits>
+
+#include <ports-of-call/portability.hpp>
+#include <singularity-opac/base/lookup_state.hpp>
+#include <singularity-opac/base/opac_error.hpp>
+#include <singularity-opac/base/radiation_types.hpp>
+#include <singularity-opac/base/sum_components.hpp>
+#include <singularity-opac/neutrinos/brt_neutrinos.hpp>
+#include <singularity-opac/neutrinos/gray_opacity_neutrinos.hpp>
+#include <singularity-opac/neutrinos/thermal_distributions_neutrinos.hpp>
+
+namespace singularity {
+namespace neutrinos {
+namespace impl {
+
+// Models whose emissivity is their absorption coefficient times the
+// thermal distribution ThermalDistribution. A sum only asks these for
+// their absorption and multiplies the total by B_nu once.
+template <typename Model, typename ThermalDistribution>
+struct IsKirchhoff : std::false_type {};
+template <typename ThermalDistribution, typename pc>
+struct IsKirchhoff<GrayOpacity<ThermalDistribution, pc>, ThermalDistribution>
+    : std::true_type {};
+template <typename ThermalDistribution, typename pc>
+struct IsKirchhoff<BRTOpacity<ThermalDistribution, pc>, ThermalDistribution>
+    : std::true_type {};
+
+// Adds one component of a sum at one frequency. Kirchhoff components
+// add their absorption to alphaK, to be multiplied by B_nu, and the
+// rest add their own emissivity to jnu.
+template <typename ThermalDistribution, typename Model>
+PORTABLE_FORCEINLINE_FUNCTION typename std::enable_if<
+    IsKirchhoff<Model, ThermalDistribution>::value>::type
+addEmissivity(const Model &m, const Real rho, const Real temp, const Real Ye,
+              const RadiationType type, const Real nu, Real &alphaK, Real &jnu,
+              Real *lambda) {
+  alphaK += m.AbsorptionCoefficient(rho, temp, Ye, type, nu, lambda);
+}
+template <typename ThermalDistribution, typename Model>
+PORTABLE_FORCEINLINE_FUNCTION typename std::enable_if<
+    !IsKirchhoff<Model, ThermalDistribution>::value>::type
+addEmissivity(const Model &m, const Real rho, const Real temp, const Real Ye,
+              const RadiationType type, const Real nu, Real &alphaK, Real &jnu,
+              Real *lambda) {
+  jnu += m.EmissivityPerNuOmega(rho, temp, Ye, type, nu, lambda);
+}
+
+template <typename ThermalDistribution, typename Model>
+PORTABLE_FORCEINLINE_FUNCTION typename std::enable_if<
+    IsKirchhoff<Model, ThermalDistribution>::value>::type
+addAbsorptionAndEmissivity(const Model &m, const Real rho, const Real temp,
+                           const Real Ye, const RadiationType type,
+                           const Real nu, Real &alpha, Real &alphaK, Real &jnu,
+                           Real *lambda) {
+  const Real a = m.AbsorptionCoefficient(rho, temp, Ye, type, nu, lambda);
+  alpha += a;
+  alphaK += a;
+}
+template <typename ThermalDistribution, typename Model>
+PORTABLE_FORCEINLINE_FUNCTION typename std::enable_if<
+    !IsKirchhoff<Model, ThermalDistribution>::value>::type
+addAbsorptionAndEmissivity(const Model &m, const Real rho, const Real temp,
+                           const Real Ye, const RadiationType type,
+                           const Real nu, Real &alpha, Real &alphaK, Real &jnu,
+                           Real *lambda) {
+  Real a, j;
+  m.AbsorptionAndEmissivity(rho, temp, Ye, type, nu, a, j, lambda);
+  alpha += a;
+  jnu += j;
+}
+
+} // namespace impl
+
+// The sum of several absorption processes, e.g., BRT absorption plus
+// a gray floor, as one model. Each query evaluates every component
+// at a frequency in one pass and returns the total. The thermal
+// distribution is evaluated once per frequency for all the
+// components that obey Kirchhoff's law with it (see IsKirchhoff),
+// and the thermal functions of the sum are those of
+// ThermalDistribution. Every component receives the same lambda.
+template <typename ThermalDistribution, typename... Models>
+class SumOpacity {
+ public:
+  SumOpacity() = default;
+  SumOpacity(const Models &... models) : models_(models...) {}
+  SumOpacity(const ThermalDistribution &dist, const Models &... models)
+      : models_(models...), dist_(dist) {}
+
+  SumOpacity GetOnDevice() {
+    SumOpacity other;
+    other.models_ = models_.GetOnDevice();
+    other.dist_ = dist_;
+    return other;
+  }
+  PORTABLE_INLINE_FUNCTION
+  int nlambda() const noexcept {
+    int n = 0;
+    models_.forEach([&](const auto &m) {
+      const int nm = m.nlambda();
+      n = (nm > n) ? nm : n;
+    });
+    return n;
+  }
+  PORTABLE_INLINE_FUNCTION
+  void PrintParams() const noexcept {
+    printf("Sum of %d opacities:\n", static_cast<int>(sizeof...(Models)));
+    models_.forEach([](const auto &m) { m.PrintParams(); });
+  }
+  inline void Finalize() noexcept { models_.Finalize(); }
+
+  PORTABLE_INLINE_FUNCTION
+  Real AbsorptionCoefficient(const Real rho, const Real temp, const Real Ye,
+                             const RadiationType type, const Real nu,
+                             Real *lambda = nullptr) const {
+    Real alpha = 0;
+    models_.forEach([&](const auto &m) {
+      alpha += m.AbsorptionCoefficient(rho, temp, Ye, type, nu, lambda);
+    });
+    return alpha;
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  AbsorptionCoefficient(const Real rho, const Real temp, const Real Ye,
+                        const RadiationType type, FrequencyIndexer &nu_bins,
+                        DataIndexer &coeffs, const int nbins,
+                        Real *lambda = nullptr) const {
+    for (int i = 0; i < nbins; ++i) {
+      coeffs[i] =
+          AbsorptionCoefficient(rho, temp, Ye, type, nu_bins[i], lambda);
+    }
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real AngleAveragedAbsorptionCoefficient(const Real rho, const Real temp,
+                                          const Real Ye,
+                                          const RadiationType type,
+                                          const Real nu,
+                                          Real *lambda = nullptr) const {
+    Real alpha = 0;
+    models_.forEach([&](const auto &m) {
+      alpha += m.AngleAveragedAbsorptionCoefficient(rho, temp, Ye, type, nu,
+                                                    lambda);
+    });
+    return alpha;
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void AngleAveragedAbsorptionCoefficient(
+      const Real rho, const Real temp, const Real Ye, const RadiationType type,
+      FrequencyIndexer &nu_bins, DataIndexer &coeffs, const int nbins,
+      Real *lambda = nullptr) const {
+    for (int i = 0; i < nbins; ++i) {
+      coeffs[i] = AngleAveragedAbsorptionCoefficient(rho, temp, Ye, type,
+                                                     nu_bins[i], lambda);
+    }
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real EmissivityPerNuOmega(const Real rho, const Real temp, const Real Ye,
+                            const RadiationType type, const Real nu,
+                            Real *lambda = nullptr) const {
+    Real alphaK = 0;
+    Real jnu = 0;
+    models_.forEach([&](const auto &m) {
+      impl::addEmissivity<ThermalDistribution>(m, rho, temp, Ye, type, nu,
+                                               alphaK, jnu, lambda);
+    });
+    return jnu + alphaK * BnuIfNeeded_(alphaK, temp, type, nu, lambda);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  EmissivityPerNuOmega(const Real rho, const Real temp, const Real Ye,
+                       const RadiationType type, FrequencyIndexer &nu_bins,
+                       DataIndexer &coeffs, const int nbins,
+                       Real *lambda = nullptr) const {
+    for (int i = 0; i < nbins; ++i) {
+      coeffs[i] = EmissivityPerNuOmega(rho, temp, Ye, type, nu_bins[i], lambda);
+    }
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  void AbsorptionAndEmissivity(const Real rho, const Real temp, const Real Ye,
+                               const RadiationType type, const Real nu,
+                               Real &alpha, Real &jnu,
+                               Real *lambda = nullptr) const {
+    Real alphaK = 0;
+    alpha = 0;
+    jnu = 0;
+    models_.forEach([&](const auto &m) {
+      impl::addAbsorptionAndEmissivity<ThermalDistribution>(
+          m, rho, temp, Ye, type, nu, alpha, alphaK, jnu, lambda);
+    });
+    jnu += alphaK * BnuIfNeeded_(alphaK, temp, type, nu, lambda);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  AbsorptionAndEmissivity(const Real rho, const Real temp, const Real Ye,
+                          const RadiationType type, FrequencyIndexer &nu_bins,
+                          DataIndexer &alpha, DataIndexer &jnu, const int nbins,
+                          Real *lambda = nullptr) const {
+    for (int i = 0; i < nbins; ++i) {
+      Real a, j;
+      AbsorptionAndEmissivity(rho, temp, Ye, type, nu_bins[i], a, j, lambda);
+      alpha[i] = a;
+      jnu[i] = j;
+    }
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real EmissivityPerNu(const Real rho, const Real temp, const Real Ye,
+                       const RadiationType type, const Real nu,
+                       Real *lambda = nullptr) const {
+    return 4 * M_PI * EmissivityPerNuOmega(rho, temp, Ye, type, nu, lambda);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  EmissivityPerNu(const Real rho, const Real temp, const Real Ye,
+                  const RadiationType type, FrequencyIndexer &nu_bins,
+                  DataIndexer &coeffs, const int nbins,
+                  Real *lambda = nullptr) const {
+    for (int i = 0; i < nbins; ++i) {
+      coeffs[i] = EmissivityPerNu(rho, temp, Ye, type, nu_bins[i], lambda);
+    }
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real Emissivity(const Real rho, const Real temp, const Real Ye,
+                  const RadiationType type, Real *lambda = nullptr) const {
+    Real J = 0;
+    models_.forEach(
+        [&](const auto &m) { J += m.Emissivity(rho, temp, Ye, type, lambda); });
+    return J;
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real NumberEmissivity(const Real rho, const Real temp, Real Ye,
+                        RadiationType type, Real *lambda = nullptr) const {
+    Real Jn = 0;
+    models_.forEach([&](const auto &m) {
+      Jn += m.NumberEmissivity(rho, temp, Ye, type, lambda);
+    });
+    return Jn;
+  }
+
+  // The components may have tables of their own, so a LookupState is
+  // just the point, and each component finds its own cell
+  PORTABLE_INLINE_FUNCTION
+  LookupState PrepareLookup(const Real rho, const Real temp,
+                            const Real Ye) const {
+    return singularity::impl::pointState(rho, temp, Ye);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real AbsorptionCoefficient(const LookupState &s, const RadiationType type,
+                             const Real nu, Real *lambda = nullptr) const {
+    return AbsorptionCoefficient(s.rho, s.temp, s.Ye, type, nu, lambda);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  AbsorptionCoefficient(const LookupState &s, const RadiationType type,
+                        FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+                        const int nbins, Real *lambda = nullptr) const {
+    AbsorptionCoefficient(s.rho, s.temp, s.Ye, type, nu_bins, coeffs, nbins,
+                          lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real AngleAveragedAbsorptionCoefficient(const LookupState &s,
+                                          const RadiationType type,
+                                          const Real nu,
+                                          Real *lambda = nullptr) const {
+    return AngleAveragedAbsorptionCoefficient(s.rho, s.temp, s.Ye, type, nu,
+                                              lambda);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void AngleAveragedAbsorptionCoefficient(
+      const LookupState &s, const RadiationType type, FrequencyIndexer &nu_bins,
+      DataIndexer &coeffs, const int nbins, Real *lambda = nullptr) const {
+    AngleAveragedAbsorptionCoefficient(s.rho, s.temp, s.Ye, type, nu_bins,
+                                       coeffs, nbins, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real EmissivityPerNuOmega(const LookupState &s, const RadiationType type,
+                            const Real nu, Real *lambda = nullptr) const {
+    return EmissivityPerNuOmega(s.rho, s.temp, s.Ye, type, nu, lambda);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  EmissivityPerNuOmega(const LookupState &s, const RadiationType type,
+                       FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+                       const int nbins, Real *lambda = nullptr) const {
+    EmissivityPerNuOmega(s.rho, s.temp, s.Ye, type, nu_bins, coeffs, nbins,
+                         lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real EmissivityPerNu(const LookupState &s, const RadiationType type,
+                       const Real nu, Real *lambda = nullptr) const {
+    return EmissivityPerNu(s.rho, s.temp, s.Ye, type, nu, lambda);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  EmissivityPerNu(const LookupState &s, const RadiationType type,
+                  FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+                  const int nbins, Real *lambda = nullptr) const {
+    EmissivityPerNu(s.rho, s.temp, s.Ye, type, nu_bins, coeffs, nbins, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  void AbsorptionAndEmissivity(const LookupState &s, const RadiationType type,
+                               const Real nu, Real &alpha, Real &jnu,
+                               Real *lambda = nullptr) const {
+    AbsorptionAndEmissivity(s.rho, s.temp, s.Ye, type, nu, alpha, jnu, lambda);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  AbsorptionAndEmissivity(const LookupState &s, const RadiationType type,
+                          FrequencyIndexer &nu_bins, DataIndexer &alpha,
+                          DataIndexer &jnu, const int nbins,
+                          Real *lambda = nullptr) const {
+    AbsorptionAndEmissivity(s.rho, s.temp, s.Ye, type, nu_bins, alpha, jnu,
+                            nbins, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real Emissivity(const LookupState &s, const RadiationType type,
+                  Real *lambda = nullptr) const {
+    return Emissivity(s.rho, s.temp, s.Ye, type, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real NumberEmissivity(const LookupState &s, const RadiationType type,
+                        Real *lambda = nullptr) const {
+    return NumberEmissivity(s.rho, s.temp, s.Ye, type, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real ThermalDistributionOfTNu(const Real temp, const RadiationType type,
+                                const Real nu, Real *lambda = nullptr) const {
+    return dist_.ThermalDistributionOfTNu(temp, type, nu, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real DThermalDistributionOfTNuDT(const Real temp, const RadiationType type,
+                                   const Real nu,
+                                   Real *lambda = nullptr) const {
+    return dist_.DThermalDistributionOfTNuDT(temp, type, nu, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real ThermalDistributionOfT(const Real temp, const RadiationType type,
+                              Real *lambda = nullptr) const {
+    return dist_.ThermalDistributionOfT(temp, type, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION Real ThermalNumberDistributionOfT(
+      const Real temp, const RadiationType type, Real *lambda = nullptr) const {
+    return dist_.ThermalNumberDistributionOfT(temp, type, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real EnergyDensityFromTemperature(const Real temp, const RadiationType type,
+                                    Real *lambda = nullptr) const {
+    return dist_.EnergyDensityFromTemperature(temp, type, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real TemperatureFromEnergyDensity(const Real er, const RadiationType type,
+                                    Real *lambda = nullptr) const {
+    return dist_.TemperatureFromEnergyDensity(er, type, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real NumberDensityFromTemperature(const Real temp, const RadiationType type,
+                                    Real *lambda = nullptr) const {
+    return dist_.NumberDensityFromTemperature(temp, type, lambda);
+  }
+
+ private:
+  // B_nu, skipped when no Kirchhoff component contributes
+  PORTABLE_FORCEINLINE_FUNCTION
+  Real BnuIfNeeded_(const Real alphaK, const Real temp,
+                    const RadiationType type, const Real nu,
+                    Real *lambda) const {
+    return (alphaK == 0)
+               ? 0
+               : dist_.ThermalDistributionOfTNu(temp, type, nu, lambda);
+  }
+
+  singularity::impl::SumComponents<Models...> models_;
+  ThermalDistribution dist_;
+};
+
+} // namespace neutrinos
+} // namespace singularity
+
+#endif // SINGULARITY_OPAC_NEUTRINOS_SUM_OPACITY_NEUTRINOS_
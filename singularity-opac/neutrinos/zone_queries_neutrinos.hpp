@@ -0,0 +1,146 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+#ifndef SINGULARITY_OPAC_NEUTRINOS_ZONE_QUERIES_NEUTRINOS_
+#define SINGULARITY_OPAC_NEUTRINOS_ZONE_QUERIES_NEUTRINOS_
+
+#include <ports-of-call/portability.hpp>
+
+#include <singularity-opac/base/radiation_types.hpp>
+#include <singularity-opac/base/zone_loops.hpp>
+
+// What the bulk forms of the neutrino variants evaluate at each
+// zone. See singularity-opac/base/zone_loops.hpp.
+
+namespace singularity {
+namespace neutrinos {
+namespace impl {
+
+// Zone z is at rho[z], temp[z] and Ye[z], for species types[z]
+template <typename ZoneIndexer, typename TypeIndexer>
+struct ZoneArrays {
+  ZoneIndexer rho;
+  ZoneIndexer temp;
+  ZoneIndexer Ye;
+  TypeIndexer types;
+};
+template <typename ZoneIndexer, typename TypeIndexer>
+ZoneArrays<ZoneIndexer, TypeIndexer>
+zoneArrays(const ZoneIndexer &rho, const ZoneIndexer &temp,
+           const ZoneIndexer &Ye, const TypeIndexer &types) {
+  return {rho, temp, Ye, types};
+}
+
+struct AbsorptionQuery {
+  template <typename Opac, typename Zones, typename FrequencyIndexer,
+            typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION static void
+  spectrum(const Opac &opac, const Zones &zones, const int z,
+           const FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+           const int nbins) {
+    opac.AbsorptionCoefficient(zones.rho[z], zones.temp[z], zones.Ye[z],
+                               zones.types[z], nu_bins, coeffs, nbins);
+  }
+};
+
+struct EmissivityPerNuQuery {
+  template <typename Opac, typename Zones, typename FrequencyIndexer,
+            typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION static void
+  spectrum(const Opac &opac, const Zones &zones, const int z,
+           const FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+           const int nbins) {
+    opac.EmissivityPerNu(zones.rho[z], zones.temp[z], zones.Ye[z],
+                         zones.types[z], nu_bins, coeffs, nbins);
+  }
+};
+
+struct EmissivityQuery {
+  template <typename Opac, typename Zones>
+  PORTABLE_INLINE_FUNCTION static Real value(const Opac &opac,
+                                             const Zones &zones, const int z) {
+    return opac.Emissivity(zones.rho[z], zones.temp[z], zones.Ye[z],
+                           zones.types[z]);
+  }
+};
+
+struct NumberEmissivityQuery {
+  template <typename Opac, typename Zones>
+  PORTABLE_INLINE_FUNCTION static Real value(const Opac &opac,
+                                             const Zones &zones, const int z) {
+    return opac.NumberEmissivity(zones.rho[z], zones.temp[z], zones.Ye[z],
+                                 zones.types[z]);
+  }
+};
+
+struct TotalScatteringQuery {
+  template <typename Opac, typename Zones, typename FrequencyIndexer,
+            typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION static void
+  spectrum(const Opac &opac, const Zones &zones, const int z,
+           const FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+           const int nbins) {
+    for (int i = 0; i < nbins; ++i) {
+      coeffs[i] = opac.TotalScatteringCoefficient(zones.rho[z], zones.temp[z],
+                                                  zones.Ye[z], zones.types[z],
+                                                  nu_bins[i]);
+    }
+  }
+};
+
+struct PlanckMeanAbsorptionQuery {
+  template <typename Opac, typename Zones>
+  PORTABLE_INLINE_FUNCTION static Real value(const Opac &opac,
+                                             const Zones &zones, const int z) {
+    return opac.PlanckMeanAbsorptionCoefficient(zones.rho[z], zones.temp[z],
+                                                zones.Ye[z], zones.types[z]);
+  }
+};
+
+struct RosselandMeanAbsorptionQuery {
+  template <typename Opac, typename Zones>
+  PORTABLE_INLINE_FUNCTION static Real value(const Opac &opac,
+                                             const Zones &zones, const int z) {
+    return opac.RosselandMeanAbsorptionCoefficient(zones.rho[z], zones.temp[z],
+                                                   zones.Ye[z], zones.types[z]);
+  }
+};
+
+struct PlanckMeanScatteringQuery {
+  template <typename Opac, typename Zones>
+  PORTABLE_INLINE_FUNCTION static Real value(const Opac &opac,
+                                             const Zones &zones, const int z) {
+    return opac.PlanckMeanTotalScatteringCoefficient(zones.rho[z],
+                                                     zones.temp[z], zones.Ye[z],
+                                                     zones.types[z]);
+  }
+};
+
+struct RosselandMeanScatteringQuery {
+  template <typename Opac, typename Zones>
+  PORTABLE_INLINE_FUNCTION static Real value(const Opac &opac,
+                                             const Zones &zones, const int z) {
+    return opac.RosselandMeanTotalScatteringCoefficient(zones.rho[z],
+                                                        zones.temp[z],
+                                                        zones.Ye[z],
+                                                        zones.types[z]);
+  }
+};
+
+} // namespace impl
+} // namespace neutrinos
+} // namespace singularity
+
+#endif // SINGULARITY_OPAC_NEUTRINOS_ZONE_QUERIES_NEUTRINOS_
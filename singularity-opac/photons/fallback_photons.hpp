@@ -0,0 +1,72 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+#ifndef SINGULARITY_OPAC_PHOTONS_FALLBACK_PHOTONS_
+#define SINGULARITY_OPAC_PHOTONS_FALLBACK_PHOTONS_
+
+#include <utility>
+
+#include <ports-of-call/portability.hpp>
+
+namespace singularity {
+namespace photons {
+
+// Hands the points a mean opacity table doesn't cover to another
+// model. A point is covered unless it is outside the table on an axis
+// whose policy is OutOfRange::Fallback; see SetOutOfRange. Both
+// models must use the same units.
+template <typename Table, typename Fallback>
+class MeanWithFallback {
+ public:
+  MeanWithFallback() = default;
+  MeanWithFallback(Table &&table, Fallback &&fallback)
+      : table_(std::forward<Table>(table)),
+        fallback_(std::forward<Fallback>(fallback)) {}
+
+  auto GetOnDevice() {
+    return MeanWithFallback<Table, Fallback>(table_.GetOnDevice(),
+                                             fallback_.GetOnDevice());
+  }
+  inline void Finalize() noexcept {
+    table_.Finalize();
+    fallback_.Finalize();
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real PlanckMeanAbsorptionCoefficient(const Real rho, const Real temp) const {
+    if (table_.InTable(rho, temp)) {
+      return table_.PlanckMeanAbsorptionCoefficient(rho, temp);
+    }
+    return fallback_.PlanckMeanAbsorptionCoefficient(rho, temp);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real RosselandMeanAbsorptionCoefficient(const Real rho,
+                                          const Real temp) const {
+    if (table_.InTable(rho, temp)) {
+      return table_.RosselandMeanAbsorptionCoefficient(rho, temp);
+    }
+    return fallback_.RosselandMeanAbsorptionCoefficient(rho, temp);
+  }
+
+ private:
+  Table table_;
+  Fallback fallback_;
+};
+
+} // namespace photons
+} // namespace singularity
+
+#endif // SINGULARITY_OPAC_PHOTONS_FALLBACK_PHOTONS_
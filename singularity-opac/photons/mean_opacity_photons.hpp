@@ -16,18 +16,34 @@
 #ifndef SINGULARITY_OPAC_PHOTONS_MEAN_OPACITY_PHOTONS_
 #define SINGULARITY_OPAC_PHOTONS_MEAN_OPACITY_PHOTONS_
 
+#include <algorithm>
 #include <cmath>
+#include <vector>
 
+#include <fast-math/logs.hpp>
 #include <ports-of-call/portability.hpp>
+#include <singularity-opac/base/host_parallel.hpp>
+#include <singularity-opac/base/lookup_state.hpp>
+#include <singularity-opac/base/mapped_tables.hpp>
+#include <singularity-opac/base/mean_quadrature.hpp>
 #include <singularity-opac/base/radiation_types.hpp>
 #include <singularity-opac/base/robust_utils.hpp>
 #include <singularity-opac/base/sp5.hpp>
+#include <singularity-opac/base/table_grid.hpp>
+#include <singularity-opac/base/table_storage.hpp>
+#include <singularity-opac/base/unit_system.hpp>
 #include <singularity-opac/constants/constants.hpp>
 #include <spiner/databox.hpp>
 
+#include <singularity-opac/photons/fallback_photons.hpp>
 #include <singularity-opac/photons/mean_photon_variant.hpp>
 #include <singularity-opac/photons/non_cgs_photons.hpp>
 
+// Tables are CGS in files and in memory, unless a file is loaded in
+// other units. That bakes the conversion MeanNonCGSUnits would make
+// into the tables, so lookups in those units cost what lookups in CGS
+// do. Tables loaded this way can't be saved.
+
 namespace singularity {
 namespace photons {
 namespace impl {
@@ -42,44 +58,99 @@ class MeanOpacity {
 
  public:
   MeanOpacity() = default;
+  // The tables are filled on nthreads host threads, one by default
+  // and all cores if nthreads <= 0. With more than one, opac must
+  // be safe to call concurrently. The tables don't depend on how many.
   template <typename Opacity>
   MeanOpacity(const Opacity &opac, const Real lRhoMin, const Real lRhoMax,
               const int NRho, const Real lTMin, const Real lTMax, const int NT,
-              Real *lambda = nullptr) {
+              Real *lambda = nullptr,
+              TablePrecision precision = TablePrecision::Double,
+              const int nthreads = 1) {
     MeanOpacityImpl_<Opacity, true>(opac, lRhoMin, lRhoMax, NRho, lTMin, lTMax,
-                                    NT, -1., -1., 100, lambda);
+                                    NT, -1., -1., MeanQuadrature(), lambda,
+                                    nthreads);
+    setPrecision_(precision);
   }
 
+  // Integrates over frequency with quadrature. Trapezoid points span
+  // the range the constructor above chooses.
   template <typename Opacity>
   MeanOpacity(const Opacity &opac, const Real lRhoMin, const Real lRhoMax,
               const int NRho, const Real lTMin, const Real lTMax, const int NT,
-              Real lNuMin, Real lNuMax, const int NNu, Real *lambda = nullptr) {
+              const MeanQuadrature &quadrature, Real *lambda = nullptr,
+              TablePrecision precision = TablePrecision::Double,
+              const int nthreads = 1) {
+    MeanOpacityImpl_<Opacity, true>(opac, lRhoMin, lRhoMax, NRho, lTMin, lTMax,
+                                    NT, -1., -1., quadrature, lambda,
+                                    nthreads);
+    setPrecision_(precision);
+  }
+
+  template <typename Opacity>
+  MeanOpacity(const Opacity &opac, const Real lRhoMin, const Real lRhoMax,
+              const int NRho, const Real lTMin, const Real lTMax, const int NT,
+              Real lNuMin, Real lNuMax, const int NNu, Real *lambda = nullptr,
+              TablePrecision precision = TablePrecision::Double,
+              const int nthreads = 1) {
     MeanOpacityImpl_<Opacity, false>(opac, lRhoMin, lRhoMax, NRho, lTMin, lTMax,
-                                     NT, lNuMin, lNuMax, NNu, lambda);
+                                     NT, lNuMin, lNuMax,
+                                     {QuadratureRule::Trapezoid, NNu}, lambda,
+                                     nthreads);
+    setPrecision_(precision);
   }
 
 #ifdef SPINER_USE_HDF
-  MeanOpacity(const std::string &filename) : filename_(filename.c_str()) {
+  // Files hold double or quantized tables. Either is decoded on load
+  // and converted to precision.
+  MeanOpacity(const std::string &filename,
+              TablePrecision precision = TablePrecision::Double)
+      : MeanOpacity(filename, UnitSystem(), precision) {}
+
+  // Loads filename in units, as described at the top of the file
+  MeanOpacity(const std::string &filename, const UnitSystem &units,
+              TablePrecision precision = TablePrecision::Double)
+      : filename_(filename.c_str()) {
     herr_t status = H5_SUCCESS;
     hid_t file = H5Fopen(filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
-    status += lkappaPlanck_.loadHDF(file, SP5::MeanOpac::PlanckMeanOpacity);
-    status +=
-        lkappaRosseland_.loadHDF(file, SP5::MeanOpac::RosselandMeanOpacity);
+    status += singularity::impl::loadHDFTable(
+        file, SP5::MeanOpac::PlanckMeanOpacity, lkappaPlanck_);
+    status += singularity::impl::loadHDFTable(
+        file, SP5::MeanOpac::RosselandMeanOpacity, lkappaRosseland_);
+    const TableEncoding encoding = singularity::impl::loadEncoding(file);
     status += H5Fclose(file);
 
     if (status != H5_SUCCESS) {
       OPAC_ERROR("photons::MeanOpacity: HDF5 error\n");
     }
+    if (encoding == TableEncoding::Log10) {
+      singularity::impl::log10ToLog2(lkappaPlanck_, {0, 1});
+      singularity::impl::log10ToLog2(lkappaRosseland_, {0, 1});
+    }
+    bakeUnits_(units);
+    setPrecision_(precision);
   }
 
   void Save(const std::string &filename) const {
+    requireCGS_();
+    Spiner::DataBox lkappaPlanck = lkappaPlanck_;
+    Spiner::DataBox lkappaRosseland = lkappaRosseland_;
+    if (precision_ != TablePrecision::Double) {
+      widen_(PLANCK, lkappaPlanck);
+      widen_(ROSSELAND, lkappaRosseland);
+    }
     herr_t status = H5_SUCCESS;
     hid_t file =
         H5Fcreate(filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
-    status += lkappaPlanck_.saveHDF(file, SP5::MeanOpac::PlanckMeanOpacity);
+    status += lkappaPlanck.saveHDF(file, SP5::MeanOpac::PlanckMeanOpacity);
     status +=
-        lkappaRosseland_.saveHDF(file, SP5::MeanOpac::RosselandMeanOpacity);
+        lkappaRosseland.saveHDF(file, SP5::MeanOpac::RosselandMeanOpacity);
+    status += singularity::impl::saveEncoding(file, TableEncoding::Log2);
     status += H5Fclose(file);
+    if (precision_ != TablePrecision::Double) {
+      lkappaPlanck.finalize();
+      lkappaRosseland.finalize();
+    }
 
     if (status != H5_SUCCESS) {
       OPAC_ERROR("photons::MeanOpacity: HDF5 error\n");
@@ -87,35 +158,134 @@ class MeanOpacity {
   }
 #endif
 
+#ifdef SINGULARITY_USE_MMAP
+  // Maps a file written by SaveRaw. At double precision the mapped
+  // tables are used in place, without reading or copying them.
+  MeanOpacity(const std::string &filename, RawFormat,
+              TablePrecision precision = TablePrecision::Double)
+      : filename_(filename.c_str()) {
+    mapped_.open(filename);
+    fromMapped_(precision);
+  }
+
+  // Attaches to a shared memory segment created by SaveShared. Only
+  // double precision tables are shared; others are private.
+  MeanOpacity(const std::string &name, SharedMemory,
+              TablePrecision precision = TablePrecision::Double)
+      : filename_(name.c_str()) {
+    mapped_.attachShared(name);
+    fromMapped_(precision);
+  }
+#endif
+
+#if defined(SINGULARITY_USE_MPI) && defined(SPINER_USE_HDF)
+  // Collective over comm. The first rank on each node loads filename
+  // and shares the tables with the other ranks on the node through
+  // an MPI shared window. Finalize is collective as well. If the
+  // first rank can't load the file, every rank on the node fails.
+  MeanOpacity(const std::string &filename, MPI_Comm comm,
+              TablePrecision precision = TablePrecision::Double)
+      : filename_(filename.c_str()) {
+    MPI_Comm node;
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node);
+    mapped_.shareOnNode(node, TableEncoding::Log2, [&](const auto &share) {
+      MeanOpacity loaded(filename);
+      loaded.withRawTables_(share);
+      loaded.Finalize();
+    });
+    fromMapped_(precision);
+  }
+#endif
+
+  void SaveRaw(const std::string &filename) const {
+    withRawTables_([&](const singularity::impl::RawTableWriter &w) {
+      w.write(filename, TableEncoding::Log2);
+    });
+  }
+
+#ifdef SINGULARITY_USE_MMAP
+  // Copies the tables into a new POSIX shared memory segment. Other
+  // processes on the node may attach to it once this returns; remove
+  // it with RemoveSharedTables once they have.
+  void SaveShared(const std::string &name) const {
+    withRawTables_([&](const singularity::impl::RawTableWriter &w) {
+      singularity::impl::createSharedTables(name, w, TableEncoding::Log2);
+    });
+  }
+#endif
+
+  // Sets what lookups do outside the table on the rho and T axes,
+  // which by default is to extrapolate. Set it on host, before
+  // GetOnDevice.
+  void SetOutOfRange(const OutOfRangePolicy &policy) {
+    bounds_.Rho = singularity::impl::AxisBounds(policy.rho, grids_.Rho.min(),
+                                                grids_.Rho.max());
+    bounds_.T = singularity::impl::AxisBounds(policy.T, grids_.T.min(),
+                                              grids_.T.max());
+  }
+
+  // Whether a point is inside the table on every axis whose policy is
+  // OutOfRange::Fallback
+  PORTABLE_INLINE_FUNCTION bool InTable(const Real rho, const Real temp) const {
+    return bounds_.Rho.covers(toLog_(rho)) && bounds_.T.covers(toLog_(temp));
+  }
+
   PORTABLE_INLINE_FUNCTION void PrintParams() const {
     printf("Mean opacity\n");
   }
 
   MeanOpacity GetOnDevice() {
     MeanOpacity other;
-    other.lkappaPlanck_ = Spiner::getOnDeviceDataBox(lkappaPlanck_);
-    other.lkappaRosseland_ = Spiner::getOnDeviceDataBox(lkappaRosseland_);
+    if (precision_ != TablePrecision::Double) {
+      other.lkappa_ = lkappa_.getOnDevice();
+      other.qkappa_ = qkappa_.getOnDevice();
+    } else {
+      other.lkappaPlanck_ = Spiner::getOnDeviceDataBox(lkappaPlanck_);
+      other.lkappaRosseland_ = Spiner::getOnDeviceDataBox(lkappaRosseland_);
+    }
+    other.grids_ = grids_;
+    other.bounds_ = bounds_;
+    other.precision_ = precision_;
+    other.units_ = units_;
     return other;
   }
 
   void Finalize() {
     lkappaPlanck_.finalize();
     lkappaRosseland_.finalize();
+    lkappa_.finalize();
+    qkappa_.finalize();
+    mapped_.close();
+  }
+
+  // The cell of (rho, temp), for the forms of the queries below that
+  // take a LookupState
+  PORTABLE_INLINE_FUNCTION
+  LookupState PrepareLookup(const Real rho, const Real temp) const {
+    LookupState s = singularity::impl::pointState(rho, temp, 0);
+    singularity::impl::locate(grids_.Rho, bounds_.Rho(toLog_(rho)), s.iRho,
+                              s.wRho);
+    singularity::impl::locate(grids_.T, bounds_.T(toLog_(temp)), s.iT, s.wT);
+    return s;
   }
 
   PORTABLE_INLINE_FUNCTION
   Real PlanckMeanAbsorptionCoefficient(const Real rho, const Real temp) const {
-    Real lRho = toLog_(rho);
-    Real lT = toLog_(temp);
-    return rho * fromLog_(lkappaPlanck_.interpToReal(lRho, lT));
+    return PlanckMeanAbsorptionCoefficient(PrepareLookup(rho, temp));
+  }
+  PORTABLE_INLINE_FUNCTION
+  Real PlanckMeanAbsorptionCoefficient(const LookupState &s) const {
+    return s.rho * fromLog_(interp_(PLANCK, s));
   }
 
   PORTABLE_INLINE_FUNCTION
   Real RosselandMeanAbsorptionCoefficient(const Real rho,
                                           const Real temp) const {
-    Real lRho = toLog_(rho);
-    Real lT = toLog_(temp);
-    return rho * fromLog_(lkappaRosseland_.interpToReal(lRho, lT));
+    return RosselandMeanAbsorptionCoefficient(PrepareLookup(rho, temp));
+  }
+  PORTABLE_INLINE_FUNCTION
+  Real RosselandMeanAbsorptionCoefficient(const LookupState &s) const {
+    return s.rho * fromLog_(interp_(ROSSELAND, s));
   }
 
  private:
@@ -123,71 +293,225 @@ class MeanOpacity {
   void MeanOpacityImpl_(const Opacity &opac, const Real lRhoMin,
                         const Real lRhoMax, const int NRho, const Real lTMin,
                         const Real lTMax, const int NT, Real lNuMin,
-                        Real lNuMax, const int NNu, Real *lambda = nullptr) {
+                        Real lNuMax, const MeanQuadrature &quadrature,
+                        Real *lambda, const int nthreads) {
     lkappaPlanck_.resize(NRho, NT);
-    lkappaPlanck_.setRange(0, lTMin, lTMax, NT);
-    lkappaPlanck_.setRange(1, lRhoMin, lRhoMax, NRho);
+    // Bounds are given in log10, but the tables are stored in log2
+    constexpr Real LOG2_10 = singularity::impl::LOG2_10;
+    lkappaPlanck_.setRange(0, LOG2_10 * lTMin, LOG2_10 * lTMax, NT);
+    lkappaPlanck_.setRange(1, LOG2_10 * lRhoMin, LOG2_10 * lRhoMax,
+                           NRho);
+    lNuMin *= LOG2_10;
+    lNuMax *= LOG2_10;
+    const Real TMin = fromLog_(lkappaPlanck_.range(0).min());
+    const Real TMax = fromLog_(lkappaPlanck_.range(0).max());
     lkappaRosseland_.copyMetadata(lkappaPlanck_);
 
-    // Fill tables
-    for (int iRho = 0; iRho < NRho; ++iRho) {
-      Real lRho = lkappaPlanck_.range(1).x(iRho);
-      Real rho = fromLog_(lRho);
-      for (int iT = 0; iT < NT; ++iT) {
-        Real lT = lkappaPlanck_.range(0).x(iT);
-        Real T = fromLog_(lT);
-        Real kappaPlanckNum = 0.;
-        Real kappaPlanckDenom = 0.;
-        Real kappaRosselandNum = 0.;
-        Real kappaRosselandDenom = 0.;
-        if (AUTOFREQ) {
-          lNuMin = toLog_(1.e-3 * pc::kb * fromLog_(lTMin) / pc::h);
-          lNuMax = toLog_(1.e3 * pc::kb * fromLog_(lTMax) / pc::h);
-        }
-        const Real dlnu = (lNuMax - lNuMin) / (NNu - 1);
-        // Integrate over frequency
-        for (int inu = 0; inu < NNu; ++inu) {
-          const Real weight =
-              (inu == 0 || inu == NNu - 1) ? 0.5 : 1.; // Trapezoidal rule
-          const Real lnu = lNuMin + inu * dlnu;
-          const Real nu = fromLog_(lnu);
-          const Real alpha = opac.AbsorptionCoefficient(rho, T, nu, lambda);
-          const Real B = opac.ThermalDistributionOfTNu(T, nu);
-          const Real dBdT = opac.DThermalDistributionOfTNuDT(T, nu);
-          kappaPlanckNum += weight * alpha / rho * B * nu * dlnu;
-          kappaPlanckDenom += weight * B * nu * dlnu;
-
-          if (alpha > singularity_opac::robust::SMALL()) {
-            kappaRosselandNum += weight *
-                                 singularity_opac::robust::ratio(rho, alpha) *
-                                 dBdT * nu * dlnu;
-            kappaRosselandDenom += weight * dBdT * nu * dlnu;
-          }
-        }
-
-        Real kappaPlanck =
-            singularity_opac::robust::ratio(kappaPlanckNum, kappaPlanckDenom);
-        Real kappaRosseland = kappaPlanck > singularity_opac::robust::SMALL()
-                                  ? singularity_opac::robust::ratio(
-                                        kappaRosselandDenom, kappaRosselandNum)
-                                  : 0.;
-        lkappaPlanck_(iRho, iT) = toLog_(kappaPlanck);
-        lkappaRosseland_(iRho, iT) = toLog_(kappaRosseland);
-        if (std::isnan(lkappaPlanck_(iRho, iT)) ||
-            std::isnan(lkappaRosseland_(iRho, iT))) {
-          OPAC_ERROR("photons::MeanOpacity: NAN in opacity evaluations");
-        }
-      }
+    if (AUTOFREQ) {
+      lNuMin =
+          toLog_(singularity::impl::THERMAL_NU_LOW * pc::kb * TMin / pc::h);
+      lNuMax =
+          toLog_(singularity::impl::THERMAL_NU_HIGH * pc::kb * TMax / pc::h);
     }
+    const singularity::impl::FrequencyQuadrature frequencies(
+        quadrature, fromLog_(lNuMin), fromLog_(lNuMax));
+
+    // The thermal spectra depend only on T, so with fixed rules they
+    // are filled once per temperature, at the nodes integrate uses, B
+    // first and then dB/dT. GaussKronrod nodes follow the integrands,
+    // so it evaluates them where it needs them.
+    std::vector<std::vector<Real>> thermal(NT);
+    singularity::impl::hostParallelFor(NT, nthreads, [&](const int iT) {
+      const Real T = fromLog_(lkappaPlanck_.range(0).x(iT));
+      const std::vector<Real> nu = frequencies.nodes(pc::kb * T / pc::h);
+      const int n = nu.size();
+      thermal[iT].resize(2 * n);
+      for (int inu = 0; inu < n; ++inu) {
+        thermal[iT][inu] = opac.ThermalDistributionOfTNu(T, nu[inu]);
+        thermal[iT][n + inu] = opac.DThermalDistributionOfTNuDT(T, nu[inu]);
+      }
+    });
+
+    // Fill tables. Each (rho, T) node is independent, so they are
+    // spread over host threads, and the absorption coefficients at
+    // every frequency of a rule come from batched calls.
+    singularity::impl::hostParallelFor(NRho * NT, nthreads, [&](const int i) {
+      const int iRho = i / NT;
+      const int iT = i % NT;
+      const Real rho = fromLog_(lkappaPlanck_.range(1).x(iRho));
+      const Real T = fromLog_(lkappaPlanck_.range(0).x(iT));
+      const singularity::impl::MeanSums sums = frequencies.integrate(
+          rho, pc::kb * T / pc::h,
+          [&](const Real *nu, const int n, Real *alpha, Real *B, Real *dBdT) {
+            opac.AbsorptionCoefficient(rho, T, nu, alpha, n, lambda);
+            if (!thermal[iT].empty()) {
+              std::copy(thermal[iT].begin(), thermal[iT].begin() + n, B);
+              std::copy(thermal[iT].begin() + n, thermal[iT].end(), dBdT);
+              return;
+            }
+            for (int inu = 0; inu < n; ++inu) {
+              B[inu] = opac.ThermalDistributionOfTNu(T, nu[inu]);
+              dBdT[inu] = opac.DThermalDistributionOfTNuDT(T, nu[inu]);
+            }
+          });
+      const Real kappaPlanck = sums.Planck();
+      const Real kappaRosseland = sums.Rosseland();
+      lkappaPlanck_(iRho, iT) = toLog_(kappaPlanck);
+      lkappaRosseland_(iRho, iT) = toLog_(kappaRosseland);
+      if (std::isnan(lkappaPlanck_(iRho, iT)) ||
+          std::isnan(lkappaRosseland_(iRho, iT))) {
+        OPAC_ERROR("photons::MeanOpacity: NAN in opacity evaluations");
+      }
+    });
   }
   PORTABLE_INLINE_FUNCTION Real toLog_(const Real x) const {
-    return std::log10(std::abs(x) + EPS);
+    return BDMath::log2(std::abs(x) + EPS);
   }
   PORTABLE_INLINE_FUNCTION Real fromLog_(const Real lx) const {
-    return std::pow(10., lx);
+    return BDMath::exp2(lx);
   }
+  PORTABLE_INLINE_FUNCTION Real interp_(const int q,
+                                        const LookupState &s) const {
+    const std::size_t NT = grids_.T.nPoints();
+    if (precision_ == TablePrecision::Float) {
+      const float *data = lkappa_.data<float>() + q * grids_.size();
+      return singularity::impl::interp2D(data, NT, s);
+    }
+    if (precision_ == TablePrecision::Quantized) {
+      return singularity::impl::interp2D(qkappa_.table(q), NT, s);
+    }
+    const Spiner::DataBox &db =
+        (q == PLANCK) ? lkappaPlanck_ : lkappaRosseland_;
+    return singularity::impl::interp2D(&db(0, 0), NT, s);
+  }
+  void fromMapped_(const TablePrecision precision) {
+    if (mapped_.encoding() != TableEncoding::Log2) {
+      mapped_.close();
+      OPAC_ERROR("photons::MeanOpacity: raw tables must be log2\n");
+    }
+    lkappaPlanck_ = mapped_.get(SP5::MeanOpac::PlanckMeanOpacity);
+    lkappaRosseland_ = mapped_.get(SP5::MeanOpac::RosselandMeanOpacity);
+    setPrecision_(precision);
+    // Reduced precision tables are copies, so the mapping is no
+    // longer needed
+    if (precision != TablePrecision::Double) {
+      mapped_.close();
+    }
+  }
+  // Calls f with a writer holding the tables at double precision
+  template <typename Function>
+  void withRawTables_(const Function &f) const {
+    requireCGS_();
+    Spiner::DataBox lkappaPlanck = lkappaPlanck_;
+    Spiner::DataBox lkappaRosseland = lkappaRosseland_;
+    if (precision_ != TablePrecision::Double) {
+      widen_(PLANCK, lkappaPlanck);
+      widen_(ROSSELAND, lkappaRosseland);
+    }
+    singularity::impl::RawTableWriter writer;
+    writer.add(SP5::MeanOpac::PlanckMeanOpacity, lkappaPlanck);
+    writer.add(SP5::MeanOpac::RosselandMeanOpacity, lkappaRosseland);
+    f(writer);
+    if (precision_ != TablePrecision::Double) {
+      lkappaPlanck.finalize();
+      lkappaRosseland.finalize();
+    }
+  }
+  // Lookups multiply kappa by rho, so the tables shift by the log of
+  // the conversion of rho kappa
+  void bakeUnits_(const UnitSystem &units) {
+    units_ = units;
+    if (units.IsCGS()) {
+      return;
+    }
+    const Real lkappa = std::log2(units.mass / (units.length * units.length));
+    const Real lT = -std::log2(units.temp);
+    const Real lRho = -std::log2(units.Density());
+    singularity::impl::shiftLog2(lkappaPlanck_, lkappa,
+                                 {{0, lT}, {1, lRho}});
+    singularity::impl::shiftLog2(lkappaRosseland_, lkappa,
+                                 {{0, lT}, {1, lRho}});
+  }
+  // Files and raw tables are CGS
+  void requireCGS_() const {
+    if (!units_.IsCGS()) {
+      OPAC_ERROR("photons::MeanOpacity: tables loaded in other units can't be "
+                 "saved\n");
+    }
+  }
+  // Converts the tables to the requested precision, releasing the
+  // double tables if they are no longer needed.
+  void setPrecision_(const TablePrecision precision) {
+    grids_.Rho = lkappaPlanck_.range(1);
+    grids_.T = lkappaPlanck_.range(0);
+    precision_ = precision;
+    if (precision == TablePrecision::Double) {
+      return;
+    }
+    const std::size_t N = grids_.size();
+    const Real *planck = &lkappaPlanck_(0, 0);
+    const Real *rosseland = &lkappaRosseland_(0, 0);
+    if (precision == TablePrecision::Quantized) {
+      qkappa_.allocate(N, 2);
+      qkappa_.encode(PLANCK, planck);
+      qkappa_.encode(ROSSELAND, rosseland);
+    } else {
+      lkappa_.allocate(2 * N * sizeof(float));
+      float *data = lkappa_.data<float>();
+      for (std::size_t i = 0; i < N; ++i) {
+        data[PLANCK * N + i] = static_cast<float>(planck[i]);
+        data[ROSSELAND * N + i] = static_cast<float>(rosseland[i]);
+      }
+    }
+    lkappaPlanck_.finalize();
+    lkappaRosseland_.finalize();
+    lkappaPlanck_ = Spiner::DataBox();
+    lkappaRosseland_ = Spiner::DataBox();
+  }
+  // Copies reduced precision table q into a new double table on host.
+  // The caller is responsible for freeing it.
+  void widen_(const int q, Spiner::DataBox &db) const {
+    db = Spiner::DataBox();
+    db.resize(grids_.Rho.nPoints(), grids_.T.nPoints());
+    db.setRange(0, grids_.T.min(), grids_.T.max(), grids_.T.nPoints());
+    db.setRange(1, grids_.Rho.min(), grids_.Rho.max(), grids_.Rho.nPoints());
+    const std::size_t N = grids_.size();
+    Real *out = &db(0, 0);
+    if (precision_ == TablePrecision::Quantized) {
+      const singularity::impl::QuantizedPtr data = qkappa_.table(q);
+      for (std::size_t i = 0; i < N; ++i) {
+        out[i] = data[i];
+      }
+      return;
+    }
+    const float *data = lkappa_.data<float>() + q * N;
+    for (std::size_t i = 0; i < N; ++i) {
+      out[i] = data[i];
+    }
+  }
+  struct Grids {
+    Spiner::RegularGrid1D Rho, T;
+    PORTABLE_INLINE_FUNCTION std::size_t size() const {
+      return static_cast<std::size_t>(Rho.nPoints()) * T.nPoints();
+    }
+  };
+  struct Bounds {
+    singularity::impl::AxisBounds Rho, T;
+  };
+  enum { PLANCK = 0, ROSSELAND = 1 };
   Spiner::DataBox lkappaPlanck_;
   Spiner::DataBox lkappaRosseland_;
+  // both tables as floats, with TablePrecision::Float
+  singularity::impl::AlignedStorage lkappa_;
+  // both tables with TablePrecision::Quantized
+  singularity::impl::QuantizedStorage qkappa_;
+  Grids grids_;
+  Bounds bounds_;
+  TablePrecision precision_ = TablePrecision::Double;
+  // Units of the tables, CGS unless loaded in others
+  UnitSystem units_;
+  // raw file the tables are mapped from, if any
+  singularity::impl::MappedTables mapped_;
   const char *filename_;
 };
 
@@ -19,10 +19,12 @@
 #include <utility>
 
 #include <ports-of-call/portability.hpp>
+#include <singularity-opac/base/lookup_state.hpp>
 #include <singularity-opac/base/opac_error.hpp>
+#include <singularity-opac/base/opac_variant.hpp>
 #include <singularity-opac/base/radiation_types.hpp>
 #include <singularity-opac/photons/photon_s_variant.hpp>
-#include <variant/include/mpark/variant.hpp>
+#include <singularity-opac/photons/zone_queries_photons.hpp>
 
 namespace singularity {
 namespace photons {
@@ -60,11 +62,11 @@ class MeanSVariant {
           !std::is_same<MeanSVariant, typename std::decay<Choice>::type>::value,
           bool>::type = true>
   Choice get() {
-    return mpark::get<Choice>(s_opac_);
+    return singularity::impl::get<Choice>(s_opac_);
   }
 
   MeanSVariant GetOnDevice() {
-    return mpark::visit(
+    return singularity::impl::visit(
         [](auto &s_opac) {
           return s_opac_variant<SOpacs...>(s_opac.GetOnDevice());
         },
@@ -73,7 +75,7 @@ class MeanSVariant {
 
   PORTABLE_INLINE_FUNCTION Real
   PlanckMeanTotalScatteringCoefficient(const Real rho, const Real temp) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &s_opac) {
           return s_opac.PlanckMeanTotalScatteringCoefficient(rho, temp);
         },
@@ -81,16 +83,63 @@ class MeanSVariant {
   }
   PORTABLE_INLINE_FUNCTION Real RosselandMeanTotalScatteringCoefficient(
       const Real rho, const Real temp) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &s_opac) {
           return s_opac.RosselandMeanTotalScatteringCoefficient(rho, temp);
         },
         s_opac_);
   }
 
+  PORTABLE_INLINE_FUNCTION LookupState PrepareLookup(const Real rho,
+                                                     const Real temp) const {
+    return singularity::impl::visit(
+        [=](const auto &s_opac) { return s_opac.PrepareLookup(rho, temp); },
+        s_opac_);
+  }
+  PORTABLE_INLINE_FUNCTION Real
+  PlanckMeanTotalScatteringCoefficient(const LookupState &s) const {
+    return singularity::impl::visit(
+        [&](const auto &s_opac) {
+          return s_opac.PlanckMeanTotalScatteringCoefficient(s);
+        },
+        s_opac_);
+  }
+  PORTABLE_INLINE_FUNCTION Real
+  RosselandMeanTotalScatteringCoefficient(const LookupState &s) const {
+    return singularity::impl::visit(
+        [&](const auto &s_opac) {
+          return s_opac.RosselandMeanTotalScatteringCoefficient(s);
+        },
+        s_opac_);
+  }
+
+  // Bulk forms, for nzones zones at once, as for the bulk forms of
+  // Variant. values[z] is the mean of zone z.
+  template <typename ZoneIndexer, typename DataIndexer>
+  void BulkPlanckMeanTotalScatteringCoefficient(const int nzones,
+                                                const ZoneIndexer &rho,
+                                                const ZoneIndexer &temp,
+                                                const DataIndexer &values,
+                                                const int nthreads = 1) const {
+    singularity::impl::visitZones(
+        s_opac_, nzones, nthreads,
+        singularity::impl::zoneValues<PlanckMeanScatteringQuery>(
+            zoneArrays(rho, temp), values));
+  }
+
+  template <typename ZoneIndexer, typename DataIndexer>
+  void BulkRosselandMeanTotalScatteringCoefficient(
+      const int nzones, const ZoneIndexer &rho, const ZoneIndexer &temp,
+      const DataIndexer &values, const int nthreads = 1) const {
+    singularity::impl::visitZones(
+        s_opac_, nzones, nthreads,
+        singularity::impl::zoneValues<RosselandMeanScatteringQuery>(
+            zoneArrays(rho, temp), values));
+  }
+
   inline void Finalize() noexcept {
-    return mpark::visit([](auto &s_opac) { return s_opac.Finalize(); },
-                        s_opac_);
+    return singularity::impl::visit(
+        [](auto &s_opac) { return s_opac.Finalize(); }, s_opac_);
   }
 };
 
@@ -19,10 +19,12 @@
 #include <utility>
 
 #include <ports-of-call/portability.hpp>
+#include <singularity-opac/base/lookup_state.hpp>
 #include <singularity-opac/base/opac_error.hpp>
+#include <singularity-opac/base/opac_variant.hpp>
 #include <singularity-opac/base/radiation_types.hpp>
 #include <singularity-opac/photons/photon_variant.hpp>
-#include <variant/include/mpark/variant.hpp>
+#include <singularity-opac/photons/zone_queries_photons.hpp>
 
 namespace singularity {
 namespace photons {
@@ -60,18 +62,18 @@ class MeanVariant {
           !std::is_same<MeanVariant, typename std::decay<Choice>::type>::value,
           bool>::type = true>
   Choice get() {
-    return mpark::get<Choice>(opac_);
+    return singularity::impl::get<Choice>(opac_);
   }
 
   MeanVariant GetOnDevice() {
-    return mpark::visit(
+    return singularity::impl::visit(
         [](auto &opac) { return opac_variant<Opacs...>(opac.GetOnDevice()); },
         opac_);
   }
 
   PORTABLE_INLINE_FUNCTION Real
   PlanckMeanAbsorptionCoefficient(const Real rho, const Real temp) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.PlanckMeanAbsorptionCoefficient(rho, temp);
         },
@@ -79,15 +81,65 @@ class MeanVariant {
   }
   PORTABLE_INLINE_FUNCTION Real
   RosselandMeanAbsorptionCoefficient(const Real rho, const Real temp) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.RosselandMeanAbsorptionCoefficient(rho, temp);
         },
         opac_);
   }
 
+  PORTABLE_INLINE_FUNCTION LookupState PrepareLookup(const Real rho,
+                                                     const Real temp) const {
+    return singularity::impl::visit(
+        [=](const auto &opac) { return opac.PrepareLookup(rho, temp); },
+        opac_);
+  }
+  PORTABLE_INLINE_FUNCTION Real
+  PlanckMeanAbsorptionCoefficient(const LookupState &s) const {
+    return singularity::impl::visit(
+        [&](const auto &opac) {
+          return opac.PlanckMeanAbsorptionCoefficient(s);
+        },
+        opac_);
+  }
+  PORTABLE_INLINE_FUNCTION Real
+  RosselandMeanAbsorptionCoefficient(const LookupState &s) const {
+    return singularity::impl::visit(
+        [&](const auto &opac) {
+          return opac.RosselandMeanAbsorptionCoefficient(s);
+        },
+        opac_);
+  }
+
+  // Bulk forms, for nzones zones at once, as for the bulk forms of
+  // Variant. values[z] is the mean of zone z.
+  template <typename ZoneIndexer, typename DataIndexer>
+  void BulkPlanckMeanAbsorptionCoefficient(const int nzones,
+                                           const ZoneIndexer &rho,
+                                           const ZoneIndexer &temp,
+                                           const DataIndexer &values,
+                                           const int nthreads = 1) const {
+    singularity::impl::visitZones(
+        opac_, nzones, nthreads,
+        singularity::impl::zoneValues<PlanckMeanAbsorptionQuery>(
+            zoneArrays(rho, temp), values));
+  }
+
+  template <typename ZoneIndexer, typename DataIndexer>
+  void BulkRosselandMeanAbsorptionCoefficient(const int nzones,
+                                              const ZoneIndexer &rho,
+                                              const ZoneIndexer &temp,
+                                              const DataIndexer &values,
+                                              const int nthreads = 1) const {
+    singularity::impl::visitZones(
+        opac_, nzones, nthreads,
+        singularity::impl::zoneValues<RosselandMeanAbsorptionQuery>(
+            zoneArrays(rho, temp), values));
+  }
+
   inline void Finalize() noexcept {
-    return mpark::visit([](auto &opac) { return opac.Finalize(); }, opac_);
+    return singularity::impl::visit(
+        [](auto &opac) { return opac.Finalize(); }, opac_);
   }
 };
 
@@ -17,11 +17,18 @@
 #define SINGULARITY_OPAC_PHOTONS_MEAN_S_OPACITY_PHOTONS_
 
 #include <cmath>
+#include <vector>
 
+#include <fast-math/logs.hpp>
 #include <ports-of-call/portability.hpp>
+#include <singularity-opac/base/host_parallel.hpp>
+#include <singularity-opac/base/lookup_state.hpp>
+#include <singularity-opac/base/mapped_tables.hpp>
+#include <singularity-opac/base/mean_quadrature.hpp>
 #include <singularity-opac/base/radiation_types.hpp>
 #include <singularity-opac/base/robust_utils.hpp>
 #include <singularity-opac/base/sp5.hpp>
+#include <singularity-opac/base/table_storage.hpp>
 #include <singularity-opac/constants/constants.hpp>
 #include <spiner/databox.hpp>
 
@@ -43,45 +50,86 @@ class MeanSOpacity {
 
  public:
   MeanSOpacity() = default;
+  // The tables are filled on nthreads host threads, one by default
+  // and all cores if nthreads <= 0. With more than one, s_opac must
+  // be safe to call concurrently. The tables don't depend on how many.
   template <typename SOpacity>
   MeanSOpacity(const SOpacity &s_opac, const Real lRhoMin, const Real lRhoMax,
                const int NRho, const Real lTMin, const Real lTMax, const int NT,
-               Real *lambda = nullptr) {
+               Real *lambda = nullptr,
+               TablePrecision precision = TablePrecision::Double,
+               const int nthreads = 1) {
     MeanSOpacityImpl_<SOpacity, true>(s_opac, lRhoMin, lRhoMax, NRho, lTMin,
-                                      lTMax, NT, -1., -1., 100, lambda);
+                                      lTMax, NT, -1., -1., MeanQuadrature(),
+                                      lambda, nthreads);
+    setPrecision_(precision);
   }
 
+  // Integrates over frequency with quadrature, as MeanOpacity does.
+  // Trapezoid points span the range the constructor above chooses.
   template <typename SOpacity>
   MeanSOpacity(const SOpacity &s_opac, const Real lRhoMin, const Real lRhoMax,
                const int NRho, const Real lTMin, const Real lTMax, const int NT,
-               Real lNuMin, Real lNuMax, const int NNu,
-               Real *lambda = nullptr) {
+               const MeanQuadrature &quadrature, Real *lambda = nullptr,
+               TablePrecision precision = TablePrecision::Double,
+               const int nthreads = 1) {
+    MeanSOpacityImpl_<SOpacity, true>(s_opac, lRhoMin, lRhoMax, NRho, lTMin,
+                                      lTMax, NT, -1., -1., quadrature, lambda,
+                                      nthreads);
+    setPrecision_(precision);
+  }
+
+  template <typename SOpacity>
+  MeanSOpacity(const SOpacity &s_opac, const Real lRhoMin, const Real lRhoMax,
+               const int NRho, const Real lTMin, const Real lTMax, const int NT,
+               Real lNuMin, Real lNuMax, const int NNu, Real *lambda = nullptr,
+               TablePrecision precision = TablePrecision::Double,
+               const int nthreads = 1) {
     MeanSOpacityImpl_<SOpacity, false>(s_opac, lRhoMin, lRhoMax, NRho, lTMin,
-                                       lTMax, NT, lNuMin, lNuMax, NNu, lambda);
+                                       lTMax, NT, lNuMin, lNuMax,
+                                       {QuadratureRule::Trapezoid, NNu}, lambda,
+                                       nthreads);
+    setPrecision_(precision);
   }
 
 #ifdef SPINER_USE_HDF
-  MeanSOpacity(const std::string &filename) : filename_(filename.c_str()) {
+  // Files hold double or quantized tables. Either is decoded on load
+  // and converted to precision.
+  MeanSOpacity(const std::string &filename,
+               TablePrecision precision = TablePrecision::Double)
+      : filename_(filename.c_str()) {
     herr_t status = H5_SUCCESS;
     hid_t file = H5Fopen(filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
-    status += lkappaPlanck_.loadHDF(file, SP5::MeanSOpac::PlanckMeanSOpacity);
-    status +=
-        lkappaRosseland_.loadHDF(file, SP5::MeanSOpac::RosselandMeanSOpacity);
+    status += singularity::impl::loadHDFTable(
+        file, SP5::MeanSOpac::PlanckMeanSOpacity, lkappaPlanck_);
+    status += singularity::impl::loadHDFTable(
+        file, SP5::MeanSOpac::RosselandMeanSOpacity, lkappaRosseland_);
     status += H5Fclose(file);
 
     if (status != H5_SUCCESS) {
       OPAC_ERROR("photons::MeanSOpacity: HDF5 error\n");
     }
+    setPrecision_(precision);
   }
 
   void Save(const std::string &filename) const {
+    Spiner::DataBox lkappaPlanck = lkappaPlanck_;
+    Spiner::DataBox lkappaRosseland = lkappaRosseland_;
+    if (precision_ != TablePrecision::Double) {
+      widen_(PLANCK, lkappaPlanck);
+      widen_(ROSSELAND, lkappaRosseland);
+    }
     herr_t status = H5_SUCCESS;
     hid_t file =
         H5Fcreate(filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
-    status += lkappaPlanck_.saveHDF(file, SP5::MeanSOpac::PlanckMeanSOpacity);
+    status += lkappaPlanck.saveHDF(file, SP5::MeanSOpac::PlanckMeanSOpacity);
     status +=
-        lkappaRosseland_.saveHDF(file, SP5::MeanSOpac::RosselandMeanSOpacity);
+        lkappaRosseland.saveHDF(file, SP5::MeanSOpac::RosselandMeanSOpacity);
     status += H5Fclose(file);
+    if (precision_ != TablePrecision::Double) {
+      lkappaPlanck.finalize();
+      lkappaRosseland.finalize();
+    }
 
     if (status != H5_SUCCESS) {
       OPAC_ERROR("photons::MeanSOpacity: HDF5 error\n");
@@ -89,36 +137,99 @@ class MeanSOpacity {
   }
 #endif
 
+#ifdef SINGULARITY_USE_MMAP
+  // Maps a file written by SaveRaw. At double precision the mapped
+  // tables are used in place, without reading or copying them.
+  MeanSOpacity(const std::string &filename, RawFormat,
+               TablePrecision precision = TablePrecision::Double)
+      : filename_(filename.c_str()) {
+    mapped_.open(filename);
+    if (mapped_.encoding() != TableEncoding::Log10) {
+      mapped_.close();
+      OPAC_ERROR("photons::MeanSOpacity: raw tables must be log10\n");
+    }
+    lkappaPlanck_ = mapped_.get(SP5::MeanSOpac::PlanckMeanSOpacity);
+    lkappaRosseland_ = mapped_.get(SP5::MeanSOpac::RosselandMeanSOpacity);
+    setPrecision_(precision);
+    // Reduced precision tables are copies, so the mapping is no
+    // longer needed
+    if (precision != TablePrecision::Double) {
+      mapped_.close();
+    }
+  }
+#endif
+
+  void SaveRaw(const std::string &filename) const {
+    Spiner::DataBox lkappaPlanck = lkappaPlanck_;
+    Spiner::DataBox lkappaRosseland = lkappaRosseland_;
+    if (precision_ != TablePrecision::Double) {
+      widen_(PLANCK, lkappaPlanck);
+      widen_(ROSSELAND, lkappaRosseland);
+    }
+    singularity::impl::RawTableWriter writer;
+    writer.add(SP5::MeanSOpac::PlanckMeanSOpacity, lkappaPlanck);
+    writer.add(SP5::MeanSOpac::RosselandMeanSOpacity, lkappaRosseland);
+    writer.write(filename, TableEncoding::Log10);
+    if (precision_ != TablePrecision::Double) {
+      lkappaPlanck.finalize();
+      lkappaRosseland.finalize();
+    }
+  }
+
   PORTABLE_INLINE_FUNCTION void PrintParams() const {
     printf("Mean scattering opacity\n");
   }
 
   MeanSOpacity GetOnDevice() {
     MeanSOpacity other;
-    other.lkappaPlanck_ = Spiner::getOnDeviceDataBox(lkappaPlanck_);
-    other.lkappaRosseland_ = Spiner::getOnDeviceDataBox(lkappaRosseland_);
+    if (precision_ != TablePrecision::Double) {
+      other.lkappa_ = lkappa_.getOnDevice();
+      other.qkappa_ = qkappa_.getOnDevice();
+    } else {
+      other.lkappaPlanck_ = Spiner::getOnDeviceDataBox(lkappaPlanck_);
+      other.lkappaRosseland_ = Spiner::getOnDeviceDataBox(lkappaRosseland_);
+    }
+    other.grids_ = grids_;
+    other.precision_ = precision_;
     return other;
   }
 
   void Finalize() {
     lkappaPlanck_.finalize();
     lkappaRosseland_.finalize();
+    lkappa_.finalize();
+    qkappa_.finalize();
+    mapped_.close();
+  }
+
+  // The cell of (rho, temp), for the forms of the queries below that
+  // take a LookupState
+  PORTABLE_INLINE_FUNCTION
+  LookupState PrepareLookup(const Real rho, const Real temp) const {
+    LookupState s = singularity::impl::pointState(rho, temp, 0);
+    singularity::impl::locate(grids_.Rho, toLog_(rho), s.iRho, s.wRho);
+    singularity::impl::locate(grids_.T, toLog_(temp), s.iT, s.wT);
+    return s;
   }
 
   PORTABLE_INLINE_FUNCTION
   Real PlanckMeanTotalScatteringCoefficient(const Real rho,
                                             const Real temp) const {
-    Real lRho = toLog_(rho);
-    Real lT = toLog_(temp);
-    return rho * fromLog_(lkappaPlanck_.interpToReal(lRho, lT));
+    return PlanckMeanTotalScatteringCoefficient(PrepareLookup(rho, temp));
+  }
+  PORTABLE_INLINE_FUNCTION
+  Real PlanckMeanTotalScatteringCoefficient(const LookupState &s) const {
+    return s.rho * fromLog_(interp_(PLANCK, s));
   }
 
   PORTABLE_INLINE_FUNCTION
   Real RosselandMeanTotalScatteringCoefficient(const Real rho,
                                                const Real temp) const {
-    Real lRho = toLog_(rho);
-    Real lT = toLog_(temp);
-    return rho * fromLog_(lkappaRosseland_.interpToReal(lRho, lT));
+    return RosselandMeanTotalScatteringCoefficient(PrepareLookup(rho, temp));
+  }
+  PORTABLE_INLINE_FUNCTION
+  Real RosselandMeanTotalScatteringCoefficient(const LookupState &s) const {
+    return s.rho * fromLog_(interp_(ROSSELAND, s));
   }
 
  private:
@@ -126,7 +237,8 @@ class MeanSOpacity {
   void MeanSOpacityImpl_(const SOpacity &s_opac, const Real lRhoMin,
                          const Real lRhoMax, const int NRho, const Real lTMin,
                          const Real lTMax, const int NT, Real lNuMin,
-                         Real lNuMax, const int NNu, Real *lambda = nullptr) {
+                         Real lNuMax, const MeanQuadrature &quadrature,
+                         Real *lambda, const int nthreads) {
     ThermalDistribution dist;
 
     lkappaPlanck_.resize(NRho, NT);
@@ -134,66 +246,130 @@ class MeanSOpacity {
     lkappaPlanck_.setRange(1, lRhoMin, lRhoMax, NRho);
     lkappaRosseland_.copyMetadata(lkappaPlanck_);
 
-    // Fill tables
-    for (int iRho = 0; iRho < NRho; ++iRho) {
-      Real lRho = lkappaPlanck_.range(1).x(iRho);
-      Real rho = fromLog_(lRho);
-      for (int iT = 0; iT < NT; ++iT) {
-        Real lT = lkappaPlanck_.range(0).x(iT);
-        Real T = fromLog_(lT);
-        Real kappaPlanckNum = 0.;
-        Real kappaPlanckDenom = 0.;
-        Real kappaRosselandNum = 0.;
-        Real kappaRosselandDenom = 0.;
-        if (AUTOFREQ) {
-          lNuMin = toLog_(1.e-3 * pc::kb * fromLog_(lTMin) / pc::h);
-          lNuMax = toLog_(1.e3 * pc::kb * fromLog_(lTMax) / pc::h);
-        }
-        const Real dlnu = (lNuMax - lNuMin) / (NNu - 1);
-        // Integrate over frequency
-        for (int inu = 0; inu < NNu; ++inu) {
-          const Real weight =
-              (inu == 0 || inu == NNu - 1) ? 0.5 : 1.; // Trapezoidal rule
-          const Real lnu = lNuMin + inu * dlnu;
-          const Real nu = fromLog_(lnu);
-          const Real alpha =
-              s_opac.TotalScatteringCoefficient(rho, T, nu, lambda);
-          const Real B = dist.ThermalDistributionOfTNu(T, nu);
-          const Real dBdT = dist.DThermalDistributionOfTNuDT(T, nu);
-          kappaPlanckNum += weight * alpha / rho * B * nu * dlnu;
-          kappaPlanckDenom += weight * B * nu * dlnu;
-
-          if (alpha > singularity_opac::robust::SMALL()) {
-            kappaRosselandNum += weight *
-                                 singularity_opac::robust::ratio(rho, alpha) *
-                                 dBdT * nu * dlnu;
-            kappaRosselandDenom += weight * dBdT * nu * dlnu;
-          }
-        }
-
-        Real kappaPlanck =
-            singularity_opac::robust::ratio(kappaPlanckNum, kappaPlanckDenom);
-        Real kappaRosseland = kappaPlanck > singularity_opac::robust::SMALL()
-                                  ? singularity_opac::robust::ratio(
-                                        kappaRosselandDenom, kappaRosselandNum)
-                                  : 0.;
-        lkappaPlanck_(iRho, iT) = toLog_(kappaPlanck);
-        lkappaRosseland_(iRho, iT) = toLog_(kappaRosseland);
-        if (std::isnan(lkappaPlanck_(iRho, iT)) ||
-            std::isnan(lkappaRosseland_(iRho, iT))) {
-          OPAC_ERROR("photons::MeanSOpacity: NAN in opacity evaluations");
-        }
-      }
+    if (AUTOFREQ) {
+      lNuMin = toLog_(singularity::impl::THERMAL_NU_LOW * pc::kb *
+                      fromLog_(lTMin) / pc::h);
+      lNuMax = toLog_(singularity::impl::THERMAL_NU_HIGH * pc::kb *
+                      fromLog_(lTMax) / pc::h);
     }
+    const singularity::impl::FrequencyQuadrature frequencies(
+        quadrature, fromLog_(lNuMin), fromLog_(lNuMax));
+
+    // Fill tables. Each (rho, T) node is independent, so they are
+    // spread over host threads. Scattering models have no batched
+    // query, so they are called once per frequency.
+    singularity::impl::hostParallelFor(NRho * NT, nthreads, [&](const int i) {
+      const int iRho = i / NT;
+      const int iT = i % NT;
+      const Real rho = fromLog_(lkappaPlanck_.range(1).x(iRho));
+      const Real T = fromLog_(lkappaPlanck_.range(0).x(iT));
+      const singularity::impl::MeanSums sums = frequencies.integrate(
+          rho, pc::kb * T / pc::h,
+          [&](const Real *nu, const int n, Real *alpha, Real *B, Real *dBdT) {
+            for (int inu = 0; inu < n; ++inu) {
+              alpha[inu] =
+                  s_opac.TotalScatteringCoefficient(rho, T, nu[inu], lambda);
+              B[inu] = dist.ThermalDistributionOfTNu(T, nu[inu]);
+              dBdT[inu] = dist.DThermalDistributionOfTNuDT(T, nu[inu]);
+            }
+          });
+      const Real kappaPlanck = sums.Planck();
+      const Real kappaRosseland = sums.Rosseland();
+      lkappaPlanck_(iRho, iT) = toLog_(kappaPlanck);
+      lkappaRosseland_(iRho, iT) = toLog_(kappaRosseland);
+      if (std::isnan(lkappaPlanck_(iRho, iT)) ||
+          std::isnan(lkappaRosseland_(iRho, iT))) {
+        OPAC_ERROR("photons::MeanSOpacity: NAN in opacity evaluations");
+      }
+    });
   }
   PORTABLE_INLINE_FUNCTION Real toLog_(const Real x) const {
-    return std::log10(std::abs(x) + EPS);
+    return BDMath::log10(std::abs(x) + EPS);
   }
   PORTABLE_INLINE_FUNCTION Real fromLog_(const Real lx) const {
-    return std::pow(10., lx);
+    return BDMath::exp10(lx);
   }
+  PORTABLE_INLINE_FUNCTION Real interp_(const int q,
+                                        const LookupState &s) const {
+    const std::size_t NT = grids_.T.nPoints();
+    if (precision_ == TablePrecision::Float) {
+      const float *data = lkappa_.data<float>() + q * grids_.size();
+      return singularity::impl::interp2D(data, NT, s);
+    }
+    if (precision_ == TablePrecision::Quantized) {
+      return singularity::impl::interp2D(qkappa_.table(q), NT, s);
+    }
+    const Spiner::DataBox &db =
+        (q == PLANCK) ? lkappaPlanck_ : lkappaRosseland_;
+    return singularity::impl::interp2D(&db(0, 0), NT, s);
+  }
+  // Converts the tables to the requested precision, releasing the
+  // double tables if they are no longer needed.
+  void setPrecision_(const TablePrecision precision) {
+    grids_.Rho = lkappaPlanck_.range(1);
+    grids_.T = lkappaPlanck_.range(0);
+    precision_ = precision;
+    if (precision == TablePrecision::Double) {
+      return;
+    }
+    const std::size_t N = grids_.size();
+    const Real *planck = &lkappaPlanck_(0, 0);
+    const Real *rosseland = &lkappaRosseland_(0, 0);
+    if (precision == TablePrecision::Quantized) {
+      qkappa_.allocate(N, 2);
+      qkappa_.encode(PLANCK, planck);
+      qkappa_.encode(ROSSELAND, rosseland);
+    } else {
+      lkappa_.allocate(2 * N * sizeof(float));
+      float *data = lkappa_.data<float>();
+      for (std::size_t i = 0; i < N; ++i) {
+        data[PLANCK * N + i] = static_cast<float>(planck[i]);
+        data[ROSSELAND * N + i] = static_cast<float>(rosseland[i]);
+      }
+    }
+    lkappaPlanck_.finalize();
+    lkappaRosseland_.finalize();
+    lkappaPlanck_ = Spiner::DataBox();
+    lkappaRosseland_ = Spiner::DataBox();
+  }
+  // Copies reduced precision table q into a new double table on host.
+  // The caller is responsible for freeing it.
+  void widen_(const int q, Spiner::DataBox &db) const {
+    db = Spiner::DataBox();
+    db.resize(grids_.Rho.nPoints(), grids_.T.nPoints());
+    db.setRange(0, grids_.T.min(), grids_.T.max(), grids_.T.nPoints());
+    db.setRange(1, grids_.Rho.min(), grids_.Rho.max(), grids_.Rho.nPoints());
+    const std::size_t N = grids_.size();
+    Real *out = &db(0, 0);
+    if (precision_ == TablePrecision::Quantized) {
+      const singularity::impl::QuantizedPtr data = qkappa_.table(q);
+      for (std::size_t i = 0; i < N; ++i) {
+        out[i] = data[i];
+      }
+      return;
+    }
+    const float *data = lkappa_.data<float>() + q * N;
+    for (std::size_t i = 0; i < N; ++i) {
+      out[i] = data[i];
+    }
+  }
+  struct Grids {
+    Spiner::RegularGrid1D Rho, T;
+    PORTABLE_INLINE_FUNCTION std::size_t size() const {
+      return static_cast<std::size_t>(Rho.nPoints()) * T.nPoints();
+    }
+  };
+  enum { PLANCK = 0, ROSSELAND = 1 };
   Spiner::DataBox lkappaPlanck_;
   Spiner::DataBox lkappaRosseland_;
+  // both tables as floats, with TablePrecision::Float
+  singularity::impl::AlignedStorage lkappa_;
+  // both tables with TablePrecision::Quantized
+  singularity::impl::QuantizedStorage qkappa_;
+  Grids grids_;
+  TablePrecision precision_ = TablePrecision::Double;
+  // raw file the tables are mapped from, if any
+  singularity::impl::MappedTables mapped_;
   const char *filename_;
 };
 
@@ -21,6 +21,8 @@
 #include <cstdio>
 
 #include <ports-of-call/portability.hpp>
+#include <singularity-opac/base/indexers.hpp>
+#include <singularity-opac/base/lookup_state.hpp>
 #include <singularity-opac/base/opac_error.hpp>
 
 namespace singularity {
@@ -65,18 +67,13 @@ class NonCGSUnits {
   }
 
   template <typename FrequencyIndexer, typename DataIndexer>
-  PORTABLE_INLINE_FUNCTION Real AbsorptionCoefficient(
+  PORTABLE_INLINE_FUNCTION void AbsorptionCoefficient(
       const Real rho, const Real temp, FrequencyIndexer &nu_bins,
       DataIndexer &coeffs, const int nbins, Real *lambda = nullptr) const {
-    for (int i = 0; i < nbins; ++i) {
-      nu_bins[i] *= freq_unit_;
-    }
-    opac_.AbsorptionCoefficient(rho * rho_unit_, temp * temp_unit_, nu_bins,
-                                coeffs, nbins, lambda);
-    for (int i = 0; i < nbins; ++i) {
-      nu_bins[i] *= time_unit_;
-      coeffs[i] *= length_unit_;
-    }
+    indexers::ScaledFrequencies<FrequencyIndexer> nu_cgs(nu_bins, freq_unit_);
+    indexers::ScaledData<DataIndexer> coeffs_cgs(coeffs, length_unit_);
+    opac_.AbsorptionCoefficient(rho * rho_unit_, temp * temp_unit_, nu_cgs,
+                                coeffs_cgs, nbins, lambda);
   }
 
   PORTABLE_INLINE_FUNCTION
@@ -88,21 +85,14 @@ class NonCGSUnits {
     return alpha * length_unit_;
   }
 
-  // TODO(JMM): Doing the frequency conversion here is SUPER gross.
-  // Is there no better way? Should we just not allow modified units?
   template <typename FrequencyIndexer, typename DataIndexer>
   PORTABLE_INLINE_FUNCTION void AngleAveragedAbsorptionCoefficient(
       const Real rho, const Real temp, FrequencyIndexer &nu_bins,
       DataIndexer &coeffs, const int nbins, Real *lambda = nullptr) const {
-    for (int i = 0; i < nbins; ++i) {
-      nu_bins[i] *= freq_unit_;
-    }
+    indexers::ScaledFrequencies<FrequencyIndexer> nu_cgs(nu_bins, freq_unit_);
+    indexers::ScaledData<DataIndexer> coeffs_cgs(coeffs, length_unit_);
     opac_.AngleAveragedAbsorptionCoefficient(rho * rho_unit_, temp * temp_unit_,
-                                             nu_bins, coeffs, nbins, lambda);
-    for (int i = 0; i < nbins; ++i) {
-      nu_bins[i] *= time_unit_;
-      coeffs[i] *= length_unit_;
-    }
+                                             nu_cgs, coeffs_cgs, nbins, lambda);
   }
 
   PORTABLE_INLINE_FUNCTION
@@ -118,15 +108,10 @@ class NonCGSUnits {
   EmissivityPerNuOmega(const Real rho, const Real temp,
                        FrequencyIndexer &nu_bins, DataIndexer &coeffs,
                        const int nbins, Real *lambda = nullptr) const {
-    for (int i = 0; i < nbins; ++i) {
-      nu_bins[i] *= freq_unit_;
-    }
-    opac_.EmissivityPerNuOmega(rho * rho_unit_, temp * temp_unit_, nu_bins,
-                               coeffs, nbins, lambda);
-    for (int i = 0; i < nbins; ++i) {
-      nu_bins[i] *= time_unit_;
-      coeffs[i] *= inv_emiss_unit_;
-    }
+    indexers::ScaledFrequencies<FrequencyIndexer> nu_cgs(nu_bins, freq_unit_);
+    indexers::ScaledData<DataIndexer> coeffs_cgs(coeffs, inv_emiss_unit_);
+    opac_.EmissivityPerNuOmega(rho * rho_unit_, temp * temp_unit_, nu_cgs,
+                               coeffs_cgs, nbins, lambda);
   }
 
   PORTABLE_INLINE_FUNCTION
@@ -142,15 +127,10 @@ class NonCGSUnits {
   EmissivityPerNu(const Real rho, const Real temp, FrequencyIndexer &nu_bins,
                   DataIndexer &coeffs, const int nbins,
                   Real *lambda = nullptr) const {
-    for (int i = 0; i < nbins; ++i) {
-      nu_bins[i] *= freq_unit_;
-    }
-    opac_.EmissivityPerNu(rho * rho_unit_, temp * temp_unit_, nu_bins, coeffs,
-                          nbins, lambda);
-    for (int i = 0; i < nbins; ++i) {
-      nu_bins[i] *= time_unit_;
-      coeffs[i] *= inv_emiss_unit_;
-    }
+    indexers::ScaledFrequencies<FrequencyIndexer> nu_cgs(nu_bins, freq_unit_);
+    indexers::ScaledData<DataIndexer> coeffs_cgs(coeffs, inv_emiss_unit_);
+    opac_.EmissivityPerNu(rho * rho_unit_, temp * temp_unit_, nu_cgs,
+                          coeffs_cgs, nbins, lambda);
   }
 
   PORTABLE_INLINE_FUNCTION
@@ -269,6 +249,19 @@ class MeanNonCGSUnits {
     return alpha * length_unit_;
   }
 
+  PORTABLE_INLINE_FUNCTION
+  LookupState PrepareLookup(const Real rho, const Real temp) const {
+    return mean_opac_.PrepareLookup(rho_unit_ * rho, temp_unit_ * temp);
+  }
+  PORTABLE_INLINE_FUNCTION
+  Real PlanckMeanAbsorptionCoefficient(const LookupState &s) const {
+    return mean_opac_.PlanckMeanAbsorptionCoefficient(s) * length_unit_;
+  }
+  PORTABLE_INLINE_FUNCTION
+  Real RosselandMeanAbsorptionCoefficient(const LookupState &s) const {
+    return mean_opac_.RosselandMeanAbsorptionCoefficient(s) * length_unit_;
+  }
+
  private:
   MeanOpac mean_opac_;
   Real time_unit_, mass_unit_, length_unit_, temp_unit_;
@@ -20,6 +20,7 @@
 #include <singularity-opac/photons/gray_opacity_photons.hpp>
 #include <singularity-opac/photons/non_cgs_photons.hpp>
 #include <singularity-opac/photons/photon_variant.hpp>
+#include <singularity-opac/photons/sum_opacity_photons.hpp>
 #include <singularity-opac/photons/thermal_distributions_photons.hpp>
 
 #include <singularity-opac/photons/mean_opacity_photons.hpp>
@@ -34,6 +35,10 @@ using EPBremss = EPBremsstrahlungOpacity<PhysicalConstantsCGS>;
 using Opacity = impl::Variant<ScaleFree, Gray, EPBremss, NonCGSUnits<Gray>,
                               NonCGSUnits<EPBremss>>;
 
+// The interface of Opacity for exactly one model, with no dispatch
+template <typename Model>
+using Monomorphic = impl::Variant<Model>;
+
 } // namespace photons
 } // namespace singularity
 
@@ -20,15 +20,16 @@
 
 #include <ports-of-call/portability.hpp>
 #include <singularity-opac/base/opac_error.hpp>
+#include <singularity-opac/base/opac_variant.hpp>
 #include <singularity-opac/base/radiation_types.hpp>
-#include <variant/include/mpark/variant.hpp>
+#include <singularity-opac/photons/zone_queries_photons.hpp>
 
 namespace singularity {
 namespace photons {
 namespace impl {
 
 template <typename... Ts>
-using s_opac_variant = mpark::variant<Ts...>;
+using s_opac_variant = singularity::impl::opac_variant<Ts...>;
 
 template <typename... S_Opacs>
 class S_Variant {
@@ -62,11 +63,11 @@ class S_Variant {
           !std::is_same<S_Variant, typename std::decay<Choice>::type>::value,
           bool>::type = true>
   Choice get() {
-    return mpark::get<Choice>(s_opac_);
+    return singularity::impl::get<Choice>(s_opac_);
   }
 
   S_Variant GetOnDevice() {
-    return mpark::visit(
+    return singularity::impl::visit(
         [](auto &s_opac) {
           return s_opac_variant<S_Opacs...>(s_opac.GetOnDevice());
         },
@@ -79,7 +80,7 @@ class S_Variant {
   PORTABLE_INLINE_FUNCTION Real
   TotalCrossSection(const Real rho, const Real temp, const Real nu,
                     Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &s_opac) {
           return s_opac.TotalCrossSection(rho, temp, nu, lambda);
         },
@@ -92,7 +93,7 @@ class S_Variant {
   PORTABLE_INLINE_FUNCTION Real
   DifferentialCrossSection(const Real rho, const Real temp, const Real nu,
                            const Real mu, Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &s_opac) {
           return s_opac.DifferentialCrossSection(rho, temp, nu, mu, lambda);
         },
@@ -105,7 +106,7 @@ class S_Variant {
   PORTABLE_INLINE_FUNCTION Real
   TotalScatteringCoefficient(const Real rho, const Real temp, const Real nu,
                              Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &s_opac) {
           return s_opac.TotalScatteringCoefficient(rho, temp, nu, lambda);
         },
@@ -114,24 +115,40 @@ class S_Variant {
 
   PORTABLE_INLINE_FUNCTION
   int nlambda() const noexcept {
-    return mpark::visit([](const auto &s_opac) { return s_opac.nlambda(); },
-                        s_opac_);
+    return singularity::impl::visit(
+        [](const auto &s_opac) { return s_opac.nlambda(); }, s_opac_);
   }
 
   template <typename T>
   PORTABLE_INLINE_FUNCTION bool IsType() const noexcept {
-    return mpark::holds_alternative<T>(s_opac_);
+    return singularity::impl::holds_alternative<T>(s_opac_);
   }
 
   PORTABLE_INLINE_FUNCTION
   void PrintParams() const noexcept {
-    return mpark::visit([](const auto &s_opac) { return s_opac.PrintParams(); },
-                        s_opac_);
+    return singularity::impl::visit(
+        [](const auto &s_opac) { return s_opac.PrintParams(); }, s_opac_);
+  }
+
+  // Bulk form, for nzones zones at once, as for the bulk forms of
+  // Variant. coeffs[z * nbins + i] is at frequency nu_bins[i].
+  template <typename ZoneIndexer, typename FrequencyIndexer,
+            typename DataIndexer>
+  void BulkTotalScatteringCoefficient(const int nzones, const ZoneIndexer &rho,
+                                      const ZoneIndexer &temp,
+                                      const FrequencyIndexer &nu_bins,
+                                      const DataIndexer &coeffs,
+                                      const int nbins,
+                                      const int nthreads = 1) const {
+    singularity::impl::visitZones(
+        s_opac_, nzones, nthreads,
+        singularity::impl::zoneSpectra<TotalScatteringQuery>(
+            zoneArrays(rho, temp), nu_bins, coeffs, nbins));
   }
 
   inline void Finalize() noexcept {
-    return mpark::visit([](auto &s_opac) { return s_opac.Finalize(); },
-                        s_opac_);
+    return singularity::impl::visit(
+        [](auto &s_opac) { return s_opac.Finalize(); }, s_opac_);
   }
 };
 
@@ -20,15 +20,16 @@
 
 #include <ports-of-call/portability.hpp>
 #include <singularity-opac/base/opac_error.hpp>
+#include <singularity-opac/base/opac_variant.hpp>
 #include <singularity-opac/base/radiation_types.hpp>
-#include <variant/include/mpark/variant.hpp>
+#include <singularity-opac/photons/zone_queries_photons.hpp>
 
 namespace singularity {
 namespace photons {
 namespace impl {
 
 template <typename... Ts>
-using opac_variant = mpark::variant<Ts...>;
+using opac_variant = singularity::impl::opac_variant<Ts...>;
 
 template <typename... Opacs>
 class Variant {
@@ -62,11 +63,11 @@ class Variant {
           !std::is_same<Variant, typename std::decay<Choice>::type>::value,
           bool>::type = true>
   Choice get() {
-    return mpark::get<Choice>(opac_);
+    return singularity::impl::get<Choice>(opac_);
   }
 
   Variant GetOnDevice() {
-    return mpark::visit(
+    return singularity::impl::visit(
         [](auto &opac) { return opac_variant<Opacs...>(opac.GetOnDevice()); },
         opac_);
   }
@@ -77,7 +78,7 @@ class Variant {
   PORTABLE_INLINE_FUNCTION Real
   AbsorptionCoefficient(const Real rho, const Real temp, const Real nu,
                         Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.AbsorptionCoefficient(rho, temp, nu, lambda);
         },
@@ -89,7 +90,7 @@ class Variant {
   AbsorptionCoefficient(const Real rho, const Real temp,
                         FrequencyIndexer &nu_bins, DataIndexer &coeffs,
                         const int nbins, Real *lambda = nullptr) const {
-    mpark::visit(
+    singularity::impl::visit(
         [&](const auto &opac) {
           opac.AbsorptionCoefficient(rho, temp, nu_bins, coeffs, nbins, lambda);
         },
@@ -102,7 +103,7 @@ class Variant {
   PORTABLE_INLINE_FUNCTION Real AngleAveragedAbsorptionCoefficient(
       const Real rho, const Real temp, const Real nu,
       Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.AngleAveragedAbsorptionCoefficient(rho, temp, nu, lambda);
         },
@@ -113,7 +114,7 @@ class Variant {
   PORTABLE_INLINE_FUNCTION void AngleAveragedAbsorptionCoefficient(
       const Real rho, const Real temp, FrequencyIndexer &nu_bins,
       DataIndexer &coeffs, const int nbins, Real *lambda = nullptr) const {
-    mpark::visit(
+    singularity::impl::visit(
         [&](const auto &opac) {
           opac.AngleAveragedAbsorptionCoefficient(rho, temp, nu_bins, coeffs,
                                                   nbins, lambda);
@@ -126,7 +127,7 @@ class Variant {
   PORTABLE_INLINE_FUNCTION Real
   EmissivityPerNuOmega(const Real rho, const Real temp, const Real nu,
                        Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.EmissivityPerNuOmega(rho, temp, nu, lambda);
         },
@@ -138,7 +139,7 @@ class Variant {
   EmissivityPerNuOmega(const Real rho, const Real temp,
                        FrequencyIndexer &nu_bins, DataIndexer &coeffs,
                        const int nbins, Real *lambda = nullptr) const {
-    mpark::visit(
+    singularity::impl::visit(
         [&](const auto &opac) {
           return opac.EmissivityPerNuOmega(rho, temp, nu_bins, coeffs, nbins,
                                            lambda);
@@ -150,7 +151,7 @@ class Variant {
   PORTABLE_INLINE_FUNCTION Real EmissivityPerNu(const Real rho, const Real temp,
                                                 const Real nu,
                                                 Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.EmissivityPerNu(rho, temp, nu, lambda);
         },
@@ -162,7 +163,7 @@ class Variant {
   EmissivityPerNu(const Real rho, const Real temp, FrequencyIndexer &nu_bins,
                   DataIndexer &coeffs, const int nbins,
                   Real *lambda = nullptr) const {
-    mpark::visit(
+    singularity::impl::visit(
         [&](const auto &opac) {
           return opac.EmissivityPerNu(rho, temp, nu_bins, coeffs, nbins,
                                       lambda);
@@ -173,7 +174,7 @@ class Variant {
   // emissivity integrated over angle and frequency
   PORTABLE_INLINE_FUNCTION Real Emissivity(const Real rho, const Real temp,
                                            Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) { return opac.Emissivity(rho, temp, lambda); },
         opac_);
   }
@@ -182,7 +183,7 @@ class Variant {
   PORTABLE_INLINE_FUNCTION auto NumberEmissivity(const Real rho,
                                                  const Real temp,
                                                  Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.NumberEmissivity(rho, temp, lambda);
         },
@@ -192,7 +193,7 @@ class Variant {
   // Specific intensity of thermal distribution
   PORTABLE_INLINE_FUNCTION Real ThermalDistributionOfTNu(
       const Real temp, const Real nu, Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.ThermalDistributionOfTNu(temp, nu, lambda);
         },
@@ -202,7 +203,7 @@ class Variant {
   // Temperature derivative of specific intensity of thermal distribution
   PORTABLE_INLINE_FUNCTION Real DThermalDistributionOfTNuDT(
       const Real temp, const Real nu, Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.DThermalDistributionOfTNuDT(temp, nu, lambda);
         },
@@ -212,7 +213,7 @@ class Variant {
   // Integral of thermal distribution over frequency and angle
   PORTABLE_INLINE_FUNCTION Real
   ThermalDistributionOfT(const Real temp, Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.ThermalDistributionOfT(temp, lambda);
         },
@@ -222,7 +223,7 @@ class Variant {
   // Integral of thermal distribution over energy per frequency and angle
   PORTABLE_INLINE_FUNCTION Real
   ThermalNumberDistributionOfT(const Real temp, Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.ThermalNumberDistributionOfT(temp, lambda);
         },
@@ -232,7 +233,7 @@ class Variant {
   // Energy density of thermal distribution
   PORTABLE_INLINE_FUNCTION Real
   EnergyDensityFromTemperature(const Real temp, Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.EnergyDensityFromTemperature(temp, lambda);
         },
@@ -242,7 +243,7 @@ class Variant {
   // Temperature of thermal distribution
   PORTABLE_INLINE_FUNCTION Real
   TemperatureFromEnergyDensity(const Real er, Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.TemperatureFromEnergyDensity(er, lambda);
         },
@@ -252,7 +253,7 @@ class Variant {
   // Number density of thermal distribution
   PORTABLE_INLINE_FUNCTION Real
   NumberDensityFromTemperature(const Real temp, Real *lambda = nullptr) const {
-    return mpark::visit(
+    return singularity::impl::visit(
         [=](const auto &opac) {
           return opac.NumberDensityFromTemperature(temp, lambda);
         },
@@ -261,22 +262,70 @@ class Variant {
 
   PORTABLE_INLINE_FUNCTION
   int nlambda() const noexcept {
-    return mpark::visit([](const auto &opac) { return opac.nlambda(); }, opac_);
+    return singularity::impl::visit(
+        [](const auto &opac) { return opac.nlambda(); }, opac_);
   }
 
   template <typename T>
   PORTABLE_INLINE_FUNCTION bool IsType() const noexcept {
-    return mpark::holds_alternative<T>(opac_);
+    return singularity::impl::holds_alternative<T>(opac_);
   }
 
   PORTABLE_INLINE_FUNCTION
   void PrintParams() const noexcept {
-    return mpark::visit([](const auto &opac) { return opac.PrintParams(); },
-                        opac_);
+    return singularity::impl::visit(
+        [](const auto &opac) { return opac.PrintParams(); }, opac_);
+  }
+
+  // Bulk forms, for nzones zones at once. Zone z is at rho[z] and
+  // temp[z]. Spectral quantities at the nbins frequencies nu_bins go
+  // to coeffs[z * nbins + i], and the others to values[z]. The variant
+  // is visited once per call and the zones loop over the model it
+  // holds, with portableFor in device builds and otherwise on nthreads
+  // host threads: serially by default, all cores if nthreads <= 0.
+  // Threads are started on every call, so they only pay off for large
+  // nzones. Indexers are anything with an operator[] valid where the
+  // loop runs, such as pointers or views.
+  template <typename ZoneIndexer, typename FrequencyIndexer,
+            typename DataIndexer>
+  void BulkAbsorptionCoefficient(const int nzones, const ZoneIndexer &rho,
+                                 const ZoneIndexer &temp,
+                                 const FrequencyIndexer &nu_bins,
+                                 const DataIndexer &coeffs, const int nbins,
+                                 const int nthreads = 1) const {
+    singularity::impl::visitZones(
+        opac_, nzones, nthreads,
+        singularity::impl::zoneSpectra<AbsorptionQuery>(zoneArrays(rho, temp),
+                                                        nu_bins, coeffs,
+                                                        nbins));
+  }
+
+  template <typename ZoneIndexer, typename FrequencyIndexer,
+            typename DataIndexer>
+  void BulkEmissivityPerNu(const int nzones, const ZoneIndexer &rho,
+                           const ZoneIndexer &temp,
+                           const FrequencyIndexer &nu_bins,
+                           const DataIndexer &coeffs, const int nbins,
+                           const int nthreads = 1) const {
+    singularity::impl::visitZones(
+        opac_, nzones, nthreads,
+        singularity::impl::zoneSpectra<EmissivityPerNuQuery>(
+            zoneArrays(rho, temp), nu_bins, coeffs, nbins));
+  }
+
+  template <typename ZoneIndexer, typename DataIndexer>
+  void BulkEmissivity(const int nzones, const ZoneIndexer &rho,
+                      const ZoneIndexer &temp, const DataIndexer &values,
+                      const int nthreads = 1) const {
+    singularity::impl::visitZones(
+        opac_, nzones, nthreads,
+        singularity::impl::zoneValues<EmissivityQuery>(zoneArrays(rho, temp),
+                                                       values));
   }
 
   inline void Finalize() noexcept {
-    return mpark::visit([](auto &opac) { return opac.Finalize(); }, opac_);
+    return singularity::impl::visit(
+        [](auto &opac) { return opac.Finalize(); }, opac_);
   }
 };
 
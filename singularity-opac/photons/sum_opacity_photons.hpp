@@ -0,0 +1,280 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+#ifndef SINGULARITY_OPAC_PHOTONS_SUM_OPACITY_PHOTONS_
+#define SINGULARITY_OPAC_PHOTONS_SUM_OPACITY_PHOTONS_
+
+#include <cmath>
+#include <cstdio>
+#include <type_traits>
+
+#include <ports-of-call/portability.hpp>
+#include <singularity-opac/base/opac_error.hpp>
+#include <singularity-opac/base/robust_utils.hpp>
+#include <singularity-opac/base/sum_components.hpp>
+#include <singularity-opac/photons/epbremsstrahlung_opacity_photons.hpp>
+#include <singularity-opac/photons/gray_opacity_photons.hpp>
+#include <singularity-opac/photons/thermal_distributions_photons.hpp>
+
+namespace singularity {
+namespace photons {
+namespace impl {
+
+// Models that derive their absorption coefficient from their
+// emissivity by Kirchhoff's law with PlanckDistribution<pc>. A sum
+// only asks these for their emissivity and divides the total by B_nu
+// once.
+template <typename Model, typename pc>
+struct IsKirchhoff : std::false_type {};
+template <typename pc>
+struct IsKirchhoff<GrayOpacity<pc>, pc> : std::true_type {};
+template <typename pc>
+struct IsKirchhoff<EPBremsstrahlungOpacity<pc>, pc> : std::true_type {};
+
+// Adds one component of a sum at one frequency. Kirchhoff components
+// add their emissivity to jK, to be divided by B_nu, and the rest add
+// their own absorption to alpha.
+template <typename pc, typename Model>
+PORTABLE_FORCEINLINE_FUNCTION
+    typename std::enable_if<IsKirchhoff<Model, pc>::value>::type
+    addAbsorption(const Model &m, const Real rho, const Real temp,
+                  const Real nu, Real &alpha, Real &jK, Real *lambda) {
+  jK += m.EmissivityPerNuOmega(rho, temp, nu, lambda);
+}
+template <typename pc, typename Model>
+PORTABLE_FORCEINLINE_FUNCTION
+    typename std::enable_if<!IsKirchhoff<Model, pc>::value>::type
+    addAbsorption(const Model &m, const Real rho, const Real temp,
+                  const Real nu, Real &alpha, Real &jK, Real *lambda) {
+  alpha += m.AbsorptionCoefficient(rho, temp, nu, lambda);
+}
+
+template <typename pc, typename Model>
+PORTABLE_FORCEINLINE_FUNCTION
+    typename std::enable_if<IsKirchhoff<Model, pc>::value>::type
+    addAngleAveragedAbsorption(const Model &m, const Real rho,
+                               const Real temp, const Real nu, Real &alpha,
+                               Real &jK, Real *lambda) {
+  jK += m.EmissivityPerNu(rho, temp, nu, lambda) / (4. * M_PI);
+}
+template <typename pc, typename Model>
+PORTABLE_FORCEINLINE_FUNCTION
+    typename std::enable_if<!IsKirchhoff<Model, pc>::value>::type
+    addAngleAveragedAbsorption(const Model &m, const Real rho,
+                               const Real temp, const Real nu, Real &alpha,
+                               Real &jK, Real *lambda) {
+  alpha += m.AngleAveragedAbsorptionCoefficient(rho, temp, nu, lambda);
+}
+
+} // namespace impl
+
+// The sum of several emission and absorption processes, e.g.,
+// bremsstrahlung plus a gray floor, as one model. Each query evaluates
+// every component at a frequency in one pass and returns the total.
+// The Planck distribution is evaluated once per frequency for all the
+// components whose absorption follows from Kirchhoff's law (see
+// IsKirchhoff), and the thermal functions of the sum are those of
+// PlanckDistribution<pc>. Every component receives the same lambda.
+template <typename pc, typename... Models>
+class SumOpacity {
+ public:
+  SumOpacity() = default;
+  SumOpacity(const Models &... models) : models_(models...) {}
+  SumOpacity(const PlanckDistribution<pc> &dist, const Models &... models)
+      : models_(models...), dist_(dist) {}
+
+  SumOpacity GetOnDevice() {
+    SumOpacity other;
+    other.models_ = models_.GetOnDevice();
+    other.dist_ = dist_;
+    return other;
+  }
+  PORTABLE_INLINE_FUNCTION
+  int nlambda() const noexcept {
+    int n = 0;
+    models_.forEach([&](const auto &m) {
+      const int nm = m.nlambda();
+      n = (nm > n) ? nm : n;
+    });
+    return n;
+  }
+  PORTABLE_INLINE_FUNCTION
+  void PrintParams() const noexcept {
+    printf("Sum of %d opacities:\n", static_cast<int>(sizeof...(Models)));
+    models_.forEach([](const auto &m) { m.PrintParams(); });
+  }
+  inline void Finalize() noexcept { models_.Finalize(); }
+
+  PORTABLE_INLINE_FUNCTION
+  Real AbsorptionCoefficient(const Real rho, const Real temp, const Real nu,
+                             Real *lambda = nullptr) const {
+    Real alpha = 0;
+    Real jK = 0;
+    models_.forEach([&](const auto &m) {
+      impl::addAbsorption<pc>(m, rho, temp, nu, alpha, jK, lambda);
+    });
+    return alpha + KirchhoffAbsorption_(jK, temp, nu, lambda);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  AbsorptionCoefficient(const Real rho, const Real temp,
+                        FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+                        const int nbins, Real *lambda = nullptr) const {
+    for (int i = 0; i < nbins; ++i) {
+      coeffs[i] = AbsorptionCoefficient(rho, temp, nu_bins[i], lambda);
+    }
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real AngleAveragedAbsorptionCoefficient(const Real rho, const Real temp,
+                                          const Real nu,
+                                          Real *lambda = nullptr) const {
+    Real alpha = 0;
+    Real jK = 0;
+    models_.forEach([&](const auto &m) {
+      impl::addAngleAveragedAbsorption<pc>(m, rho, temp, nu, alpha, jK,
+                                           lambda);
+    });
+    return alpha + KirchhoffAbsorption_(jK, temp, nu, lambda);
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void AngleAveragedAbsorptionCoefficient(
+      const Real rho, const Real temp, FrequencyIndexer &nu_bins,
+      DataIndexer &coeffs, const int nbins, Real *lambda = nullptr) const {
+    for (int i = 0; i < nbins; ++i) {
+      coeffs[i] =
+          AngleAveragedAbsorptionCoefficient(rho, temp, nu_bins[i], lambda);
+    }
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real EmissivityPerNuOmega(const Real rho, const Real temp, const Real nu,
+                            Real *lambda = nullptr) const {
+    Real jnu = 0;
+    models_.forEach([&](const auto &m) {
+      jnu += m.EmissivityPerNuOmega(rho, temp, nu, lambda);
+    });
+    return jnu;
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  EmissivityPerNuOmega(const Real rho, const Real temp,
+                       FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+                       const int nbins, Real *lambda = nullptr) const {
+    for (int i = 0; i < nbins; ++i) {
+      coeffs[i] = EmissivityPerNuOmega(rho, temp, nu_bins[i], lambda);
+    }
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real EmissivityPerNu(const Real rho, const Real temp, const Real nu,
+                       Real *lambda = nullptr) const {
+    Real jnu = 0;
+    models_.forEach([&](const auto &m) {
+      jnu += m.EmissivityPerNu(rho, temp, nu, lambda);
+    });
+    return jnu;
+  }
+
+  template <typename FrequencyIndexer, typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION void
+  EmissivityPerNu(const Real rho, const Real temp, FrequencyIndexer &nu_bins,
+                  DataIndexer &coeffs, const int nbins,
+                  Real *lambda = nullptr) const {
+    for (int i = 0; i < nbins; ++i) {
+      coeffs[i] = EmissivityPerNu(rho, temp, nu_bins[i], lambda);
+    }
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real Emissivity(const Real rho, const Real temp,
+                  Real *lambda = nullptr) const {
+    Real J = 0;
+    models_.forEach(
+        [&](const auto &m) { J += m.Emissivity(rho, temp, lambda); });
+    return J;
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real NumberEmissivity(const Real rho, const Real temp,
+                        Real *lambda = nullptr) const {
+    Real Jn = 0;
+    models_.forEach(
+        [&](const auto &m) { Jn += m.NumberEmissivity(rho, temp, lambda); });
+    return Jn;
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real ThermalDistributionOfTNu(const Real temp, const Real nu,
+                                Real *lambda = nullptr) const {
+    return dist_.ThermalDistributionOfTNu(temp, nu, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real DThermalDistributionOfTNuDT(const Real temp, const Real nu,
+                                   Real *lambda = nullptr) const {
+    return dist_.DThermalDistributionOfTNuDT(temp, nu, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real ThermalDistributionOfT(const Real temp, Real *lambda = nullptr) const {
+    return dist_.ThermalDistributionOfT(temp, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION Real
+  ThermalNumberDistributionOfT(const Real temp, Real *lambda = nullptr) const {
+    return dist_.ThermalNumberDistributionOfT(temp, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real EnergyDensityFromTemperature(const Real temp,
+                                    Real *lambda = nullptr) const {
+    return dist_.EnergyDensityFromTemperature(temp, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real TemperatureFromEnergyDensity(const Real er,
+                                    Real *lambda = nullptr) const {
+    return dist_.TemperatureFromEnergyDensity(er, lambda);
+  }
+
+  PORTABLE_INLINE_FUNCTION
+  Real NumberDensityFromTemperature(const Real temp,
+                                    Real *lambda = nullptr) const {
+    return dist_.NumberDensityFromTemperature(temp, lambda);
+  }
+
+ private:
+  // The absorption of the Kirchhoff components from their total
+  // emissivity jK, skipping B_nu when there is none
+  PORTABLE_FORCEINLINE_FUNCTION
+  Real KirchhoffAbsorption_(const Real jK, const Real temp, const Real nu,
+                            Real *lambda) const {
+    if (jK == 0) return 0;
+    const Real Bnu = dist_.ThermalDistributionOfTNu(temp, nu, lambda);
+    return singularity_opac::robust::ratio(jK, Bnu);
+  }
+
+  singularity::impl::SumComponents<Models...> models_;
+  PlanckDistribution<pc> dist_;
+};
+
+} // namespace photons
+} // namespace singularity
+
+#endif // SINGULARITY_OPAC_PHOTONS_SUM_OPACITY_PHOTONS_
@@ -0,0 +1,125 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+#ifndef SINGULARITY_OPAC_PHOTONS_ZONE_QUERIES_PHOTONS_
+#define SINGULARITY_OPAC_PHOTONS_ZONE_QUERIES_PHOTONS_
+
+#include <ports-of-call/portability.hpp>
+
+#include <singularity-opac/base/zone_loops.hpp>
+
+// What the bulk forms of the photon variants evaluate at each
+// zone. See singularity-opac/base/zone_loops.hpp.
+
+namespace singularity {
+namespace photons {
+namespace impl {
+
+// Zone z is at rho[z] and temp[z]
+template <typename ZoneIndexer>
+struct ZoneArrays {
+  ZoneIndexer rho;
+  ZoneIndexer temp;
+};
+template <typename ZoneIndexer>
+ZoneArrays<ZoneIndexer> zoneArrays(const ZoneIndexer &rho,
+                                   const ZoneIndexer &temp) {
+  return {rho, temp};
+}
+
+struct AbsorptionQuery {
+  template <typename Opac, typename Zones, typename FrequencyIndexer,
+            typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION static void
+  spectrum(const Opac &opac, const Zones &zones, const int z,
+           const FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+           const int nbins) {
+    opac.AbsorptionCoefficient(zones.rho[z], zones.temp[z], nu_bins, coeffs,
+                               nbins);
+  }
+};
+
+struct EmissivityPerNuQuery {
+  template <typename Opac, typename Zones, typename FrequencyIndexer,
+            typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION static void
+  spectrum(const Opac &opac, const Zones &zones, const int z,
+           const FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+           const int nbins) {
+    opac.EmissivityPerNu(zones.rho[z], zones.temp[z], nu_bins, coeffs, nbins);
+  }
+};
+
+struct EmissivityQuery {
+  template <typename Opac, typename Zones>
+  PORTABLE_INLINE_FUNCTION static Real value(const Opac &opac,
+                                             const Zones &zones, const int z) {
+    return opac.Emissivity(zones.rho[z], zones.temp[z]);
+  }
+};
+
+struct TotalScatteringQuery {
+  template <typename Opac, typename Zones, typename FrequencyIndexer,
+            typename DataIndexer>
+  PORTABLE_INLINE_FUNCTION static void
+  spectrum(const Opac &opac, const Zones &zones, const int z,
+           const FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+           const int nbins) {
+    for (int i = 0; i < nbins; ++i) {
+      coeffs[i] = opac.TotalScatteringCoefficient(zones.rho[z], zones.temp[z],
+                                                  nu_bins[i]);
+    }
+  }
+};
+
+struct PlanckMeanAbsorptionQuery {
+  template <typename Opac, typename Zones>
+  PORTABLE_INLINE_FUNCTION static Real value(const Opac &opac,
+                                             const Zones &zones, const int z) {
+    return opac.PlanckMeanAbsorptionCoefficient(zones.rho[z], zones.temp[z]);
+  }
+};
+
+struct RosselandMeanAbsorptionQuery {
+  template <typename Opac, typename Zones>
+  PORTABLE_INLINE_FUNCTION static Real value(const Opac &opac,
+                                             const Zones &zones, const int z) {
+    return opac.RosselandMeanAbsorptionCoefficient(zones.rho[z], zones.temp[z]);
+  }
+};
+
+struct PlanckMeanScatteringQuery {
+  template <typename Opac, typename Zones>
+  PORTABLE_INLINE_FUNCTION static Real value(const Opac &opac,
+                                             const Zones &zones, const int z) {
+    return opac.PlanckMeanTotalScatteringCoefficient(zones.rho[z],
+                                                     zones.temp[z]);
+  }
+};
+
+struct RosselandMeanScatteringQuery {
+  template <typename Opac, typename Zones>
+  PORTABLE_INLINE_FUNCTION static Real value(const Opac &opac,
+                                             const Zones &zones, const int z) {
+    return opac.RosselandMeanTotalScatteringCoefficient(zones.rho[z],
+                                                        zones.temp[z]);
+  }
+};
+
+} // namespace impl
+} // namespace photons
+} // namespace singularity
+
+#endif // SINGULARITY_OPAC_PHOTONS_ZONE_QUERIES_PHOTONS_
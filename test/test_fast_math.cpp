@@ -0,0 +1,111 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+#include <cmath>
+#include <limits>
+
+#include <catch2/catch.hpp>
+
+#include <fast-math/logs.hpp>
+#include <ports-of-call/portability.hpp>
+
+TEST_CASE("Double precision fast logs", "[FastMath]") {
+  // Sample the whole normal range, plus a few points in every decade
+  constexpr int NDECADES = 616;
+  constexpr int NPERDECADE = 97;
+  constexpr Real lxmin = -307.5;
+
+  WHEN("We take log10 of positive numbers") {
+    int n_wrong = 0;
+    portableReduce(
+        "log10 vs std", 0, NDECADES * NPERDECADE,
+        PORTABLE_LAMBDA(const int i, int &accumulate) {
+          const Real x = std::pow(10., lxmin + i / Real(NPERDECADE));
+          const Real ref = std::log10(x);
+          // documented bound plus an ulp for std::log10 itself
+          const Real tol = 4e-16 * std::max(1.0, std::abs(ref));
+          if (std::abs(BDMath::log10(x) - ref) > tol) {
+            accumulate += 1;
+          }
+        },
+        n_wrong);
+    THEN("It agrees with std::log10") { REQUIRE(n_wrong == 0); }
+  }
+
+  WHEN("We take log10 near 1") {
+    int n_wrong = 0;
+    portableReduce(
+        "log10 near 1", 0, 10000,
+        PORTABLE_LAMBDA(const int i, int &accumulate) {
+          const Real x = 0.5 + 1.5 * i / 10000.;
+          if (std::abs(BDMath::log10(x) - std::log10(x)) > 4e-16) {
+            accumulate += 1;
+          }
+        },
+        n_wrong);
+    THEN("The absolute error is a few ulp of 1") { REQUIRE(n_wrong == 0); }
+  }
+
+  WHEN("We take exp10") {
+    int n_wrong = 0;
+    portableReduce(
+        "exp10 vs std", 0, NDECADES * NPERDECADE,
+        PORTABLE_LAMBDA(const int i, int &accumulate) {
+          const Real lx = lxmin + i / Real(NPERDECADE);
+          const Real ref = std::pow(10., lx);
+          if (std::abs(BDMath::exp10(lx) - ref) > 6e-16 * ref) {
+            accumulate += 1;
+          }
+        },
+        n_wrong);
+    THEN("It agrees with std::pow") { REQUIRE(n_wrong == 0); }
+  }
+
+  WHEN("We take log2 and exp2") {
+    int n_wrong = 0;
+    portableReduce(
+        "base 2 vs std", 0, NDECADES * NPERDECADE,
+        PORTABLE_LAMBDA(const int i, int &accumulate) {
+          const Real l2x = (lxmin + i / Real(NPERDECADE)) * 3.321928094887362;
+          const Real ref = std::exp2(l2x);
+          if (std::abs(BDMath::exp2(l2x) - ref) > 4e-16 * ref) {
+            accumulate += 1;
+          }
+          const Real lref = std::log2(ref);
+          if (std::abs(BDMath::log2(ref) - lref) >
+              3e-16 * std::max(1.0, std::abs(lref))) {
+            accumulate += 1;
+          }
+        },
+        n_wrong);
+    THEN("They agree with the standard library") { REQUIRE(n_wrong == 0); }
+  }
+
+  THEN("The edges of the double range behave like the standard library") {
+    constexpr Real inf = std::numeric_limits<Real>::infinity();
+    constexpr Real denorm = std::numeric_limits<Real>::denorm_min();
+    REQUIRE(BDMath::exp10(309.) == inf);
+    REQUIRE(BDMath::exp10(inf) == inf);
+    REQUIRE(BDMath::exp10(-400.) == 0);
+    REQUIRE(BDMath::exp10(-inf) == 0);
+    REQUIRE(std::isnan(BDMath::exp10(std::nan(""))));
+    REQUIRE(BDMath::exp10(-320.) == Approx(std::pow(10., -320.)));
+    REQUIRE(BDMath::log10(denorm) == Approx(std::log10(denorm)));
+    REQUIRE(BDMath::log10(0.) < -324);
+    REQUIRE(BDMath::exp2(1024.) == inf);
+    REQUIRE(BDMath::exp2(-1074.) == denorm);
+    REQUIRE(BDMath::log2(denorm) == -1074);
+  }
+}
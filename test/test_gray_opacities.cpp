@@ -109,6 +109,29 @@ TEST_CASE("Gray neutrino opacities", "[GrayNeutrinos]") {
               if (FractionalDifference(jnu, jnu_funny * j_unit) > EPS_TEST) {
                 n_wrong_d() += 1;
               }
+              Real alpha_fused, jnu_fused;
+              funny_units.AbsorptionAndEmissivity(
+                  rho / rho_unit, temp / temp_unit, Ye, type, nu * time_unit,
+                  alpha_fused, jnu_fused);
+              Real alpha = opac.AbsorptionCoefficient(rho, temp, Ye, type, nu);
+              if (FractionalDifference(alpha, alpha_fused / length_unit) >
+                  EPS_TEST) {
+                n_wrong_d() += 1;
+              }
+              if (FractionalDifference(jnu, jnu_fused * j_unit) > EPS_TEST) {
+                n_wrong_d() += 1;
+              }
+              // The log derivative of B in T picks up one temp_unit
+              Real B_funny = funny_units.ThermalDistributionOfTNu(
+                  temp / temp_unit, type, nu * time_unit);
+              Real dBdT_funny = funny_units.DThermalDistributionOfTNuDT(
+                  temp / temp_unit, type, nu * time_unit);
+              Real B = opac.ThermalDistributionOfTNu(temp, type, nu);
+              Real dBdT = opac.DThermalDistributionOfTNuDT(temp, type, nu);
+              if (FractionalDifference(dBdT / B * temp_unit,
+                                       dBdT_funny / B_funny) > EPS_TEST) {
+                n_wrong_d() += 1;
+              }
             });
 #ifdef PORTABILITY_STRATEGY_KOKKOS
         Kokkos::deep_copy(n_wrong_h, n_wrong_d);
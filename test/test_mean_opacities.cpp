@@ -15,6 +15,9 @@
 
 #include <cmath>
 #include <iostream>
+#include <string>
+
+#include <unistd.h>
 
 #include <catch2/catch.hpp>
 
@@ -59,6 +62,69 @@ PORTABLE_INLINE_FUNCTION bool IsWrong(const T &a, const T &b) {
            FractionalDifference(a, b) > EPS_TEST));
 }
 
+// Absorption and scattering coefficients a nu^2 and exact thermal
+// spectra, so that the mean opacities are known in closed form.
+// Counts the frequencies absorption is evaluated at.
+struct PowerLawNeutrinos {
+  template <typename FrequencyIndexer, typename DataIndexer>
+  void AbsorptionCoefficient(const Real rho, const Real temp, const Real Ye,
+                             const RadiationType type,
+                             FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+                             const int nbins, Real *lambda = nullptr) const {
+    for (int i = 0; i < nbins; ++i) {
+      coeffs[i] = a * nu_bins[i] * nu_bins[i];
+    }
+    *evaluations += nbins;
+  }
+  Real TotalScatteringCoefficient(const Real rho, const Real temp,
+                                  const Real Ye, const RadiationType type,
+                                  const Real nu, Real *lambda = nullptr) const {
+    return a * nu * nu;
+  }
+  Real ThermalDistributionOfTNu(const Real temp, const RadiationType type,
+                                const Real nu) const {
+    const Real x = pc::h * nu / (pc::kb * temp);
+    return 2. * pc::h * nu * nu * nu / (pc::c * pc::c) / (std::exp(x) + 1.);
+  }
+  Real DThermalDistributionOfTNuDT(const Real temp, const RadiationType type,
+                                   const Real nu) const {
+    const Real x = pc::h * nu / (pc::kb * temp);
+    return 2. * pc::h * pc::h * nu * nu * nu * nu /
+           (pc::c * pc::c * pc::kb * temp * temp) * std::exp(x) /
+           ((std::exp(x) + 1.) * (std::exp(x) + 1.));
+  }
+  Real a;
+  int *evaluations;
+};
+
+struct PowerLawPhotons {
+  template <typename FrequencyIndexer, typename DataIndexer>
+  void AbsorptionCoefficient(const Real rho, const Real temp,
+                             FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+                             const int nbins, Real *lambda = nullptr) const {
+    for (int i = 0; i < nbins; ++i) {
+      coeffs[i] = a * nu_bins[i] * nu_bins[i];
+    }
+    *evaluations += nbins;
+  }
+  Real TotalScatteringCoefficient(const Real rho, const Real temp,
+                                  const Real nu, Real *lambda = nullptr) const {
+    return a * nu * nu;
+  }
+  Real ThermalDistributionOfTNu(const Real temp, const Real nu) const {
+    const Real x = pc::h * nu / (pc::kb * temp);
+    return 2. * pc::h * nu * nu * nu / (pc::c * pc::c) / std::expm1(x);
+  }
+  Real DThermalDistributionOfTNuDT(const Real temp, const Real nu) const {
+    const Real x = pc::h * nu / (pc::kb * temp);
+    return 2. * pc::h * pc::h * nu * nu * nu * nu /
+           (pc::c * pc::c * pc::kb * temp * temp) * std::exp(x) /
+           (std::expm1(x) * std::expm1(x));
+  }
+  Real a;
+  int *evaluations;
+};
+
 TEST_CASE("Mean neutrino opacities", "[MeanNeutrinos]") {
   const std::string grayname = "mean_gray.sp5";
 
@@ -92,6 +158,215 @@ TEST_CASE("Mean neutrino opacities", "[MeanNeutrinos]") {
     // neutrinos::MeanOpacity mean_opac = mean_opac_host.GetOnDevice();
     auto mean_opac = mean_opac_host.GetOnDevice();
 
+    THEN("The table doesn't depend on the number of threads building it") {
+      const neutrinos::BRTOpac brt = neutrinos::BRTOpac();
+      neutrinos::MeanOpacityCGS serial(brt, lRhoMin, lRhoMax, NRho, lTMin,
+                                       lTMax, NT, YeMin, YeMax, NYe, nullptr,
+                                       TablePrecision::Double, 1);
+      neutrinos::MeanOpacityCGS threaded(brt, lRhoMin, lRhoMax, NRho, lTMin,
+                                         lTMax, NT, YeMin, YeMax, NYe, nullptr,
+                                         TablePrecision::Double, 3);
+      int n_wrong = 0;
+      for (int iRho = 0; iRho < NRho; ++iRho) {
+        for (int iT = 0; iT < NT; ++iT) {
+          for (int iYe = 0; iYe < NYe; ++iYe) {
+            const Real rho =
+                std::pow(10, lRhoMin + (lRhoMax - lRhoMin) / (NRho - 1) * iRho);
+            const Real T =
+                std::pow(10, lTMin + (lTMax - lTMin) / (NT - 1) * iT);
+            const Real Ye = YeMin + (YeMax - YeMin) / (NYe - 1) * iYe;
+            for (int itp = 0; itp < NEUTRINO_NTYPES; ++itp) {
+              const RadiationType type = Idx2RadType(itp);
+              if (serial.PlanckMeanAbsorptionCoefficient(rho, T, Ye, type) !=
+                      threaded.PlanckMeanAbsorptionCoefficient(rho, T, Ye,
+                                                               type) ||
+                  serial.RosselandMeanAbsorptionCoefficient(rho, T, Ye, type) !=
+                      threaded.RosselandMeanAbsorptionCoefficient(rho, T, Ye,
+                                                                  type)) {
+                n_wrong += 1;
+              }
+            }
+          }
+        }
+      }
+      REQUIRE(n_wrong == 0);
+      serial.Finalize();
+      threaded.Finalize();
+    }
+
+    THEN("Every quadrature rule reproduces the gray opacity") {
+      const MeanQuadrature rules[] = {{QuadratureRule::GaussLaguerre, 16},
+                                      {QuadratureRule::GaussKronrod}};
+      int n_wrong = 0;
+      for (const MeanQuadrature &quadrature : rules) {
+        neutrinos::MeanOpacityCGS gray(opac_host, lRhoMin, lRhoMax, NRho,
+                                       lTMin, lTMax, NT, YeMin, YeMax, NYe,
+                                       quadrature);
+        for (int iRho = 0; iRho < NRho; ++iRho) {
+          for (int iT = 0; iT < NT; ++iT) {
+            const Real rho =
+                std::pow(10, lRhoMin + (lRhoMax - lRhoMin) / (NRho - 1) * iRho);
+            const Real T =
+                std::pow(10, lTMin + (lTMax - lTMin) / (NT - 1) * iT);
+            const Real alpha = rho * kappa;
+            if (FractionalDifference(
+                    gray.PlanckMeanAbsorptionCoefficient(rho, T, Ye, type),
+                    alpha) > 1e-10 ||
+                FractionalDifference(
+                    gray.RosselandMeanAbsorptionCoefficient(rho, T, Ye, type),
+                    alpha) > 1e-10) {
+              n_wrong += 1;
+            }
+          }
+        }
+        gray.Finalize();
+      }
+      REQUIRE(n_wrong == 0);
+    }
+
+    THEN("High order quadratures match the absorption and scattering means "
+         "of a power law") {
+      // In units of a (k T / h)^2, for a Fermi-Dirac spectrum without
+      // chemical potential
+      const Real planck = 310. / 147. * M_PI * M_PI;
+      const Real rosseland = 7. / 5. * M_PI * M_PI;
+      constexpr Real a = 1e-42;
+      const MeanQuadrature rules[] = {{QuadratureRule::GaussLaguerre, 16},
+                                      {QuadratureRule::GaussKronrod}};
+      int evaluations[2] = {0, 0};
+      int n_wrong = 0;
+      for (int r = 0; r < 2; ++r) {
+        const PowerLawNeutrinos power_law = {a, &evaluations[r]};
+        neutrinos::MeanOpacityCGS mean(power_law, lRhoMin, lRhoMax, NRho, lTMin,
+                                       lTMax, NT, YeMin, YeMax, NYe, rules[r],
+                                       nullptr, TablePrecision::Double, 1);
+        for (int iRho = 0; iRho < NRho; ++iRho) {
+          for (int iT = 0; iT < NT; ++iT) {
+            const Real rho =
+                std::pow(10, lRhoMin + (lRhoMax - lRhoMin) / (NRho - 1) * iRho);
+            const Real T =
+                std::pow(10, lTMin + (lTMax - lTMin) / (NT - 1) * iT);
+            const Real nuT = pc::kb * T / pc::h;
+            const Real alpha = a * nuT * nuT;
+            if (FractionalDifference(
+                    mean.PlanckMeanAbsorptionCoefficient(rho, T, Ye, type),
+                    planck * alpha) > 1e-6 ||
+                FractionalDifference(
+                    mean.RosselandMeanAbsorptionCoefficient(rho, T, Ye, type),
+                    rosseland * alpha) > 1e-6) {
+              n_wrong += 1;
+            }
+          }
+        }
+        mean.Finalize();
+      }
+      REQUIRE(n_wrong == 0);
+      // Both take fewer than the 100 points of the default rule
+      constexpr int NODES = NRho * NT * NYe * NEUTRINO_NTYPES;
+      REQUIRE(evaluations[0] == 16 * NODES);
+      REQUIRE(evaluations[1] < 100 * NODES);
+
+      // Scattering tables take their spectra from their thermal
+      // distribution, so only the Planck mean is known in closed form
+      const PowerLawNeutrinos power_law = {a, &evaluations[0]};
+      neutrinos::MeanSOpacityCGS laguerre(power_law, lRhoMin, lRhoMax, NRho,
+                                          lTMin, lTMax, NT, YeMin, YeMax, NYe,
+                                          rules[0]);
+      neutrinos::MeanSOpacityCGS kronrod(power_law, lRhoMin, lRhoMax, NRho,
+                                         lTMin, lTMax, NT, YeMin, YeMax, NYe,
+                                         rules[1]);
+      for (int iT = 0; iT < NT; ++iT) {
+        const Real T = std::pow(10, lTMin + (lTMax - lTMin) / (NT - 1) * iT);
+        const Real nuT = pc::kb * T / pc::h;
+        const Real alpha = a * nuT * nuT;
+        for (const auto *smean : {&laguerre, &kronrod}) {
+          if (FractionalDifference(
+                  smean->PlanckMeanTotalScatteringCoefficient(rho, T, Ye, type),
+                  planck * alpha) > 1e-6 ||
+              FractionalDifference(
+                  smean->RosselandMeanTotalScatteringCoefficient(rho, T, Ye,
+                                                                 type),
+                  laguerre.RosselandMeanTotalScatteringCoefficient(rho, T, Ye,
+                                                                   type)) >
+                  1e-6) {
+            n_wrong += 1;
+          }
+        }
+      }
+      REQUIRE(n_wrong == 0);
+      laguerre.Finalize();
+      kronrod.Finalize();
+    }
+
+    THEN("A float table agrees with the double table") {
+      neutrinos::MeanOpacityCGS float_host(
+          opac_host, lRhoMin, lRhoMax, NRho, lTMin, lTMax, NT, YeMin, YeMax,
+          NYe, nullptr, TablePrecision::Float);
+      auto float_opac = float_host.GetOnDevice();
+
+      int n_wrong = 0;
+      portableReduce(
+          "float vs double", 0, NRho - 1, 0, NT - 1, 0, NYe - 1, 0,
+          NEUTRINO_NTYPES,
+          PORTABLE_LAMBDA(const int iRho, const int iT, const int iYe,
+                          const int itp, int &accumulate) {
+            const Real dlRho = (lRhoMax - lRhoMin) / (NRho - 1);
+            const Real dlT = (lTMax - lTMin) / (NT - 1);
+            const Real dYe = (YeMax - YeMin) / (NYe - 1);
+            const Real rho = std::pow(10, lRhoMin + (iRho + 0.3) * dlRho);
+            const Real T = std::pow(10, lTMin + (iT + 0.6) * dlT);
+            const Real Ye = YeMin + (iYe + 0.2) * dYe;
+            const RadiationType type = Idx2RadType(itp);
+            const Real refs[] = {
+                mean_opac.PlanckMeanAbsorptionCoefficient(rho, T, Ye, type),
+                mean_opac.RosselandMeanAbsorptionCoefficient(rho, T, Ye, type)};
+            const Real vals[] = {
+                float_opac.PlanckMeanAbsorptionCoefficient(rho, T, Ye, type),
+                float_opac.RosselandMeanAbsorptionCoefficient(rho, T, Ye,
+                                                              type)};
+            for (int k = 0; k < 2; ++k) {
+              // float rounding of the stored log10
+              const Real tol =
+                  1e-6 * std::max(1.0, std::abs(std::log10(refs[k])));
+              if (FractionalDifference(refs[k], vals[k]) > tol) {
+                accumulate += 1;
+              }
+            }
+          },
+          n_wrong);
+      REQUIRE(n_wrong == 0);
+
+#ifdef SPINER_USE_HDF
+      AND_THEN("A float table reloads exactly") {
+        float_host.Save(grayname);
+        neutrinos::MeanOpacityCGS reloaded(grayname, TablePrecision::Float);
+        n_wrong = 0;
+        portableReduce(
+            "float reload", 0, NRho, 0, NT, 0, NYe, 0, NEUTRINO_NTYPES,
+            PORTABLE_LAMBDA(const int iRho, const int iT, const int iYe,
+                            const int itp, int &accumulate) {
+              const Real rho = std::pow(
+                  10, lRhoMin + (lRhoMax - lRhoMin) / (NRho - 1) * iRho);
+              const Real T =
+                  std::pow(10, lTMin + (lTMax - lTMin) / (NT - 1) * iT);
+              const Real Ye = YeMin + (YeMax - YeMin) / (NYe - 1) * iYe;
+              const RadiationType type = Idx2RadType(itp);
+              if (float_opac.PlanckMeanAbsorptionCoefficient(rho, T, Ye,
+                                                             type) !=
+                  reloaded.PlanckMeanAbsorptionCoefficient(rho, T, Ye, type)) {
+                accumulate += 1;
+              }
+            },
+            n_wrong);
+        REQUIRE(n_wrong == 0);
+        reloaded.Finalize();
+      }
+#endif
+
+      float_opac.Finalize();
+      float_host.Finalize();
+    }
+
     THEN("The emissivity per nu omega is consistent with the emissity per nu") {
       int n_wrong_h = 0;
 #ifdef PORTABILITY_STRATEGY_KOKKOS
@@ -165,8 +440,90 @@ TEST_CASE("Mean neutrino opacities", "[MeanNeutrinos]") {
         REQUIRE(n_wrong == 0);
       }
     }
+
+    THEN("A table loaded in other units matches MeanNonCGSUnits") {
+      constexpr Real time_unit = 123;
+      constexpr Real mass_unit = 456;
+      constexpr Real length_unit = 789;
+      constexpr Real temp_unit = 276;
+      constexpr Real rho_unit =
+          mass_unit / (length_unit * length_unit * length_unit);
+      mean_opac_host.Save(grayname);
+      neutrinos::MeanOpacityCGS baked(
+          grayname, UnitSystem(time_unit, mass_unit, length_unit, temp_unit));
+      neutrinos::MeanNonCGSUnits<neutrinos::MeanOpacityCGS> wrapped(
+          neutrinos::MeanOpacityCGS(grayname), time_unit, mass_unit,
+          length_unit, temp_unit);
+      for (const Real f : {0.15, 0.5, 0.85}) {
+        const Real rho =
+            std::pow(10, lRhoMin + f * (lRhoMax - lRhoMin)) / rho_unit;
+        const Real T = std::pow(10, lTMax - f * (lTMax - lTMin)) / temp_unit;
+        const Real Ye = YeMin + f * (YeMax - YeMin);
+        for (int itp = 0; itp < NEUTRINO_NTYPES; ++itp) {
+          const RadiationType type = Idx2RadType(itp);
+          REQUIRE(baked.InTable(rho, T, Ye));
+          REQUIRE(FractionalDifference(
+                      baked.PlanckMeanAbsorptionCoefficient(rho, T, Ye, type),
+                      wrapped.PlanckMeanAbsorptionCoefficient(rho, T, Ye,
+                                                              type)) < 1e-10);
+          REQUIRE(FractionalDifference(
+                      baked.RosselandMeanAbsorptionCoefficient(rho, T, Ye,
+                                                               type),
+                      wrapped.RosselandMeanAbsorptionCoefficient(rho, T, Ye,
+                                                                 type)) <
+                  1e-10);
+        }
+      }
+      baked.Finalize();
+      wrapped.Finalize();
+    }
 #endif
 
+    THEN("Points outside the table can fall back to another model") {
+      neutrinos::MeanOpacityCGS table_host(opac_host, lRhoMin, lRhoMax, NRho,
+                                           lTMin, lTMax, NT, YeMin, YeMax,
+                                           NYe);
+      neutrinos::MeanOpacityCGS wide_host(neutrinos::Gray(2 * kappa),
+                                          lRhoMin - 2, lRhoMax + 2, NRho,
+                                          lTMin - 2, lTMax + 2, NT, 0, 0.6,
+                                          NYe);
+      OutOfRangePolicy policy;
+      policy.rho = OutOfRange::Fallback;
+      policy.T = OutOfRange::Clamp;
+      table_host.SetOutOfRange(policy);
+      REQUIRE(table_host.InTable(rho, temp, Ye));
+      REQUIRE(table_host.InTable(rho, 100 * temp, Ye));
+      REQUIRE(!table_host.InTable(100 * rho, temp, Ye));
+      neutrinos::MeanWithFallback<neutrinos::MeanOpacityCGS,
+                                  neutrinos::MeanOpacityCGS>
+          mean(table_host.GetOnDevice(), wide_host.GetOnDevice());
+
+      // Inside, past the clamped T axis, and past the rho axis
+      int n_wrong = 0;
+      portableReduce(
+          "mean fallback", 0, 3,
+          PORTABLE_LAMBDA(const int i, int &accumulate) {
+            const Real rhos[] = {rho, rho, 100 * rho};
+            const Real temps[] = {temp, 100 * temp, temp};
+            const Real kappas[] = {kappa, kappa, 2 * kappa};
+            const Real ref = rhos[i] * kappas[i];
+            for (int itp = 0; itp < NEUTRINO_NTYPES; ++itp) {
+              const RadiationType type = Idx2RadType(itp);
+              if (IsWrong(ref, mean.PlanckMeanAbsorptionCoefficient(
+                                   rhos[i], temps[i], Ye, type)) ||
+                  IsWrong(ref, mean.RosselandMeanAbsorptionCoefficient(
+                                   rhos[i], temps[i], Ye, type))) {
+                accumulate += 1;
+              }
+            }
+          },
+          n_wrong);
+      REQUIRE(n_wrong == 0);
+      mean.Finalize();
+      table_host.Finalize();
+      wide_host.Finalize();
+    }
+
     THEN("We can create an opacity object with funny units") {
       constexpr Real time_unit = 123;
       constexpr Real mass_unit = 456;
@@ -209,6 +566,19 @@ TEST_CASE("Mean neutrino opacities", "[MeanNeutrinos]") {
                 EPS_TEST) {
               n_wrong_d() += 1;
             }
+            // The same through a prepared lookup
+            const LookupState s =
+                funny_units.PrepareLookup(rho / rho_unit, temp / temp_unit, Ye);
+            if (FractionalDifference(
+                    funny_units.PlanckMeanAbsorptionCoefficient(s, type),
+                    alphaPlanckFunny) > 1e-12) {
+              n_wrong_d() += 1;
+            }
+            if (FractionalDifference(
+                    funny_units.RosselandMeanAbsorptionCoefficient(s, type),
+                    alphaRosselandFunny) > 1e-12) {
+              n_wrong_d() += 1;
+            }
           });
 
 #ifdef PORTABILITY_STRATEGY_KOKKOS
@@ -379,6 +749,20 @@ TEST_CASE("Mean neutrino scattering opacities", "[MeanNeutrinosS]") {
                 EPS_TEST) {
               n_wrong_d() += 1;
             }
+            // The same through a prepared lookup
+            const LookupState s =
+                funny_units.PrepareLookup(rho / rho_unit, temp / temp_unit, Ye);
+            if (FractionalDifference(
+                    funny_units.PlanckMeanTotalScatteringCoefficient(s, type),
+                    alphaPlanckFunny) > 1e-12) {
+              n_wrong_d() += 1;
+            }
+            const Real alphaRosselandPrepared =
+                funny_units.RosselandMeanTotalScatteringCoefficient(s, type);
+            if (FractionalDifference(alphaRosselandPrepared,
+                                     alphaRosselandFunny) > 1e-12) {
+              n_wrong_d() += 1;
+            }
           });
 
 #ifdef PORTABILITY_STRATEGY_KOKKOS
@@ -418,6 +802,228 @@ TEST_CASE("Mean photon opacities", "[MeanPhotons]") {
                                            lTMin, lTMax, NT);
     auto mean_opac = mean_opac_host.GetOnDevice();
 
+    THEN("The table doesn't depend on the number of threads building it") {
+      const photons::EPBremss brems = photons::EPBremss();
+      photons::MeanOpacityCGS serial(brems, lRhoMin, lRhoMax, NRho, lTMin,
+                                     lTMax, NT, nullptr,
+                                     TablePrecision::Double, 1);
+      photons::MeanOpacityCGS threaded(brems, lRhoMin, lRhoMax, NRho, lTMin,
+                                       lTMax, NT, nullptr,
+                                       TablePrecision::Double, 3);
+      int n_wrong = 0;
+      for (int iRho = 0; iRho < NRho; ++iRho) {
+        for (int iT = 0; iT < NT; ++iT) {
+          const Real rho =
+              std::pow(10, lRhoMin + (lRhoMax - lRhoMin) / (NRho - 1) * iRho);
+          const Real T = std::pow(10, lTMin + (lTMax - lTMin) / (NT - 1) * iT);
+          if (serial.PlanckMeanAbsorptionCoefficient(rho, T) !=
+                  threaded.PlanckMeanAbsorptionCoefficient(rho, T) ||
+              serial.RosselandMeanAbsorptionCoefficient(rho, T) !=
+                  threaded.RosselandMeanAbsorptionCoefficient(rho, T)) {
+            n_wrong += 1;
+          }
+        }
+      }
+      REQUIRE(n_wrong == 0);
+      serial.Finalize();
+      threaded.Finalize();
+    }
+
+    THEN("Every quadrature rule reproduces the gray opacity") {
+      const MeanQuadrature rules[] = {{QuadratureRule::GaussLaguerre, 16},
+                                      {QuadratureRule::GaussKronrod}};
+      int n_wrong = 0;
+      for (const MeanQuadrature &quadrature : rules) {
+        photons::MeanOpacityCGS gray(opac_host, lRhoMin, lRhoMax, NRho, lTMin,
+                                     lTMax, NT, quadrature);
+        for (int iRho = 0; iRho < NRho; ++iRho) {
+          for (int iT = 0; iT < NT; ++iT) {
+            const Real rho =
+                std::pow(10, lRhoMin + (lRhoMax - lRhoMin) / (NRho - 1) * iRho);
+            const Real T =
+                std::pow(10, lTMin + (lTMax - lTMin) / (NT - 1) * iT);
+            const Real alpha = rho * kappa;
+            const Real planck = gray.PlanckMeanAbsorptionCoefficient(rho, T);
+            const Real rosseland =
+                gray.RosselandMeanAbsorptionCoefficient(rho, T);
+            if (FractionalDifference(planck, alpha) > 1e-10 ||
+                FractionalDifference(rosseland, alpha) > 1e-10) {
+              n_wrong += 1;
+            }
+          }
+        }
+        gray.Finalize();
+      }
+      REQUIRE(n_wrong == 0);
+    }
+
+    THEN("High order quadratures match the absorption and scattering means "
+         "of a power law") {
+      // In units of a (k T / h)^2, for a Planck spectrum
+      const Real planck = 40. / 21. * M_PI * M_PI;
+      const Real rosseland = 4. / 5. * M_PI * M_PI;
+      constexpr Real a = 1e-30;
+      const MeanQuadrature rules[] = {{QuadratureRule::GaussLaguerre, 16},
+                                      {QuadratureRule::GaussKronrod}};
+      int evaluations[2] = {0, 0};
+      int n_wrong = 0;
+      for (int r = 0; r < 2; ++r) {
+        const PowerLawPhotons power_law = {a, &evaluations[r]};
+        photons::MeanOpacityCGS mean(power_law, lRhoMin, lRhoMax, NRho, lTMin,
+                                     lTMax, NT, rules[r], nullptr,
+                                     TablePrecision::Double, 1);
+        for (int iRho = 0; iRho < NRho; ++iRho) {
+          for (int iT = 0; iT < NT; ++iT) {
+            const Real rho =
+                std::pow(10, lRhoMin + (lRhoMax - lRhoMin) / (NRho - 1) * iRho);
+            const Real T =
+                std::pow(10, lTMin + (lTMax - lTMin) / (NT - 1) * iT);
+            const Real nuT = pc::kb * T / pc::h;
+            const Real alpha = a * nuT * nuT;
+            const Real planck_mean =
+                mean.PlanckMeanAbsorptionCoefficient(rho, T);
+            const Real rosseland_mean =
+                mean.RosselandMeanAbsorptionCoefficient(rho, T);
+            if (FractionalDifference(planck_mean, planck * alpha) > 1e-6 ||
+                FractionalDifference(rosseland_mean, rosseland * alpha) >
+                    1e-6) {
+              n_wrong += 1;
+            }
+          }
+        }
+        mean.Finalize();
+      }
+      REQUIRE(n_wrong == 0);
+      // Both take fewer than the 100 points of the default rule
+      REQUIRE(evaluations[0] == 16 * NRho * NT);
+      REQUIRE(evaluations[1] < 100 * NRho * NT);
+
+      // Scattering tables take their spectra from their thermal
+      // distribution, so only the Planck mean is known in closed form
+      const PowerLawPhotons power_law = {a, &evaluations[0]};
+      photons::MeanSOpacityCGS laguerre(power_law, lRhoMin, lRhoMax, NRho,
+                                        lTMin, lTMax, NT, rules[0]);
+      photons::MeanSOpacityCGS kronrod(power_law, lRhoMin, lRhoMax, NRho,
+                                       lTMin, lTMax, NT, rules[1]);
+      for (int iT = 0; iT < NT; ++iT) {
+        const Real T = std::pow(10, lTMin + (lTMax - lTMin) / (NT - 1) * iT);
+        const Real nuT = pc::kb * T / pc::h;
+        const Real alpha = a * nuT * nuT;
+        for (const auto *smean : {&laguerre, &kronrod}) {
+          if (FractionalDifference(
+                  smean->PlanckMeanTotalScatteringCoefficient(rho, T),
+                  planck * alpha) > 1e-6 ||
+              FractionalDifference(
+                  smean->RosselandMeanTotalScatteringCoefficient(rho, T),
+                  laguerre.RosselandMeanTotalScatteringCoefficient(rho, T)) >
+                  1e-6) {
+            n_wrong += 1;
+          }
+        }
+      }
+      REQUIRE(n_wrong == 0);
+      laguerre.Finalize();
+      kronrod.Finalize();
+    }
+
+    THEN("A float table agrees with the double table") {
+      photons::MeanOpacityCGS float_host(opac_host, lRhoMin, lRhoMax, NRho,
+                                         lTMin, lTMax, NT, nullptr,
+                                         TablePrecision::Float);
+      auto float_opac = float_host.GetOnDevice();
+
+      int n_wrong = 0;
+      portableReduce(
+          "float vs double", 0, NRho - 1, 0, NT - 1, 0, 0,
+          PORTABLE_LAMBDA(const int iRho, const int iT, const int igarbage,
+                          int &accumulate) {
+            const Real dlRho = (lRhoMax - lRhoMin) / (NRho - 1);
+            const Real dlT = (lTMax - lTMin) / (NT - 1);
+            const Real rho = std::pow(10, lRhoMin + (iRho + 0.3) * dlRho);
+            const Real T = std::pow(10, lTMin + (iT + 0.6) * dlT);
+            const Real refs[] = {
+                mean_opac.PlanckMeanAbsorptionCoefficient(rho, T),
+                mean_opac.RosselandMeanAbsorptionCoefficient(rho, T)};
+            const Real vals[] = {
+                float_opac.PlanckMeanAbsorptionCoefficient(rho, T),
+                float_opac.RosselandMeanAbsorptionCoefficient(rho, T)};
+            for (int k = 0; k < 2; ++k) {
+              // float rounding of the stored log10
+              const Real tol =
+                  1e-6 * std::max(1.0, std::abs(std::log10(refs[k])));
+              if (FractionalDifference(refs[k], vals[k]) > tol) {
+                accumulate += 1;
+              }
+            }
+          },
+          n_wrong);
+      REQUIRE(n_wrong == 0);
+
+#ifdef SPINER_USE_HDF
+      AND_THEN("A float table reloads exactly") {
+        float_host.Save(grayname);
+        photons::MeanOpacityCGS reloaded(grayname, TablePrecision::Float);
+        n_wrong = 0;
+        portableReduce(
+            "float reload", 0, NRho, 0, NT, 0, 0,
+            PORTABLE_LAMBDA(const int iRho, const int iT, const int igarbage,
+                            int &accumulate) {
+              const Real rho = std::pow(
+                  10, lRhoMin + (lRhoMax - lRhoMin) / (NRho - 1) * iRho);
+              const Real T =
+                  std::pow(10, lTMin + (lTMax - lTMin) / (NT - 1) * iT);
+              if (float_opac.RosselandMeanAbsorptionCoefficient(rho, T) !=
+                  reloaded.RosselandMeanAbsorptionCoefficient(rho, T)) {
+                accumulate += 1;
+              }
+            },
+            n_wrong);
+        REQUIRE(n_wrong == 0);
+        reloaded.Finalize();
+      }
+#endif
+
+      float_opac.Finalize();
+      float_host.Finalize();
+    }
+
+    THEN("A quantized table agrees with the double table") {
+      photons::MeanOpacityCGS quantized_host(opac_host, lRhoMin, lRhoMax, NRho,
+                                             lTMin, lTMax, NT, nullptr,
+                                             TablePrecision::Quantized);
+      auto quantized = quantized_host.GetOnDevice();
+
+      int n_wrong = 0;
+      portableReduce(
+          "quantized vs double", 0, NRho - 1, 0, NT - 1, 0, 0,
+          PORTABLE_LAMBDA(const int iRho, const int iT, const int igarbage,
+                          int &accumulate) {
+            const Real dlRho = (lRhoMax - lRhoMin) / (NRho - 1);
+            const Real dlT = (lTMax - lTMin) / (NT - 1);
+            const Real rho = std::pow(10, lRhoMin + (iRho + 0.3) * dlRho);
+            const Real T = std::pow(10, lTMin + (iT + 0.6) * dlT);
+            const Real refs[] = {
+                mean_opac.PlanckMeanAbsorptionCoefficient(rho, T),
+                mean_opac.RosselandMeanAbsorptionCoefficient(rho, T)};
+            const Real vals[] = {
+                quantized.PlanckMeanAbsorptionCoefficient(rho, T),
+                quantized.RosselandMeanAbsorptionCoefficient(rho, T)};
+            for (int k = 0; k < 2; ++k) {
+              // half a quantization step of the stored log2
+              const Real tol =
+                  1e-5 * std::max(1.0, std::abs(std::log2(refs[k])));
+              if (FractionalDifference(refs[k], vals[k]) > tol) {
+                accumulate += 1;
+              }
+            }
+          },
+          n_wrong);
+      REQUIRE(n_wrong == 0);
+
+      quantized.Finalize();
+      quantized_host.Finalize();
+    }
+
     THEN("The emissivity per nu omega is consistent with the emissity per nu") {
       int n_wrong_h = 0;
 #ifdef PORTABILITY_STRATEGY_KOKKOS
@@ -446,6 +1052,67 @@ TEST_CASE("Mean photon opacities", "[MeanPhotons]") {
       REQUIRE(n_wrong_h == 0);
     }
 
+#ifdef SINGULARITY_USE_MMAP
+    THEN("A raw file maps back to the same table") {
+      const std::string rawname = "mean_gray_photons.raw";
+      mean_opac_host.SaveRaw(rawname);
+      photons::MeanOpacityCGS mapped(rawname, RawFormat());
+      photons::MeanOpacityCGS single(rawname, RawFormat(),
+                                     TablePrecision::Float);
+      photons::MeanOpacityCGS float_host(opac_host, lRhoMin, lRhoMax, NRho,
+                                         lTMin, lTMax, NT, nullptr,
+                                         TablePrecision::Float);
+      int n_wrong = 0;
+      portableReduce(
+          "raw table", 0, NRho - 1, 0, NT - 1, 0, 0,
+          PORTABLE_LAMBDA(const int iRho, const int iT, const int igarbage,
+                          int &accumulate) {
+            const Real dlRho = (lRhoMax - lRhoMin) / (NRho - 1);
+            const Real dlT = (lTMax - lTMin) / (NT - 1);
+            const Real rho = std::pow(10, lRhoMin + (iRho + 0.3) * dlRho);
+            const Real T = std::pow(10, lTMin + (iT + 0.6) * dlT);
+            if (mean_opac.PlanckMeanAbsorptionCoefficient(rho, T) !=
+                    mapped.PlanckMeanAbsorptionCoefficient(rho, T) ||
+                mean_opac.RosselandMeanAbsorptionCoefficient(rho, T) !=
+                    mapped.RosselandMeanAbsorptionCoefficient(rho, T) ||
+                float_host.RosselandMeanAbsorptionCoefficient(rho, T) !=
+                    single.RosselandMeanAbsorptionCoefficient(rho, T)) {
+              accumulate += 1;
+            }
+          },
+          n_wrong);
+      REQUIRE(n_wrong == 0);
+      mapped.Finalize();
+      single.Finalize();
+      float_host.Finalize();
+    }
+
+    THEN("The table can be shared through shared memory") {
+      const std::string shmname =
+          "/singularity_opac_mean_test_" + std::to_string(getpid());
+      mean_opac_host.SaveShared(shmname);
+      photons::MeanOpacityCGS shared(shmname, SharedMemory());
+      RemoveSharedTables(shmname);
+      int n_wrong = 0;
+      portableReduce(
+          "shared table", 0, NRho, 0, NT, 0, 0,
+          PORTABLE_LAMBDA(const int iRho, const int iT, const int igarbage,
+                          int &accumulate) {
+            const Real rho = std::pow(
+                10, lRhoMin + (lRhoMax - lRhoMin) / (NRho - 1) * iRho);
+            const Real T =
+                std::pow(10, lTMin + (lTMax - lTMin) / (NT - 1) * iT);
+            if (mean_opac.PlanckMeanAbsorptionCoefficient(rho, T) !=
+                shared.PlanckMeanAbsorptionCoefficient(rho, T)) {
+              accumulate += 1;
+            }
+          },
+          n_wrong);
+      REQUIRE(n_wrong == 0);
+      shared.Finalize();
+    }
+#endif
+
 #ifdef SPINER_USE_HDF
     THEN("We can save to disk and reload") {
       mean_opac.Save(grayname);
@@ -486,8 +1153,79 @@ TEST_CASE("Mean photon opacities", "[MeanPhotons]") {
         REQUIRE(n_wrong == 0);
       }
     }
+
+    THEN("A table loaded in other units matches MeanNonCGSUnits") {
+      constexpr Real time_unit = 123;
+      constexpr Real mass_unit = 456;
+      constexpr Real length_unit = 789;
+      constexpr Real temp_unit = 276;
+      constexpr Real rho_unit =
+          mass_unit / (length_unit * length_unit * length_unit);
+      mean_opac_host.Save(grayname);
+      photons::MeanOpacityCGS baked(
+          grayname, UnitSystem(time_unit, mass_unit, length_unit, temp_unit));
+      photons::MeanNonCGSUnits<photons::MeanOpacityCGS> wrapped(
+          photons::MeanOpacityCGS(grayname), time_unit, mass_unit, length_unit,
+          temp_unit);
+      for (const Real f : {0.15, 0.5, 0.85}) {
+        const Real rho =
+            std::pow(10, lRhoMin + f * (lRhoMax - lRhoMin)) / rho_unit;
+        const Real T = std::pow(10, lTMax - f * (lTMax - lTMin)) / temp_unit;
+        REQUIRE(baked.InTable(rho, T));
+        REQUIRE(FractionalDifference(
+                    baked.PlanckMeanAbsorptionCoefficient(rho, T),
+                    wrapped.PlanckMeanAbsorptionCoefficient(rho, T)) < 1e-10);
+        REQUIRE(FractionalDifference(
+                    baked.RosselandMeanAbsorptionCoefficient(rho, T),
+                    wrapped.RosselandMeanAbsorptionCoefficient(rho, T)) <
+                1e-10);
+      }
+      baked.Finalize();
+      wrapped.Finalize();
+    }
 #endif
 
+    THEN("Points outside the table can fall back to another model") {
+      photons::MeanOpacityCGS table_host(opac_host, lRhoMin, lRhoMax, NRho,
+                                         lTMin, lTMax, NT);
+      photons::MeanOpacityCGS wide_host(photons::Gray(2 * kappa), lRhoMin - 2,
+                                        lRhoMax + 2, NRho, lTMin - 2,
+                                        lTMax + 2, NT);
+      OutOfRangePolicy policy;
+      policy.rho = OutOfRange::Fallback;
+      policy.T = OutOfRange::Clamp;
+      table_host.SetOutOfRange(policy);
+      REQUIRE(table_host.InTable(rho, temp));
+      REQUIRE(table_host.InTable(rho, 100 * temp));
+      REQUIRE(!table_host.InTable(100 * rho, temp));
+      photons::MeanWithFallback<photons::MeanOpacityCGS,
+                                photons::MeanOpacityCGS>
+          mean(table_host.GetOnDevice(), wide_host.GetOnDevice());
+
+      // Inside, past the clamped T axis, and past the rho axis
+      int n_wrong = 0;
+      portableReduce(
+          "mean fallback", 0, 3,
+          PORTABLE_LAMBDA(const int i, int &accumulate) {
+            const Real rhos[] = {rho, rho, 100 * rho};
+            const Real temps[] = {temp, 100 * temp, temp};
+            const Real kappas[] = {kappa, kappa, 2 * kappa};
+            const Real ref = rhos[i] * kappas[i];
+            const Real planck =
+                mean.PlanckMeanAbsorptionCoefficient(rhos[i], temps[i]);
+            const Real rosseland =
+                mean.RosselandMeanAbsorptionCoefficient(rhos[i], temps[i]);
+            if (IsWrong(ref, planck) || IsWrong(ref, rosseland)) {
+              accumulate += 1;
+            }
+          },
+          n_wrong);
+      REQUIRE(n_wrong == 0);
+      mean.Finalize();
+      table_host.Finalize();
+      wide_host.Finalize();
+    }
+
     THEN("We can create an opacity object with funny units") {
       constexpr Real time_unit = 123;
       constexpr Real mass_unit = 456;
@@ -529,6 +1267,19 @@ TEST_CASE("Mean photon opacities", "[MeanPhotons]") {
                 EPS_TEST) {
               n_wrong_d() += 1;
             }
+            // The same through a prepared lookup
+            const LookupState s =
+                funny_units.PrepareLookup(rho / rho_unit, temp / temp_unit);
+            if (FractionalDifference(
+                    funny_units.PlanckMeanAbsorptionCoefficient(s),
+                    alphaPlanckFunny) > 1e-12) {
+              n_wrong_d() += 1;
+            }
+            if (FractionalDifference(
+                    funny_units.RosselandMeanAbsorptionCoefficient(s),
+                    alphaRosselandFunny) > 1e-12) {
+              n_wrong_d() += 1;
+            }
           });
 
 #ifdef PORTABILITY_STRATEGY_KOKKOS
@@ -600,6 +1351,68 @@ TEST_CASE("Mean photon scattering opacities", "[MeanPhotonS]") {
       REQUIRE(n_wrong_h == 0);
     }
 
+    THEN("A quantized table agrees with the double table") {
+      photons::MeanSOpacityCGS quantized_host(opac_host, lRhoMin, lRhoMax,
+                                              NRho, lTMin, lTMax, NT, nullptr,
+                                              TablePrecision::Quantized);
+      auto quantized = quantized_host.GetOnDevice();
+      int n_wrong = 0;
+      portableReduce(
+          "quantized vs double", 0, NRho - 1, 0, NT - 1, 0, 0,
+          PORTABLE_LAMBDA(const int iRho, const int iT, const int igarbage,
+                          int &accumulate) {
+            const Real dlRho = (lRhoMax - lRhoMin) / (NRho - 1);
+            const Real dlT = (lTMax - lTMin) / (NT - 1);
+            const Real rho = std::pow(10, lRhoMin + (iRho + 0.3) * dlRho);
+            const Real T = std::pow(10, lTMin + (iT + 0.6) * dlT);
+            const Real refs[] = {
+                mean_opac.PlanckMeanTotalScatteringCoefficient(rho, T),
+                mean_opac.RosselandMeanTotalScatteringCoefficient(rho, T)};
+            const Real vals[] = {
+                quantized.PlanckMeanTotalScatteringCoefficient(rho, T),
+                quantized.RosselandMeanTotalScatteringCoefficient(rho, T)};
+            for (int k = 0; k < 2; ++k) {
+              // half a quantization step of the stored log10
+              const Real tol =
+                  1e-5 * std::max(1.0, std::abs(std::log10(refs[k])));
+              if (FractionalDifference(refs[k], vals[k]) > tol) {
+                accumulate += 1;
+              }
+            }
+          },
+          n_wrong);
+      REQUIRE(n_wrong == 0);
+      quantized.Finalize();
+      quantized_host.Finalize();
+    }
+
+#ifdef SINGULARITY_USE_MMAP
+    THEN("A raw file maps back to the same table") {
+      const std::string rawname = "mean_gray_s.raw";
+      mean_opac_host.SaveRaw(rawname);
+      photons::MeanSOpacityCGS mapped(rawname, RawFormat());
+      int n_wrong = 0;
+      portableReduce(
+          "raw table", 0, NRho - 1, 0, NT - 1, 0, 0,
+          PORTABLE_LAMBDA(const int iRho, const int iT, const int igarbage,
+                          int &accumulate) {
+            const Real dlRho = (lRhoMax - lRhoMin) / (NRho - 1);
+            const Real dlT = (lTMax - lTMin) / (NT - 1);
+            const Real rho = std::pow(10, lRhoMin + (iRho + 0.3) * dlRho);
+            const Real T = std::pow(10, lTMin + (iT + 0.6) * dlT);
+            if (mean_opac.PlanckMeanTotalScatteringCoefficient(rho, T) !=
+                    mapped.PlanckMeanTotalScatteringCoefficient(rho, T) ||
+                mean_opac.RosselandMeanTotalScatteringCoefficient(rho, T) !=
+                    mapped.RosselandMeanTotalScatteringCoefficient(rho, T)) {
+              accumulate += 1;
+            }
+          },
+          n_wrong);
+      REQUIRE(n_wrong == 0);
+      mapped.Finalize();
+    }
+#endif
+
 #ifdef SPINER_USE_HDF
     THEN("We can save to disk and reload") {
       mean_opac.Save(grayname);
@@ -684,6 +1497,19 @@ TEST_CASE("Mean photon scattering opacities", "[MeanPhotonS]") {
                 EPS_TEST) {
               n_wrong_d() += 1;
             }
+            // The same through a prepared lookup
+            const LookupState s =
+                funny_units.PrepareLookup(rho / rho_unit, temp / temp_unit);
+            if (FractionalDifference(
+                    funny_units.PlanckMeanTotalScatteringCoefficient(s),
+                    alphaPlanckFunny) > 1e-12) {
+              n_wrong_d() += 1;
+            }
+            if (FractionalDifference(
+                    funny_units.RosselandMeanTotalScatteringCoefficient(s),
+                    alphaRosselandFunny) > 1e-12) {
+              n_wrong_d() += 1;
+            }
           });
 
 #ifdef PORTABILITY_STRATEGY_KOKKOS
@@ -695,3 +1521,70 @@ TEST_CASE("Mean photon scattering opacities", "[MeanPhotonS]") {
     opac.Finalize();
   }
 }
+
+#ifdef SPINER_USE_HDF
+TEST_CASE("Mean photon opacities from base 10 files", "[MeanPhotons]") {
+  const std::string legacyname = "mean_legacy_photons.sp5";
+  constexpr Real lRhoMin = -1;
+  constexpr Real lRhoMax = 1;
+  constexpr int NRho = 3;
+  constexpr Real lTMin = 4;
+  constexpr Real lTMax = 6;
+  constexpr int NT = 5;
+
+  WHEN("We write log10 tables without a recorded log base") {
+    // Linear in the log coordinates, so interpolation is exact
+    auto lkappa = [](const Real lRho, const Real lT) {
+      return 0.5 * lRho - 3 * lT;
+    };
+    Spiner::DataBox lkappa_db;
+    lkappa_db.resize(NRho, NT);
+    lkappa_db.setRange(0, lTMin, lTMax, NT);
+    lkappa_db.setRange(1, lRhoMin, lRhoMax, NRho);
+    for (int iRho = 0; iRho < NRho; ++iRho) {
+      for (int iT = 0; iT < NT; ++iT) {
+        lkappa_db(iRho, iT) =
+            lkappa(lkappa_db.range(1).x(iRho), lkappa_db.range(0).x(iT));
+      }
+    }
+    herr_t status = H5_SUCCESS;
+    hid_t file = H5Fcreate(legacyname.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT,
+                           H5P_DEFAULT);
+    status += lkappa_db.saveHDF(file, SP5::MeanOpac::PlanckMeanOpacity);
+    status += lkappa_db.saveHDF(file, SP5::MeanOpac::RosselandMeanOpacity);
+    status += H5Fclose(file);
+    REQUIRE(status == H5_SUCCESS);
+    lkappa_db.finalize();
+
+    photons::MeanOpacityCGS mean_opac_host(legacyname);
+    auto mean_opac = mean_opac_host.GetOnDevice();
+
+    THEN("They are read as log10") {
+      int n_wrong = 0;
+      portableReduce(
+          "legacy file", 0, NRho - 1, 0, NT - 1, 0, 0,
+          PORTABLE_LAMBDA(const int iRho, const int iT, const int igarbage,
+                          int &accumulate) {
+            const Real lRho =
+                lRhoMin + (iRho + 0.3) * (lRhoMax - lRhoMin) / (NRho - 1);
+            const Real lT = lTMin + (iT + 0.6) * (lTMax - lTMin) / (NT - 1);
+            const Real rho = std::pow(10, lRho);
+            const Real T = std::pow(10, lT);
+            const Real ref = rho * std::pow(10, lkappa(lRho, lT));
+            if (FractionalDifference(
+                    ref, mean_opac.PlanckMeanAbsorptionCoefficient(rho, T)) >
+                    1e-10 ||
+                FractionalDifference(
+                    ref, mean_opac.RosselandMeanAbsorptionCoefficient(
+                             rho, T)) > 1e-10) {
+              accumulate += 1;
+            }
+          },
+          n_wrong);
+      REQUIRE(n_wrong == 0);
+    }
+
+    mean_opac.Finalize();
+  }
+}
+#endif
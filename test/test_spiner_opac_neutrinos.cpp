@@ -13,10 +13,14 @@
 // publicly, and to permit others to do so.
 // ======================================================================
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 
 #include <string>
+#include <vector>
+
+#include <unistd.h>
 
 #include <catch2/catch.hpp>
 
@@ -27,7 +31,11 @@
 
 #include <singularity-opac/base/indexers.hpp>
 #include <singularity-opac/base/radiation_types.hpp>
+#include <singularity-opac/base/table_grid.hpp>
 #include <singularity-opac/constants/constants.hpp>
+#include <singularity-opac/neutrinos/adaptive_table_neutrinos.hpp>
+#include <singularity-opac/neutrinos/emission_sampler_neutrinos.hpp>
+#include <singularity-opac/neutrinos/mean_opacity_neutrinos.hpp>
 #include <singularity-opac/neutrinos/opac_neutrinos.hpp>
 #include <singularity-opac/neutrinos/spiner_opac_neutrinos.hpp>
 
@@ -43,6 +51,32 @@ template <typename T>
 PORTABLE_INLINE_FUNCTION T FractionalDifference(const T &a, const T &b) {
   return 2 * std::abs(b - a) / (std::abs(a) + std::abs(b) + 1e-20);
 }
+// Gray absorption that falls off above nu0, so that mean opacities
+// aren't power laws in T
+struct RolloffNeutrinos {
+  template <typename FrequencyIndexer, typename DataIndexer>
+  void AbsorptionCoefficient(const Real rho, const Real temp, const Real Ye,
+                             const RadiationType type,
+                             FrequencyIndexer &nu_bins, DataIndexer &coeffs,
+                             const int nbins, Real *lambda = nullptr) const {
+    for (int i = 0; i < nbins; ++i) {
+      const Real x = nu_bins[i] / nu0;
+      coeffs[i] = rho * kappa / (1. + x * x);
+    }
+  }
+  Real ThermalDistributionOfTNu(const Real temp, const RadiationType type,
+                                const Real nu) const {
+    return dist.ThermalDistributionOfTNu(temp, type, nu);
+  }
+  Real DThermalDistributionOfTNuDT(const Real temp, const RadiationType type,
+                                   const Real nu) const {
+    return dist.DThermalDistributionOfTNuDT(temp, type, nu);
+  }
+  Real kappa;
+  Real nu0;
+  neutrinos::FermiDiracDistributionNoMu<3> dist;
+};
+
 constexpr Real EPS_TEST = 1e-3;
 template <typename T>
 PORTABLE_INLINE_FUNCTION bool IsWrong(const T &a, const T &b) {
@@ -54,6 +88,28 @@ PORTABLE_INLINE_FUNCTION bool IsWrong(const T &a, const T &b) {
            FractionalDifference(a, b) > EPS_TEST));
 }
 
+// Opacities whose logs are linear in log rho, log T, Ye and log nu,
+// so that linear interpolation reproduces them on any grid
+struct PowerLawNeutrinos {
+  Real AbsorptionCoefficient(const Real rho, const Real temp, const Real Ye,
+                             const RadiationType type, const Real nu) const {
+    return std::pow(rho, 1.5) * std::sqrt(temp) * std::pow(10., Ye) /
+           (nu * nu) * (1 + RadType2Idx(type));
+  }
+  Real EmissivityPerNuOmega(const Real rho, const Real temp, const Real Ye,
+                            const RadiationType type, const Real nu) const {
+    return temp * temp * std::sqrt(nu) / rho * std::pow(10., -Ye);
+  }
+  Real Emissivity(const Real rho, const Real temp, const Real Ye,
+                  const RadiationType type) const {
+    return rho * temp * temp * temp;
+  }
+  Real NumberEmissivity(const Real rho, const Real temp, const Real Ye,
+                        const RadiationType type) const {
+    return std::sqrt(rho) / temp * std::pow(10., Ye);
+  }
+};
+
 TEST_CASE("Spiner opacities, filled with gray data",
           "[GrayNeutrinos][SpinerNeutrinos]") {
   constexpr Real MeV2K = 1e6 * pc::eV / pc::kb;
@@ -231,6 +287,437 @@ TEST_CASE("Spiner opacities, filled with gray data",
       opac.Finalize();
     }
 
+    THEN("The indexer API matches the scalar API between grid points") {
+      neutrinos::SpinerOpac opac = filled.GetOnDevice();
+
+      // Sample at cell centers so every axis actually interpolates
+      constexpr int NeHalf = Ne - 1;
+      Real *nu_bins = (Real *)PORTABLE_MALLOC(NeHalf * sizeof(Real));
+      portableFor(
+          "fill nu bins", 0, NeHalf, PORTABLE_LAMBDA(const int ie) {
+            const Real le = leGrid.x(ie) + 0.5 * leGrid.dx();
+            nu_bins[ie] = std::pow(10, le) * neutrinos::SpinerOpac::MeV2Hz;
+          });
+
+      int n_wrong = 0;
+      portableReduce(
+          "scalar vs indexer", 0, NRho - 1, 0, NT - 1, 0, NYe - 1, 0,
+          NEUTRINO_NTYPES,
+          PORTABLE_LAMBDA(const int iRho, const int iT, const int iYe,
+                          const int itp, int &accumulate) {
+            const Real rho =
+                std::pow(10, lRhoGrid.x(iRho) + 0.5 * lRhoGrid.dx());
+            const Real T = std::pow(10, lTGrid.x(iT) + 0.5 * lTGrid.dx());
+            const Real Ye = YeGrid.x(iYe) + 0.5 * YeGrid.dx();
+            const RadiationType type = Idx2RadType(itp);
+            Real data[NeHalf];
+
+            opac.AbsorptionCoefficient(rho, T, Ye, type, nu_bins, data, NeHalf);
+            for (int ie = 0; ie < NeHalf; ++ie) {
+              const Real alpha =
+                  opac.AbsorptionCoefficient(rho, T, Ye, type, nu_bins[ie]);
+              if (FractionalDifference(alpha, data[ie]) > 1e-12) {
+                accumulate += 1;
+              }
+            }
+
+            opac.EmissivityPerNuOmega(rho, T, Ye, type, nu_bins, data, NeHalf);
+            for (int ie = 0; ie < NeHalf; ++ie) {
+              const Real jnu =
+                  opac.EmissivityPerNuOmega(rho, T, Ye, type, nu_bins[ie]);
+              if (FractionalDifference(jnu, data[ie]) > 1e-12) {
+                accumulate += 1;
+              }
+            }
+
+            opac.EmissivityPerNu(rho, T, Ye, type, nu_bins, data, NeHalf);
+            for (int ie = 0; ie < NeHalf; ++ie) {
+              const Real Jnu =
+                  opac.EmissivityPerNu(rho, T, Ye, type, nu_bins[ie]);
+              if (FractionalDifference(Jnu, data[ie]) > 1e-12) {
+                accumulate += 1;
+              }
+            }
+          },
+          n_wrong);
+      PORTABLE_FREE(nu_bins);
+      REQUIRE(n_wrong == 0);
+
+      opac.Finalize();
+    }
+
+    THEN("Queries at a prepared lookup match direct queries") {
+      neutrinos::Opacity table = filled.GetOnDevice();
+
+      constexpr int NeHalf = Ne - 1;
+      Real *nu_bins = (Real *)PORTABLE_MALLOC(NeHalf * sizeof(Real));
+      portableFor(
+          "fill nu bins", 0, NeHalf, PORTABLE_LAMBDA(const int ie) {
+            const Real le = leGrid.x(ie) + 0.5 * leGrid.dx();
+            nu_bins[ie] = std::pow(10, le) * neutrinos::SpinerOpac::MeV2Hz;
+          });
+
+      int n_wrong = 0;
+      portableReduce(
+          "prepared vs direct", 0, NRho - 1, 0, NT - 1, 0, NYe - 1, 0,
+          NEUTRINO_NTYPES,
+          PORTABLE_LAMBDA(const int iRho, const int iT, const int iYe,
+                          const int itp, int &accumulate) {
+            const Real rho =
+                std::pow(10, lRhoGrid.x(iRho) + 0.5 * lRhoGrid.dx());
+            const Real T = std::pow(10, lTGrid.x(iT) + 0.5 * lTGrid.dx());
+            const Real Ye = YeGrid.x(iYe) + 0.5 * YeGrid.dx();
+            const RadiationType type = Idx2RadType(itp);
+            const Real nu = nu_bins[(iRho + iT + iYe) % NeHalf];
+            const neutrinos::Opacity models[] = {table, gray};
+            for (const neutrinos::Opacity &opac : models) {
+              const LookupState s = opac.PrepareLookup(rho, T, Ye);
+              if (FractionalDifference(
+                      opac.AbsorptionCoefficient(s, type, nu),
+                      opac.AbsorptionCoefficient(rho, T, Ye, type, nu)) >
+                  1e-12) {
+                accumulate += 1;
+              }
+              if (FractionalDifference(
+                      opac.EmissivityPerNu(s, type, nu),
+                      opac.EmissivityPerNu(rho, T, Ye, type, nu)) > 1e-12) {
+                accumulate += 1;
+              }
+              if (FractionalDifference(opac.Emissivity(s, type),
+                                       opac.Emissivity(rho, T, Ye, type)) >
+                  1e-12) {
+                accumulate += 1;
+              }
+              if (FractionalDifference(
+                      opac.NumberEmissivity(s, type),
+                      opac.NumberEmissivity(rho, T, Ye, type)) > 1e-12) {
+                accumulate += 1;
+              }
+              Real alpha, jnu;
+              opac.AbsorptionAndEmissivity(s, type, nu, alpha, jnu);
+              if (FractionalDifference(alpha, opac.AbsorptionCoefficient(
+                                                  rho, T, Ye, type, nu)) >
+                      1e-12 ||
+                  FractionalDifference(jnu, opac.EmissivityPerNuOmega(
+                                                rho, T, Ye, type, nu)) >
+                      1e-12) {
+                accumulate += 1;
+              }
+              Real data[NeHalf];
+              opac.EmissivityPerNuOmega(s, type, nu_bins, data, NeHalf);
+              for (int ie = 0; ie < NeHalf; ++ie) {
+                const Real j =
+                    opac.EmissivityPerNuOmega(rho, T, Ye, type, nu_bins[ie]);
+                if (FractionalDifference(j, data[ie]) > 1e-12) {
+                  accumulate += 1;
+                }
+              }
+            }
+          },
+          n_wrong);
+      PORTABLE_FREE(nu_bins);
+      REQUIRE(n_wrong == 0);
+
+      AND_THEN("Units are converted around a prepared lookup") {
+        constexpr Real time_unit = 123.;
+        constexpr Real mass_unit = 456.;
+        constexpr Real length_unit = 789.;
+        constexpr Real temp_unit = 276.;
+        const Real rho = 1e10;
+        const Real T = 3 * MeV2K;
+        const Real Ye = 0.3;
+        const Real nu = 5 * neutrinos::SpinerOpac::MeV2Hz;
+        const RadiationType type = RadiationType::NU_ELECTRON;
+        using SpinerUnits = neutrinos::NonCGSUnits<neutrinos::SpinerOpac>;
+        neutrinos::SpinerOpac copy = filled;
+        neutrinos::Opacity units =
+            SpinerUnits(std::forward<neutrinos::SpinerOpac>(copy), time_unit,
+                        mass_unit, length_unit, temp_unit);
+        const LookupState s = units.PrepareLookup(rho, T, Ye);
+        REQUIRE(units.AbsorptionCoefficient(s, type, nu) ==
+                units.AbsorptionCoefficient(rho, T, Ye, type, nu));
+        REQUIRE(units.Emissivity(s, type) ==
+                units.Emissivity(rho, T, Ye, type));
+
+        // Batched calls convert the frequencies as they read them, so
+        // a const grid works and is left exactly as it was
+        const Real nu_grid[] = {0.5 * nu, nu, 2 * nu};
+        Real alpha[3], jnu[3];
+        units.AbsorptionAndEmissivity(s, type, nu_grid, alpha, jnu, 3);
+        for (int i = 0; i < 3; ++i) {
+          Real alpha_ref, jnu_ref;
+          units.AbsorptionAndEmissivity(rho, T, Ye, type, nu_grid[i],
+                                        alpha_ref, jnu_ref);
+          REQUIRE(FractionalDifference(alpha[i], alpha_ref) < 1e-12);
+          REQUIRE(FractionalDifference(jnu[i], jnu_ref) < 1e-12);
+        }
+        REQUIRE(nu_grid[1] == nu);
+      }
+
+      table.Finalize();
+    }
+
+    THEN("An interleaved table gives the same fused and unfused results") {
+      neutrinos::SpinerOpac interleaved_host(
+          gray, lRhoMin, lRhoMax, NRho, lTMin, lTMax, NT, YeMin, YeMax, NYe,
+          leMin, leMax, Ne, neutrinos::SpectralLayout::Interleaved);
+      neutrinos::SpinerOpac separate = filled.GetOnDevice();
+      neutrinos::Opacity interleaved = interleaved_host.GetOnDevice();
+
+      constexpr int NeHalf = Ne - 1;
+      Real *nu_bins = (Real *)PORTABLE_MALLOC(NeHalf * sizeof(Real));
+      portableFor(
+          "fill nu bins", 0, NeHalf, PORTABLE_LAMBDA(const int ie) {
+            const Real le = leGrid.x(ie) + 0.5 * leGrid.dx();
+            nu_bins[ie] = std::pow(10, le) * neutrinos::SpinerOpac::MeV2Hz;
+          });
+
+      int n_wrong = 0;
+      portableReduce(
+          "separate vs interleaved", 0, NRho - 1, 0, NT - 1, 0, NYe - 1, 0,
+          NEUTRINO_NTYPES,
+          PORTABLE_LAMBDA(const int iRho, const int iT, const int iYe,
+                          const int itp, int &accumulate) {
+            const Real rho =
+                std::pow(10, lRhoGrid.x(iRho) + 0.5 * lRhoGrid.dx());
+            const Real T = std::pow(10, lTGrid.x(iT) + 0.5 * lTGrid.dx());
+            const Real Ye = YeGrid.x(iYe) + 0.5 * YeGrid.dx();
+            const RadiationType type = Idx2RadType(itp);
+            Real alpha[NeHalf];
+            Real jnu[NeHalf];
+
+            interleaved.AbsorptionAndEmissivity(rho, T, Ye, type, nu_bins,
+                                                alpha, jnu, NeHalf);
+            for (int ie = 0; ie < NeHalf; ++ie) {
+              const Real nu = nu_bins[ie];
+              Real alpha_fused, jnu_fused;
+              interleaved.AbsorptionAndEmissivity(rho, T, Ye, type, nu,
+                                                  alpha_fused, jnu_fused);
+              Real alpha_separate, jnu_separate;
+              separate.AbsorptionAndEmissivity(rho, T, Ye, type, nu,
+                                               alpha_separate, jnu_separate);
+              const Real alpha_ref =
+                  separate.AbsorptionCoefficient(rho, T, Ye, type, nu);
+              const Real jnu_ref =
+                  separate.EmissivityPerNuOmega(rho, T, Ye, type, nu);
+              const Real alphas[] = {
+                  alpha[ie], alpha_fused, alpha_separate,
+                  interleaved.AbsorptionCoefficient(rho, T, Ye, type, nu)};
+              const Real jnus[] = {
+                  jnu[ie], jnu_fused, jnu_separate,
+                  interleaved.EmissivityPerNuOmega(rho, T, Ye, type, nu)};
+              for (int k = 0; k < 4; ++k) {
+                if (FractionalDifference(alpha_ref, alphas[k]) > 1e-12) {
+                  accumulate += 1;
+                }
+                if (FractionalDifference(jnu_ref, jnus[k]) > 1e-12) {
+                  accumulate += 1;
+                }
+              }
+            }
+          },
+          n_wrong);
+      PORTABLE_FREE(nu_bins);
+      REQUIRE(n_wrong == 0);
+
+#ifdef SPINER_USE_HDF
+      AND_THEN("An interleaved table saves in the standard format") {
+        interleaved_host.Save(grayname);
+        neutrinos::SpinerOpac reloaded(grayname);
+        n_wrong = 0;
+        portableReduce(
+            "interleaved reload", 0, NRho, 0, NT, 0, NYe, 0, NEUTRINO_NTYPES,
+            0, Ne,
+            PORTABLE_LAMBDA(const int iRho, const int iT, const int iYe,
+                            const int itp, const int ie, int &accumulate) {
+              const Real rho = std::pow(10, lRhoGrid.x(iRho));
+              const Real T = std::pow(10, lTGrid.x(iT));
+              const Real Ye = YeGrid.x(iYe);
+              const Real nu =
+                  std::pow(10, leGrid.x(ie)) * neutrinos::SpinerOpac::MeV2Hz;
+              const RadiationType type = Idx2RadType(itp);
+              if (IsWrong(separate.AbsorptionCoefficient(rho, T, Ye, type, nu),
+                          reloaded.AbsorptionCoefficient(rho, T, Ye, type,
+                                                         nu))) {
+                accumulate += 1;
+              }
+              if (IsWrong(separate.EmissivityPerNuOmega(rho, T, Ye, type, nu),
+                          reloaded.EmissivityPerNuOmega(rho, T, Ye, type,
+                                                        nu))) {
+                accumulate += 1;
+              }
+            },
+            n_wrong);
+        REQUIRE(n_wrong == 0);
+        reloaded.Finalize();
+      }
+#endif
+
+      separate.Finalize();
+      interleaved.Finalize();
+      interleaved_host.Finalize();
+    }
+
+    THEN("The table doesn't depend on the number of threads building it") {
+      neutrinos::SpinerOpac serial_host(
+          gray, lRhoMin, lRhoMax, NRho, lTMin, lTMax, NT, YeMin, YeMax, NYe,
+          leMin, leMax, Ne, neutrinos::SpectralLayout::Separate,
+          TablePrecision::Double, 1);
+      neutrinos::SpinerOpac threaded_host(
+          gray, lRhoMin, lRhoMax, NRho, lTMin, lTMax, NT, YeMin, YeMax, NYe,
+          leMin, leMax, Ne, neutrinos::SpectralLayout::Separate,
+          TablePrecision::Double, 3);
+      neutrinos::SpinerOpac serial = serial_host.GetOnDevice();
+      neutrinos::SpinerOpac threaded = threaded_host.GetOnDevice();
+
+      int n_wrong = 0;
+      portableReduce(
+          "serial vs threaded", 0, NRho, 0, NT, 0, NYe, 0, NEUTRINO_NTYPES, 0,
+          Ne,
+          PORTABLE_LAMBDA(const int iRho, const int iT, const int iYe,
+                          const int itp, const int ie, int &accumulate) {
+            const Real rho = std::pow(10, lRhoGrid.x(iRho));
+            const Real T = std::pow(10, lTGrid.x(iT));
+            const Real Ye = YeGrid.x(iYe);
+            const Real nu =
+                std::pow(10, leGrid.x(ie)) * neutrinos::SpinerOpac::MeV2Hz;
+            const RadiationType type = Idx2RadType(itp);
+            if (serial.AbsorptionCoefficient(rho, T, Ye, type, nu) !=
+                    threaded.AbsorptionCoefficient(rho, T, Ye, type, nu) ||
+                serial.EmissivityPerNuOmega(rho, T, Ye, type, nu) !=
+                    threaded.EmissivityPerNuOmega(rho, T, Ye, type, nu) ||
+                serial.Emissivity(rho, T, Ye, type) !=
+                    threaded.Emissivity(rho, T, Ye, type)) {
+              accumulate += 1;
+            }
+          },
+          n_wrong);
+      REQUIRE(n_wrong == 0);
+
+      serial.Finalize();
+      threaded.Finalize();
+      serial_host.Finalize();
+      threaded_host.Finalize();
+    }
+
+    THEN("A float table agrees with the double table") {
+      neutrinos::SpinerOpac separate = filled.GetOnDevice();
+      constexpr int NeHalf = Ne - 1;
+      Real *nu_bins = (Real *)PORTABLE_MALLOC(NeHalf * sizeof(Real));
+      portableFor(
+          "fill nu bins", 0, NeHalf, PORTABLE_LAMBDA(const int ie) {
+            const Real le = leGrid.x(ie) + 0.3 * leGrid.dx();
+            nu_bins[ie] = std::pow(10, le) * neutrinos::SpinerOpac::MeV2Hz;
+          });
+
+      const neutrinos::SpectralLayout layouts[] = {
+          neutrinos::SpectralLayout::Separate,
+          neutrinos::SpectralLayout::Interleaved};
+      for (const neutrinos::SpectralLayout layout : layouts) {
+        neutrinos::SpinerOpac single_host(
+            gray, lRhoMin, lRhoMax, NRho, lTMin, lTMax, NT, YeMin, YeMax, NYe,
+            leMin, leMax, Ne, layout, TablePrecision::Float);
+        neutrinos::SpinerOpac single = single_host.GetOnDevice();
+
+        int n_wrong = 0;
+        portableReduce(
+            "double vs float", 0, NRho - 1, 0, NT - 1, 0, NYe - 1, 0,
+            NEUTRINO_NTYPES,
+            PORTABLE_LAMBDA(const int iRho, const int iT, const int iYe,
+                            const int itp, int &accumulate) {
+              // float rounding of the stored log10
+              auto tolerance = [](const Real ref) {
+                return 1e-6 * std::max(1.0, std::abs(std::log10(ref)));
+              };
+              const Real rho =
+                  std::pow(10, lRhoGrid.x(iRho) + 0.2 * lRhoGrid.dx());
+              const Real T = std::pow(10, lTGrid.x(iT) + 0.7 * lTGrid.dx());
+              const Real Ye = YeGrid.x(iYe) + 0.4 * YeGrid.dx();
+              const RadiationType type = Idx2RadType(itp);
+              Real alpha[NeHalf];
+              Real jnu[NeHalf];
+
+              single.AbsorptionAndEmissivity(rho, T, Ye, type, nu_bins, alpha,
+                                             jnu, NeHalf);
+              for (int ie = 0; ie < NeHalf; ++ie) {
+                const Real nu = nu_bins[ie];
+                const Real alpha_ref =
+                    separate.AbsorptionCoefficient(rho, T, Ye, type, nu);
+                const Real jnu_ref =
+                    separate.EmissivityPerNuOmega(rho, T, Ye, type, nu);
+                Real alpha_fused, jnu_fused;
+                single.AbsorptionAndEmissivity(rho, T, Ye, type, nu,
+                                               alpha_fused, jnu_fused);
+                const Real alphas[] = {
+                    alpha[ie], alpha_fused,
+                    single.AbsorptionCoefficient(rho, T, Ye, type, nu)};
+                const Real jnus[] = {
+                    jnu[ie], jnu_fused,
+                    single.EmissivityPerNuOmega(rho, T, Ye, type, nu)};
+                for (int k = 0; k < 3; ++k) {
+                  if (FractionalDifference(alpha_ref, alphas[k]) >
+                      tolerance(alpha_ref)) {
+                    accumulate += 1;
+                  }
+                  if (FractionalDifference(jnu_ref, jnus[k]) >
+                      tolerance(jnu_ref)) {
+                    accumulate += 1;
+                  }
+                }
+              }
+              const Real J_ref = separate.Emissivity(rho, T, Ye, type);
+              const Real JYe_ref = separate.NumberEmissivity(rho, T, Ye, type);
+              if (FractionalDifference(J_ref,
+                                       single.Emissivity(rho, T, Ye, type)) >
+                  tolerance(J_ref)) {
+                accumulate += 1;
+              }
+              if (FractionalDifference(
+                      JYe_ref, single.NumberEmissivity(rho, T, Ye, type)) >
+                  tolerance(JYe_ref)) {
+                accumulate += 1;
+              }
+            },
+            n_wrong);
+        REQUIRE(n_wrong == 0);
+
+#ifdef SPINER_USE_HDF
+        // Sections in a loop would only run once, so no AND_THEN here
+        single_host.Save(grayname);
+        neutrinos::SpinerOpac reloaded(grayname, layout,
+                                       TablePrecision::Float);
+        n_wrong = 0;
+        portableReduce(
+            "float reload", 0, NRho, 0, NT, 0, NYe, 0, NEUTRINO_NTYPES, 0, Ne,
+            PORTABLE_LAMBDA(const int iRho, const int iT, const int iYe,
+                            const int itp, const int ie, int &accumulate) {
+              const Real rho = std::pow(10, lRhoGrid.x(iRho));
+              const Real T = std::pow(10, lTGrid.x(iT));
+              const Real Ye = YeGrid.x(iYe);
+              const Real nu =
+                  std::pow(10, leGrid.x(ie)) * neutrinos::SpinerOpac::MeV2Hz;
+              const RadiationType type = Idx2RadType(itp);
+              if (single.AbsorptionCoefficient(rho, T, Ye, type, nu) !=
+                  reloaded.AbsorptionCoefficient(rho, T, Ye, type, nu)) {
+                accumulate += 1;
+              }
+              if (single.Emissivity(rho, T, Ye, type) !=
+                  reloaded.Emissivity(rho, T, Ye, type)) {
+                accumulate += 1;
+              }
+            },
+            n_wrong);
+        REQUIRE(n_wrong == 0);
+        reloaded.Finalize();
+#endif
+
+        single.Finalize();
+        single_host.Finalize();
+      }
+      PORTABLE_FREE(nu_bins);
+      separate.Finalize();
+    }
+
 #ifdef SPINER_USE_HDF
     THEN("We can save to disk and reload") {
       filled.Save(grayname);
@@ -323,6 +810,1519 @@ TEST_CASE("Spiner opacities, filled with gray data",
         opac.Finalize();
       }
     }
+
+    THEN("A table loaded in other units matches NonCGSUnits") {
+      constexpr Real time_unit = 123.;
+      constexpr Real mass_unit = 456.;
+      constexpr Real length_unit = 789.;
+      constexpr Real temp_unit = 276.;
+      constexpr Real rho_unit =
+          mass_unit / (length_unit * length_unit * length_unit);
+      filled.Save(grayname);
+      neutrinos::SpinerOpac baked(
+          grayname, UnitSystem(time_unit, mass_unit, length_unit, temp_unit));
+      neutrinos::NonCGSUnits<neutrinos::SpinerOpac> wrapped(
+          neutrinos::SpinerOpac(grayname), time_unit, mass_unit, length_unit,
+          temp_unit);
+      const Real Ye = 0.27;
+      const RadiationType type = RadiationType::NU_ELECTRON_ANTI;
+      for (const Real lRho : {8.3, 10.1, 11.7}) {
+        for (const Real lT : {lTMin + 0.4, lTMax - 1.1}) {
+          const Real rho = std::pow(10, lRho) / rho_unit;
+          const Real T = std::pow(10, lT) / temp_unit;
+          for (const Real le : {-0.6, 0.5, 1.8}) {
+            const Real nu =
+                std::pow(10, le) * neutrinos::SpinerOpac::MeV2Hz * time_unit;
+            REQUIRE(baked.InTable(rho, T, Ye, nu));
+            REQUIRE(FractionalDifference(
+                        baked.AbsorptionCoefficient(rho, T, Ye, type, nu),
+                        wrapped.AbsorptionCoefficient(rho, T, Ye, type, nu)) <
+                    1e-10);
+            REQUIRE(FractionalDifference(
+                        baked.EmissivityPerNu(rho, T, Ye, type, nu),
+                        wrapped.EmissivityPerNu(rho, T, Ye, type, nu)) <
+                    1e-10);
+            REQUIRE(FractionalDifference(
+                        baked.DThermalDistributionOfTNuDT(T, type, nu),
+                        wrapped.DThermalDistributionOfTNuDT(T, type, nu)) <
+                    1e-12);
+          }
+          REQUIRE(FractionalDifference(baked.Emissivity(rho, T, Ye, type),
+                                       wrapped.Emissivity(rho, T, Ye, type)) <
+                  1e-10);
+          REQUIRE(FractionalDifference(
+                      baked.NumberEmissivity(rho, T, Ye, type),
+                      wrapped.NumberEmissivity(rho, T, Ye, type)) < 1e-10);
+          REQUIRE(FractionalDifference(
+                      baked.EnergyDensityFromTemperature(T, type),
+                      wrapped.EnergyDensityFromTemperature(T, type)) < 1e-12);
+          REQUIRE(FractionalDifference(
+                      baked.ThermalDistributionOfT(T, type),
+                      wrapped.ThermalDistributionOfT(T, type)) < 1e-12);
+          REQUIRE(FractionalDifference(
+                      baked.ThermalNumberDistributionOfT(T, type),
+                      wrapped.ThermalNumberDistributionOfT(T, type)) < 1e-12);
+          REQUIRE(FractionalDifference(
+                      baked.NumberDensityFromTemperature(T, type),
+                      wrapped.NumberDensityFromTemperature(T, type)) < 1e-12);
+          const Real er = wrapped.EnergyDensityFromTemperature(T, type);
+          REQUIRE(FractionalDifference(
+                      baked.TemperatureFromEnergyDensity(er, type),
+                      wrapped.TemperatureFromEnergyDensity(er, type)) < 1e-12);
+        }
+      }
+      baked.Finalize();
+      wrapped.Finalize();
+    }
 #endif // SPINER_USE_HDF
   }
 }
+
+TEST_CASE("Spiner opacities from base 10 tables", "[SpinerNeutrinos]") {
+  constexpr Real lRhoMin = 8;
+  constexpr Real lRhoMax = 12;
+  constexpr int NRho = 5;
+  constexpr Real lTMin = -2; // MeV
+  constexpr Real lTMax = 2;
+  constexpr int NT = 6;
+  constexpr Real YeMin = 0.1;
+  constexpr Real YeMax = 0.5;
+  constexpr int NYe = 4;
+  constexpr Real leMin = -1;
+  constexpr Real leMax = 2;
+  constexpr int Ne = 7;
+  const std::string legacyname = "legacy_log10.sp5";
+
+  WHEN("We fill log10 tables with functions linear in the log coordinates") {
+    // Linear interpolation reproduces these exactly, in any base
+    auto lalpha = [](Real lRho, Real lT, Real Ye, int idx, Real le) {
+      return lRho - 2 * lT + Ye + 0.5 * le - idx;
+    };
+    auto ljnu = [](Real lRho, Real lT, Real Ye, int idx, Real le) {
+      return -lRho + lT - Ye + 2 * le + idx;
+    };
+    auto lJ = [](Real lRho, Real lT, Real Ye, int idx) {
+      return lRho + lT - idx;
+    };
+    auto lJYe = [](Real lRho, Real lT, Real Ye, int idx) {
+      return 0.5 * lRho - lT + Ye;
+    };
+
+    Spiner::DataBox lalphanu_db, ljnu_db, lJ_db, lJYe_db;
+    lalphanu_db.resize(NRho, NT, NYe, NEUTRINO_NTYPES, Ne);
+    lalphanu_db.setRange(0, leMin, leMax, Ne);
+    lalphanu_db.setRange(2, YeMin, YeMax, NYe);
+    lalphanu_db.setRange(3, lTMin, lTMax, NT);
+    lalphanu_db.setRange(4, lRhoMin, lRhoMax, NRho);
+    ljnu_db.copyMetadata(lalphanu_db);
+    lJ_db.resize(NRho, NT, NYe, NEUTRINO_NTYPES);
+    lJ_db.setRange(1, YeMin, YeMax, NYe);
+    lJ_db.setRange(2, lTMin, lTMax, NT);
+    lJ_db.setRange(3, lRhoMin, lRhoMax, NRho);
+    lJYe_db.copyMetadata(lJ_db);
+    for (int iRho = 0; iRho < NRho; ++iRho) {
+      const Real lRho = lalphanu_db.range(4).x(iRho);
+      for (int iT = 0; iT < NT; ++iT) {
+        const Real lT = lalphanu_db.range(3).x(iT);
+        for (int iYe = 0; iYe < NYe; ++iYe) {
+          const Real Ye = lalphanu_db.range(2).x(iYe);
+          for (int idx = 0; idx < NEUTRINO_NTYPES; ++idx) {
+            lJ_db(iRho, iT, iYe, idx) = lJ(lRho, lT, Ye, idx);
+            lJYe_db(iRho, iT, iYe, idx) = lJYe(lRho, lT, Ye, idx);
+            for (int ie = 0; ie < Ne; ++ie) {
+              const Real le = lalphanu_db.range(0).x(ie);
+              lalphanu_db(iRho, iT, iYe, idx, ie) =
+                  lalpha(lRho, lT, Ye, idx, le);
+              ljnu_db(iRho, iT, iYe, idx, ie) = ljnu(lRho, lT, Ye, idx, le);
+            }
+          }
+        }
+      }
+    }
+
+    neutrinos::SpinerOpac opac_host(lalphanu_db, ljnu_db, lJ_db, lJYe_db);
+
+    THEN("The converted tables reproduce the functions between grid points") {
+      neutrinos::SpinerOpac opac = opac_host.GetOnDevice();
+      int n_wrong = 0;
+      portableReduce(
+          "log10 tables", 0, NRho - 1, 0, NT - 1, 0, NYe - 1, 0,
+          NEUTRINO_NTYPES,
+          PORTABLE_LAMBDA(const int iRho, const int iT, const int iYe,
+                          const int idx, int &accumulate) {
+            const Real lRho =
+                lRhoMin + (iRho + 0.3) * (lRhoMax - lRhoMin) / (NRho - 1);
+            const Real lT = lTMin + (iT + 0.6) * (lTMax - lTMin) / (NT - 1);
+            const Real Ye = YeMin + (iYe + 0.4) * (YeMax - YeMin) / (NYe - 1);
+            const Real le = leMin + 0.7 * (leMax - leMin);
+            const Real rho = std::pow(10., lRho);
+            const Real T = std::pow(10., lT) * neutrinos::SpinerOpac::MeV2K;
+            const Real nu = std::pow(10., le) * neutrinos::SpinerOpac::MeV2Hz;
+            const RadiationType type = Idx2RadType(idx);
+            const Real refs[] = {std::pow(10., lalpha(lRho, lT, Ye, idx, le)),
+                                 std::pow(10., ljnu(lRho, lT, Ye, idx, le)),
+                                 std::pow(10., lJ(lRho, lT, Ye, idx)),
+                                 std::pow(10., lJYe(lRho, lT, Ye, idx))};
+            const Real vals[] = {
+                opac.AbsorptionCoefficient(rho, T, Ye, type, nu),
+                opac.EmissivityPerNuOmega(rho, T, Ye, type, nu),
+                opac.Emissivity(rho, T, Ye, type),
+                opac.NumberEmissivity(rho, T, Ye, type)};
+            for (int k = 0; k < 4; ++k) {
+              if (FractionalDifference(refs[k], vals[k]) > 1e-10) {
+                accumulate += 1;
+              }
+            }
+          },
+          n_wrong);
+      REQUIRE(n_wrong == 0);
+
+#ifdef SPINER_USE_HDF
+      AND_THEN("A file without a recorded log base loads as log10") {
+        herr_t status = H5_SUCCESS;
+        hid_t file = H5Fcreate(legacyname.c_str(), H5F_ACC_TRUNC,
+                               H5P_DEFAULT, H5P_DEFAULT);
+        status += lalphanu_db.saveHDF(file, SP5::Opac::AbsorptionCoefficient);
+        status += ljnu_db.saveHDF(file, SP5::Opac::EmissivityPerNu);
+        status += lJ_db.saveHDF(file, SP5::Opac::TotalEmissivity);
+        status += lJYe_db.saveHDF(file, SP5::Opac::NumberEmissivity);
+        status += H5Fclose(file);
+        REQUIRE(status == H5_SUCCESS);
+
+        neutrinos::SpinerOpac legacy(legacyname);
+        opac_host.Save(legacyname);
+        neutrinos::SpinerOpac current(legacyname);
+        n_wrong = 0;
+        portableReduce(
+            "legacy file", 0, NRho, 0, NT, 0, NYe, 0, NEUTRINO_NTYPES, 0, Ne,
+            PORTABLE_LAMBDA(const int iRho, const int iT, const int iYe,
+                            const int idx, const int ie, int &accumulate) {
+              const Real rho = std::pow(
+                  10., lRhoMin + iRho * (lRhoMax - lRhoMin) / (NRho - 1));
+              const Real T =
+                  std::pow(10., lTMin + iT * (lTMax - lTMin) / (NT - 1)) *
+                  neutrinos::SpinerOpac::MeV2K;
+              const Real Ye = YeMin + iYe * (YeMax - YeMin) / (NYe - 1);
+              const Real nu =
+                  std::pow(10., leMin + ie * (leMax - leMin) / (Ne - 1)) *
+                  neutrinos::SpinerOpac::MeV2Hz;
+              const RadiationType type = Idx2RadType(idx);
+              const Real ref = opac.AbsorptionCoefficient(rho, T, Ye, type, nu);
+              if (FractionalDifference(
+                      ref, legacy.AbsorptionCoefficient(rho, T, Ye, type,
+                                                        nu)) > 1e-12 ||
+                  ref != current.AbsorptionCoefficient(rho, T, Ye, type, nu)) {
+                accumulate += 1;
+              }
+            },
+            n_wrong);
+        REQUIRE(n_wrong == 0);
+        legacy.Finalize();
+        current.Finalize();
+      }
+
+      AND_THEN("A subset of a file matches the full table within it") {
+        const std::string subsetname = "subset.sp5";
+        const Real lK = std::log10(neutrinos::SpinerOpac::MeV2K);
+        neutrinos::TableSubset subset;
+        subset.lRhoMin = 9.1;
+        subset.lRhoMax = 10.9;
+        subset.lTMin = -1.1 + lK;
+        subset.lTMax = 0.5 + lK;
+        subset.YeMin = 0.2;
+        subset.YeMax = 0.4;
+        subset.leMin = 0;
+        subset.leMax = 1.2;
+        subset.species[1] = false;
+
+        // Both a current file and a base 10 one
+        opac_host.Save(subsetname);
+        neutrinos::SpinerOpac sub(subsetname, subset);
+        herr_t status = H5_SUCCESS;
+        hid_t file = H5Fcreate(legacyname.c_str(), H5F_ACC_TRUNC,
+                               H5P_DEFAULT, H5P_DEFAULT);
+        status += lalphanu_db.saveHDF(file, SP5::Opac::AbsorptionCoefficient);
+        status += ljnu_db.saveHDF(file, SP5::Opac::EmissivityPerNu);
+        status += lJ_db.saveHDF(file, SP5::Opac::TotalEmissivity);
+        status += lJYe_db.saveHDF(file, SP5::Opac::NumberEmissivity);
+        status += H5Fclose(file);
+        REQUIRE(status == H5_SUCCESS);
+        neutrinos::SpinerOpac legacy_sub(legacyname, subset);
+        // The species map must survive a round trip
+        sub.Save(subsetname);
+        neutrinos::SpinerOpac reloaded(subsetname);
+        const std::string rawname = "subset.raw";
+        sub.SaveRaw(rawname);
+#ifdef SINGULARITY_USE_MMAP
+        neutrinos::SpinerOpac mapped(rawname, RawFormat());
+#else
+        neutrinos::SpinerOpac mapped(subsetname);
+#endif
+
+        constexpr int NS = 5;
+        n_wrong = 0;
+        portableReduce(
+            "subset", 0, NS, 0, NS, 0, NS, 0, NS,
+            PORTABLE_LAMBDA(const int iRho, const int iT, const int iYe,
+                            const int ie, int &accumulate) {
+              const Real lRho = 9.1 + iRho * 1.8 / (NS - 1);
+              const Real lT = -1.1 + iT * 1.6 / (NS - 1);
+              const Real Ye = 0.2 + iYe * 0.2 / (NS - 1);
+              const Real le = ie * 1.2 / (NS - 1);
+              const Real rho = std::pow(10., lRho);
+              const Real T = std::pow(10., lT) * neutrinos::SpinerOpac::MeV2K;
+              const Real nu =
+                  std::pow(10., le) * neutrinos::SpinerOpac::MeV2Hz;
+              for (const int idx : {0, 2}) {
+                const RadiationType type = Idx2RadType(idx);
+                const neutrinos::SpinerOpac *tables[] = {&sub, &legacy_sub,
+                                                         &reloaded, &mapped};
+                for (const neutrinos::SpinerOpac *t : tables) {
+                  if (FractionalDifference(
+                          opac.AbsorptionCoefficient(rho, T, Ye, type, nu),
+                          t->AbsorptionCoefficient(rho, T, Ye, type, nu)) >
+                          1e-12 ||
+                      FractionalDifference(
+                          opac.EmissivityPerNuOmega(rho, T, Ye, type, nu),
+                          t->EmissivityPerNuOmega(rho, T, Ye, type, nu)) >
+                          1e-12 ||
+                      FractionalDifference(opac.Emissivity(rho, T, Ye, type),
+                                           t->Emissivity(rho, T, Ye, type)) >
+                          1e-12 ||
+                      FractionalDifference(
+                          opac.NumberEmissivity(rho, T, Ye, type),
+                          t->NumberEmissivity(rho, T, Ye, type)) > 1e-12) {
+                    accumulate += 1;
+                  }
+                }
+              }
+            },
+            n_wrong);
+        REQUIRE(n_wrong == 0);
+        sub.Finalize();
+        legacy_sub.Finalize();
+        reloaded.Finalize();
+        mapped.Finalize();
+      }
+#endif
+
+      opac.Finalize();
+    }
+
+#ifdef SINGULARITY_USE_MMAP
+    THEN("The tables map back from a raw file") {
+      const std::string rawname = "log10_tables.raw";
+      opac_host.SaveRaw(rawname);
+      neutrinos::SpinerOpac mapped(rawname, RawFormat());
+      neutrinos::SpinerOpac interleaved(rawname, RawFormat(),
+                                        neutrinos::SpectralLayout::Interleaved);
+      int n_wrong = 0;
+      portableReduce(
+          "raw tables", 0, NRho - 1, 0, NT - 1, 0, NYe - 1, 0,
+          NEUTRINO_NTYPES,
+          PORTABLE_LAMBDA(const int iRho, const int iT, const int iYe,
+                          const int idx, int &accumulate) {
+            const Real lRho =
+                lRhoMin + (iRho + 0.3) * (lRhoMax - lRhoMin) / (NRho - 1);
+            const Real lT = lTMin + (iT + 0.6) * (lTMax - lTMin) / (NT - 1);
+            const Real Ye = YeMin + (iYe + 0.4) * (YeMax - YeMin) / (NYe - 1);
+            const Real le = leMin + 0.7 * (leMax - leMin);
+            const Real rho = std::pow(10., lRho);
+            const Real T = std::pow(10., lT) * neutrinos::SpinerOpac::MeV2K;
+            const Real nu = std::pow(10., le) * neutrinos::SpinerOpac::MeV2Hz;
+            const RadiationType type = Idx2RadType(idx);
+            const Real alpha =
+                opac_host.AbsorptionCoefficient(rho, T, Ye, type, nu);
+            const Real J = opac_host.Emissivity(rho, T, Ye, type);
+            // The mapped tables are the same bits
+            if (alpha != mapped.AbsorptionCoefficient(rho, T, Ye, type, nu) ||
+                J != mapped.Emissivity(rho, T, Ye, type)) {
+              accumulate += 1;
+            }
+            if (FractionalDifference(
+                    alpha, interleaved.AbsorptionCoefficient(rho, T, Ye, type,
+                                                             nu)) > 1e-12) {
+              accumulate += 1;
+            }
+          },
+          n_wrong);
+      REQUIRE(n_wrong == 0);
+      mapped.Finalize();
+      interleaved.Finalize();
+    }
+#endif
+
+    THEN("Quantized tables agree with the double tables") {
+      const neutrinos::SpectralLayout layouts[] = {
+          neutrinos::SpectralLayout::Separate,
+          neutrinos::SpectralLayout::Interleaved};
+      // Half a step of a block spanning the whole table, which covers
+      // up to about 18 decades when absorption and emission share it
+      constexpr Real tolerance = 3.5e-4;
+      for (const neutrinos::SpectralLayout layout : layouts) {
+        neutrinos::SpinerOpac quantized(lalphanu_db, ljnu_db, lJ_db, lJYe_db,
+                                        layout, TablePrecision::Quantized);
+        int n_wrong = 0;
+        portableReduce(
+            "quantized tables", 0, NRho - 1, 0, NT - 1, 0, NYe - 1, 0,
+            NEUTRINO_NTYPES,
+            PORTABLE_LAMBDA(const int iRho, const int iT, const int iYe,
+                            const int idx, int &accumulate) {
+              const Real lRho =
+                  lRhoMin + (iRho + 0.3) * (lRhoMax - lRhoMin) / (NRho - 1);
+              const Real lT = lTMin + (iT + 0.6) * (lTMax - lTMin) / (NT - 1);
+              const Real Ye =
+                  YeMin + (iYe + 0.4) * (YeMax - YeMin) / (NYe - 1);
+              const Real le = leMin + 0.7 * (leMax - leMin);
+              const Real rho = std::pow(10., lRho);
+              const Real T = std::pow(10., lT) * neutrinos::SpinerOpac::MeV2K;
+              const Real nu =
+                  std::pow(10., le) * neutrinos::SpinerOpac::MeV2Hz;
+              const RadiationType type = Idx2RadType(idx);
+              Real alpha, jnu;
+              quantized.AbsorptionAndEmissivity(rho, T, Ye, type, nu, alpha,
+                                                jnu);
+              const Real refs[] = {
+                  opac_host.AbsorptionCoefficient(rho, T, Ye, type, nu),
+                  opac_host.EmissivityPerNuOmega(rho, T, Ye, type, nu),
+                  opac_host.Emissivity(rho, T, Ye, type),
+                  opac_host.NumberEmissivity(rho, T, Ye, type)};
+              const Real vals[] = {
+                  alpha, jnu, quantized.Emissivity(rho, T, Ye, type),
+                  quantized.NumberEmissivity(rho, T, Ye, type)};
+              for (int k = 0; k < 4; ++k) {
+                if (FractionalDifference(refs[k], vals[k]) > tolerance) {
+                  accumulate += 1;
+                }
+              }
+            },
+            n_wrong);
+        REQUIRE(n_wrong == 0);
+        quantized.Finalize();
+      }
+
+#ifdef SPINER_USE_HDF
+      AND_THEN("A quantized file loads at any precision") {
+        const std::string savedname = "log10_tables.sp5";
+        const std::string quantizedname = "log10_tables_quantized.sp5";
+        opac_host.Save(savedname);
+        const char *names[] = {
+            SP5::Opac::AbsorptionCoefficient, SP5::Opac::EmissivityPerNu,
+            SP5::Opac::TotalEmissivity, SP5::Opac::NumberEmissivity};
+        herr_t status = H5_SUCCESS;
+        hid_t in = H5Fopen(savedname.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+        hid_t out = H5Fcreate(quantizedname.c_str(), H5F_ACC_TRUNC,
+                              H5P_DEFAULT, H5P_DEFAULT);
+        Real error = 0;
+        for (const char *name : names) {
+          Spiner::DataBox db;
+          status += db.loadHDF(in, name);
+          Real table_error;
+          status += singularity::impl::saveHDFQuantized(out, name, db,
+                                                        table_error);
+          error = std::max(error, table_error);
+          db.finalize();
+        }
+        status += singularity::impl::saveEncoding(out, TableEncoding::Log2);
+        status += H5Fclose(out);
+        status += H5Fclose(in);
+        REQUIRE(status == H5_SUCCESS);
+        // At most half a step of a block spanning the whole table
+        REQUIRE(error > 0);
+        REQUIRE(error < 16 * singularity::impl::LOG2_10 / 131068);
+
+        neutrinos::SpinerOpac decoded(quantizedname);
+        neutrinos::SpinerOpac requantized(quantizedname,
+                                          neutrinos::SpectralLayout::Separate,
+                                          TablePrecision::Quantized);
+        int n_wrong = 0;
+        portableReduce(
+            "quantized file", 0, NRho, 0, NT, 0, NYe, 0, NEUTRINO_NTYPES,
+            PORTABLE_LAMBDA(const int iRho, const int iT, const int iYe,
+                            const int idx, int &accumulate) {
+              const Real rho = std::pow(
+                  10., lRhoMin + iRho * (lRhoMax - lRhoMin) / (NRho - 1));
+              const Real T =
+                  std::pow(10., lTMin + iT * (lTMax - lTMin) / (NT - 1)) *
+                  neutrinos::SpinerOpac::MeV2K;
+              const Real Ye = YeMin + iYe * (YeMax - YeMin) / (NYe - 1);
+              const Real nu = std::pow(10., 0.5 * (leMin + leMax)) *
+                              neutrinos::SpinerOpac::MeV2Hz;
+              const RadiationType type = Idx2RadType(idx);
+              const Real alpha =
+                  opac_host.AbsorptionCoefficient(rho, T, Ye, type, nu);
+              const Real J = opac_host.Emissivity(rho, T, Ye, type);
+              // On grid points the error is the file's alone
+              const Real file_tolerance = 2 * std::log(2.) * error;
+              if (FractionalDifference(alpha, decoded.AbsorptionCoefficient(
+                                                  rho, T, Ye, type, nu)) >
+                      file_tolerance ||
+                  FractionalDifference(J, decoded.Emissivity(rho, T, Ye,
+                                                             type)) >
+                      file_tolerance) {
+                accumulate += 1;
+              }
+              // Quantized in the file and again on load
+              if (FractionalDifference(alpha,
+                                       requantized.AbsorptionCoefficient(
+                                           rho, T, Ye, type, nu)) >
+                  2 * tolerance) {
+                accumulate += 1;
+              }
+            },
+            n_wrong);
+        REQUIRE(n_wrong == 0);
+
+        // A subset decodes its blocks as the whole file does
+        neutrinos::TableSubset subset;
+        subset.lRhoMin = 9.1;
+        subset.lRhoMax = 10.9;
+        subset.lTMin = -1.1 + std::log10(neutrinos::SpinerOpac::MeV2K);
+        subset.lTMax = 0.5 + std::log10(neutrinos::SpinerOpac::MeV2K);
+        subset.YeMin = 0.2;
+        subset.YeMax = 0.4;
+        subset.leMin = 0;
+        subset.leMax = 1.2;
+        subset.species[1] = false;
+        neutrinos::SpinerOpac sub(quantizedname, subset);
+        constexpr int NS = 5;
+        n_wrong = 0;
+        portableReduce(
+            "quantized subset", 0, NS, 0, NS, 0, NS, 0, NS,
+            PORTABLE_LAMBDA(const int iRho, const int iT, const int iYe,
+                            const int ie, int &accumulate) {
+              const Real rho = std::pow(10., 9.1 + iRho * 1.8 / (NS - 1));
+              const Real T = std::pow(10., -1.1 + iT * 1.6 / (NS - 1)) *
+                             neutrinos::SpinerOpac::MeV2K;
+              const Real Ye = 0.2 + iYe * 0.2 / (NS - 1);
+              const Real nu = std::pow(10., ie * 1.2 / (NS - 1)) *
+                              neutrinos::SpinerOpac::MeV2Hz;
+              for (const int idx : {0, 2}) {
+                const RadiationType type = Idx2RadType(idx);
+                if (FractionalDifference(
+                        decoded.AbsorptionCoefficient(rho, T, Ye, type, nu),
+                        sub.AbsorptionCoefficient(rho, T, Ye, type, nu)) >
+                        1e-12 ||
+                    FractionalDifference(
+                        decoded.EmissivityPerNu(rho, T, Ye, type, nu),
+                        sub.EmissivityPerNu(rho, T, Ye, type, nu)) > 1e-12 ||
+                    FractionalDifference(
+                        decoded.NumberEmissivity(rho, T, Ye, type),
+                        sub.NumberEmissivity(rho, T, Ye, type)) > 1e-12) {
+                  accumulate += 1;
+                }
+              }
+            },
+            n_wrong);
+        REQUIRE(n_wrong == 0);
+        sub.Finalize();
+        decoded.Finalize();
+        requantized.Finalize();
+      }
+#endif
+    }
+
+#ifdef SINGULARITY_USE_MMAP
+    THEN("The tables can be shared through shared memory") {
+      const std::string shmname =
+          "/singularity_opac_test_" + std::to_string(getpid());
+      opac_host.SaveShared(shmname);
+      neutrinos::SpinerOpac shared(shmname, SharedMemory());
+      // Attached processes keep their mapping
+      RemoveSharedTables(shmname);
+      int n_wrong = 0;
+      portableReduce(
+          "shared tables", 0, NRho, 0, NT, 0, NYe, 0, NEUTRINO_NTYPES,
+          PORTABLE_LAMBDA(const int iRho, const int iT, const int iYe,
+                          const int idx, int &accumulate) {
+            const Real rho = std::pow(
+                10., lRhoMin + iRho * (lRhoMax - lRhoMin) / (NRho - 1));
+            const Real T =
+                std::pow(10., lTMin + iT * (lTMax - lTMin) / (NT - 1)) *
+                neutrinos::SpinerOpac::MeV2K;
+            const Real Ye = YeMin + iYe * (YeMax - YeMin) / (NYe - 1);
+            const Real nu = std::pow(10., 0.5 * (leMin + leMax)) *
+                            neutrinos::SpinerOpac::MeV2Hz;
+            const RadiationType type = Idx2RadType(idx);
+            if (opac_host.AbsorptionCoefficient(rho, T, Ye, type, nu) !=
+                    shared.AbsorptionCoefficient(rho, T, Ye, type, nu) ||
+                opac_host.NumberEmissivity(rho, T, Ye, type) !=
+                    shared.NumberEmissivity(rho, T, Ye, type)) {
+              accumulate += 1;
+            }
+          },
+          n_wrong);
+      REQUIRE(n_wrong == 0);
+      shared.Finalize();
+    }
+#endif
+
+    opac_host.Finalize();
+    lalphanu_db.finalize();
+    ljnu_db.finalize();
+    lJ_db.finalize();
+    lJYe_db.finalize();
+  }
+}
+
+TEST_CASE("Quantized storage", "[SpinerNeutrinos]") {
+  using singularity::impl::QuantizedPtr;
+  using singularity::impl::QuantizedStorage;
+
+  WHEN("Blocks mix zeros with physical values") {
+    // Zeros are clamped to a floor far below the physical values, as
+    // log2(EPS) is when tables are built
+    const Real floor = std::log2(10.0 * std::numeric_limits<Real>::min());
+    constexpr int N = 200;
+    constexpr Real lo = 10;
+    constexpr Real hi = 30;
+    std::vector<Real> values(N);
+    for (int i = 0; i < N; ++i) {
+      values[i] = (i % 3 == 0) ? floor : lo + (hi - lo) * i / (N - 1);
+    }
+    QuantizedStorage storage;
+    storage.allocate(N, 1);
+    const Real error = storage.encode(0, values.data());
+    const QuantizedPtr q = storage.table(0);
+
+    THEN("The floor is exact and the rest keeps the resolution of its "
+         "own range") {
+      // Half a step of the physical range, rather than of the range
+      // from the floor
+      REQUIRE(error < (hi - lo) / 131068 * (1 + 1e-3));
+      int n_wrong = 0;
+      for (int i = 0; i < N; ++i) {
+        if (i % 3 == 0) {
+          n_wrong += (q[i] != static_cast<float>(floor));
+        } else {
+          n_wrong += (std::abs(q[i] - values[i]) > error);
+        }
+      }
+      REQUIRE(n_wrong == 0);
+    }
+    storage.finalize();
+  }
+}
+
+TEST_CASE("Non-uniform table grids", "[SpinerNeutrinos]") {
+  using Grid = singularity::impl::TableGrid1D;
+
+  WHEN("We build grids on unevenly spaced nodes") {
+    // The second is too uneven for its bins to be narrower than every
+    // cell
+    const std::vector<Real> nodes[] = {{-1, -0.9, -0.5, 0, 0.05, 1, 3},
+                                       {0, 1e-4, 2e-4, 1, 2}};
+    THEN("Every point lands in the cell a search finds") {
+      int n_wrong = 0;
+      for (const std::vector<Real> &x : nodes) {
+        const int N = x.size();
+        Grid grid(x.data(), N);
+        REQUIRE(!grid.isUniform());
+        // Covers points outside the nodes, which extrapolate
+        for (int i = 0; i <= 4000; ++i) {
+          const Real xi = x.front() - 1 + (x.back() - x.front() + 2) * i / 4000;
+          int cell = 0;
+          while (cell < N - 2 && xi >= x[cell + 1]) {
+            ++cell;
+          }
+          int ix;
+          Spiner::weights_t w;
+          grid.weights(xi, ix, w);
+          if (ix != cell || std::abs(w[0] * x[ix] + w[1] * x[ix + 1] - xi) >
+                                1e-12 * (1 + std::abs(xi))) {
+            n_wrong += 1;
+          }
+        }
+        for (int i = 0; i < N; ++i) {
+          if (grid.index(x[i]) != std::min(i, N - 2) || grid.x(i) != x[i]) {
+            n_wrong += 1;
+          }
+        }
+        grid.finalize();
+      }
+      REQUIRE(n_wrong == 0);
+    }
+  }
+
+  WHEN("We build a grid on evenly spaced nodes") {
+    const std::vector<Real> nodes = {0.1, 0.2, 0.3, 0.4, 0.5};
+    Grid grid(nodes.data(), nodes.size());
+    THEN("It is uniform") {
+      REQUIRE(grid.isUniform());
+      REQUIRE(grid.nPoints() == 5);
+      REQUIRE(FractionalDifference(grid.x(3), Real(0.4)) < 1e-12);
+    }
+  }
+}
+
+TEST_CASE("Spiner opacities on non-uniform grids", "[SpinerNeutrinos]") {
+  constexpr Real MeV2K = 1e6 * pc::eV / pc::kb;
+  constexpr int NRho = 7;
+  constexpr int NT = 5;
+  constexpr int NYe = 4;
+  constexpr int Ne = 6;
+  // log10, with T in K and E in MeV. Denser near nuclear density.
+  const Real lRhos[NRho] = {8, 9, 10, 11, 11.2, 11.4, 12};
+  const Real lTs[NT] = {-2 + std::log10(MeV2K), -1.5 + std::log10(MeV2K),
+                        std::log10(MeV2K), 0.2 + std::log10(MeV2K),
+                        2 + std::log10(MeV2K)};
+  const Real Yes[NYe] = {0.1, 0.15, 0.3, 0.5};
+  const Real les[Ne] = {-1, -0.8, -0.5, 0, 1, 2};
+  const std::vector<Real> lRhoNodes(lRhos, lRhos + NRho);
+  const std::vector<Real> lTNodes(lTs, lTs + NT);
+  const std::vector<Real> YeNodes(Yes, Yes + NYe);
+  const std::vector<Real> leNodes(les, les + Ne);
+
+  WHEN("We tabulate a power law on non-uniform nodes") {
+    PowerLawNeutrinos powerlaw;
+    neutrinos::SpinerOpac opac_host(powerlaw, lRhoNodes, lTNodes, YeNodes,
+                                    leNodes);
+
+    // Lookups inside every cell that miss the power law
+    auto misses = [&](const neutrinos::SpinerOpac &opac, const Real tol) {
+      int n_wrong = 0;
+      portableReduce(
+          "non-uniform tables", 0, NRho - 1, 0, NT - 1, 0, NYe - 1, 0,
+          NEUTRINO_NTYPES,
+          PORTABLE_LAMBDA(const int iRho, const int iT, const int iYe,
+                          const int idx, int &accumulate) {
+            const int ie = (iRho + iT + iYe) % (Ne - 1);
+            const Real lRho =
+                lRhos[iRho] + 0.3 * (lRhos[iRho + 1] - lRhos[iRho]);
+            const Real lT = lTs[iT] + 0.6 * (lTs[iT + 1] - lTs[iT]);
+            const Real Ye = Yes[iYe] + 0.4 * (Yes[iYe + 1] - Yes[iYe]);
+            const Real le = les[ie] + 0.7 * (les[ie + 1] - les[ie]);
+            const Real rho = std::pow(10., lRho);
+            const Real T = std::pow(10., lT);
+            const Real nu = std::pow(10., le) * neutrinos::SpinerOpac::MeV2Hz;
+            const RadiationType type = Idx2RadType(idx);
+            Real alpha, jnu;
+            opac.AbsorptionAndEmissivity(rho, T, Ye, type, nu, alpha, jnu);
+            const Real refs[] = {
+                powerlaw.AbsorptionCoefficient(rho, T, Ye, type, nu),
+                powerlaw.EmissivityPerNuOmega(rho, T, Ye, type, nu),
+                powerlaw.Emissivity(rho, T, Ye, type),
+                powerlaw.NumberEmissivity(rho, T, Ye, type)};
+            const Real vals[] = {alpha, jnu, opac.Emissivity(rho, T, Ye, type),
+                                 opac.NumberEmissivity(rho, T, Ye, type)};
+            for (int k = 0; k < 4; ++k) {
+              if (FractionalDifference(refs[k], vals[k]) > tol) {
+                accumulate += 1;
+              }
+            }
+          },
+          n_wrong);
+      return n_wrong;
+    };
+
+    THEN("Lookups reproduce the power law between the nodes") {
+      neutrinos::SpinerOpac opac = opac_host.GetOnDevice();
+      REQUIRE(misses(opac, 1e-10) == 0);
+      opac.Finalize();
+    }
+
+    THEN("Every layout and precision works on the nodes") {
+      const neutrinos::SpectralLayout layouts[] = {
+          neutrinos::SpectralLayout::Separate,
+          neutrinos::SpectralLayout::Interleaved};
+      const TablePrecision precisions[] = {
+          TablePrecision::Double, TablePrecision::Float,
+          TablePrecision::Quantized};
+      // The quantized blocks span many decades
+      const Real tols[] = {1e-10, 1e-5, 1e-2};
+      for (const neutrinos::SpectralLayout layout : layouts) {
+        for (int p = 0; p < 3; ++p) {
+          neutrinos::SpinerOpac packed(powerlaw, lRhoNodes, lTNodes, YeNodes,
+                                       leNodes, layout, precisions[p]);
+          REQUIRE(misses(packed, tols[p]) == 0);
+          packed.Finalize();
+        }
+      }
+    }
+
+    THEN("Evenly spaced nodes give the uniform table") {
+      const Real lRhoMin = 8, lRhoMax = 12;
+      const Real lTMin = lTs[0], lTMax = lTs[NT - 1];
+      const Real YeMin = 0.1, YeMax = 0.5;
+      const Real leMin = -1, leMax = 2;
+      auto even = [](const Real lo, const Real hi, const int N) {
+        std::vector<Real> x(N);
+        for (int i = 0; i < N; ++i) {
+          x[i] = lo + (hi - lo) * i / (N - 1);
+        }
+        return x;
+      };
+      neutrinos::SpinerOpac uniform(powerlaw, lRhoMin, lRhoMax, NRho, lTMin,
+                                    lTMax, NT, YeMin, YeMax, NYe, leMin, leMax,
+                                    Ne);
+      neutrinos::SpinerOpac nodal(powerlaw, even(lRhoMin, lRhoMax, NRho),
+                                  even(lTMin, lTMax, NT),
+                                  even(YeMin, YeMax, NYe),
+                                  even(leMin, leMax, Ne));
+      const Real rho = 3e9;
+      const Real T = 2 * MeV2K;
+      const Real nu = 5 * neutrinos::SpinerOpac::MeV2Hz;
+      for (int idx = 0; idx < NEUTRINO_NTYPES; ++idx) {
+        const RadiationType type = Idx2RadType(idx);
+        REQUIRE(FractionalDifference(
+                    uniform.AbsorptionCoefficient(rho, T, 0.2, type, nu),
+                    nodal.AbsorptionCoefficient(rho, T, 0.2, type, nu)) <
+                1e-12);
+        REQUIRE(FractionalDifference(uniform.Emissivity(rho, T, 0.2, type),
+                                     nodal.Emissivity(rho, T, 0.2, type)) <
+                1e-12);
+      }
+      uniform.Finalize();
+      nodal.Finalize();
+    }
+
+#ifdef SINGULARITY_USE_MMAP
+    THEN("The nodes round trip through a raw file") {
+      const std::string rawname = "nonuniform.raw";
+      opac_host.SaveRaw(rawname);
+      neutrinos::SpinerOpac mapped(rawname, RawFormat());
+      REQUIRE(misses(mapped, 1e-10) == 0);
+      mapped.Finalize();
+    }
+#endif
+
+#ifdef SPINER_USE_HDF
+    THEN("The nodes round trip through HDF5") {
+      const std::string nonuniformname = "nonuniform.sp5";
+      opac_host.Save(nonuniformname);
+      neutrinos::SpinerOpac loaded(nonuniformname);
+      REQUIRE(misses(loaded, 1e-10) == 0);
+      loaded.Finalize();
+    }
+
+    THEN("A subset keeps the nodes within it") {
+      const std::string subsetname = "nonuniform_subset.sp5";
+      opac_host.Save(subsetname);
+      // Cuts every axis between nodes, so the subset keeps rho nodes 2
+      // to 5, T nodes 1 to 3, Ye nodes 1 to 2 and E nodes 1 to 4
+      neutrinos::TableSubset subset;
+      subset.lRhoMin = 10.5;
+      subset.lRhoMax = 11.3;
+      subset.lTMin = lTs[1] + 0.1;
+      subset.lTMax = lTs[3] - 0.1;
+      subset.YeMin = 0.2;
+      subset.YeMax = 0.25;
+      subset.leMin = -0.7;
+      subset.leMax = 0.5;
+      neutrinos::SpinerOpac sub(subsetname, subset);
+      int n_wrong = 0;
+      for (int iRho = 2; iRho < 5; ++iRho) {
+        for (int iT = 1; iT < 3; ++iT) {
+          for (int ie = 1; ie < 4; ++ie) {
+            const Real rho = std::pow(
+                10., lRhos[iRho] + 0.3 * (lRhos[iRho + 1] - lRhos[iRho]));
+            const Real T =
+                std::pow(10., lTs[iT] + 0.6 * (lTs[iT + 1] - lTs[iT]));
+            const Real Ye = Yes[1] + 0.4 * (Yes[2] - Yes[1]);
+            const Real nu =
+                std::pow(10., les[ie] + 0.7 * (les[ie + 1] - les[ie])) *
+                neutrinos::SpinerOpac::MeV2Hz;
+            for (int idx = 0; idx < NEUTRINO_NTYPES; ++idx) {
+              const RadiationType type = Idx2RadType(idx);
+              if (FractionalDifference(
+                      sub.AbsorptionCoefficient(rho, T, Ye, type, nu),
+                      opac_host.AbsorptionCoefficient(rho, T, Ye, type, nu)) >
+                      1e-12 ||
+                  FractionalDifference(
+                      sub.EmissivityPerNu(rho, T, Ye, type, nu),
+                      opac_host.EmissivityPerNu(rho, T, Ye, type, nu)) >
+                      1e-12 ||
+                  FractionalDifference(sub.Emissivity(rho, T, Ye, type),
+                                       opac_host.Emissivity(rho, T, Ye, type)) >
+                      1e-12) {
+                n_wrong += 1;
+              }
+            }
+          }
+        }
+      }
+      REQUIRE(n_wrong == 0);
+      sub.Finalize();
+      unlink(subsetname.c_str());
+    }
+#endif
+
+    opac_host.Finalize();
+  }
+}
+
+TEST_CASE("Multigroup opacities", "[SpinerNeutrinos][MultigroupNeutrinos]") {
+  constexpr Real MeV2K = 1e6 * pc::eV / pc::kb;
+  constexpr Real MeV2Hz = neutrinos::SpinerOpac::MeV2Hz;
+  constexpr Real lRhoMin = 8;
+  constexpr Real lRhoMax = 12;
+  constexpr int NRho = 6;
+  constexpr Real lTMin = -2 + std::log10(MeV2K);
+  constexpr Real lTMax = 2 + std::log10(MeV2K);
+  constexpr int NT = 5;
+  constexpr Real YeMin = 0.1;
+  constexpr Real YeMax = 0.5;
+  constexpr int NYe = 4;
+  constexpr Real leMin = -1;
+  constexpr Real leMax = 2;
+  constexpr int Ne = 8;
+  // MeV. The first and last groups reach past the energy nodes.
+  constexpr int NG = 5;
+  const Real edgesMeV[NG + 1] = {0.05, 0.5, 2, 10, 40, 300};
+  std::vector<Real> edges(NG + 1);
+  for (int g = 0; g <= NG; ++g) {
+    edges[g] = edgesMeV[g] * MeV2Hz;
+  }
+
+  WHEN("We integrate tables of a power law over fixed groups") {
+    using Grid_t = Spiner::RegularGrid1D;
+    Grid_t lRhoGrid(lRhoMin, lRhoMax, NRho);
+    Grid_t lTGrid(lTMin, lTMax, NT);
+    Grid_t YeGrid(YeMin, YeMax, NYe);
+
+    PowerLawNeutrinos powerlaw;
+    neutrinos::SpinerOpac spectral(powerlaw, lRhoMin, lRhoMax, NRho, lTMin,
+                                   lTMax, NT, YeMin, YeMax, NYe, leMin, leMax,
+                                   Ne);
+    neutrinos::MultigroupOpac groups_host(spectral, edges);
+    spectral.Finalize();
+
+    Real *nu_edges = (Real *)PORTABLE_MALLOC((NG + 1) * sizeof(Real));
+    portableCopyToDevice(nu_edges, edges.data(), (NG + 1) * sizeof(Real));
+
+    THEN("Group values at the nodes are the exact group integrals") {
+      neutrinos::MultigroupOpac opac = groups_host.GetOnDevice();
+      REQUIRE(opac.NumGroups() == NG);
+      int n_wrong = 0;
+      portableReduce(
+          "multigroup vs power law", 0, NRho, 0, NT, 0, NYe, 0,
+          NEUTRINO_NTYPES,
+          PORTABLE_LAMBDA(const int iRho, const int iT, const int iYe,
+                          const int idx, int &accumulate) {
+            const Real rho = std::pow(10., lRhoGrid.x(iRho));
+            const Real T = std::pow(10., lTGrid.x(iT));
+            const Real Ye = YeGrid.x(iYe);
+            const RadiationType type = Idx2RadType(idx);
+            // alpha goes as nu^-2 and j as nu^1/2
+            const Real alpha1 =
+                powerlaw.AbsorptionCoefficient(rho, T, Ye, type, 1);
+            const Real j1 = powerlaw.EmissivityPerNuOmega(rho, T, Ye, type, 1);
+            Real nu_bins[NG];
+            Real alpha[NG], jnu[NG], fused_alpha[NG], fused_jnu[NG];
+            Real group_alpha[NG], group_jnu[NG];
+            for (int g = 0; g < NG; ++g) {
+              nu_bins[g] = std::sqrt(nu_edges[g] * nu_edges[g + 1]);
+            }
+            opac.AbsorptionCoefficient(rho, T, Ye, type, nu_bins, alpha, NG);
+            opac.EmissivityPerNuOmega(rho, T, Ye, type, nu_bins, jnu, NG);
+            opac.AbsorptionAndEmissivity(rho, T, Ye, type, nu_bins,
+                                         fused_alpha, fused_jnu, NG);
+            opac.GroupAbsorptionAndEmissivity(rho, T, Ye, type, group_alpha,
+                                              group_jnu);
+            Real J = 0;
+            Real JYe = 0;
+            for (int g = 0; g < NG; ++g) {
+              const Real a = nu_edges[g];
+              const Real b = nu_edges[g + 1];
+              const Real ref_alpha = alpha1 * (1 / a - 1 / b) / (b - a);
+              const Real ref_j =
+                  j1 * 2. / 3. * (b * std::sqrt(b) - a * std::sqrt(a));
+              J += 4 * M_PI * ref_j;
+              JYe += 4 * M_PI * j1 * 2 * (std::sqrt(b) - std::sqrt(a)) / pc::h;
+              const Real vals_alpha[] = {
+                  alpha[g], fused_alpha[g], group_alpha[g],
+                  opac.AbsorptionCoefficient(rho, T, Ye, type, nu_bins[g]),
+                  opac.AngleAveragedAbsorptionCoefficient(rho, T, Ye, type,
+                                                          nu_bins[g])};
+              const Real vals_j[] = {
+                  jnu[g], fused_jnu[g], group_jnu[g],
+                  opac.EmissivityPerNuOmega(rho, T, Ye, type, nu_bins[g]),
+                  opac.EmissivityPerNu(rho, T, Ye, type, nu_bins[g]) /
+                      (4 * M_PI)};
+              for (int k = 0; k < 5; ++k) {
+                if (FractionalDifference(ref_alpha, vals_alpha[k]) > 1e-10 ||
+                    FractionalDifference(ref_j / (b - a), vals_j[k]) > 1e-10) {
+                  accumulate += 1;
+                }
+              }
+            }
+            if (FractionalDifference(J, opac.Emissivity(rho, T, Ye, type)) >
+                    1e-10 ||
+                FractionalDifference(
+                    JYe, opac.NumberEmissivity(rho, T, Ye, type)) > 1e-10) {
+              accumulate += 1;
+            }
+          },
+          n_wrong);
+      REQUIRE(n_wrong == 0);
+      opac.Finalize();
+    }
+
+    THEN("Frequencies map to the group holding them") {
+      neutrinos::MultigroupOpac opac = groups_host.GetOnDevice();
+      int n_wrong = 0;
+      portableReduce(
+          "multigroup frequency lookup", 0, NRho - 1, 0, NT - 1, 0, NYe - 1,
+          0, NEUTRINO_NTYPES,
+          PORTABLE_LAMBDA(const int iRho, const int iT, const int iYe,
+                          const int idx, int &accumulate) {
+            const Real rho = std::pow(10., lRhoGrid.x(iRho) + 0.3);
+            const Real T = std::pow(10., lTGrid.x(iT) + 0.4);
+            const Real Ye = YeGrid.x(iYe) + 0.05;
+            const RadiationType type = Idx2RadType(idx);
+            Real alpha[NG];
+            opac.AbsorptionCoefficient(rho, T, Ye, type, nu_edges, alpha, NG);
+            // Below, inside and above the groups, with a bin count that
+            // differs from the number of groups
+            constexpr int NB = 4;
+            Real nu_bins[NB] = {0.5 * nu_edges[0], nu_edges[1],
+                                0.99 * nu_edges[3], 2 * nu_edges[NG]};
+            const int expected[NB] = {0, 1, 2, NG - 1};
+            Real binned[NB];
+            opac.AbsorptionCoefficient(rho, T, Ye, type, nu_bins, binned, NB);
+            for (int i = 0; i < NB; ++i) {
+              const Real scalar =
+                  opac.AbsorptionCoefficient(rho, T, Ye, type, nu_bins[i]);
+              if (binned[i] != alpha[expected[i]] || scalar != binned[i]) {
+                accumulate += 1;
+              }
+            }
+            // As many bins as groups, all inside the third group
+            Real same_bins[NG], same_alpha[NG], same_jnu[NG];
+            for (int i = 0; i < NG; ++i) {
+              same_bins[i] = nu_edges[2] * (1 + 0.1 * i);
+            }
+            opac.AbsorptionAndEmissivity(rho, T, Ye, type, same_bins,
+                                         same_alpha, same_jnu, NG);
+            for (int i = 0; i < NG; ++i) {
+              if (same_alpha[i] != alpha[2]) {
+                accumulate += 1;
+              }
+            }
+            opac.EmissivityPerNu(rho, T, Ye, type, same_bins, same_jnu, NG);
+            for (int i = 0; i < NG; ++i) {
+              if (same_jnu[i] != same_jnu[0]) {
+                accumulate += 1;
+              }
+            }
+          },
+          n_wrong);
+      REQUIRE(n_wrong == 0);
+      opac.Finalize();
+    }
+
+    THEN("The model is selectable through the opacity variant") {
+      const Real rho = 1e10;
+      const Real T = 3 * MeV2K;
+      const Real Ye = 0.3;
+      const Real nu = 5 * MeV2Hz;
+      const RadiationType type = RadiationType::NU_ELECTRON;
+      neutrinos::Opacity opac = groups_host;
+      REQUIRE(opac.IsType<neutrinos::MultigroupOpac>());
+      REQUIRE(opac.AbsorptionCoefficient(rho, T, Ye, type, nu) ==
+              groups_host.AbsorptionCoefficient(rho, T, Ye, type, nu));
+
+      constexpr Real time_unit = 123.;
+      constexpr Real mass_unit = 456.;
+      constexpr Real length_unit = 789.;
+      constexpr Real temp_unit = 276.;
+      constexpr Real rho_unit =
+          mass_unit / (length_unit * length_unit * length_unit);
+      using MultigroupUnits = neutrinos::NonCGSUnits<neutrinos::MultigroupOpac>;
+      neutrinos::MultigroupOpac copy = groups_host;
+      neutrinos::Opacity units =
+          MultigroupUnits(std::forward<neutrinos::MultigroupOpac>(copy),
+                          time_unit, mass_unit, length_unit, temp_unit);
+      const Real alpha = units.AbsorptionCoefficient(
+          rho / rho_unit, T / temp_unit, Ye, type, nu * time_unit);
+      REQUIRE(FractionalDifference(
+                  alpha, length_unit * groups_host.AbsorptionCoefficient(
+                                           rho, T, Ye, type, nu)) < 1e-12);
+    }
+
+    PORTABLE_FREE(nu_edges);
+    groups_host.Finalize();
+  }
+}
+
+TEST_CASE("Spiner opacities outside the table", "[SpinerNeutrinos]") {
+  constexpr Real MeV2K = 1e6 * pc::eV / pc::kb;
+  constexpr Real MeV2Hz = neutrinos::SpinerOpac::MeV2Hz;
+  // A table trimmed to a small core of states
+  constexpr Real lRhoMin = 9;
+  constexpr Real lRhoMax = 11;
+  constexpr int NRho = 5;
+  constexpr Real lTMin = -1 + std::log10(MeV2K);
+  constexpr Real lTMax = 1 + std::log10(MeV2K);
+  constexpr int NT = 5;
+  constexpr Real YeMin = 0.2;
+  constexpr Real YeMax = 0.4;
+  constexpr int NYe = 3;
+  constexpr Real leMin = -0.5;
+  constexpr Real leMax = 1;
+  constexpr int Ne = 7;
+  constexpr Real kappa = 3;
+
+  WHEN("We tabulate a power law on a trimmed table") {
+    PowerLawNeutrinos powerlaw;
+    neutrinos::SpinerOpac table_host(powerlaw, lRhoMin, lRhoMax, NRho, lTMin,
+                                     lTMax, NT, YeMin, YeMax, NYe, leMin,
+                                     leMax, Ne);
+
+    // Case 0 is inside the table. Cases 1 to 4 are outside on rho, T,
+    // Ye and energy, and case 5 on all of them at once. Edges are the
+    // points the clamp moves them to.
+    constexpr int NCASES = 6;
+    auto point = PORTABLE_LAMBDA(const int c, const bool edge, Real &rho,
+                                 Real &T, Real &Ye, Real &nu) {
+      rho = (c == 1 || c == 5) ? (edge ? 1e11 : 1e13) : 1e10;
+      T = ((c == 2 || c == 5) ? (edge ? 0.1 : 1e-2) : 1) * MeV2K;
+      Ye = (c == 3 || c == 5) ? (edge ? YeMax : 0.5) : 0.3;
+      nu = ((c == 4 || c == 5) ? (edge ? 10 : 50) : 3) * MeV2Hz;
+    };
+    // Host lookups at each case that miss ref(case, type, q)
+    auto misses = [&](const neutrinos::SpinerOpac &opac, const auto &ref) {
+      int n_wrong = 0;
+      for (int c = 0; c < NCASES; ++c) {
+        for (int idx = 0; idx < NEUTRINO_NTYPES; ++idx) {
+          const RadiationType type = Idx2RadType(idx);
+          Real rho, T, Ye, nu;
+          point(c, false, rho, T, Ye, nu);
+          Real alpha, jnu, alphas[1], jnus[1];
+          Real nu_bins[1] = {nu};
+          opac.AbsorptionAndEmissivity(rho, T, Ye, type, nu, alpha, jnu);
+          opac.AbsorptionAndEmissivity(rho, T, Ye, type, nu_bins, alphas,
+                                       jnus, 1);
+          const Real vals[] = {alpha, jnu, opac.Emissivity(rho, T, Ye, type),
+                               opac.NumberEmissivity(rho, T, Ye, type),
+                               alphas[0], jnus[0]};
+          for (int q = 0; q < 6; ++q) {
+            if (FractionalDifference(vals[q], ref(c, type, q % 4)) > 1e-10) {
+              n_wrong += 1;
+            }
+          }
+        }
+      }
+      return n_wrong;
+    };
+    // The power law at case c, or at its edge
+    auto powerlawAt = [&](const int c, const bool edge,
+                          const RadiationType type, const int q) {
+      Real rho, T, Ye, nu;
+      point(c, edge, rho, T, Ye, nu);
+      const Real refs[] = {
+          powerlaw.AbsorptionCoefficient(rho, T, Ye, type, nu),
+          powerlaw.EmissivityPerNuOmega(rho, T, Ye, type, nu),
+          powerlaw.Emissivity(rho, T, Ye, type),
+          powerlaw.NumberEmissivity(rho, T, Ye, type)};
+      return refs[q];
+    };
+
+    THEN("By default lookups continue the power laws past the table") {
+      REQUIRE(misses(table_host, [&](const int c, const RadiationType type,
+                                     const int q) {
+                return powerlawAt(c, false, type, q);
+              }) == 0);
+    }
+
+    THEN("Clamped axes hold lookups on the edge of the table") {
+      OutOfRangePolicy policy;
+      policy.rho = OutOfRange::Clamp;
+      policy.T = OutOfRange::Clamp;
+      policy.Ye = OutOfRange::Clamp;
+      policy.e = OutOfRange::Clamp;
+      table_host.SetOutOfRange(policy);
+      REQUIRE(misses(table_host, [&](const int c, const RadiationType type,
+                                     const int q) {
+                return powerlawAt(c, true, type, q);
+              }) == 0);
+    }
+
+    THEN("Fallback axes hand lookups to another model") {
+      OutOfRangePolicy policy;
+      policy.rho = OutOfRange::Fallback;
+      policy.T = OutOfRange::Fallback;
+      policy.Ye = OutOfRange::Fallback;
+      policy.e = OutOfRange::Fallback;
+      table_host.SetOutOfRange(policy);
+      neutrinos::Gray gray(kappa);
+      using Trimmed = neutrinos::WithFallback<neutrinos::SpinerOpac,
+                                              neutrinos::Gray>;
+      Trimmed opac(table_host.GetOnDevice(), neutrinos::Gray(kappa));
+
+      int n_wrong = 0;
+      portableReduce(
+          "fallback lookups", 0, NCASES,
+          PORTABLE_LAMBDA(const int c, int &accumulate) {
+            Real rho, T, Ye, nu;
+            point(c, false, rho, T, Ye, nu);
+            const RadiationType type = RadiationType::NU_ELECTRON;
+            // Bins inside and outside the table energies
+            Real nu_bins[] = {nu, 50 * MeV2Hz};
+            Real alphas[2], jnus[2];
+            opac.AbsorptionAndEmissivity(rho, T, Ye, type, nu_bins, alphas,
+                                         jnus, 2);
+            const Real alpha = opac.AbsorptionCoefficient(rho, T, Ye, type, nu);
+            const Real ref =
+                (c == 0) ? powerlaw.AbsorptionCoefficient(rho, T, Ye, type, nu)
+                         : gray.AbsorptionCoefficient(rho, T, Ye, type, nu);
+            const Real ref_j =
+                (c == 0) ? powerlaw.EmissivityPerNuOmega(rho, T, Ye, type, nu)
+                         : gray.EmissivityPerNuOmega(rho, T, Ye, type, nu);
+            const Real ref_J = (c == 0 || c == 4)
+                                   ? powerlaw.Emissivity(rho, T, Ye, type)
+                                   : gray.Emissivity(rho, T, Ye, type);
+            if (FractionalDifference(alpha, ref) > 1e-10 ||
+                FractionalDifference(alphas[0], ref) > 1e-10 ||
+                FractionalDifference(jnus[0], ref_j) > 1e-10 ||
+                FractionalDifference(
+                    alphas[1], gray.AbsorptionCoefficient(rho, T, Ye, type,
+                                                          nu_bins[1])) >
+                    1e-10 ||
+                FractionalDifference(opac.Emissivity(rho, T, Ye, type),
+                                     ref_J) > 1e-10) {
+              accumulate += 1;
+            }
+          },
+          n_wrong);
+      REQUIRE(n_wrong == 0);
+      opac.Finalize();
+    }
+
+    table_host.Finalize();
+  }
+}
+
+TEST_CASE("Adaptive Spiner tables", "[SpinerNeutrinos]") {
+  constexpr Real MeV2K = 1e6 * pc::eV / pc::kb;
+  constexpr Real lRhoMin = 8;
+  constexpr Real lRhoMax = 12;
+  constexpr Real lTMin = std::log10(MeV2K);
+  constexpr Real lTMax = 1 + std::log10(MeV2K);
+  constexpr Real YeMin = 0.1;
+  constexpr Real YeMax = 0.5;
+  constexpr Real leMin = -1;
+  constexpr Real leMax = 0.5;
+  constexpr Real kappa = 1.0;
+  using Table = neutrinos::SpinerOpac;
+  using Thermal = neutrinos::FermiDiracDistributionNoMu<3>;
+  neutrinos::Gray gray(kappa);
+
+  WHEN("We build a table of gray opacities to a target error") {
+    neutrinos::AdaptiveTableOptions options;
+    options.tolerance = 5e-2;
+    neutrinos::AdaptiveTableReport report;
+    Table table = neutrinos::BuildAdaptiveSpinerOpacity<Thermal>(
+        gray, lRhoMin, lRhoMax, lTMin, lTMax, YeMin, YeMax, leMin, leMax,
+        report, options);
+
+    THEN("It meets the target, refining only the axes that need it") {
+      REQUIRE(report.converged);
+      REQUIRE(report.error <= options.tolerance);
+      REQUIRE(report.error == std::max({report.errorRho, report.errorT,
+                                        report.errorYe, report.errorE}));
+      // Gray opacities are power laws in rho and don't depend on Ye
+      REQUIRE(report.NRho == options.minPoints);
+      REQUIRE(report.NYe == options.minPoints);
+      REQUIRE(report.Ne > options.minPoints);
+      REQUIRE(report.builds > 1);
+    }
+
+    THEN("Halving the cells of an axis keeps the old nodes") {
+      for (int n : {report.NRho, report.NT, report.NYe, report.Ne}) {
+        while (n > options.minPoints) {
+          REQUIRE(n % 2 == 1);
+          n = (n + 1) / 2;
+        }
+        REQUIRE(n == options.minPoints);
+      }
+    }
+
+    THEN("A tighter target gives a finer table") {
+      neutrinos::AdaptiveTableOptions tight = options;
+      tight.tolerance = 1e-2;
+      neutrinos::AdaptiveTableReport fine;
+      Table finer = neutrinos::BuildAdaptiveSpinerOpacity<Thermal>(
+          gray, lRhoMin, lRhoMax, lTMin, lTMax, YeMin, YeMax, leMin, leMax,
+          fine, tight);
+      REQUIRE(fine.converged);
+      REQUIRE(fine.error <= tight.tolerance);
+      REQUIRE(fine.Ne > report.Ne);
+      finer.Finalize();
+    }
+
+#ifdef SPINER_USE_HDF
+    THEN("The table saves to and loads from a file") {
+      const std::string filename = "adaptive.sp5";
+      table.Save(filename);
+      Table loaded(filename);
+      const Real rho = 1e10;
+      const Real T = 3 * MeV2K;
+      const Real Ye = 0.3;
+      const Real nu = 2 * Table::MeV2Hz;
+      const RadiationType type = RadiationType::NU_ELECTRON;
+      REQUIRE(FractionalDifference(
+                  loaded.EmissivityPerNu(rho, T, Ye, type, nu),
+                  table.EmissivityPerNu(rho, T, Ye, type, nu)) < 1e-12);
+      REQUIRE(FractionalDifference(
+                  loaded.EmissivityPerNu(rho, T, Ye, type, nu),
+                  gray.EmissivityPerNu(rho, T, Ye, type, nu)) < 1e-2);
+      loaded.Finalize();
+      unlink(filename.c_str());
+    }
+#endif
+
+    table.Finalize();
+  }
+
+  WHEN("The points allowed are too few to meet the target") {
+    neutrinos::AdaptiveTableOptions options;
+    options.tolerance = 1e-4;
+    options.maxPoints = 5;
+    neutrinos::AdaptiveTableReport report;
+    Table table = neutrinos::BuildAdaptiveSpinerOpacity<Thermal>(
+        gray, lRhoMin, lRhoMax, lTMin, lTMax, YeMin, YeMax, leMin, leMax,
+        report, options);
+    THEN("The best table allowed is reported as not converged") {
+      REQUIRE(!report.converged);
+      REQUIRE(report.Ne == options.maxPoints);
+      REQUIRE(report.error > options.tolerance);
+    }
+    table.Finalize();
+  }
+
+  WHEN("maxPoints is not reached by halving cells") {
+    neutrinos::AdaptiveTableOptions options;
+    options.tolerance = 1e-4;
+    options.maxPoints = 12;
+    neutrinos::AdaptiveTableReport report;
+    Table table = neutrinos::BuildAdaptiveSpinerOpacity<Thermal>(
+        gray, lRhoMin, lRhoMax, lTMin, lTMax, YeMin, YeMax, leMin, leMax,
+        report, options);
+    THEN("Axes stop at the last halving within it") {
+      // 3, 5, 9 and not 12, which would leave cells of uneven size
+      REQUIRE(!report.converged);
+      REQUIRE(report.Ne == 9);
+      for (int n : {report.NRho, report.NT, report.NYe, report.Ne}) {
+        REQUIRE(n <= options.maxPoints);
+        while (n > options.minPoints) {
+          REQUIRE(n % 2 == 1);
+          n = (n + 1) / 2;
+        }
+        REQUIRE(n == options.minPoints);
+      }
+    }
+    table.Finalize();
+  }
+
+  WHEN("We build a table of mean opacities to a target error") {
+    const RolloffNeutrinos rolloff = {kappa, 3 * Table::MeV2Hz};
+    neutrinos::AdaptiveTableOptions options;
+    options.tolerance = 1e-2;
+    const MeanQuadrature quadrature = {QuadratureRule::GaussLaguerre, 32};
+    neutrinos::AdaptiveTableReport report;
+    neutrinos::MeanOpacityCGS mean = neutrinos::BuildAdaptiveMeanOpacity(
+        rolloff, lRhoMin, lRhoMax, lTMin, lTMax, YeMin, YeMax, report, options,
+        quadrature);
+
+    THEN("It meets the target, refining T but not rho or Ye") {
+      REQUIRE(report.converged);
+      REQUIRE(report.error <= options.tolerance);
+      REQUIRE(report.NT > options.minPoints);
+      // The means are proportional to rho and don't depend on Ye
+      REQUIRE(report.NRho == options.minPoints);
+      REQUIRE(report.NYe == options.minPoints);
+      REQUIRE(report.Ne == 0);
+      REQUIRE(report.errorE == 0);
+    }
+
+    THEN("It matches a table built directly at that resolution") {
+      neutrinos::MeanOpacityCGS direct(rolloff, lRhoMin, lRhoMax, report.NRho,
+                                       lTMin, lTMax, report.NT, YeMin, YeMax,
+                                       report.NYe, quadrature);
+      const Real rho = 1e10;
+      const Real Ye = 0.3;
+      const RadiationType type = RadiationType::NU_ELECTRON;
+      for (const Real T : {1.3 * MeV2K, 2.9 * MeV2K, 7.1 * MeV2K}) {
+        REQUIRE(mean.PlanckMeanAbsorptionCoefficient(rho, T, Ye, type) ==
+                direct.PlanckMeanAbsorptionCoefficient(rho, T, Ye, type));
+        REQUIRE(mean.RosselandMeanAbsorptionCoefficient(rho, T, Ye, type) ==
+                direct.RosselandMeanAbsorptionCoefficient(rho, T, Ye, type));
+      }
+      direct.Finalize();
+    }
+
+    mean.Finalize();
+  }
+}
+
+TEST_CASE("Emission energy sampling", "[SpinerNeutrinos]") {
+  constexpr Real MeV2K = 1e6 * pc::eV / pc::kb;
+  constexpr Real lRhoMin = 8;
+  constexpr Real lRhoMax = 12;
+  constexpr int NRho = 5;
+  constexpr Real lTMin = std::log10(MeV2K);
+  constexpr Real lTMax = 1 + std::log10(MeV2K);
+  constexpr int NT = 17;
+  constexpr Real YeMin = 0.1;
+  constexpr Real YeMax = 0.5;
+  constexpr int NYe = 3;
+  constexpr Real leMin = -1;
+  constexpr Real leMax = 2;
+  constexpr int Ne = 64;
+  constexpr Real kappa = 1.0;
+  constexpr int NSAMPLES = 2000;
+  using Table = neutrinos::SpinerOpac;
+  neutrinos::Gray gray(kappa);
+
+  // Mean energy of the gray emission between the bounds, integrated
+  // finely in log E
+  auto meanEnergy = [&](const Real rho, const Real T, const Real Ye,
+                        const RadiationType type) {
+    constexpr int N = 4000;
+    Real num = 0;
+    Real den = 0;
+    for (int i = 0; i < N; ++i) {
+      const Real le = leMin + (leMax - leMin) * (i + 0.5) / N;
+      const Real nu = std::pow(10., le) * Table::MeV2Hz;
+      const Real jdnu = gray.EmissivityPerNu(rho, T, Ye, type, nu) * nu;
+      num += nu * jdnu;
+      den += jdnu;
+    }
+    return num / den;
+  };
+  // Mean of NSAMPLES evenly spaced draws, and whether they increase
+  // with u
+  auto sampledMean = [&](const auto &sampler, const Real rho, const Real T,
+                         const Real Ye, const RadiationType type,
+                         bool &monotonic) {
+    Real sum = 0;
+    Real last = 0;
+    monotonic = true;
+    for (int i = 0; i < NSAMPLES; ++i) {
+      const Real u = (i + 0.5) / NSAMPLES;
+      const Real nu = sampler.SampleEmissionEnergy(rho, T, Ye, type, u);
+      monotonic = monotonic && nu >= last;
+      last = nu;
+      sum += nu;
+    }
+    return sum / NSAMPLES;
+  };
+  // On and between the temperature nodes
+  const Real temps[] = {2 * MeV2K, 3.3 * MeV2K, 7.1 * MeV2K};
+  const Real rho = 3e10;
+  const Real Ye = 0.27;
+
+  WHEN("We tabulate the emission of a gray model and a table of it") {
+    neutrinos::EmissionSampler<> sampler(gray, lRhoMin, lRhoMax, NRho, lTMin,
+                                         lTMax, NT, YeMin, YeMax, NYe, leMin,
+                                         leMax, Ne);
+    Table table(gray, lRhoMin, lRhoMax, NRho, lTMin, lTMax, NT, YeMin, YeMax,
+                NYe, leMin, leMax, Ne);
+    REQUIRE(!table.HasEmissionSampling());
+    table.BuildEmissionSampling();
+    REQUIRE(table.HasEmissionSampling());
+
+    THEN("Samples cover the energies emitted, with the right mean") {
+      for (const Real T : temps) {
+        for (int idx = 0; idx < NEUTRINO_NTYPES; ++idx) {
+          const RadiationType type = Idx2RadType(idx);
+          const Real mean = meanEnergy(rho, T, Ye, type);
+          bool monotonic;
+          REQUIRE(FractionalDifference(
+                      sampledMean(sampler, rho, T, Ye, type, monotonic),
+                      mean) < 1e-2);
+          REQUIRE(monotonic);
+          REQUIRE(FractionalDifference(
+                      sampledMean(table, rho, T, Ye, type, monotonic), mean) <
+                  1e-2);
+          REQUIRE(monotonic);
+          const Real emin = std::pow(10., leMin) * Table::MeV2Hz;
+          const Real emax = std::pow(10., leMax) * Table::MeV2Hz;
+          REQUIRE(FractionalDifference(
+                      table.SampleEmissionEnergy(rho, T, Ye, type, 0), emin) <
+                  1e-2);
+          REQUIRE(FractionalDifference(
+                      table.SampleEmissionEnergy(rho, T, Ye, type, 1), emax) <
+                  1e-2);
+        }
+      }
+    }
+
+#ifdef SPINER_USE_HDF
+    THEN("The sampling tables save and load with the opacities") {
+      const std::string tablename = "sampling.sp5";
+      const std::string samplername = "sampler.sp5";
+      table.Save(tablename);
+      sampler.Save(samplername);
+      Table loaded(tablename);
+      neutrinos::EmissionSampler<> loadedSampler(samplername);
+      REQUIRE(loaded.HasEmissionSampling());
+      const RadiationType type = RadiationType::NU_ELECTRON_ANTI;
+      for (const Real u : {0.1, 0.5, 0.9}) {
+        REQUIRE(FractionalDifference(
+                    loaded.SampleEmissionEnergy(rho, temps[1], Ye, type, u),
+                    table.SampleEmissionEnergy(rho, temps[1], Ye, type, u)) <
+                1e-12);
+        REQUIRE(FractionalDifference(
+                    loadedSampler.SampleEmissionEnergy(rho, temps[1], Ye, type,
+                                                       u),
+                    sampler.SampleEmissionEnergy(rho, temps[1], Ye, type, u)) <
+                1e-12);
+      }
+      loaded.Finalize();
+      loadedSampler.Finalize();
+      unlink(tablename.c_str());
+      unlink(samplername.c_str());
+    }
+
+    THEN("The sampling tables survive every other way of loading") {
+      const std::string tablename = "sampling_paths.sp5";
+      table.Save(tablename);
+      Table loaded(tablename);
+      neutrinos::TableSubset subset;
+      subset.lTMin = std::log10(temps[1]) - 0.2;
+      subset.lTMax = std::log10(temps[1]) + 0.2;
+      subset.species[0] = false;
+      subset.species[2] = false;
+      Table sub(tablename, subset);
+#ifdef SINGULARITY_USE_MMAP
+      const std::string rawname = "sampling.raw";
+      table.SaveRaw(rawname);
+      Table mapped(rawname, RawFormat());
+      // Converting every table releases the mapping
+      Table converted(rawname, RawFormat(),
+                      neutrinos::SpectralLayout::Interleaved,
+                      TablePrecision::Float);
+      const std::string shmname =
+          "/singularity_opac_sampling_" + std::to_string(getpid());
+      table.SaveShared(shmname);
+      Table shared(shmname, SharedMemory());
+      RemoveSharedTables(shmname);
+      Table *others[] = {&sub, &mapped, &converted, &shared};
+#else
+      Table *others[] = {&sub};
+#endif
+      const RadiationType type = RadiationType::NU_ELECTRON_ANTI;
+      for (Table *other : others) {
+        REQUIRE(other->HasEmissionSampling());
+        for (const Real u : {0.1, 0.5, 0.9}) {
+          REQUIRE(FractionalDifference(
+                      other->SampleEmissionEnergy(rho, temps[1], Ye, type, u),
+                      loaded.SampleEmissionEnergy(rho, temps[1], Ye, type,
+                                                  u)) < 1e-12);
+        }
+        other->Finalize();
+      }
+      loaded.Finalize();
+      unlink(tablename.c_str());
+#ifdef SINGULARITY_USE_MMAP
+      unlink(rawname.c_str());
+#endif
+    }
+#endif
+
+    sampler.Finalize();
+    table.Finalize();
+  }
+}
@@ -0,0 +1,347 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+#include <cmath>
+#include <iostream>
+
+#include <catch2/catch.hpp>
+
+#include <ports-of-call/portability.hpp>
+#include <ports-of-call/portable_arrays.hpp>
+
+#include <singularity-opac/base/radiation_types.hpp>
+#include <singularity-opac/constants/constants.hpp>
+#include <singularity-opac/neutrinos/opac_neutrinos.hpp>
+#include <singularity-opac/photons/opac_photons.hpp>
+
+using namespace singularity;
+
+using pc = PhysicalConstantsCGS;
+
+#ifdef PORTABILITY_STRATEGY_KOKKOS
+using atomic_view = Kokkos::MemoryTraits<Kokkos::Atomic>;
+#endif
+
+template <typename T>
+PORTABLE_INLINE_FUNCTION T FractionalDifference(const T &a, const T &b) {
+  return 2 * std::abs(b - a) / (std::abs(a) + std::abs(b) + 1e-20);
+}
+constexpr Real EPS_TEST = 1e-10;
+
+TEST_CASE("Sums of neutrino opacities", "[SumNeutrinos]") {
+  WHEN("We sum BRT, gray and tophat neutrino opacities") {
+    constexpr Real MeV2K = 1e6 * pc::eV / pc::kb;
+    constexpr Real MeV2Hz = 1e6 * pc::eV / pc::h;
+    constexpr Real rho = 1e11;        // g/cc
+    constexpr Real temp = 10 * MeV2K; // 10 MeV
+    constexpr Real Ye = 0.1;
+    constexpr RadiationType type = RadiationType::NU_ELECTRON;
+    constexpr int nbins = 9;
+    constexpr Real lnuMin = std::log10(0.1 * MeV2Hz);
+    constexpr Real dlnu = 0.25;
+
+    using Dist = neutrinos::FermiDiracDistributionNoMu<3>;
+    using Sum = neutrinos::SumOpacity<Dist, neutrinos::BRTOpac,
+                                      neutrinos::Gray, neutrinos::Tophat>;
+    const neutrinos::BRTOpac brt = neutrinos::BRTOpac();
+    const neutrinos::Gray gray(1e-19);
+    const neutrinos::Tophat tophat(1e-2, 0.5 * MeV2Hz, 2 * MeV2Hz);
+    Sum sum_host(brt, gray, tophat);
+    neutrinos::Monomorphic<Sum> sum = sum_host.GetOnDevice();
+    neutrinos::Opacity brt_d = neutrinos::BRTOpac(brt).GetOnDevice();
+    neutrinos::Opacity gray_d = neutrinos::Gray(gray).GetOnDevice();
+    neutrinos::Opacity tophat_d = neutrinos::Tophat(tophat).GetOnDevice();
+
+    THEN("Every query is the sum of the components") {
+      int n_wrong_h = 0;
+#ifdef PORTABILITY_STRATEGY_KOKKOS
+      Kokkos::View<int, atomic_view> n_wrong_d("wrong");
+#else
+      PortableMDArray<int> n_wrong_d(&n_wrong_h, 1);
+#endif
+
+      portableFor(
+          "sum of components", 0, nbins, PORTABLE_LAMBDA(const int &i) {
+            const Real nu = std::pow(10, lnuMin + i * dlnu);
+            const Real alpha =
+                brt_d.AbsorptionCoefficient(rho, temp, Ye, type, nu) +
+                gray_d.AbsorptionCoefficient(rho, temp, Ye, type, nu) +
+                tophat_d.AbsorptionCoefficient(rho, temp, Ye, type, nu);
+            const Real jnu =
+                brt_d.EmissivityPerNuOmega(rho, temp, Ye, type, nu) +
+                gray_d.EmissivityPerNuOmega(rho, temp, Ye, type, nu) +
+                tophat_d.EmissivityPerNuOmega(rho, temp, Ye, type, nu);
+            const Real J = brt_d.Emissivity(rho, temp, Ye, type) +
+                           gray_d.Emissivity(rho, temp, Ye, type) +
+                           tophat_d.Emissivity(rho, temp, Ye, type);
+            Real alpha_fused, jnu_fused;
+            sum.AbsorptionAndEmissivity(rho, temp, Ye, type, nu, alpha_fused,
+                                        jnu_fused);
+            const Real vals[] = {
+                sum.AbsorptionCoefficient(rho, temp, Ye, type, nu),
+                sum.EmissivityPerNuOmega(rho, temp, Ye, type, nu),
+                sum.EmissivityPerNu(rho, temp, Ye, type, nu) / (4 * M_PI),
+                alpha_fused,
+                jnu_fused,
+                sum.Emissivity(rho, temp, Ye, type)};
+            const Real refs[] = {alpha, jnu, jnu, alpha, jnu, J};
+            for (int k = 0; k < 6; ++k) {
+              if (FractionalDifference(vals[k], refs[k]) > EPS_TEST) {
+                n_wrong_d() += 1;
+              }
+            }
+          });
+#ifdef PORTABILITY_STRATEGY_KOKKOS
+      Kokkos::deep_copy(n_wrong_h, n_wrong_d);
+#endif
+      REQUIRE(n_wrong_h == 0);
+    }
+
+    THEN("The batched forms agree with the scalar forms") {
+      int n_wrong_h = 0;
+#ifdef PORTABILITY_STRATEGY_KOKKOS
+      Kokkos::View<int, atomic_view> n_wrong_d("wrong");
+#else
+      PortableMDArray<int> n_wrong_d(&n_wrong_h, 1);
+#endif
+
+      portableFor(
+          "batched sums", 0, 1, PORTABLE_LAMBDA(const int &i) {
+            Real nu_bins[nbins];
+            Real alpha[nbins];
+            Real jnu[nbins];
+            for (int b = 0; b < nbins; ++b) {
+              nu_bins[b] = std::pow(10, lnuMin + b * dlnu);
+            }
+            LookupState s = sum.PrepareLookup(rho, temp, Ye);
+            sum.AbsorptionAndEmissivity(s, type, nu_bins, alpha, jnu, nbins);
+            for (int b = 0; b < nbins; ++b) {
+              Real a, j;
+              sum.AbsorptionAndEmissivity(rho, temp, Ye, type, nu_bins[b], a,
+                                          j);
+              if (FractionalDifference(a, alpha[b]) > EPS_TEST ||
+                  FractionalDifference(j, jnu[b]) > EPS_TEST) {
+                n_wrong_d() += 1;
+              }
+            }
+          });
+#ifdef PORTABILITY_STRATEGY_KOKKOS
+      Kokkos::deep_copy(n_wrong_h, n_wrong_d);
+#endif
+      REQUIRE(n_wrong_h == 0);
+    }
+
+    WHEN("We put the sum in non-cgs units") {
+      constexpr Real time_unit = 123;
+      constexpr Real mass_unit = 456;
+      constexpr Real length_unit = 789;
+      constexpr Real temp_unit = 276;
+      constexpr Real rho_unit =
+          mass_unit / (length_unit * length_unit * length_unit);
+      constexpr Real j_unit = mass_unit / (length_unit * time_unit * time_unit);
+      neutrinos::Monomorphic<neutrinos::NonCGSUnits<Sum>> funny_units_host =
+          neutrinos::NonCGSUnits<Sum>(Sum(sum_host), time_unit, mass_unit,
+                                      length_unit, temp_unit);
+      auto funny_units = funny_units_host.GetOnDevice();
+
+      THEN("We can convert meaningfully into and out of funny units") {
+        int n_wrong_h = 0;
+#ifdef PORTABILITY_STRATEGY_KOKKOS
+        Kokkos::View<int, atomic_view> n_wrong_d("wrong");
+#else
+        PortableMDArray<int> n_wrong_d(&n_wrong_h, 1);
+#endif
+
+        portableFor(
+            "sums in funny units", 0, nbins, PORTABLE_LAMBDA(const int &i) {
+              const Real nu = std::pow(10, lnuMin + i * dlnu);
+              Real alpha_funny, jnu_funny;
+              funny_units.AbsorptionAndEmissivity(
+                  rho / rho_unit, temp / temp_unit, Ye, type, nu * time_unit,
+                  alpha_funny, jnu_funny);
+              Real alpha, jnu;
+              sum.AbsorptionAndEmissivity(rho, temp, Ye, type, nu, alpha, jnu);
+              if (FractionalDifference(alpha, alpha_funny / length_unit) >
+                  1e-8) {
+                n_wrong_d() += 1;
+              }
+              if (FractionalDifference(jnu, jnu_funny * j_unit) > 1e-8) {
+                n_wrong_d() += 1;
+              }
+            });
+#ifdef PORTABILITY_STRATEGY_KOKKOS
+        Kokkos::deep_copy(n_wrong_h, n_wrong_d);
+#endif
+        REQUIRE(n_wrong_h == 0);
+      }
+    }
+
+    THEN("A mean opacity of a sum of gray opacities is the gray mean") {
+      constexpr Real kappa = 1e-20;
+      constexpr Real lRhoMin = std::log10(0.1 * rho);
+      constexpr Real lRhoMax = std::log10(10. * rho);
+      constexpr int NRho = 2;
+      constexpr Real lTMin = std::log10(0.1 * temp);
+      constexpr Real lTMax = std::log10(10. * temp);
+      constexpr int NT = 4;
+      constexpr Real YeMin = 0.1;
+      constexpr Real YeMax = 0.5;
+      constexpr int NYe = 2;
+      using GraySum = neutrinos::SumOpacity<Dist, neutrinos::Gray,
+                                            neutrinos::Gray>;
+      neutrinos::MeanOpacityCGS mean_sum(
+          GraySum(neutrinos::Gray(kappa), neutrinos::Gray(2 * kappa)),
+          lRhoMin, lRhoMax, NRho, lTMin, lTMax, NT, YeMin, YeMax, NYe);
+      neutrinos::MeanOpacityCGS mean_gray(neutrinos::Gray(3 * kappa), lRhoMin,
+                                          lRhoMax, NRho, lTMin, lTMax, NT,
+                                          YeMin, YeMax, NYe);
+      REQUIRE(FractionalDifference(
+                  mean_sum.PlanckMeanAbsorptionCoefficient(rho, temp, Ye, type),
+                  mean_gray.PlanckMeanAbsorptionCoefficient(rho, temp, Ye,
+                                                            type)) < 1e-8);
+      REQUIRE(FractionalDifference(
+                  mean_sum.RosselandMeanAbsorptionCoefficient(rho, temp, Ye,
+                                                              type),
+                  mean_gray.RosselandMeanAbsorptionCoefficient(rho, temp, Ye,
+                                                               type)) < 1e-8);
+      mean_sum.Finalize();
+      mean_gray.Finalize();
+    }
+  }
+}
+
+TEST_CASE("Sums of photon opacities", "[SumPhotons]") {
+  WHEN("We sum bremsstrahlung and gray photon opacities") {
+    constexpr Real rho = 1e-2;  // g/cc
+    constexpr Real temp = 1e5;  // K
+    constexpr int nbins = 9;
+    constexpr Real lnuMin = 13; // Hz
+    constexpr Real dlnu = 0.5;
+
+    using Sum = photons::SumOpacity<pc, photons::EPBremss, photons::Gray>;
+    const photons::EPBremss brems = photons::EPBremss();
+    const photons::Gray gray(1e-2);
+    Sum sum_host(brems, gray);
+    photons::Monomorphic<Sum> sum = sum_host.GetOnDevice();
+    photons::Opacity brems_d = photons::EPBremss(brems).GetOnDevice();
+    photons::Opacity gray_d = photons::Gray(gray).GetOnDevice();
+
+    THEN("Every query is the sum of the components") {
+      int n_wrong_h = 0;
+#ifdef PORTABILITY_STRATEGY_KOKKOS
+      Kokkos::View<int, atomic_view> n_wrong_d("wrong");
+#else
+      PortableMDArray<int> n_wrong_d(&n_wrong_h, 1);
+#endif
+
+      portableFor(
+          "sum of components", 0, nbins, PORTABLE_LAMBDA(const int &i) {
+            const Real nu = std::pow(10, lnuMin + i * dlnu);
+            const Real vals[] = {
+                sum.AbsorptionCoefficient(rho, temp, nu),
+                sum.AngleAveragedAbsorptionCoefficient(rho, temp, nu),
+                sum.EmissivityPerNuOmega(rho, temp, nu),
+                sum.EmissivityPerNu(rho, temp, nu),
+                sum.Emissivity(rho, temp),
+                sum.NumberEmissivity(rho, temp)};
+            const Real refs[] = {
+                brems_d.AbsorptionCoefficient(rho, temp, nu) +
+                    gray_d.AbsorptionCoefficient(rho, temp, nu),
+                brems_d.AngleAveragedAbsorptionCoefficient(rho, temp, nu) +
+                    gray_d.AngleAveragedAbsorptionCoefficient(rho, temp, nu),
+                brems_d.EmissivityPerNuOmega(rho, temp, nu) +
+                    gray_d.EmissivityPerNuOmega(rho, temp, nu),
+                brems_d.EmissivityPerNu(rho, temp, nu) +
+                    gray_d.EmissivityPerNu(rho, temp, nu),
+                brems_d.Emissivity(rho, temp) + gray_d.Emissivity(rho, temp),
+                brems_d.NumberEmissivity(rho, temp) +
+                    gray_d.NumberEmissivity(rho, temp)};
+            for (int k = 0; k < 6; ++k) {
+              if (FractionalDifference(vals[k], refs[k]) > EPS_TEST) {
+                n_wrong_d() += 1;
+              }
+            }
+          });
+#ifdef PORTABILITY_STRATEGY_KOKKOS
+      Kokkos::deep_copy(n_wrong_h, n_wrong_d);
+#endif
+      REQUIRE(n_wrong_h == 0);
+    }
+
+    WHEN("We put the sum in non-cgs units") {
+      constexpr Real time_unit = 123;
+      constexpr Real mass_unit = 456;
+      constexpr Real length_unit = 789;
+      constexpr Real temp_unit = 276;
+      constexpr Real rho_unit =
+          mass_unit / (length_unit * length_unit * length_unit);
+      photons::Monomorphic<photons::NonCGSUnits<Sum>> funny_units_host =
+          photons::NonCGSUnits<Sum>(Sum(sum_host), time_unit, mass_unit,
+                                    length_unit, temp_unit);
+      auto funny_units = funny_units_host.GetOnDevice();
+
+      THEN("The absorption coefficient converts meaningfully") {
+        int n_wrong_h = 0;
+#ifdef PORTABILITY_STRATEGY_KOKKOS
+        Kokkos::View<int, atomic_view> n_wrong_d("wrong");
+#else
+        PortableMDArray<int> n_wrong_d(&n_wrong_h, 1);
+#endif
+
+        portableFor(
+            "sums in funny units", 0, nbins, PORTABLE_LAMBDA(const int &i) {
+              const Real nu = std::pow(10, lnuMin + i * dlnu);
+              const Real alpha_funny = funny_units.AbsorptionCoefficient(
+                  rho / rho_unit, temp / temp_unit, nu * time_unit);
+              const Real alpha = sum.AbsorptionCoefficient(rho, temp, nu);
+              if (FractionalDifference(alpha, alpha_funny / length_unit) >
+                  1e-8) {
+                n_wrong_d() += 1;
+              }
+            });
+#ifdef PORTABILITY_STRATEGY_KOKKOS
+        Kokkos::deep_copy(n_wrong_h, n_wrong_d);
+#endif
+        REQUIRE(n_wrong_h == 0);
+      }
+    }
+
+    THEN("A mean opacity of a sum of gray opacities is the gray mean") {
+      constexpr Real kappa = 1e-2;
+      constexpr Real lRhoMin = std::log10(0.1 * rho);
+      constexpr Real lRhoMax = std::log10(10. * rho);
+      constexpr int NRho = 2;
+      constexpr Real lTMin = std::log10(0.1 * temp);
+      constexpr Real lTMax = std::log10(10. * temp);
+      constexpr int NT = 4;
+      using GraySum = photons::SumOpacity<pc, photons::Gray, photons::Gray>;
+      photons::MeanOpacityCGS mean_sum(
+          GraySum(photons::Gray(kappa), photons::Gray(2 * kappa)), lRhoMin,
+          lRhoMax, NRho, lTMin, lTMax, NT);
+      photons::MeanOpacityCGS mean_gray(photons::Gray(3 * kappa), lRhoMin,
+                                        lRhoMax, NRho, lTMin, lTMax, NT);
+      REQUIRE(FractionalDifference(
+                  mean_sum.PlanckMeanAbsorptionCoefficient(rho, temp),
+                  mean_gray.PlanckMeanAbsorptionCoefficient(rho, temp)) <
+              1e-8);
+      REQUIRE(FractionalDifference(
+                  mean_sum.RosselandMeanAbsorptionCoefficient(rho, temp),
+                  mean_gray.RosselandMeanAbsorptionCoefficient(rho, temp)) <
+              1e-8);
+      mean_sum.Finalize();
+      mean_gray.Finalize();
+    }
+  }
+}
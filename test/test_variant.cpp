@@ -17,14 +17,24 @@
  * Variants are finicky things. If a method is missing in any class
  * the variant contains, that method will be deleted from the entire
  * variant. This test checks that default constructors and assignment
- * operators are available for the photon and neutrino variants.
+ * operators are available for the photon and neutrino variants, that
+ * their bulk forms agree with the pointwise ones, and that switch
+ * dispatch picks the alternative the variant holds.
  */
 
+#include <cmath>
+#include <type_traits>
+
 #include <catch2/catch.hpp>
 
 #include <ports-of-call/portability.hpp>
+#include <variant/include/mpark/variant.hpp>
 
+#include <singularity-opac/base/opac_variant.hpp>
+#include <singularity-opac/base/radiation_types.hpp>
+#include <singularity-opac/constants/constants.hpp>
 #include <singularity-opac/neutrinos/opac_neutrinos.hpp>
+#include <singularity-opac/neutrinos/s_opac_neutrinos.hpp>
 #include <singularity-opac/photons/opac_photons.hpp>
 
 using namespace singularity;
@@ -58,3 +68,215 @@ TEST_CASE("Constructor and assignment for photons", "[Photons][Variant]") {
     }
   }
 }
+
+PORTABLE_INLINE_FUNCTION int Differs(const Real a, const Real b) {
+  return std::abs(a - b) > 1e-12 * (std::abs(a) + std::abs(b));
+}
+
+TEST_CASE("Monomorphic opacities", "[Neutrinos][Photons][Variant]") {
+  using pc = PhysicalConstantsCGS;
+  constexpr Real MeV2K = 1e6 * pc::eV / pc::kb;
+  constexpr Real MeV2Hz = 1e6 * pc::eV / pc::h;
+  using NModel = neutrinos::NonCGSUnits<neutrinos::Gray>;
+  using NMono = neutrinos::Monomorphic<NModel>;
+  using PMono = photons::Monomorphic<photons::Gray>;
+
+  WHEN("We hold a single model without a variant") {
+    NMono mono_host = NModel(neutrinos::Gray(1), 123, 456, 789, 276);
+    NOpac opac_host = NModel(neutrinos::Gray(1), 123, 456, 789, 276);
+    NMono mono = mono_host.GetOnDevice();
+    NOpac opac = opac_host.GetOnDevice();
+    PMono pmono = photons::Gray(1);
+    POpac popac = photons::Gray(1);
+
+    THEN("It takes no more space than the model") {
+      REQUIRE(sizeof(NMono) == sizeof(NModel));
+      REQUIRE(sizeof(PMono) == sizeof(photons::Gray));
+      REQUIRE(mono.IsType<NModel>());
+      REQUIRE(!mono.IsType<neutrinos::Gray>());
+    }
+
+    THEN("It agrees with the full variant") {
+      int n_wrong = 0;
+      portableReduce(
+          "monomorphic", 0, 100,
+          PORTABLE_LAMBDA(const int &i, int &nw) {
+            const Real rho = std::pow(10, 8 + 0.05 * i);
+            const Real temp = (0.5 + 0.2 * i) * MeV2K;
+            const Real Ye = 0.1 + 0.003 * i;
+            const Real nu = (1 + 0.3 * i) * MeV2Hz;
+            const RadiationType type = Idx2RadType(i % NEUTRINO_NTYPES);
+            nw += Differs(mono.AbsorptionCoefficient(rho, temp, Ye, type, nu),
+                          opac.AbsorptionCoefficient(rho, temp, Ye, type, nu));
+            nw += Differs(mono.EmissivityPerNu(rho, temp, Ye, type, nu),
+                          opac.EmissivityPerNu(rho, temp, Ye, type, nu));
+            nw += Differs(mono.Emissivity(rho, temp, Ye, type),
+                          opac.Emissivity(rho, temp, Ye, type));
+            nw += Differs(pmono.AbsorptionCoefficient(rho, temp, nu),
+                          popac.AbsorptionCoefficient(rho, temp, nu));
+          },
+          n_wrong);
+      REQUIRE(n_wrong == 0);
+    }
+
+    mono.Finalize();
+    opac.Finalize();
+  }
+}
+
+TEST_CASE("Bulk evaluation over zones", "[Neutrinos][Photons][Variant]") {
+  using pc = PhysicalConstantsCGS;
+  constexpr Real MeV2K = 1e6 * pc::eV / pc::kb;
+  constexpr Real MeV2Hz = 1e6 * pc::eV / pc::h;
+  constexpr int nzones = 50;
+  constexpr int nbins = 8;
+
+  Real *rho = (Real *)PORTABLE_MALLOC(nzones * sizeof(Real));
+  Real *temp = (Real *)PORTABLE_MALLOC(nzones * sizeof(Real));
+  Real *Ye = (Real *)PORTABLE_MALLOC(nzones * sizeof(Real));
+  RadiationType *types =
+      (RadiationType *)PORTABLE_MALLOC(nzones * sizeof(RadiationType));
+  Real *nu_bins = (Real *)PORTABLE_MALLOC(nbins * sizeof(Real));
+  Real *coeffs = (Real *)PORTABLE_MALLOC(nzones * nbins * sizeof(Real));
+  Real *values = (Real *)PORTABLE_MALLOC(nzones * sizeof(Real));
+  portableFor(
+      "set zones", 0, nzones, PORTABLE_LAMBDA(const int &z) {
+        rho[z] = std::pow(10, 8 + 6 * z / Real(nzones));
+        temp[z] = (0.5 + z) * MeV2K;
+        Ye[z] = 0.05 + 0.4 * z / Real(nzones);
+        types[z] = Idx2RadType(z % NEUTRINO_NTYPES);
+      });
+  portableFor(
+      "set nu bins", 0, nbins, PORTABLE_LAMBDA(const int &i) {
+        nu_bins[i] = std::pow(2, i) * MeV2Hz;
+      });
+
+  WHEN("We evaluate a neutrino opacity in non-cgs units over the zones") {
+    NOpac opac_host = neutrinos::NonCGSUnits<neutrinos::Gray>(
+        neutrinos::Gray(1), 123, 456, 789, 276);
+    NOpac opac = opac_host.GetOnDevice();
+    neutrinos::SOpacity s_opac_host = neutrinos::GrayS(1, 1);
+    neutrinos::SOpacity s_opac = s_opac_host.GetOnDevice();
+
+    THEN("The bulk forms agree with the pointwise ones") {
+      int n_wrong = 0;
+      opac.BulkAbsorptionCoefficient(nzones, rho, temp, Ye, types, nu_bins,
+                                     coeffs, nbins);
+      portableReduce(
+          "check absorption", 0, nzones * nbins,
+          PORTABLE_LAMBDA(const int &k, int &nw) {
+            const int z = k / nbins;
+            const int i = k % nbins;
+            nw += Differs(coeffs[k],
+                          opac.AbsorptionCoefficient(rho[z], temp[z], Ye[z],
+                                                     types[z], nu_bins[i]));
+          },
+          n_wrong);
+      opac.BulkEmissivityPerNu(nzones, rho, temp, Ye, types, nu_bins, coeffs,
+                               nbins, 2);
+      portableReduce(
+          "check emissivity per nu", 0, nzones * nbins,
+          PORTABLE_LAMBDA(const int &k, int &nw) {
+            const int z = k / nbins;
+            const int i = k % nbins;
+            nw += Differs(coeffs[k],
+                          opac.EmissivityPerNu(rho[z], temp[z], Ye[z], types[z],
+                                               nu_bins[i]));
+          },
+          n_wrong);
+      s_opac.BulkTotalScatteringCoefficient(nzones, rho, temp, Ye, types,
+                                            nu_bins, coeffs, nbins);
+      portableReduce(
+          "check scattering", 0, nzones * nbins,
+          PORTABLE_LAMBDA(const int &k, int &nw) {
+            const int z = k / nbins;
+            const int i = k % nbins;
+            nw += Differs(coeffs[k],
+                          s_opac.TotalScatteringCoefficient(
+                              rho[z], temp[z], Ye[z], types[z], nu_bins[i]));
+          },
+          n_wrong);
+      opac.BulkEmissivity(nzones, rho, temp, Ye, types, values);
+      portableReduce(
+          "check emissivity", 0, nzones,
+          PORTABLE_LAMBDA(const int &z, int &nw) {
+            nw += Differs(values[z],
+                          opac.Emissivity(rho[z], temp[z], Ye[z], types[z]));
+          },
+          n_wrong);
+      opac.BulkNumberEmissivity(nzones, rho, temp, Ye, types, values);
+      portableReduce(
+          "check number emissivity", 0, nzones,
+          PORTABLE_LAMBDA(const int &z, int &nw) {
+            nw += Differs(values[z], opac.NumberEmissivity(rho[z], temp[z],
+                                                           Ye[z], types[z]));
+          },
+          n_wrong);
+      portableReduce(
+          "check nu bins", 0, nbins,
+          PORTABLE_LAMBDA(const int &i, int &nw) {
+            nw += Differs(nu_bins[i], std::pow(2, i) * MeV2Hz);
+          },
+          n_wrong);
+      REQUIRE(n_wrong == 0);
+    }
+
+    opac.Finalize();
+    s_opac.Finalize();
+  }
+
+  WHEN("We evaluate a photon opacity over the zones") {
+    POpac opac_host = photons::Gray(1);
+    POpac opac = opac_host.GetOnDevice();
+
+    THEN("The bulk forms agree with the pointwise ones") {
+      int n_wrong = 0;
+      opac.BulkAbsorptionCoefficient(nzones, rho, temp, nu_bins, coeffs, nbins);
+      portableReduce(
+          "check absorption", 0, nzones * nbins,
+          PORTABLE_LAMBDA(const int &k, int &nw) {
+            const int z = k / nbins;
+            const int i = k % nbins;
+            nw += Differs(coeffs[k],
+                          opac.AbsorptionCoefficient(rho[z], temp[z],
+                                                     nu_bins[i]));
+          },
+          n_wrong);
+      opac.BulkEmissivity(nzones, rho, temp, values, 0);
+      portableReduce(
+          "check emissivity", 0, nzones,
+          PORTABLE_LAMBDA(const int &z, int &nw) {
+            nw += Differs(values[z], opac.Emissivity(rho[z], temp[z]));
+          },
+          n_wrong);
+      REQUIRE(n_wrong == 0);
+    }
+
+    opac.Finalize();
+  }
+
+  PORTABLE_FREE(rho);
+  PORTABLE_FREE(temp);
+  PORTABLE_FREE(Ye);
+  PORTABLE_FREE(types);
+  PORTABLE_FREE(nu_bins);
+  PORTABLE_FREE(coeffs);
+  PORTABLE_FREE(values);
+}
+
+template <int K>
+using Tag = std::integral_constant<int, K>;
+
+TEST_CASE("Switch dispatch of variants", "[Variant]") {
+  // More alternatives than one switch block holds
+  using Tags = mpark::variant<Tag<0>, Tag<1>, Tag<2>, Tag<3>, Tag<4>, Tag<5>,
+                              Tag<6>, Tag<7>, Tag<8>, Tag<9>, Tag<10>>;
+  const Tags tags[] = {Tag<0>(), Tag<1>(), Tag<2>(), Tag<3>(),
+                       Tag<4>(), Tag<5>(), Tag<6>(), Tag<7>(),
+                       Tag<8>(), Tag<9>(), Tag<10>()};
+  auto value = [](const auto &tag) { return tag.value; };
+  for (int k = 0; k < 11; ++k) {
+    REQUIRE(singularity::impl::switchVisit(value, tags[k]) == k);
+    REQUIRE(mpark::visit(value, tags[k]) == k);
+  }
+}
@@ -0,0 +1,140 @@
+// ======================================================================
+// © 2021. Triad National Security, LLC. All rights reserved.  This
+// program was produced under U.S. Government contract
+// 89233218CNA000001 for Los Alamos National Laboratory (LANL), which
+// is operated by Triad National Security, LLC for the U.S.
+// Department of Energy/National Nuclear Security Administration. All
+// rights in the program are reserved by Triad National Security, LLC,
+// and the U.S. Department of Energy/National Nuclear Security
+// Administration. The Government is granted for itself and others
+// acting on its behalf a nonexclusive, paid-up, irrevocable worldwide
+// license in this material to reproduce, prepare derivative works,
+// distribute copies to the public, perform publicly and display
+// publicly, and to permit others to do so.
+// ======================================================================
+
+// Converts the tables in an sp5 file to 16-bit quantized storage.
+//
+// Usage: sp5_quantize input.sp5 output.sp5
+//
+// Every root group holding a DataBox is quantized in blocks of
+// QUANTIZED_BLOCK values. Other objects and the root attributes are
+// copied unchanged. For each table the worst-case error is reported,
+// both in the stored log and as the relative error it implies in the
+// opacity. The output can be loaded at any TablePrecision.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <hdf5.h>
+#include <hdf5_hl.h>
+
+#include <spiner/databox.hpp>
+#include <spiner/sp5.hpp>
+
+#include <singularity-opac/base/table_storage.hpp>
+
+using namespace singularity::impl;
+
+struct Totals {
+  hid_t out;
+  Real base;
+  double before = 0;
+  double after = 0;
+  int errors = 0;
+};
+
+herr_t CopyAttribute(hid_t loc, const char *name, const H5A_info_t *,
+                     void *data) {
+  const hid_t out = *static_cast<hid_t *>(data);
+  hid_t attr = H5Aopen(loc, name, H5P_DEFAULT);
+  hid_t type = H5Aget_type(attr);
+  hid_t space = H5Aget_space(attr);
+  herr_t status = 0;
+  if (H5Tis_variable_str(type) > 0) {
+    std::fprintf(stderr, "Skipping variable length attribute %s\n", name);
+  } else {
+    const hssize_t n = H5Sget_simple_extent_npoints(space);
+    std::vector<char> buffer(H5Tget_size(type) * n);
+    status += H5Aread(attr, type, buffer.data());
+    hid_t copy = H5Acreate(out, name, type, space, H5P_DEFAULT, H5P_DEFAULT);
+    status += H5Awrite(copy, type, buffer.data());
+    status += H5Aclose(copy);
+  }
+  status += H5Sclose(space);
+  status += H5Tclose(type);
+  status += H5Aclose(attr);
+  return status;
+}
+
+herr_t ConvertObject(hid_t loc, const char *name, const H5L_info_t *,
+                     void *data) {
+  Totals &totals = *static_cast<Totals *>(data);
+  const std::string path = std::string(name) + "/" + SP5::DB::DSETNAME;
+  if (H5Lexists(loc, path.c_str(), H5P_DEFAULT) <= 0) {
+    std::printf("%-40s copied\n", name);
+    return H5Ocopy(loc, name, totals.out, name, H5P_DEFAULT, H5P_DEFAULT);
+  }
+  Spiner::DataBox db;
+  herr_t status = db.loadHDF(loc, name);
+  Real error;
+  status += saveHDFQuantized(totals.out, name, db, error);
+  if (status != H5_SUCCESS) {
+    std::fprintf(stderr, "HDF5 error converting %s\n", name);
+    totals.errors++;
+    return 0;
+  }
+  const std::size_t n = db.size();
+  const std::size_t nblocks = QuantizedStorage::stride(n) / QUANTIZED_BLOCK;
+  totals.before += n * sizeof(Real);
+  totals.after +=
+      n * sizeof(std::uint16_t) + (2 * nblocks + 1) * sizeof(float);
+  std::printf("%-40s %12zu %14.3e %14.3e\n", name, n, error,
+              std::pow(totals.base, error) - 1);
+  db.finalize();
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 3) {
+    std::fprintf(stderr, "Usage: %s input.sp5 output.sp5\n", argv[0]);
+    return 1;
+  }
+  hid_t in = H5Fopen(argv[1], H5F_ACC_RDONLY, H5P_DEFAULT);
+  if (in < 0) {
+    std::fprintf(stderr, "Could not open %s\n", argv[1]);
+    return 1;
+  }
+  hid_t out = H5Fcreate(argv[2], H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+  if (out < 0) {
+    std::fprintf(stderr, "Could not create %s\n", argv[2]);
+    H5Fclose(in);
+    return 1;
+  }
+
+  Totals totals;
+  totals.out = out;
+  totals.base = static_cast<Real>(static_cast<int>(loadEncoding(in)));
+  herr_t status = H5Aiterate2(in, H5_INDEX_NAME, H5_ITER_INC, nullptr,
+                              CopyAttribute, &out);
+
+  std::printf("%-40s %12s %14s %14s\n", "dataset", "values", "max log err",
+              "max rel err");
+  status += H5Literate(in, H5_INDEX_NAME, H5_ITER_INC, nullptr, ConvertObject,
+                       &totals);
+  status += H5Fclose(out);
+  status += H5Fclose(in);
+  if (totals.before > 0) {
+    constexpr double MB = 1024. * 1024.;
+    std::printf("Tables: %.2f MB before, %.2f MB after\n", totals.before / MB,
+                totals.after / MB);
+  }
+  if (status != H5_SUCCESS || totals.errors > 0) {
+    std::fprintf(stderr, "Conversion failed\n");
+    return 1;
+  }
+  return 0;
+}
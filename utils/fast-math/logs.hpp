@@ -1,5 +1,6 @@
 //======================================================================
-// approximate log10, approximately 5x faster than std::log10
+// approximate log10, approximately 5x faster than std::log10, and
+// branch-free double precision log10, exp10, log2, and exp2
 // Author: Jonah Miller (jonahm@lanl.gov)
 
 // © 2021. Triad National Security, LLC. All rights reserved.  This
@@ -20,6 +21,8 @@
 #define _FAST_MATH_LOGS_
 
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <ports-of-call/portability.hpp>
 
 // herumi-fmath does not work on device
@@ -45,6 +48,163 @@ float log10(const float x) {
 #endif
 }
 
+namespace impl {
+PORTABLE_INLINE_FUNCTION
+std::uint64_t as_bits(const double x) {
+  std::uint64_t i;
+  std::memcpy(&i, &x, sizeof(i));
+  return i;
+}
+PORTABLE_INLINE_FUNCTION
+double from_bits(const std::uint64_t i) {
+  double x;
+  std::memcpy(&x, &i, sizeof(x));
+  return x;
+}
+// 2^n for -1022 <= n <= 1023
+PORTABLE_INLINE_FUNCTION
+double exp2i(const std::int64_t n) {
+  return from_bits(static_cast<std::uint64_t>(n + 1023) << 52);
+}
+// log10(2) = LOG10_2_HI + LOG10_2_LO, where LOG10_2_HI has 32
+// significant bits, so that n * LOG10_2_HI is exact for |n| < 2^21.
+constexpr double LOG10_2_HI = 0.3010299955494702;
+constexpr double LOG10_2_LO = 1.1451100898021838e-10;
+
+// Splits positive x into 2^e m, with sqrt(1/2) <= m < sqrt(2), and
+// returns log(m). Subnormals are handled; x = 0 gives e = -1077.
+PORTABLE_INLINE_FUNCTION
+double log_split(const double x, double &e) {
+  constexpr double SQRT2 = 1.4142135623730951;
+  constexpr double DBL_MIN_NORMAL = 2.2250738585072014e-308;
+  constexpr double TWO54 = 18014398509481984.0;
+  // Scale subnormals into the normal range. Selects between
+  // constants, rather than branches, keep the loops vectorizable.
+  const bool subnormal = x < DBL_MIN_NORMAL;
+  const double xs = x * (subnormal ? TWO54 : 1.);
+  const std::uint64_t bits = as_bits(xs);
+  const double m1 =
+      from_bits((bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL);
+  const bool big = m1 > SQRT2;
+  const double m = m1 * (big ? 0.5 : 1.);
+  e = static_cast<double>(static_cast<int>(bits >> 52) - 1023) +
+      ((big ? 1. : 0.) - (subnormal ? 54. : 0.));
+  // log(m) = 2 atanh(s), with |s| <= 0.172, so the truncation error
+  // of the series below is below 1e-17
+  const double s = (m - 1.) / (m + 1.);
+  const double s2 = s * s;
+  double p = 1. / 21.;
+  p = p * s2 + 1. / 19.;
+  p = p * s2 + 1. / 17.;
+  p = p * s2 + 1. / 15.;
+  p = p * s2 + 1. / 13.;
+  p = p * s2 + 1. / 11.;
+  p = p * s2 + 1. / 9.;
+  p = p * s2 + 1. / 7.;
+  p = p * s2 + 1. / 5.;
+  p = p * s2 + 1. / 3.;
+  return 2. * s + 2. * s * s2 * p;
+}
+
+// exp(y) for |y| <= 0.347, where the Taylor series below is
+// truncated with an error below 1e-17.
+PORTABLE_INLINE_FUNCTION
+double exp_reduced(const double y) {
+  double p = 1. / 6227020800.;
+  p = p * y + 1. / 479001600.;
+  p = p * y + 1. / 39916800.;
+  p = p * y + 1. / 3628800.;
+  p = p * y + 1. / 362880.;
+  p = p * y + 1. / 40320.;
+  p = p * y + 1. / 5040.;
+  p = p * y + 1. / 720.;
+  p = p * y + 1. / 120.;
+  p = p * y + 1. / 24.;
+  p = p * y + 1. / 6.;
+  p = p * y + 0.5;
+  p = p * y + 1.;
+  return p * y + 1.;
+}
+
+// Adding SHIFT to |x| < 2^51 rounds it to an integer held in the low
+// mantissa bits, which avoids a float to int conversion that doesn't
+// vectorize on all targets
+constexpr double SHIFT = 6755399441055744.0; // 1.5 * 2^52
+PORTABLE_INLINE_FUNCTION
+std::int64_t shifted_int(const double kd) {
+  return static_cast<std::int64_t>(as_bits(kd)) -
+         static_cast<std::int64_t>(as_bits(SHIFT));
+}
+
+// p 2^n, for |n| <= 1100. Scales in two steps, so that both factors
+// are normal even when the result is not.
+PORTABLE_INLINE_FUNCTION
+double scale2(const double p, const std::int64_t n) {
+  const std::int64_t n1 = n >> 1;
+  return p * exp2i(n1) * exp2i(n - n1);
+}
+} // namespace impl
+
+// Double precision log10. Branch free, so loops over it vectorize.
+//
+// For positive, finite x, including subnormals, the error is below
+// 2e-16 * max(1, |log10(x)|), i.e., within a couple ulp of the
+// correctly rounded result. x = 0 returns about -324.2, the log of
+// the smallest subnormal. Negative x and NaN return garbage.
+PORTABLE_INLINE_FUNCTION
+double log10(const double x) {
+  constexpr double ILOG10 = 0.4342944819032518;
+  double e;
+  const double logm = impl::log_split(x, e);
+  return e * impl::LOG10_2_HI + (e * impl::LOG10_2_LO + logm * ILOG10);
+}
+
+// Double precision 10^x. Branch free, so loops over it vectorize.
+//
+// The relative error is below 4e-16 wherever the result is a normal
+// number. Results overflow to infinity and underflow gradually to
+// zero as std::pow(10., x) does. NaN propagates.
+PORTABLE_INLINE_FUNCTION
+double exp10(const double x) {
+  constexpr double LOG2_10 = 3.321928094887362;
+  constexpr double LN10 = 2.302585092994046;
+  // Beyond these the result is already infinity or zero, and the
+  // clamp keeps the exponent arithmetic below in range
+  const double xc = x > 310. ? 310. : (x < -330. ? -330. : x);
+  // 10^x = 2^n 10^r, with |r| <= log10(2) / 2
+  const double kd = xc * LOG2_10 + impl::SHIFT;
+  const double n = kd - impl::SHIFT;
+  const double r = (xc - n * impl::LOG10_2_HI) - n * impl::LOG10_2_LO;
+  const double result =
+      impl::scale2(impl::exp_reduced(r * LN10), impl::shifted_int(kd));
+  return (x == x) ? result : x;
+}
+
+// Double precision log2, with the same domain as log10. The exponent
+// is exact, so the error is below 2e-16 * max(1, |log2(x)|).
+PORTABLE_INLINE_FUNCTION
+double log2(const double x) {
+  constexpr double ILOG2 = 1.4426950408889634;
+  double e;
+  const double logm = impl::log_split(x, e);
+  return e + logm * ILOG2;
+}
+
+// Double precision 2^x, with the same behavior as exp10. The range
+// reduction is exact, so the relative error is below 3e-16 for
+// normal results.
+PORTABLE_INLINE_FUNCTION
+double exp2(const double x) {
+  constexpr double LN2 = 0.6931471805599453;
+  const double xc = x > 1030. ? 1030. : (x < -1100. ? -1100. : x);
+  // 2^x = 2^n 2^r, with |r| <= 1/2
+  const double kd = xc + impl::SHIFT;
+  const double r = xc - (kd - impl::SHIFT);
+  const double result =
+      impl::scale2(impl::exp_reduced(r * LN2), impl::shifted_int(kd));
+  return (x == x) ? result : x;
+}
+
 } // namespace BDMath
 
 #undef BD_USE_FMATH